@@ -0,0 +1,143 @@
+/*****************************************************************************/
+/*	@file ecds_list_sort_benchmark.c									 	 */
+/*	@brief Cost of sorting lists compared to sorting arrays.				 */
+/*																			 */
+/*	Built with -DECDS_BUILD_BENCHMARKS=ON. Sorts the same shuffled objects	 */
+/*	with ecds_list_sort(), ecds_list_sort_parallel() and qsort() on an		 */
+/*	array of object pointers, and checks that all three agree. Keys repeat	 */
+/*	so that stability is checked too. Times are wall clock time, since		 */
+/*	the parallel sort runs on several threads.								 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ecds.h>
+#include <common/ecds_list.h>
+#include <core/ecds_object.h>
+
+#define ECDS_LOG_DOMAIN "ecds-list-sort-benchmark"
+
+#define ECDS_TYPE_BENCHMARK			0x0FFFFFF1
+
+#define BENCHMARK_DEFAULT_COUNT		1000000
+#define BENCHMARK_REPEATS			5
+
+typedef struct _benchmark_object_t benchmark_object_t;
+struct _benchmark_object_t {
+	ecds_object_t obj;
+	uint32_t key;
+	uint32_t sequence;				//!<	Position before sorting, to check stability
+};
+
+static uint64_t _benchmark_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool _benchmark_behind(ecds_object_t * a, ecds_object_t * b)
+{
+	return ((benchmark_object_t *)a)->key > ((benchmark_object_t *)b)->key;
+}
+
+static int _benchmark_compare(const void * a, const void * b)
+{
+	const benchmark_object_t * object_a = *(const benchmark_object_t * const *)a;
+	const benchmark_object_t * object_b = *(const benchmark_object_t * const *)b;
+
+	/* qsort is not stable, the sequence makes its order the one a stable sort produces */
+	if (object_a->key != object_b->key)
+		return object_a->key < object_b->key ? -1 : 1;
+	return object_a->sequence < object_b->sequence ? -1 : object_a->sequence > object_b->sequence;
+}
+
+/* Refill the list in the original shuffled order */
+static void _benchmark_shuffle(ecds_list_t * list, benchmark_object_t ** objects, uint32_t count)
+{
+	ecds_list_item_t * item;
+
+	while ((item = ecds_list_first_item(list)))
+		ecds_list_dispose_item(item);
+
+	for (uint32_t i = 0; i < count; i++)
+		ecds_list_add_item(list, ECDS_OBJECT(objects[i]));
+}
+
+static bool _benchmark_check(ecds_list_t * list, benchmark_object_t ** sorted)
+{
+	uint32_t i = 0;
+
+	for (ecds_list_item_t * iter = ecds_list_first_item(list); iter; iter = ecds_list_next_item(iter), i++)
+	{
+		if (ecds_list_get_item(list, iter) != ECDS_OBJECT(sorted[i]))
+			return false;
+	}
+
+	return true;
+}
+
+//=================================== 8< ====================================//
+
+int main(int argc, char ** argv)
+{
+	uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : BENCHMARK_DEFAULT_COUNT;
+	uint32_t threads = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 0;
+	benchmark_object_t ** objects, ** sorted;
+	uint64_t start, list_time = 0, parallel_time = 0, array_time = 0;
+	ecds_list_t * list;
+	bool valid = true;
+
+	objects = (benchmark_object_t **)malloc(count * sizeof(benchmark_object_t *));
+	sorted = (benchmark_object_t **)malloc(count * sizeof(benchmark_object_t *));
+	if (!objects || !sorted || !(list = ecds_list_new()))
+		return EXIT_FAILURE;
+
+	srand(1);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		objects[i] = (benchmark_object_t *)ecds_object_new(NULL, sizeof(benchmark_object_t), ECDS_TYPE_BENCHMARK);
+		objects[i]->key = (uint32_t)rand() % (count / 4 + 1);
+		objects[i]->sequence = i;
+	}
+
+	for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+	{
+		memcpy(sorted, objects, count * sizeof(benchmark_object_t *));
+		start = _benchmark_now();
+		qsort(sorted, count, sizeof(benchmark_object_t *), _benchmark_compare);
+		array_time += _benchmark_now() - start;
+
+		_benchmark_shuffle(list, objects, count);
+		start = _benchmark_now();
+		ecds_list_sort(list, _benchmark_behind);
+		list_time += _benchmark_now() - start;
+		valid &= _benchmark_check(list, sorted);
+
+		_benchmark_shuffle(list, objects, count);
+		start = _benchmark_now();
+		ecds_list_sort_parallel(list, _benchmark_behind, threads);
+		parallel_time += _benchmark_now() - start;
+		valid &= _benchmark_check(list, sorted);
+	}
+
+	printf("Sorting %u objects, %d runs\n", count, BENCHMARK_REPEATS);
+	printf("%-40s %10.2f ms\n", "qsort on a pointer array", array_time / 1e6 / BENCHMARK_REPEATS);
+	printf("%-40s %10.2f ms\n", "ecds_list_sort", list_time / 1e6 / BENCHMARK_REPEATS);
+	printf("%-40s %10.2f ms\n", "ecds_list_sort_parallel", parallel_time / 1e6 / BENCHMARK_REPEATS);
+	printf("Results %s\n", valid ? "match" : "DO NOT MATCH");
+
+	_benchmark_shuffle(list, objects, 0);
+	for (uint32_t i = 0; i < count; i++)
+		ecds_object_unref(ECDS_OBJECT(objects[i]));
+	ecds_object_unref(ECDS_OBJECT(list));
+	free(sorted);
+	free(objects);
+
+	return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+/*****************************************************************************/
+/*	@file ecds_log_benchmark.c											 	 */
+/*	@brief Cost of logging on the object reference path.					 */
+/*																			 */
+/*	Built with -DECDS_BUILD_BENCHMARKS=ON. Measures ecds_object_ref() and	 */
+/*	ecds_object_unref(), which log every change at debug level, with		 */
+/*	debug disabled and enabled, and the same reference change with a		 */
+/*	debug message that is checked at runtime, compiled out, or passed to	 */
+/*	ecds_log() unchecked as the macros used to do. Times are CPU time of	 */
+/*	the calling thread, so queued messages do not count the work of the		 */
+/*	background thread even when it shares the core.							 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <core/ecds_object.h>
+
+#define ECDS_LOG_DOMAIN "ecds-log-benchmark"
+
+#define ECDS_TYPE_BENCHMARK			0x0FFFFFF0
+
+#define BENCHMARK_ITERATIONS		10000000
+#define BENCHMARK_LOGGED_ITERATIONS	200000
+
+static uint64_t _benchmark_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void _benchmark_report(const char * name, uint64_t start, uint32_t iterations)
+{
+	printf("%-52s %8.2f ns\n", name, (double)(_benchmark_now() - start) / iterations);
+}
+
+static void _benchmark_null_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	(void)sink;
+	(void)record;
+}
+
+static ecds_log_sink_t benchmark_null_sink = { "null", ECDS_DEBUG, _benchmark_null_write, NULL, NULL };
+
+//=================================== 8< ====================================//
+
+static __attribute__((noinline)) void _benchmark_runtime_check(ecds_object_t * obj)
+{
+	int refcnt = ecds_atomic_increment(&obj->refcnt);
+
+	ecds_log_debug("Reference count for object %s increased to %d", obj->name, refcnt);
+	ecds_atomic_decrement(&obj->refcnt);
+}
+
+static __attribute__((noinline)) void _benchmark_unchecked(ecds_object_t * obj)
+{
+	int refcnt = ecds_atomic_increment(&obj->refcnt);
+
+	ecds_log(ECDS_DEBUG, ECDS_LOG_DOMAIN, "Reference count for object %s increased to %d", obj->name, refcnt);
+	ecds_atomic_decrement(&obj->refcnt);
+}
+
+static const int benchmark_min_level = ECDS_LOG_MIN_LEVEL;
+
+/* What ECDS_LOG_MIN_LEVEL=INFO makes of the same code */
+#undef ECDS_LOG_MIN_LEVEL
+#define ECDS_LOG_MIN_LEVEL ECDS_INFO
+
+static __attribute__((noinline)) void _benchmark_compiled_out(ecds_object_t * obj)
+{
+	int refcnt = ecds_atomic_increment(&obj->refcnt);
+
+	ecds_log_debug("Reference count for object %s increased to %d", obj->name, refcnt);
+	ecds_atomic_decrement(&obj->refcnt);
+}
+
+//=================================== 8< ====================================//
+
+int main(void)
+{
+	ecds_object_t * obj;
+	ecds_log_stats_t stats;
+	uint64_t start;
+	uint32_t i;
+
+	if (!(obj = ecds_object_new("benchmark", sizeof(ecds_object_t), ECDS_TYPE_BENCHMARK)))
+		return EXIT_FAILURE;
+
+	ecds_log_set_level(ECDS_INFO);
+	printf("Per reference change and release (ECDS_LOG_MIN_LEVEL of the build: %d)\n", benchmark_min_level);
+
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+		_benchmark_compiled_out(obj);
+	_benchmark_report("debug compiled out", start, BENCHMARK_ITERATIONS);
+
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+		_benchmark_runtime_check(obj);
+	_benchmark_report("debug disabled, checked in the macro", start, BENCHMARK_ITERATIONS);
+
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+		_benchmark_unchecked(obj);
+	_benchmark_report("debug disabled, checked in ecds_log()", start, BENCHMARK_ITERATIONS);
+
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		ecds_object_ref(obj);
+		ecds_object_unref(obj);
+	}
+	_benchmark_report("ecds_object_ref/unref, debug disabled", start, BENCHMARK_ITERATIONS);
+
+	/* Enabled messages go to a sink that discards them, so only the logger is measured */
+	ecds_log_add_sink(&benchmark_null_sink);
+	ecds_log_remove_sink("stdout");
+	ecds_log_set_level(ECDS_DEBUG);
+
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_LOGGED_ITERATIONS; i++)
+	{
+		ecds_object_ref(obj);
+		ecds_object_unref(obj);
+	}
+	_benchmark_report("ecds_object_ref/unref, debug written directly", start, BENCHMARK_LOGGED_ITERATIONS);
+
+	ecds_log_start(1 << 16);
+	start = _benchmark_now();
+	for (i = 0; i < BENCHMARK_LOGGED_ITERATIONS; i++)
+	{
+		ecds_object_ref(obj);
+		ecds_object_unref(obj);
+	}
+	_benchmark_report("ecds_object_ref/unref, debug queued", start, BENCHMARK_LOGGED_ITERATIONS);
+	ecds_log_stop();
+
+	ecds_log_get_stats(&stats);
+	printf("%llu messages written, %llu dropped\n", (unsigned long long)stats.written, (unsigned long long)stats.dropped);
+
+	ecds_log_set_level(ECDS_INFO);
+	ecds_log_remove_sink("null");
+	ecds_object_unref(obj);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*****************************************************************************/
+/*	@file ecds_array.c														 */
+/*	@brief Defines an array-backed list.					 				 */
+/*																			 */
+/*	The storage is allocated from the memory manager and doubles when it	 */
+/*	is full. It never shrinks, registries rarely lose most of their			 */
+/*	objects and would grow back anyway.										 */
+/*																			 */
+/*****************************************************************************/
+
+#include <common/ecds_array.h>
+#include <core/ecds_list_internal.h>
+
+#include <memory.h>
+
+#define ECDS_ARRAY_MIN_CAPACITY		8
+
+ecds_array_t * ecds_array_new()
+{
+	return (ecds_array_t *)ecds_object_new("ecds-array", sizeof(ecds_array_t), ECDS_TYPE_ARRAY);
+}
+
+void ecds_array_initialize(ecds_array_t * array)
+{
+	if (!array)
+		return;
+
+	memset(array, 0, sizeof(ecds_array_t));
+}
+
+void ecds_array_dispose(ecds_array_t * array)
+{
+	if (!array)
+		return;
+
+	ecds_array_clear(array);
+	ecds_memory_free(array->items);
+	array->items = NULL;
+	array->capacity = 0;
+}
+
+bool ecds_array_reserve(ecds_array_t * array, uint32_t capacity)
+{
+	ecds_object_t ** items;
+	uint32_t new_capacity;
+
+	if (!array)
+		return false;
+	if (capacity <= array->capacity)
+		return true;
+
+	new_capacity = array->capacity ? array->capacity : ECDS_ARRAY_MIN_CAPACITY;
+	while (new_capacity < capacity)
+	{
+		if (new_capacity > UINT32_MAX / 2)
+			return false;
+		new_capacity <<= 1;
+	}
+
+	items = (ecds_object_t **)ecds_memory_alloc((size_t)new_capacity * sizeof(ecds_object_t *));
+	if (!items)
+		/* Out of memory, the array is left as it was */
+		return false;
+
+	if (array->count)
+		memcpy(items, array->items, array->count * sizeof(ecds_object_t *));
+	ecds_memory_free(array->items);
+
+	array->items = items;
+	array->capacity = new_capacity;
+
+	return true;
+}
+
+int ecds_array_append(ecds_array_t * array, ecds_object_t * obj)
+{
+	if (!array || !obj || array->count >= INT32_MAX)
+		return -1;
+
+	if (array->count == array->capacity && !ecds_array_reserve(array, array->count + 1))
+		return -1;
+
+	ecds_object_ref(obj);
+	array->items[array->count] = obj;
+
+	return (int)array->count++;
+}
+
+bool ecds_array_append_many(ecds_array_t * array, ecds_object_t * const * objs, uint32_t count)
+{
+	if (!array || (!objs && count))
+		return false;
+	if (count > INT32_MAX - array->count)
+		return false;
+
+	if (!ecds_array_reserve(array, array->count + count))
+		return false;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		ecds_object_ref(objs[i]);
+		array->items[array->count++] = objs[i];
+	}
+
+	return true;
+}
+
+uint32_t ecds_array_count(ecds_array_t * array)
+{
+	return array ? array->count : 0;
+}
+
+ecds_object_t * ecds_array_get(ecds_array_t * array, uint32_t index)
+{
+	if (!array || index >= array->count)
+		return NULL;
+
+	return array->items[index];
+}
+
+ecds_object_t ** ecds_array_data(ecds_array_t * array)
+{
+	return array ? array->items : NULL;
+}
+
+int ecds_array_find(ecds_array_t * array, ecds_object_t * obj)
+{
+	if (!array || !obj)
+		return -1;
+
+	for (uint32_t i = 0; i < array->count; i++)
+	{
+		if (array->items[i] == obj)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+ecds_object_t * ecds_array_remove(ecds_array_t * array, uint32_t index)
+{
+	ecds_object_t * obj;
+
+	if (!array || index >= array->count)
+		return NULL;
+
+	obj = array->items[index];
+	array->count--;
+	memmove(&array->items[index], &array->items[index + 1], (array->count - index) * sizeof(ecds_object_t *));
+
+	ecds_object_unref(obj);
+
+	return obj;
+}
+
+ecds_object_t * ecds_array_remove_fast(ecds_array_t * array, uint32_t index)
+{
+	ecds_object_t * obj;
+
+	if (!array || index >= array->count)
+		return NULL;
+
+	obj = array->items[index];
+	array->items[index] = array->items[--array->count];
+
+	ecds_object_unref(obj);
+
+	return obj;
+}
+
+void ecds_array_clear(ecds_array_t * array)
+{
+	if (!array)
+		return;
+
+	/* Release from the end, so objects that are disposed see a consistent array */
+	while (array->count)
+		ecds_object_unref(array->items[--array->count]);
+}
+
+void ecds_array_foreach(ecds_array_t * array, void (* operation)(ecds_object_t * obj))
+{
+	if (!array || !operation)
+		return;
+
+	for (uint32_t i = 0; i < array->count; i++)
+		(* operation)(array->items[i]);
+}
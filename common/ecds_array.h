@@ -0,0 +1,122 @@
+/*****************************************************************************/
+/*	@file ecds_array.h													 	 */
+/*	@brief Defines an array-backed list.					 				 */
+/*																			 */
+/*	An array holds objects in one contiguous block that grows by doubling,	 */
+/*	so appending is amortized O(1), any position is reached in O(1) and		 */
+/*	iterating touches consecutive memory. It takes a reference on every		 */
+/*	object it holds and releases it when the object is removed, the same	 */
+/*	as ecds_list_t, but it does not allocate anything per object. It is		 */
+/*	meant for registries that are mostly appended to and iterated.			 */
+/*																			 */
+/*	Positions of the objects after a removed one change, pointers from		 */
+/*	ecds_array_data() are only valid until the array is modified. The		 */
+/*	array is not thread-safe, the owner has to serialize access.			 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_ARRAY_H
+#define _ECDS_ARRAY_H
+
+#include <ecds.h>
+
+/**
+ * @brief Create a new array containing no objects.
+ */
+ecds_array_t * ecds_array_new();
+
+/**
+ * @brief Initialize an array that was allocated externally.
+ */
+void ecds_array_initialize(ecds_array_t * array);
+
+/**
+ * @brief Release all objects in an array and free its storage. The array itself is not freed.
+ * @param array The array to dispose.
+ */
+void ecds_array_dispose(ecds_array_t * array);
+
+/**
+ * @brief Make sure an array can hold a number of objects without growing.
+ * @param array The array to act on.
+ * @param capacity The number of objects.
+ * @return true if successful, false if out of memory.
+ */
+bool ecds_array_reserve(ecds_array_t * array, uint32_t capacity);
+
+/**
+ * @brief Add an object at the end of an array. The object is referenced.
+ * @param array The array to add the object to.
+ * @param obj The object to add.
+ * @return The position of the object, or -1 if not successful.
+ */
+int ecds_array_append(ecds_array_t * array, ecds_object_t * obj);
+
+/**
+ * @brief Add several objects at the end of an array, growing it at most once. The objects are referenced.
+ * @param array The array to add the objects to.
+ * @param objs The objects to add, none of them may be NULL.
+ * @param count The number of objects.
+ * @return true if all objects were added, false if none were.
+ */
+bool ecds_array_append_many(ecds_array_t * array, ecds_object_t * const * objs, uint32_t count);
+
+/**
+ * @brief Get the number of objects in an array.
+ */
+uint32_t ecds_array_count(ecds_array_t * array);
+
+/**
+ * @brief Get the object at a position.
+ * @param array The array to act on.
+ * @param index The position of the object.
+ * @return The object, or NULL if the position is out of range.
+ */
+ecds_object_t * ecds_array_get(ecds_array_t * array, uint32_t index);
+
+/**
+ * @brief Get the storage of an array to iterate over it without function calls.
+ * @param array The array to act on.
+ * @return ecds_array_count() consecutive objects. The pointer is valid until the array is modified.
+ */
+ecds_object_t ** ecds_array_data(ecds_array_t * array);
+
+/**
+ * @brief Find an object in an array.
+ * @param array The array to search.
+ * @param obj The object that you are looking for.
+ * @return The position of the first occurrence of the object, or -1 if it was not found.
+ */
+int ecds_array_find(ecds_array_t * array, ecds_object_t * obj);
+
+/**
+ * @brief Remove the object at a position and move the objects after it forward.
+ * @param array The array to act on.
+ * @param index The position of the object. The object is dereferenced.
+ * @return The removed object, or NULL if the position is out of range.
+ */
+ecds_object_t * ecds_array_remove(ecds_array_t * array, uint32_t index);
+
+/**
+ * @brief Remove the object at a position in O(1) by moving the last object into its place.
+ * @param array The array to act on.
+ * @param index The position of the object. The object is dereferenced.
+ * @return The removed object, or NULL if the position is out of range.
+ * @note The order of the objects is not preserved. The object that was last is now at index, if any.
+ */
+ecds_object_t * ecds_array_remove_fast(ecds_array_t * array, uint32_t index);
+
+/**
+ * @brief Remove all objects from an array, keeping its storage.
+ * @param array The array to act on. All objects are dereferenced.
+ */
+void ecds_array_clear(ecds_array_t * array);
+
+/**
+ * @brief Conduct an operation on each of the objects in an array.
+ * @param array The array to operate on.
+ * @param operation A function that is performed on each of the objects. It must not modify the array.
+ */
+void ecds_array_foreach(ecds_array_t * array, void (* operation)(ecds_object_t * obj));
+
+#endif /* _ECDS_ARRAY_H */
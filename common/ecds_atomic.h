@@ -0,0 +1,42 @@
+/*****************************************************************************/
+/*	@file ecds_atomic.h														 */
+/*	@brief Atomic primitives used by the ECDS core.							 */
+/*																			 */
+/*	Thin wrappers around the compiler's atomic builtins so that reference	 */
+/*	counts and other shared counters can be manipulated from several		 */
+/*	threads without taking a mutex. All operations are sequentially			 */
+/*	consistent unless the name says otherwise.								 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_ATOMIC_H
+#define _ECDS_ATOMIC_H
+
+#if defined(__GNUC__) || defined(__clang__)
+
+//!< @brief Increment the value at p and return the new value.
+#define ecds_atomic_increment(p)		__atomic_add_fetch((p), 1, __ATOMIC_SEQ_CST)
+
+//!< @brief Decrement the value at p and return the new value.
+#define ecds_atomic_decrement(p)		__atomic_sub_fetch((p), 1, __ATOMIC_SEQ_CST)
+
+//!< @brief Add v to the value at p and return the previous value.
+#define ecds_atomic_fetch_add(p, v)		__atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+
+#define ecds_atomic_load(p)				__atomic_load_n((p), __ATOMIC_SEQ_CST)
+
+//!< @brief Load the value at p without ordering, for flags that are only read as hints.
+#define ecds_atomic_load_relaxed(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+
+#define ecds_atomic_store(p, v)			__atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define ecds_atomic_exchange(p, v)		__atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+
+//!< @brief Replace *p with desired if it equals *expected, otherwise load *p into *expected.
+#define ecds_atomic_compare_exchange(p, expected, desired) \
+	__atomic_compare_exchange_n((p), (expected), (desired), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+#else
+	#error "ecds_atomic.h: no atomic primitives available for this compiler"
+#endif
+
+#endif /* _ECDS_ATOMIC_H */
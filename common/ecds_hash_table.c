@@ -0,0 +1,213 @@
+/*****************************************************************************/
+/*	@file ecds_hash_table.c												 	 */
+/*	@brief ECDS hash table.													 */
+/*																			 */
+/*	Keys are placed with linear probing in a power-of-two sized slot array	 */
+/*	that is kept at most half full, counting removal markers, so probe		 */
+/*	sequences stay short. Removed keys leave a marker behind that is reused	 */
+/*	by later inserts and dropped when the table is rebuilt.					 */
+/*																			 */
+/*****************************************************************************/
+
+#include <string.h>
+
+#include <common/ecds_hash_table.h>
+
+#define ECDS_LOG_DOMAIN "ecds-hash-table"
+
+#define ECDS_HASH_TABLE_MIN_SIZE	16
+
+uint32_t ecds_hash_string(const void * key)
+{
+	const unsigned char * str = (const unsigned char *)key;
+	uint32_t hash = 2166136261u;
+
+	/* FNV-1a */
+	while (*str)
+	{
+		hash ^= *str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+bool ecds_hash_string_equal(const void * a, const void * b)
+{
+	return strcmp((const char *)a, (const char *)b) == 0;
+}
+
+uint32_t ecds_hash_uint32(const void * key)
+{
+	uint32_t id = (uint32_t)(uintptr_t)key;
+
+	return (id ^ (id >> 16)) * 0x9E3779B1u;
+}
+
+bool ecds_hash_uint32_equal(const void * a, const void * b)
+{
+	return (uint32_t)(uintptr_t)a == (uint32_t)(uintptr_t)b;
+}
+
+void ecds_hash_table_initialize(ecds_hash_table_t * table, ecds_hash_func_t hash, ecds_hash_equal_func_t equal)
+{
+	if (!table)
+		return;
+
+	memset(table, 0, sizeof(ecds_hash_table_t));
+	table->hash = hash;
+	table->equal = equal;
+}
+
+void ecds_hash_table_clear(ecds_hash_table_t * table)
+{
+	if (!table)
+		return;
+
+	ecds_memory_free(table->slots);
+	table->slots = NULL;
+	table->mask = 0;
+	table->count = 0;
+	table->used = 0;
+}
+
+static ecds_hash_table_slot_t * _hash_table_find(ecds_hash_table_t * table, const void * key, uint32_t hash)
+{
+	ecds_hash_table_slot_t * slot;
+
+	if (!table->slots)
+		return NULL;
+
+	for (uint32_t i = hash & table->mask; ; i = (i + 1) & table->mask)
+	{
+		slot = &table->slots[i];
+
+		if (!slot->key)
+			return NULL;
+		if (!slot->removed && slot->hash == hash && table->equal(slot->key, key))
+			return slot;
+	}
+}
+
+static bool _hash_table_resize(ecds_hash_table_t * table, uint32_t size)
+{
+	ecds_hash_table_slot_t * old_slots = table->slots;
+	uint32_t old_size = old_slots ? table->mask + 1 : 0;
+	ecds_hash_table_slot_t * slots = (ecds_hash_table_slot_t *)ecds_memory_alloc(size * sizeof(ecds_hash_table_slot_t));
+
+	if (!slots)
+	{
+		ecds_log_error("Out of memory when growing hash table to %u slots", size);
+		return false;
+	}
+
+	table->slots = slots;
+	table->mask = size - 1;
+	table->used = table->count;
+
+	/* Move the live keys over, removal markers are left behind */
+	for (uint32_t i = 0; i < old_size; i++)
+	{
+		ecds_hash_table_slot_t * old = &old_slots[i];
+		uint32_t s;
+
+		if (!old->key || old->removed)
+			continue;
+
+		for (s = old->hash & table->mask; slots[s].key; s = (s + 1) & table->mask)
+			;
+		slots[s] = *old;
+	}
+
+	ecds_memory_free(old_slots);
+	return true;
+}
+
+bool ecds_hash_table_insert(ecds_hash_table_t * table, const void * key, void * value)
+{
+	uint32_t hash;
+	ecds_hash_table_slot_t * slot;
+	ecds_hash_table_slot_t * reuse = NULL;
+
+	if (!table || !key)
+		return false;
+
+	hash = table->hash(key);
+
+	if ((slot = _hash_table_find(table, key, hash)))
+	{
+		slot->key = key;
+		slot->value = value;
+		return true;
+	}
+
+	/* Keep the table at most half full */
+	if (!table->slots || (table->used + 1) * 2 > table->mask + 1)
+	{
+		uint32_t size = ECDS_HASH_TABLE_MIN_SIZE;
+
+		while (size < (table->count + 1) * 4)
+			size <<= 1;
+
+		if (!_hash_table_resize(table, size))
+			return false;
+	}
+
+	for (uint32_t i = hash & table->mask; ; i = (i + 1) & table->mask)
+	{
+		slot = &table->slots[i];
+
+		if (slot->removed)
+		{
+			if (!reuse)
+				reuse = slot;
+			continue;
+		}
+		if (!slot->key)
+			break;
+	}
+
+	if (reuse)
+		slot = reuse;
+	else
+		table->used++;
+
+	slot->hash = hash;
+	slot->key = key;
+	slot->value = value;
+	slot->removed = false;
+	table->count++;
+
+	return true;
+}
+
+void * ecds_hash_table_lookup(ecds_hash_table_t * table, const void * key)
+{
+	ecds_hash_table_slot_t * slot;
+
+	if (!table || !key)
+		return NULL;
+
+	slot = _hash_table_find(table, key, table->hash(key));
+	return slot ? slot->value : NULL;
+}
+
+void * ecds_hash_table_remove(ecds_hash_table_t * table, const void * key)
+{
+	ecds_hash_table_slot_t * slot;
+	void * value;
+
+	if (!table || !key)
+		return NULL;
+
+	if (!(slot = _hash_table_find(table, key, table->hash(key))))
+		return NULL;
+
+	/* Keep the key pointer so probe sequences running through this slot stay intact */
+	value = slot->value;
+	slot->value = NULL;
+	slot->removed = true;
+	table->count--;
+
+	return value;
+}
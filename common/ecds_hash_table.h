@@ -0,0 +1,90 @@
+/*****************************************************************************/
+/*	@file ecds_hash_table.h												 	 */
+/*	@brief ECDS hash table.													 */
+/*																			 */
+/*	A small open-addressing hash table that maps keys to values, used for	 */
+/*	the registries that are looked up by name or UID on every construction. */
+/*	The table is embedded in its owner and is not an object itself, so it	 */
+/*	can be used by the memory manager too. It stores plain pointers and		 */
+/*	neither copies keys nor takes references on values: a key has to stay	 */
+/*	valid for as long as it is in the table.								 */
+/*																			 */
+/*	The table is not thread-safe, the owner has to serialize access.		 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_HASH_TABLE_H
+#define _ECDS_HASH_TABLE_H
+
+#include <ecds.h>
+
+//!<	Turn an integer such as a type UID into a key for ecds_hash_uint32().
+#define ECDS_HASH_UINT32_KEY(x)		((const void *)(uintptr_t)(uint32_t)(x))
+
+typedef struct _ecds_hash_table_t ecds_hash_table_t;
+typedef struct _ecds_hash_table_slot_t ecds_hash_table_slot_t;
+
+typedef uint32_t (* ecds_hash_func_t)(const void * key);
+typedef bool (* ecds_hash_equal_func_t)(const void * a, const void * b);
+
+struct _ecds_hash_table_slot_t
+{
+	uint32_t hash;
+	const void * key;		//!<	NULL if the slot was never used
+	void * value;
+	bool removed;
+};
+
+struct _ecds_hash_table_t
+{
+	ecds_hash_func_t hash;
+	ecds_hash_equal_func_t equal;
+
+	ecds_hash_table_slot_t * slots;
+	uint32_t mask;
+	uint32_t count;			//!<	Number of keys in the table
+	uint32_t used;			//!<	Number of slots holding a key or a removal marker
+};
+
+//!< @brief Hash a NUL-terminated string key.
+uint32_t ecds_hash_string(const void * key);
+
+//!< @brief Compare two NUL-terminated string keys.
+bool ecds_hash_string_equal(const void * a, const void * b);
+
+//!< @brief Hash an integer key made with ECDS_HASH_UINT32_KEY().
+uint32_t ecds_hash_uint32(const void * key);
+
+//!< @brief Compare two integer keys made with ECDS_HASH_UINT32_KEY().
+bool ecds_hash_uint32_equal(const void * a, const void * b);
+
+/**
+ * @brief Set up an empty hash table. No memory is allocated until the first key is inserted.
+ * @param table The table to initialize.
+ * @param hash The function that hashes keys.
+ * @param equal The function that compares keys.
+ */
+void ecds_hash_table_initialize(ecds_hash_table_t * table, ecds_hash_func_t hash, ecds_hash_equal_func_t equal);
+
+//!< @brief Release the memory used by a hash table and remove all keys. Values are left alone.
+void ecds_hash_table_clear(ecds_hash_table_t * table);
+
+/**
+ * @brief Insert a key, or replace the value if the key is already in the table.
+ * @return true if the key was stored, false if the table could not grow.
+ */
+bool ecds_hash_table_insert(ecds_hash_table_t * table, const void * key, void * value);
+
+/**
+ * @brief Look up the value stored for a key.
+ * @return The value, or NULL if the key is not in the table.
+ */
+void * ecds_hash_table_lookup(ecds_hash_table_t * table, const void * key);
+
+/**
+ * @brief Remove a key from the table.
+ * @return The value that was stored for the key, or NULL if the key was not in the table.
+ */
+void * ecds_hash_table_remove(ecds_hash_table_t * table, const void * key);
+
+#endif /* _ECDS_HASH_TABLE_H */
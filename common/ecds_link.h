@@ -0,0 +1,153 @@
+/*****************************************************************************/
+/*	@file ecds_link.h													 	 */
+/*	@brief Intrusive double linked list.									 */
+/*																			 */
+/*	Unlike ecds_list_t, which allocates an ecds_list_item_t for every		 */
+/*	object it holds, an intrusive list links objects through an ecds_link_t */
+/*	that is a field of the object itself. Adding and removing objects		 */
+/*	allocates nothing and an object can be removed in O(1) without			 */
+/*	searching for it. An object can be in as many intrusive lists at once	 */
+/*	as it has links.														 */
+/*																			 */
+/*	The list takes no references, the owner of the list decides which		 */
+/*	references its objects hold. Use ECDS_LINK_CONTAINER() to get from a	 */
+/*	link to its object. Like the other containers, intrusive lists are not	 */
+/*	thread-safe; pushing to the back and popping from the front makes one	 */
+/*	a FIFO queue.															 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_LINK_H
+#define _ECDS_LINK_H
+
+#include <stddef.h>
+
+#include <ecds.h>
+
+typedef struct _ecds_link_t ecds_link_t;
+typedef struct _ecds_link_list_t ecds_link_list_t;
+
+struct _ecds_link_t
+{
+	ecds_link_t * previous;			//!<	Previous link in the list (NULL if first)
+	ecds_link_t * next;				//!<	Next link in the list (NULL if last)
+	ecds_link_list_t * list;		//!<	List the link is in (NULL if none)
+};
+
+struct _ecds_link_list_t
+{
+	ecds_link_t * first;
+	ecds_link_t * last;
+	uint32_t count;
+};
+
+//!<	Get the object of type that contains link as the field member, or NULL if link is NULL.
+#define ECDS_LINK_CONTAINER(link, type, member) \
+	( ((link) == NULL) ? NULL : (type *)((char *)(link) - offsetof(type, member)) )
+
+//!< @brief Initialize an empty list. Zero-filled memory is an empty list too.
+static inline void ecds_link_list_initialize(ecds_link_list_t * list)
+{
+	list->first = NULL;
+	list->last = NULL;
+	list->count = 0;
+}
+
+/**
+ * @brief Insert a link behind another one.
+ * @param list The list to insert into.
+ * @param after A link in the list, or NULL to insert at the front.
+ * @param link The link to insert.
+ * @return true if successful, false if the link is already in a list.
+ */
+static inline bool ecds_link_list_insert_after(ecds_link_list_t * list, ecds_link_t * after, ecds_link_t * link)
+{
+	if (link->list)
+		return false;
+
+	link->list = list;
+	link->previous = after;
+	link->next = after ? after->next : list->first;
+
+	if (link->next)
+		link->next->previous = link;
+	else
+		list->last = link;
+
+	if (after)
+		after->next = link;
+	else
+		list->first = link;
+
+	list->count++;
+	return true;
+}
+
+//!< @brief Add a link at the end of a list. Returns false if the link is already in a list.
+static inline bool ecds_link_list_push_back(ecds_link_list_t * list, ecds_link_t * link)
+{
+	return ecds_link_list_insert_after(list, list->last, link);
+}
+
+//!< @brief Add a link at the front of a list. Returns false if the link is already in a list.
+static inline bool ecds_link_list_push_front(ecds_link_list_t * list, ecds_link_t * link)
+{
+	return ecds_link_list_insert_after(list, NULL, link);
+}
+
+/**
+ * @brief Remove a link from the list it is in.
+ * @param link The link to remove.
+ * @return true if successful, false if the link was not in a list.
+ */
+static inline bool ecds_link_list_remove(ecds_link_t * link)
+{
+	ecds_link_list_t * list = link->list;
+
+	if (!list)
+		return false;
+
+	if (link->previous)
+		link->previous->next = link->next;
+	else
+		list->first = link->next;
+
+	if (link->next)
+		link->next->previous = link->previous;
+	else
+		list->last = link->previous;
+
+	link->list = NULL;
+	link->previous = NULL;
+	link->next = NULL;
+	list->count--;
+	return true;
+}
+
+//!< @brief Remove the first link from a list and return it, or NULL if the list is empty.
+static inline ecds_link_t * ecds_link_list_pop_front(ecds_link_list_t * list)
+{
+	ecds_link_t * link = list->first;
+
+	if (link)
+		ecds_link_list_remove(link);
+
+	return link;
+}
+
+static inline ecds_link_t * ecds_link_list_first(ecds_link_list_t * list)
+{
+	return list->first;
+}
+
+static inline ecds_link_t * ecds_link_next(ecds_link_t * link)
+{
+	return link->next;
+}
+
+static inline uint32_t ecds_link_list_count(ecds_link_list_t * list)
+{
+	return list->count;
+}
+
+#endif /* _ECDS_LINK_H */
@@ -7,22 +7,170 @@
 /*	It is an independent implementation, the items themselves do not		 */
 /*	register in the memory manager but are managed by the list itself.		 */
 /*																			 */
+/*	Indices are maintained lazily. The list remembers how many leading		 */
+/*	items have a current index and an entry in the index arrays; a change	 */
+/*	only lowers that number, and the items behind it are renumbered on the	 */
+/*	next indexed access. Appending to an indexed list extends the arrays	 */
+/*	directly, so neither appending nor taking items from the front ever		 */
+/*	walks the list.															 */
+/*																			 */
 /*****************************************************************************/
 
 #include <common/ecds_list.h>
 #include <core/ecds_list_internal.h>
 
 #include <memory.h>
+#include <unistd.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+typedef bool (* ecds_list_compare_func_t)(ecds_object_t * a, ecds_object_t * b);
+
+//=================================== 8< ====================================//
+//									INDICES									 //
+//===========================================================================//
+
+/* Forget the indices of all items from position on */
+static inline void _ecds_list_invalidate(ecds_list_t * list, uint32_t position)
+{
+	if (position < list->indexed_count)
+		list->indexed_count = position;
+}
+
+/* Whether the index of an item is current */
+static inline bool _ecds_list_is_indexed(ecds_list_t * list, ecds_list_item_t * item)
+{
+	return item->index >= 0 && (uint32_t)item->index < list->indexed_count && list->item_array[item->index] == item;
+}
+
+/* Make room for capacity items in the index arrays, plus the terminating NULL of list_array */
+static bool _ecds_list_reserve_index(ecds_list_t * list, uint32_t capacity)
+{
+	ecds_list_item_t ** items;
+	ecds_object_t ** objects;
+	uint32_t new_capacity;
+
+	if (capacity < list->array_capacity)
+		return true;
+
+	for (new_capacity = list->array_capacity ? list->array_capacity : 8; new_capacity <= capacity; new_capacity <<= 1)
+		;
+
+	items = (ecds_list_item_t **)ecds_memory_alloc(new_capacity * sizeof(ecds_list_item_t *));
+	objects = (ecds_object_t **)ecds_memory_alloc(new_capacity * sizeof(ecds_object_t *));
+	if (!items || !objects)
+	{
+		ecds_memory_free(items);
+		ecds_memory_free(objects);
+		return false;
+	}
+
+	if (list->indexed_count)
+	{
+		memcpy(items, list->item_array, list->indexed_count * sizeof(ecds_list_item_t *));
+		memcpy(objects, list->list_array, list->indexed_count * sizeof(ecds_object_t *));
+	}
+	ecds_memory_free(list->item_array);
+	ecds_memory_free(list->list_array);
+
+	list->item_array = items;
+	list->list_array = objects;
+	list->array_capacity = new_capacity;
+
+	return true;
+}
+
+static void _ecds_list_free_index(ecds_list_t * list)
+{
+	ecds_memory_free(list->item_array);
+	ecds_memory_free(list->list_array);
+	list->item_array = NULL;
+	list->list_array = NULL;
+	list->array_capacity = 0;
+	list->indexed_count = 0;
+}
 
+/* Renumber the items that do not have a current index. Leaves the list partly indexed if memory runs out */
 void _ecds_list_reorder(ecds_list_t * list)
 {
-	/* Stub. This function will iterate through all items in the list and update their sequence number. */
-	return;
+	ecds_list_item_t * iter;
+	uint32_t index = list->indexed_count;
+
+	if (index < list->count)
+	{
+		if (!_ecds_list_reserve_index(list, list->count))
+			return;
+
+		for (iter = index ? list->item_array[index - 1]->next : list->first; iter; iter = iter->next, index++)
+		{
+			iter->index = (int)index;
+			list->item_array[index] = iter;
+			list->list_array[index] = iter->data;
+		}
+		list->indexed_count = index;
+	}
+
+	if (list->list_array)
+		/* Dropping the last item leaves its object behind the indexed ones */
+		list->list_array[list->indexed_count] = NULL;
 }
 
+/* Link an orphaned item in behind another one, or in front if after is NULL */
+static void _ecds_list_link_after(ecds_list_t * list, ecds_list_item_t * after, ecds_list_item_t * item)
+{
+	item->list = list;
+	item->previous = after;
+	item->next = after ? after->next : list->first;
+
+	if (item->next)
+		item->next->previous = item;
+	else
+		list->last = item;
+
+	if (after)
+		after->next = item;
+	else
+		list->first = item;
+
+	list->count++;
+	item->index = -1;
+
+	if (!item->next && list->item_array && list->indexed_count == list->count - 1 && _ecds_list_reserve_index(list, list->count))
+	{
+		/* Appended to a fully indexed list, keep it that way */
+		item->index = (int)list->indexed_count;
+		list->item_array[list->indexed_count] = item;
+		list->list_array[list->indexed_count] = item->data;
+		list->list_array[++list->indexed_count] = NULL;
+	}
+	else if (!after)
+		_ecds_list_invalidate(list, 0);
+	else if (_ecds_list_is_indexed(list, after))
+		_ecds_list_invalidate(list, (uint32_t)after->index + 1);
+}
+
+//=================================== 8< ====================================//
+
 ecds_list_t * ecds_list_new()
 {
-	return (ecds_list_t *)ecds_object_new("ecds-list", sizeof(ecds_list_t), ECDS_TYPE_LIST);
+	ecds_list_t * list = (ecds_list_t *)ecds_object_new("ecds-list", sizeof(ecds_list_t), ECDS_TYPE_LIST);
+
+	if (list)
+		list->obj.dispose = ecds_list_dispose_object;
+
+	return list;
+}
+
+ecds_object_t * ecds_list_construct_object()
+{
+	return ECDS_OBJECT(ecds_list_new());
+}
+
+void ecds_list_dispose_object(ecds_object_t * obj)
+{
+	/* The items may outlive the list object and keep their references, only the index belongs to the list */
+	_ecds_list_free_index((ecds_list_t *)obj);
 }
 
 void ecds_list_initialize(ecds_list_t * list)
@@ -41,10 +189,12 @@ void ecds_list_dispose(ecds_list_t * list)
 		/* Invalid argument */
 		return;
 	
-	for(iter = list->last; iter; iter=iter->previous)
+	while((iter = list->last))
 	{
 		ecds_list_dispose_item(iter);
 	}
+
+	_ecds_list_free_index(list);
 }
 
 ecds_list_item_t * ecds_list_first_item(ecds_list_t * list)
@@ -86,7 +236,7 @@ ecds_list_item_t * ecds_list_add_item(ecds_list_t * list, ecds_object_t * obj)
 	if(!list || !obj)
 		return NULL;
 	
-	new_item = (ecds_list_item_t *)calloc(1, sizeof(ecds_list_item_t));
+	new_item = (ecds_list_item_t *)ecds_memory_alloc(sizeof(ecds_list_item_t));
 	if(!new_item)
 		/* Serious problem -- out of memory */
 		return NULL;
@@ -94,9 +244,29 @@ ecds_list_item_t * ecds_list_add_item(ecds_list_t * list, ecds_object_t * obj)
 	ecds_object_ref(obj);
 	
 	new_item->data = obj;
+	new_item->index = -1;
 	return ecds_list_take_item(list, new_item);
 }
 
+ecds_list_item_t * ecds_list_create_item(ecds_object_t * obj)
+{
+	ecds_list_item_t * new_item;
+
+	if (!obj)
+		return NULL;
+
+	new_item = (ecds_list_item_t *)ecds_memory_alloc(sizeof(ecds_list_item_t));
+	if (!new_item)
+		/* Serious problem -- out of memory */
+		return NULL;
+
+	ecds_object_ref(obj);
+
+	new_item->data = obj;
+	new_item->index = -1;
+	return new_item;
+}
+
 ecds_list_item_t * ecds_list_take_item(ecds_list_t * list, ecds_list_item_t * item)
 {
 	if(!list || !item)
@@ -105,18 +275,7 @@ ecds_list_item_t * ecds_list_take_item(ecds_list_t * list, ecds_list_item_t * it
 		/* Item is already attached, do not relocate it */
 		return NULL;
 	
-	item->list = list;
-	item->previous = list->last;
-	
-	if(list->last)
-		list->last->next = item;
-	
-	if (!list->first)
-		list->first = item;
-	
-	list->last = item;
-	
-	_ecds_list_reorder(list);
+	_ecds_list_link_after(list, list->last, item);
 	
 	return item;
 }
@@ -143,6 +302,10 @@ ecds_list_item_t * ecds_list_drop_item(ecds_list_item_t * item)
 		return item;
 	
 	list = item->list;
+
+	if (_ecds_list_is_indexed(list, item))
+		/* Items in front keep their index */
+		_ecds_list_invalidate(list, (uint32_t)item->index);
 		
 	if(item->previous)
 		item->previous->next = item->next;
@@ -156,8 +319,9 @@ ecds_list_item_t * ecds_list_drop_item(ecds_list_item_t * item)
 	
 	item->list = NULL;
 	item->index = -1;
-	
-	_ecds_list_reorder(list);
+	item->previous = NULL;
+	item->next = NULL;
+	list->count--;
 	
 	return item;
 }
@@ -174,7 +338,420 @@ ecds_object_t * ecds_list_dispose_item(ecds_list_item_t * item)
 	
 	ecds_object_unref(obj);
 	
-	free(item);
+	ecds_memory_free(item);
 	
 	return obj;
-}
\ No newline at end of file
+}
+
+ecds_list_item_t * ecds_fetch_item(ecds_list_t * list, int index)
+{
+	ecds_list_item_t * iter;
+
+	if (!list || index < 0 || (uint32_t)index >= list->count)
+		return NULL;
+
+	if ((uint32_t)index >= list->indexed_count)
+		_ecds_list_reorder(list);
+
+	if ((uint32_t)index < list->indexed_count)
+		return list->item_array[index];
+
+	/* Out of memory for the index, walk from the nearer end instead */
+	if ((uint32_t)index < list->count / 2)
+		for (iter = list->first; index--; iter = iter->next)
+			;
+	else
+		for (iter = list->last, index = (int)list->count - 1 - index; index--; iter = iter->previous)
+			;
+
+	return iter;
+}
+
+ecds_object_t ** ecds_list_to_array(ecds_list_t * list)
+{
+	if (!list)
+		return NULL;
+
+	_ecds_list_reorder(list);
+	if (list->indexed_count < list->count)
+		return NULL;
+	if (!list->list_array && !_ecds_list_reserve_index(list, 0))
+		/* Empty list, the array only holds the terminating NULL */
+		return NULL;
+
+	return list->list_array;
+}
+
+void ecds_list_insert_item(ecds_list_t * list, unsigned int position, ecds_list_item_t * item)
+{
+	if (!list || !item || item->list)
+		return;
+
+	if (position >= list->count)
+		_ecds_list_link_after(list, list->last, item);
+	else
+		_ecds_list_link_after(list, ecds_fetch_item(list, (int)position), item);
+}
+
+ecds_list_t * ecds_list_insert_list(ecds_list_t * list1, unsigned int position, ecds_list_t * list)
+{
+	ecds_list_item_t * after;
+	ecds_list_t * source = list;
+
+	if (!list1 || !list)
+		return NULL;
+
+	if (list == list1 && !(source = ecds_list_clone(list)))
+		/* Inserting a list into itself, copy it first so the new items are not copied again */
+		return NULL;
+
+	after = position >= list1->count ? list1->last : ecds_fetch_item(list1, (int)position);
+
+	for (ecds_list_item_t * iter = source->first; iter; iter = iter->next)
+	{
+		ecds_list_item_t * item = ecds_list_create_item(iter->data);
+
+		if (!item)
+			break;
+
+		_ecds_list_link_after(list1, after, item);
+		after = item;
+	}
+
+	if (source != list)
+	{
+		ecds_list_dispose(source);
+		ecds_object_unref(ECDS_OBJECT(source));
+	}
+
+	return list1;
+}
+
+//=================================== 8< ====================================//
+//								LIST OPERATIONS								 //
+//===========================================================================//
+
+/* Add every item of a list to another one, referencing the objects again */
+static void _ecds_list_append_all(ecds_list_t * target, ecds_list_t * source)
+{
+	for (ecds_list_item_t * iter = source->first; iter; iter = iter->next)
+		ecds_list_add_item(target, iter->data);
+}
+
+ecds_list_t * ecds_list_clone(ecds_list_t * list)
+{
+	ecds_list_t * ret;
+
+	if (!list || !(ret = ecds_list_new()))
+		return NULL;
+
+	_ecds_list_append_all(ret, list);
+
+	return ret;
+}
+
+ecds_list_t * ecds_list_filter(ecds_list_t * list, bool (* filter_func)(ecds_object_t * obj))
+{
+	ecds_list_t * ret;
+
+	if (!list || !filter_func || !(ret = ecds_list_new()))
+		return NULL;
+
+	for (ecds_list_item_t * iter = list->first; iter; iter = iter->next)
+	{
+		if ((* filter_func)(iter->data))
+			ecds_list_add_item(ret, iter->data);
+	}
+
+	return ret;
+}
+
+ecds_list_t * ecds_list_concat(ecds_list_t * list1, ecds_list_t * list2)
+{
+	ecds_list_t * ret;
+
+	if (!list1 || !list2 || !(ret = ecds_list_new()))
+		return NULL;
+
+	_ecds_list_append_all(ret, list1);
+	_ecds_list_append_all(ret, list2);
+
+	return ret;
+}
+
+ecds_list_t * ecds_list_zip(ecds_list_t * list1, ecds_list_t * list2)
+{
+	ecds_list_item_t * iter1, * iter2;
+	ecds_list_t * ret;
+
+	if (!list1 || !list2 || !(ret = ecds_list_new()))
+		return NULL;
+
+	/* Alternate while both lists have items, then the rest of the longer one follows */
+	for (iter1 = list1->first, iter2 = list2->first; iter1 || iter2; )
+	{
+		if (iter1)
+		{
+			ecds_list_add_item(ret, iter1->data);
+			iter1 = iter1->next;
+		}
+		if (iter2)
+		{
+			ecds_list_add_item(ret, iter2->data);
+			iter2 = iter2->next;
+		}
+	}
+
+	return ret;
+}
+
+ecds_list_t * ecds_list_split(ecds_list_t * list, unsigned int position)
+{
+	ecds_list_item_t * cut;
+	ecds_list_t * ret;
+	uint32_t kept = 0;
+
+	if (!list || !(ret = ecds_list_new()))
+		return NULL;
+
+	for (cut = list->first; cut && kept < position; cut = cut->next)
+		kept++;
+
+	if (!cut || !cut->next)
+		/* Nothing behind the position */
+		return ret;
+
+	/* Move the chain behind the cut as a whole */
+	ret->first = cut->next;
+	ret->last = list->last;
+	ret->count = list->count - (kept + 1);
+	ret->first->previous = NULL;
+
+	cut->next = NULL;
+	list->last = cut;
+	list->count = kept + 1;
+
+	for (ecds_list_item_t * iter = ret->first; iter; iter = iter->next)
+		iter->list = ret;
+
+	_ecds_list_invalidate(list, kept + 1);
+
+	return ret;
+}
+
+ecds_list_t * ecds_list_sublist(ecds_list_t * list, unsigned int from, unsigned int to)
+{
+	ecds_list_item_t * iter = NULL;
+	ecds_list_t * ret;
+	unsigned int index = 0;
+
+	if (!list || from > to || !(ret = ecds_list_new()))
+		return NULL;
+
+	for (iter = list->first; iter && index < from; iter = iter->next)
+		index++;
+
+	for (; iter && index <= to; iter = iter->next, index++)
+		ecds_list_add_item(ret, iter->data);
+
+	return ret;
+}
+
+//=================================== 8< ====================================//
+//									SORTING									 //
+//===========================================================================//
+
+/*
+ * The sort works on chains of items linked by next and ending in NULL. The previous links and the
+ * first and last pointers of the list are only restored once the whole list is sorted.
+ */
+
+/* Merge two sorted chains. Items of a go first when they compare equal, which keeps the sort stable */
+static ecds_list_item_t * _ecds_list_merge(ecds_list_item_t * a, ecds_list_item_t * b, ecds_list_compare_func_t compare_func)
+{
+	ecds_list_item_t head;
+	ecds_list_item_t * tail = &head;
+
+	while (a && b)
+	{
+		if ((* compare_func)(a->data, b->data))
+		{
+			tail->next = b;
+			tail = b;
+			b = b->next;
+		}
+		else
+		{
+			tail->next = a;
+			tail = a;
+			a = a->next;
+		}
+	}
+	tail->next = a ? a : b;
+
+	return head.next;
+}
+
+/*
+ * Bottom-up merge sort of a chain. runs[i] holds a sorted chain of 2^i items, or nothing. Every item
+ * is added as a run of one and carried upwards like a binary counter, so runs are always merged with
+ * one of the same size and no recursion, length or extra memory is needed. Higher runs hold earlier
+ * items, so they are always passed first.
+ */
+static ecds_list_item_t * _ecds_list_sort_chain(ecds_list_item_t * chain, ecds_list_compare_func_t compare_func)
+{
+	ecds_list_item_t * runs[32] = { NULL };
+	ecds_list_item_t * carry, * ret = NULL;
+	uint32_t i;
+
+	while (chain)
+	{
+		carry = chain;
+		chain = chain->next;
+		carry->next = NULL;
+
+		for (i = 0; i < 31 && runs[i]; i++)
+		{
+			carry = _ecds_list_merge(runs[i], carry, compare_func);
+			runs[i] = NULL;
+		}
+		runs[i] = i < 31 ? carry : _ecds_list_merge(runs[i], carry, compare_func);
+	}
+
+	for (i = 0; i < 32; i++)
+	{
+		if (runs[i])
+			ret = _ecds_list_merge(runs[i], ret, compare_func);
+	}
+
+	return ret;
+}
+
+/* Make a sorted chain the contents of a list again */
+static void _ecds_list_relink(ecds_list_t * list, ecds_list_item_t * chain)
+{
+	ecds_list_item_t * previous = NULL;
+
+	list->first = chain;
+	for (ecds_list_item_t * iter = chain; iter; iter = iter->next)
+	{
+		iter->previous = previous;
+		previous = iter;
+	}
+	list->last = previous;
+
+	_ecds_list_invalidate(list, 0);
+}
+
+void ecds_list_sort(ecds_list_t * list, bool (* compare_func)(ecds_object_t * a, ecds_object_t * b))
+{
+	if (!list || !compare_func || !list->first)
+		return;
+
+	_ecds_list_relink(list, _ecds_list_sort_chain(list->first, compare_func));
+}
+
+typedef struct _ecds_list_sort_task_t ecds_list_sort_task_t;
+struct _ecds_list_sort_task_t {
+	ecds_list_item_t * chain;			//!<	Chain to sort, or the first chain to merge
+	ecds_list_item_t * other;			//!<	Second chain to merge, NULL to sort chain
+	ecds_list_compare_func_t compare_func;
+	bool started;						//!<	Whether the task runs on a thread of its own
+	pthread_t thread[1];
+};
+
+static void * _ecds_list_sort_task(void * data)
+{
+	ecds_list_sort_task_t * task = (ecds_list_sort_task_t *)data;
+
+	if (task->other)
+		task->chain = _ecds_list_merge(task->chain, task->other, task->compare_func);
+	else
+		task->chain = _ecds_list_sort_chain(task->chain, task->compare_func);
+
+	return NULL;
+}
+
+/* Run tasks on threads of their own, the calling thread takes the first one */
+static void _ecds_list_run_tasks(ecds_list_sort_task_t * tasks, uint32_t count)
+{
+	for (uint32_t i = 1; i < count; i++)
+		tasks[i].started = pthread_create(tasks[i].thread, 0, _ecds_list_sort_task, &tasks[i]) == 0;
+
+	_ecds_list_sort_task(&tasks[0]);
+
+	for (uint32_t i = 1; i < count; i++)
+	{
+		if (tasks[i].started)
+			pthread_join(tasks[i].thread[0], NULL);
+		else
+			/* Out of threads, do the work here instead */
+			_ecds_list_sort_task(&tasks[i]);
+	}
+}
+
+void ecds_list_sort_parallel(ecds_list_t * list, bool (* compare_func)(ecds_object_t * a, ecds_object_t * b), uint32_t thread_count)
+{
+	ecds_list_sort_task_t * tasks;
+	ecds_list_item_t * iter;
+	uint32_t run_length, run_count;
+
+	if (!list || !compare_func || !list->first)
+		return;
+
+	if (thread_count == 0)
+	{
+		long processors = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_count = processors > 0 ? (uint32_t)processors : 1;
+	}
+	if (thread_count > list->count / ECDS_LIST_PARALLEL_SORT_MIN)
+		thread_count = list->count / ECDS_LIST_PARALLEL_SORT_MIN;
+
+	if (thread_count < 2 || !(tasks = (ecds_list_sort_task_t *)ecds_memory_alloc(thread_count * sizeof(ecds_list_sort_task_t))))
+	{
+		ecds_list_sort(list, compare_func);
+		return;
+	}
+
+	/* Cut the list into runs of equal length, in order */
+	run_length = (list->count + thread_count - 1) / thread_count;
+	run_count = 0;
+	for (iter = list->first; iter; run_count++)
+	{
+		tasks[run_count].chain = iter;
+		tasks[run_count].compare_func = compare_func;
+
+		for (uint32_t i = 1; i < run_length && iter->next; i++)
+			iter = iter->next;
+
+		ecds_list_item_t * next = iter->next;
+		iter->next = NULL;
+		iter = next;
+	}
+
+	_ecds_list_run_tasks(tasks, run_count);
+
+	/* Merge neighbouring runs until one is left, the earlier run always goes first */
+	while (run_count > 1)
+	{
+		uint32_t merged = 0;
+
+		for (uint32_t i = 0; i < run_count; i += 2, merged++)
+		{
+			tasks[merged].chain = tasks[i].chain;
+			tasks[merged].other = i + 1 < run_count ? tasks[i + 1].chain : NULL;
+		}
+
+		/* An odd run out has nothing to merge with and is carried over as it is */
+		if (run_count & 1)
+			merged--;
+		_ecds_list_run_tasks(tasks, merged);
+		if (run_count & 1)
+			merged++;
+
+		run_count = merged;
+	}
+
+	_ecds_list_relink(list, tasks[0].chain);
+	ecds_memory_free(tasks);
+}
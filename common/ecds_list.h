@@ -20,6 +20,9 @@
 
 #include <ecds.h>
 
+//!< Fewest items each thread of ecds_list_sort_parallel() sorts, below that threading costs more than it saves.
+#define ECDS_LIST_PARALLEL_SORT_MIN		8192
+
 /**
  * @brief Create a new list containing no items.
  */
@@ -124,7 +127,8 @@ ecds_list_item_t * ecds_list_find_item(ecds_list_t * list, ecds_object_t * obj);
  * @brief Fetch an item from the list at a specific index.
  * @param list The list to act on.
  * @param index The integer index of the object you want.
- * @return The ecds_object_t that was requested, or NULL if it was not found.
+ * @return The ecds_list_item_t that was requested, or NULL if it was not found.
+ * @note O(1) while the list is unchanged. The first access after a change renumbers the items behind it.
  */
 ecds_list_item_t * ecds_fetch_item(ecds_list_t * list, int index);
 
@@ -140,8 +144,8 @@ ecds_object_t * ecds_list_get_item(ecds_list_t * list, ecds_list_item_t * item);
 /**
  * @brief Convert a list into an array.
  * @param list The list to convert.
- * @return An array of (ecds_object_t *) objects pointing to the list entries. The array is managed by
- *		   the list.
+ * @return An array of (ecds_object_t *) objects pointing to the list entries, followed by NULL. The array is
+ *		   managed by the list and valid until the list changes.
  */
 ecds_object_t ** ecds_list_to_array(ecds_list_t * list);
 
@@ -186,45 +190,58 @@ ecds_list_t * ecds_list_zip(ecds_list_t * list1, ecds_list_t * list2);
  * @brief Split a list. The list is cut after the item at position and the remainder is returned.
  * @param list The list to split.
  * @param position The position in the list where to split.
- * @return The tail end of the split list.
+ * @return The tail end of the split list. The items are moved, not copied, and keep their references.
  */
 ecds_list_t * ecds_list_split(ecds_list_t * list, unsigned int position);
 
 /**
- * @brief Insert a list item at a specific position.
+ * @brief Insert the objects of a list at a specific position.
  * @param list1 The list to act on.
- * @param position The index after which to insert the object.
- * @param list2 The list to insert.
- * @return The merged list.
+ * @param position The index after which to insert the objects. Positions at or behind the end append them.
+ * @param list The list to insert. Its objects are referenced again, it is left unchanged.
+ * @return list1, or NULL if an argument is invalid.
  */
 ecds_list_t * ecds_list_insert_list(ecds_list_t * list1, unsigned int position, ecds_list_t * list);
 
 /**
  * @brief Insert a list item at a specific position.
  * @param list The list to act on.
- * @param position The index after which to insert the object.
- * @param item The item to insert.
+ * @param position The index after which to insert the object. Positions at or behind the end append it.
+ * @param item The item to insert. It must not be in a list.
  */
 void ecds_list_insert_item(ecds_list_t * list1, unsigned int position, ecds_list_item_t * item);
 
 /**
  * @brief Sort a list with a user-defined comparison function.
- * @param list The list to sort.
+ * @param list The list to sort. The items are relinked in place, none are allocated or copied.
  * @param compare_func A pointed to a boolean function which returns TRUE if object a should be sorted behind object b, and false otherwise.
- * @return A merged list with the items of both lists merged together.
+ * @note The sort is a stable merge sort: items that compare equal keep their order. It takes O(n log n) comparisons.
  */
 void ecds_list_sort(ecds_list_t * list, bool (* compare_func)(ecds_object_t * a, ecds_object_t * b));
 
+/**
+ * @brief Sort a list on several threads. The list is cut into one run per thread, the runs are sorted
+ *		  concurrently and then merged pairwise, also concurrently.
+ * @param list The list to sort. The items are relinked in place, none are allocated or copied.
+ * @param compare_func As for ecds_list_sort(). It is called from several threads at once.
+ * @param thread_count The number of threads to use, 0 for the number of processors. Lists with fewer than
+ *		  ECDS_LIST_PARALLEL_SORT_MIN items per thread use fewer threads.
+ * @note The result is the same as that of ecds_list_sort().
+ */
+void ecds_list_sort_parallel(ecds_list_t * list, bool (* compare_func)(ecds_object_t * a, ecds_object_t * b), uint32_t thread_count);
+
 /**
  * @brief Copy part of the list into a new list.
  * @param list The list to copy from.
  * @param from The index of the first item to copy.
- * @param to The index of the last item to copy.
- * @return A merged list with the items of both lists merged together.
+ * @param to The index of the last item to copy. Lists shorter than that are copied up to their end.
+ * @return A new list with the items from and to, or NULL if from is behind to.
  */
 ecds_list_t * ecds_list_sublist(ecds_list_t * list, unsigned int from, unsigned int to);
 
 ecds_object_t * ecds_list_construct_object();
+
+//!< @brief Destructor of list objects. Frees the index of the list, the items are left to ecds_list_dispose().
 void ecds_list_dispose_object(ecds_object_t * obj);
 
 #endif /* _ECDS_LIST_H */
\ No newline at end of file
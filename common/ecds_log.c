@@ -1,76 +1,1133 @@
+/*****************************************************************************/
+/*	@file ecds_log.c													 	 */
+/*	@brief ECDS logging.													 */
+/*																			 */
+/*	Every thread that logs gets a ring of fixed-size entries that only it	 */
+/*	writes and only the background thread reads, so queueing a message		 */
+/*	takes two atomic loads and a store. An entry holds the format pointer	 */
+/*	and the arguments the format asks for, each a type tag followed by		 */
+/*	the value; strings are copied into the entry as far as they fit.		 */
+/*																			 */
+/*	The background thread merges the rings by timestamp, formats the		 */
+/*	entries with snprintf() one conversion at a time, and hands them to		 */
+/*	the sinks. While the rings are empty it wakes up every few				 */
+/*	milliseconds. Threads only signal it for warnings and worse and when	 */
+/*	their ring fills up to half, so queueing a debug message normally		 */
+/*	takes no system call. Each pass only goes as far as the rings were		 */
+/*	filled when it started, which lets ecds_log_flush() wait for a pass		 */
+/*	instead of for the rings to be empty.									 */
+/*																			 */
+/*	The logger allocates with malloc(), because the memory manager logs.	 */
+/*																			 */
+/*****************************************************************************/
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <time.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
 
 #include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <common/ecds_log_sink.h>
+
 #define ECDS_LOG_DOMAIN "ecds-log"
 
-int ecds_log_current_level = ECDS_INFO;
+//!< Bytes of arguments an entry can hold, which makes an entry 256 bytes.
+#define ECDS_LOG_ARGUMENT_SIZE			224
+
+//!< Longest time the background thread sleeps without being signalled.
+#define ECDS_LOG_SLEEP_NS				10000000l
+
+//!< Longest conversion specification that is formatted, such as "%-+08.3lld".
+#define ECDS_LOG_SPEC_SIZE				32
+
+typedef struct _ecds_log_entry_t ecds_log_entry_t;
+typedef struct _ecds_log_ring_t ecds_log_ring_t;
+typedef struct _ecds_log_domain_t ecds_log_domain_t;
+typedef struct _ecds_log_conversion_t ecds_log_conversion_t;
+
+//!< Type tags of captured arguments, one per C type printf reads.
+enum
+{
+	ECDS_LOG_ARG_NONE = 0,				//!< %% and %n, which take no captured argument
+	ECDS_LOG_ARG_INT,
+	ECDS_LOG_ARG_LONG,
+	ECDS_LOG_ARG_LLONG,
+	ECDS_LOG_ARG_INTMAX,
+	ECDS_LOG_ARG_SIZE,
+	ECDS_LOG_ARG_PTRDIFF,
+	ECDS_LOG_ARG_DOUBLE,
+	ECDS_LOG_ARG_LDOUBLE,
+	ECDS_LOG_ARG_POINTER,
+	ECDS_LOG_ARG_STRING					//!< uint16_t length, then the characters and a NUL
+};
+
+struct _ecds_log_entry_t {
+	uint64_t timestamp;
+	const char * domain;
+	const char * fmt;
+	int16_t level;
+	uint16_t length;					//!< Bytes of arguments used
+	bool truncated;						//!< Not all arguments fit
+	uint8_t arguments[ECDS_LOG_ARGUMENT_SIZE];
+};
+
+struct _ecds_log_ring_t {
+	ecds_log_ring_t * next;				//!< All rings, changed under logger_mutex
+	uint32_t thread;
+	uint32_t mask;
+	bool closed;						//!< Set when the thread exits
+	ecds_log_entry_t * entries;			//!< Allocated the first time the thread queues a message
+
+	/* Only used by the thread that drains */
+	uint64_t target;					//!< Head when the current pass started
+	uint64_t reported;					//!< Drops that were counted
+
+	char producer_line[64];				//!< Keeps head and tail on separate cache lines
+	uint64_t head;						//!< Next entry to fill, written by the thread
+	uint64_t dropped;
+	char consumer_line[64];
+	uint64_t tail;						//!< Next entry to write out, written by the draining thread
+};
+
+struct _ecds_log_domain_t {
+	char name[48];
+	int level;
+};
+
+//!< One conversion specification of a format.
+struct _ecds_log_conversion_t {
+	size_t length;						//!< From the % up to and including the conversion character
+	int stars;							//!< Number of * for width and precision, which take int arguments
+	int precision;						//!< Digits after the ., -1 without a precision and -2 for .*
+	bool positional;					//!< Uses a %n$ argument number, which cannot be captured
+	int type;							//!< ECDS_LOG_ARG constant
+	char conversion;
+};
+
+static struct {
+	pthread_mutex_t logger_mutex[1];	//!< Protects the sinks, the domains, the ring list and the thread
+	pthread_mutex_t wake_mutex[1];
+	pthread_cond_t wake_cond[1];		//!< Signalled to wake the background thread
+	pthread_cond_t drained_cond[1];		//!< Broadcast after every pass
+	pthread_once_t key_once;
+	pthread_key_t ring_key;
+	pthread_t thread;
+
+	bool running;						//!< Whether messages are queued
+	bool stopping;
+	bool sleeping;
+	bool exit_registered;
+	uint32_t ring_slots;
+	uint64_t flush_requests;
+	uint64_t flushed;					//!< Value of flush_requests when the last complete pass started
+
+	ecds_log_ring_t * rings;
+	uint32_t ring_count;
+	uint32_t thread_count;
+
+	ecds_log_sink_t * sinks[ECDS_LOG_MAX_SINKS];
+	uint32_t sink_count;
+	bool sinks_initialized;
+
+	int level;
+	ecds_log_domain_t domains[ECDS_LOG_MAX_DOMAINS];
+	uint32_t domain_count;
+
+	uint64_t written;
+	uint64_t dropped;					//!< Drops of rings that were freed or reported
+	uint64_t truncated;
+} ecds_logger = {
+	.logger_mutex = { PTHREAD_MUTEX_INITIALIZER },
+	.wake_mutex = { PTHREAD_MUTEX_INITIALIZER },
+	.wake_cond = { PTHREAD_COND_INITIALIZER },
+	.drained_cond = { PTHREAD_COND_INITIALIZER },
+	.key_once = PTHREAD_ONCE_INIT,
+	.level = ECDS_INFO,
+};
 
-void ecds_log_format_default(char * target, int length, int level, const char * domain, const char * fmt, va_list arguments)
+int ecds_log_threshold = ECDS_INFO;
+
+static uint64_t _ecds_log_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//=================================== 8< ====================================//
+//	Levels																	 //
+//===========================================================================//
+
+/* Recompute the lowest level of all domains, called with logger_mutex held */
+static void _ecds_log_update_threshold(void)
+{
+	int threshold = ecds_logger.level, level;
+	uint32_t i;
+
+	for (i = 0; i < ecds_logger.domain_count; i++)
+	{
+		level = ecds_atomic_load(&ecds_logger.domains[i].level);
+		if (level != ECDS_LOG_INHERIT && level < threshold)
+			threshold = level;
+	}
+
+	ecds_atomic_store(&ecds_log_threshold, threshold);
+}
+
+int ecds_log_get_level(const char * domain)
 {
-	int position = 0;
+	uint32_t count = ecds_atomic_load(&ecds_logger.domain_count), i;
+	int level;
+
+	/* Domains are only ever added, and the count is raised after the name is in place */
+	for (i = 0; domain && i < count; i++)
+	{
+		if (strcmp(ecds_logger.domains[i].name, domain) == 0)
+		{
+			level = ecds_atomic_load(&ecds_logger.domains[i].level);
+			if (level != ECDS_LOG_INHERIT)
+				return level;
+			break;
+		}
+	}
+
+	return ecds_atomic_load(&ecds_logger.level);
+}
 
-	if (level < ecds_log_current_level)
+bool ecds_log_enabled(int level, const char * domain)
+{
+	return level >= ECDS_FATAL || level >= ecds_log_get_level(domain);
+}
+
+void ecds_log_set_level(int new_level)
+{
+	if (new_level < ECDS_DEBUG || new_level > ECDS_FATAL)
+	{
+		ecds_log_error("Invalid log level specified");
 		return;
-	/* TODO: Add date/time stamp to default logging messages */
-	sprintf(target, "[%s] ", domain);
-	position += strlen(target);
+	}
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	ecds_atomic_store(&ecds_logger.level, new_level);
+	_ecds_log_update_threshold();
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+}
+
+int ecds_log_set_domain_level(const char * domain, int level)
+{
+	uint32_t i;
+	int ret = 0;
 
-	switch (level)
+	if (!domain || strlen(domain) >= sizeof(ecds_logger.domains[0].name) ||
+		(level != ECDS_LOG_INHERIT && (level < ECDS_DEBUG || level > ECDS_FATAL)))
+		return -1;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+
+	for (i = 0; i < ecds_logger.domain_count; i++)
 	{
-	case ECDS_DEBUG:
-		sprintf(target + position, "D: ");
-		break;
-	case ECDS_INFO:
-		sprintf(target + position, "I: ");
-		break;
-	case ECDS_WARN:
-		sprintf(target + position, "W: ");
+		if (strcmp(ecds_logger.domains[i].name, domain) == 0)
+			break;
+	}
+
+	if (i < ecds_logger.domain_count)
+		ecds_atomic_store(&ecds_logger.domains[i].level, level);
+	else if (i < ECDS_LOG_MAX_DOMAINS)
+	{
+		strcpy(ecds_logger.domains[i].name, domain);
+		ecds_logger.domains[i].level = level;
+		ecds_atomic_store(&ecds_logger.domain_count, i + 1);
+	}
+	else
+		ret = -1;
+
+	_ecds_log_update_threshold();
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	return ret;
+}
+
+//=================================== 8< ====================================//
+//	Formatting																 //
+//===========================================================================//
+
+/* Parse the conversion specification at fmt, which points at a %. Returns false if it is invalid. */
+static bool _ecds_log_parse_conversion(const char * fmt, ecds_log_conversion_t * conversion)
+{
+	const char * p = fmt + 1;
+	int modifier = 0;
+
+	conversion->stars = 0;
+	conversion->precision = -1;
+
+	/* Argument numbers are rejected, a format has to use them for all of its conversions */
+	p += strspn(p, "0123456789");
+	conversion->positional = *p == '$';
+	if (conversion->positional)
+		return false;
+	p = fmt + 1;
+
+	p += strspn(p, "-+ #0'");
+	if (*p == '*')
+	{
+		conversion->stars++;
+		p++;
+	}
+	else
+		p += strspn(p, "0123456789");
+
+	if (*p == '.')
+	{
+		p++;
+		if (*p == '*')
+		{
+			conversion->stars++;
+			conversion->precision = -2;
+			p++;
+		}
+		else
+		{
+			conversion->precision = atoi(p);
+			p += strspn(p, "0123456789");
+		}
+	}
+
+	/* Length modifiers, l and h count double when repeated */
+	switch (*p)
+	{
+	case 'h':
+		modifier = 'h';
+		p += p[1] == 'h' ? 2 : 1;
 		break;
-	case ECDS_ERROR:
-		sprintf(target + position, "E: ");
+	case 'l':
+		modifier = p[1] == 'l' ? 'q' : 'l';
+		p += p[1] == 'l' ? 2 : 1;
 		break;
-	case ECDS_FATAL:
-		sprintf(target + position, "F: ");
+	case 'q':
+	case 'j':
+	case 'z':
+	case 't':
+	case 'L':
+		modifier = *p++;
 		break;
 	}
-	position += 3;
 
-	vsprintf(target + position, fmt, arguments);
+	conversion->conversion = *p;
+	conversion->length = (size_t)(p - fmt) + 1;
+
+	switch (*p)
+	{
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'c':
+		conversion->type = modifier == 'l' ? ECDS_LOG_ARG_LONG : modifier == 'q' ? ECDS_LOG_ARG_LLONG :
+			modifier == 'j' ? ECDS_LOG_ARG_INTMAX : modifier == 'z' ? ECDS_LOG_ARG_SIZE :
+			modifier == 't' ? ECDS_LOG_ARG_PTRDIFF : ECDS_LOG_ARG_INT;
+		return *p != 'c' || modifier == 0;
+
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		conversion->type = modifier == 'L' ? ECDS_LOG_ARG_LDOUBLE : ECDS_LOG_ARG_DOUBLE;
+		return true;
+
+	case 'p':
+		conversion->type = ECDS_LOG_ARG_POINTER;
+		return modifier == 0;
+
+	case 's':
+		conversion->type = ECDS_LOG_ARG_STRING;
+		return modifier == 0;
+
+	case 'n':
+		conversion->type = ECDS_LOG_ARG_NONE;
+		return true;
+
+	case '%':
+		conversion->type = ECDS_LOG_ARG_NONE;
+		return conversion->length == 2;
+
+	default:
+		return false;
+	}
+}
+
+static bool _ecds_log_put(ecds_log_entry_t * entry, int type, const void * value, size_t size)
+{
+	if (entry->length + 1 + size > ECDS_LOG_ARGUMENT_SIZE)
+	{
+		entry->truncated = true;
+		return false;
+	}
+
+	entry->arguments[entry->length] = (uint8_t)type;
+	memcpy(entry->arguments + entry->length + 1, value, size);
+	entry->length += (uint16_t)(1 + size);
+
+	return true;
+}
+
+/* Copy the arguments fmt asks for into an entry, returns false if fmt has to be formatted right away */
+static bool _ecds_log_capture(ecds_log_entry_t * entry, const char * fmt, va_list arguments)
+{
+	ecds_log_conversion_t conversion;
+	const char * string;
+	uint16_t length;
+	size_t room, limit;
+	int stars[2], i;
+
+	union {
+		int i;
+		long l;
+		long long ll;
+		intmax_t j;
+		size_t z;
+		ptrdiff_t t;
+		double d;
+		long double ld;
+		void * p;
+	} value;
+
+	while ((fmt = strchr(fmt, '%')))
+	{
+		if (!_ecds_log_parse_conversion(fmt, &conversion))
+			/* The formatter prints the rest of the format as it is */
+			return !conversion.positional;
+		fmt += conversion.length;
+
+		for (i = 0; i < conversion.stars; i++)
+		{
+			stars[i] = va_arg(arguments, int);
+			if (!_ecds_log_put(entry, ECDS_LOG_ARG_INT, &stars[i], sizeof(int)))
+				return true;
+		}
+		if (conversion.precision == -2)
+			/* A negative precision taken from the arguments means there is none */
+			conversion.precision = stars[conversion.stars - 1] < 0 ? -1 : stars[conversion.stars - 1];
+
+		switch (conversion.type)
+		{
+		case ECDS_LOG_ARG_NONE:
+			/* %n is not supported, its pointer is skipped */
+			if (conversion.conversion == 'n')
+				(void)va_arg(arguments, void *);
+			continue;
+
+		case ECDS_LOG_ARG_INT:		value.i = va_arg(arguments, int);						break;
+		case ECDS_LOG_ARG_LONG:		value.l = va_arg(arguments, long);						break;
+		case ECDS_LOG_ARG_LLONG:	value.ll = va_arg(arguments, long long);				break;
+		case ECDS_LOG_ARG_INTMAX:	value.j = va_arg(arguments, intmax_t);					break;
+		case ECDS_LOG_ARG_SIZE:		value.z = va_arg(arguments, size_t);					break;
+		case ECDS_LOG_ARG_PTRDIFF:	value.t = va_arg(arguments, ptrdiff_t);					break;
+		case ECDS_LOG_ARG_DOUBLE:	value.d = va_arg(arguments, double);					break;
+		case ECDS_LOG_ARG_LDOUBLE:	value.ld = va_arg(arguments, long double);				break;
+		case ECDS_LOG_ARG_POINTER:	value.p = va_arg(arguments, void *);					break;
+
+		case ECDS_LOG_ARG_STRING:
+			if (!(string = va_arg(arguments, const char *)))
+				string = "(null)";
+
+			/* Keep as much of the string as fits, and stop there */
+			room = ECDS_LOG_ARGUMENT_SIZE - entry->length;
+			if (room < 4)
+			{
+				entry->truncated = true;
+				return true;
+			}
+			/* With a precision the string does not need a NUL, so nothing beyond it may be read */
+			limit = room - 4;
+			if (conversion.precision >= 0 && (size_t)conversion.precision < limit)
+				limit = (size_t)conversion.precision;
+			length = (uint16_t)strnlen(string, limit);
+			entry->arguments[entry->length] = ECDS_LOG_ARG_STRING;
+			memcpy(entry->arguments + entry->length + 1, &length, sizeof(length));
+			memcpy(entry->arguments + entry->length + 3, string, length);
+			entry->arguments[entry->length + 3 + length] = '\0';
+			entry->length += (uint16_t)(4 + length);
+			if (length == room - 4 && length != (size_t)conversion.precision && string[length])
+			{
+				entry->truncated = true;
+				return true;
+			}
+			continue;
+		}
+
+		if (!_ecds_log_put(entry, conversion.type, &value, conversion.type == ECDS_LOG_ARG_INT ? sizeof(int) :
+				conversion.type == ECDS_LOG_ARG_LDOUBLE ? sizeof(long double) : sizeof(long long)))
+			return true;
+	}
+
+	return true;
+}
+
+/* Take the next captured argument, which has to be of the expected type */
+static const uint8_t * _ecds_log_take(const ecds_log_entry_t * entry, size_t * position, int type, size_t size)
+{
+	const uint8_t * value;
+
+	if (*position + 1 + size > entry->length || entry->arguments[*position] != type)
+		return NULL;
+
+	value = entry->arguments + *position + 1;
+	*position += 1 + size;
+
+	return value;
+}
+
+/* Append at most size - *length bytes to message, returns false once the message is full */
+static bool _ecds_log_append(char * message, size_t * length, int written)
+{
+	(void)message;
+
+	if (written < 0)
+		return false;
+
+	if ((size_t)written >= ECDS_LOG_MESSAGE_SIZE - *length)
+	{
+		*length = ECDS_LOG_MESSAGE_SIZE - 1;
+		return false;
+	}
+
+	*length += (size_t)written;
+	return true;
 }
 
-void ecds_log_output_default(char* message)
+#define _ECDS_LOG_PRINT(type) \
+	do { \
+		type v; \
+		memcpy(&v, data, sizeof(type)); \
+		written = conversion.stars == 0 ? snprintf(target, room, spec, v) : \
+			conversion.stars == 1 ? snprintf(target, room, spec, stars[0], v) : \
+			snprintf(target, room, spec, stars[0], stars[1], v); \
+	} while (0)
+
+/* Format an entry the way vsnprintf() would have formatted the arguments it was made from */
+static bool _ecds_log_format_entry(const ecds_log_entry_t * entry, char * message, size_t * length)
+{
+	ecds_log_conversion_t conversion;
+	const char * fmt = entry->fmt, * next;
+	char spec[ECDS_LOG_SPEC_SIZE], * target;
+	size_t position = 0, room, size;
+	const uint8_t * data;
+	int stars[2], written, i;
+	uint16_t string_length;
+
+	*length = 0;
+	message[0] = '\0';
+
+	while (*fmt)
+	{
+		next = strchr(fmt, '%');
+		size = next ? (size_t)(next - fmt) : strlen(fmt);
+		if (!_ecds_log_append(message, length, snprintf(message + *length, ECDS_LOG_MESSAGE_SIZE - *length, "%.*s", (int)size, fmt)))
+			return false;
+		if (!next)
+			return true;
+
+		fmt = next;
+		if (!_ecds_log_parse_conversion(fmt, &conversion) || conversion.length >= sizeof(spec))
+			/* Print what cannot be parsed as it is */
+			return _ecds_log_append(message, length, snprintf(message + *length, ECDS_LOG_MESSAGE_SIZE - *length, "%s", fmt));
+
+		memcpy(spec, fmt, conversion.length);
+		spec[conversion.length] = '\0';
+		fmt += conversion.length;
+
+		if (conversion.type == ECDS_LOG_ARG_NONE)
+		{
+			if (conversion.conversion == '%' && !_ecds_log_append(message, length, snprintf(message + *length, ECDS_LOG_MESSAGE_SIZE - *length, "%%")))
+				return false;
+			continue;
+		}
+
+		for (i = 0; i < conversion.stars; i++)
+		{
+			if (!(data = _ecds_log_take(entry, &position, ECDS_LOG_ARG_INT, sizeof(int))))
+				return false;
+			memcpy(&stars[i], data, sizeof(int));
+		}
+
+		target = message + *length;
+		room = ECDS_LOG_MESSAGE_SIZE - *length;
+
+		if (conversion.type == ECDS_LOG_ARG_STRING)
+		{
+			if (!(data = _ecds_log_take(entry, &position, ECDS_LOG_ARG_STRING, 2)))
+				return false;
+			memcpy(&string_length, data, sizeof(string_length));
+			if (position + string_length + 1 > entry->length)
+				return false;
+			data = entry->arguments + position;
+			position += string_length + 1;
+
+			written = conversion.stars == 0 ? snprintf(target, room, spec, (const char *)data) :
+				conversion.stars == 1 ? snprintf(target, room, spec, stars[0], (const char *)data) :
+				snprintf(target, room, spec, stars[0], stars[1], (const char *)data);
+		}
+		else
+		{
+			if (!(data = _ecds_log_take(entry, &position, conversion.type, conversion.type == ECDS_LOG_ARG_INT ? sizeof(int) :
+					conversion.type == ECDS_LOG_ARG_LDOUBLE ? sizeof(long double) : sizeof(long long))))
+				return false;
+
+			switch (conversion.type)
+			{
+			case ECDS_LOG_ARG_INT:		_ECDS_LOG_PRINT(int);			break;
+			case ECDS_LOG_ARG_LONG:		_ECDS_LOG_PRINT(long);			break;
+			case ECDS_LOG_ARG_LLONG:	_ECDS_LOG_PRINT(long long);		break;
+			case ECDS_LOG_ARG_INTMAX:	_ECDS_LOG_PRINT(intmax_t);		break;
+			case ECDS_LOG_ARG_SIZE:		_ECDS_LOG_PRINT(size_t);		break;
+			case ECDS_LOG_ARG_PTRDIFF:	_ECDS_LOG_PRINT(ptrdiff_t);		break;
+			case ECDS_LOG_ARG_DOUBLE:	_ECDS_LOG_PRINT(double);		break;
+			case ECDS_LOG_ARG_LDOUBLE:	_ECDS_LOG_PRINT(long double);	break;
+			default:					_ECDS_LOG_PRINT(void *);		break;
+			}
+		}
+
+		if (!_ecds_log_append(message, length, written))
+			return false;
+	}
+
+	return true;
+}
+
+//=================================== 8< ====================================//
+//	Sinks																	 //
+//===========================================================================//
+
+/* Called with logger_mutex held */
+static void _ecds_log_init_sinks(void)
 {
-	if (!message)
+	if (ecds_logger.sinks_initialized)
 		return;
-	printf("%s\n", message);
+
+	ecds_logger.sinks_initialized = true;
+	if ((ecds_logger.sinks[0] = ecds_log_stdout_sink_new(ECDS_DEBUG)))
+		ecds_logger.sink_count = 1;
 }
 
-void ecds_log(int level, const char * domain, const char* fmt, ...)
+/* Hand a message to the sinks, called with logger_mutex held */
+static void _ecds_log_dispatch(uint64_t timestamp, uint32_t thread, int level, const char * domain, char * message, size_t length, bool truncated)
 {
-	char log_message[120];
-	va_list arguments;
-	va_start(arguments, fmt);
+	ecds_log_record_t record;
+	uint32_t i;
 
-	/* TODO: Add testing for hooks here so more log methods can attach */
-	ecds_log_format_default(log_message, 120, level, domain, fmt, arguments);
-	ecds_log_output_default(log_message);
+	if (truncated)
+	{
+		/* Make the cut visible */
+		if (length > ECDS_LOG_MESSAGE_SIZE - 4)
+			length = ECDS_LOG_MESSAGE_SIZE - 4;
+		memcpy(message + length, "...", 4);
+		length += 3;
+		ecds_logger.truncated++;
+	}
 
-	va_end(arguments);
+	record.timestamp = timestamp;
+	record.thread = thread;
+	record.level = level;
+	record.domain = domain ? domain : "";
+	record.message = message;
+	record.length = (uint32_t)length;
 
-	if (level == ECDS_FATAL)
-		exit(EXIT_FAILURE);
+	_ecds_log_init_sinks();
+	for (i = 0; i < ecds_logger.sink_count; i++)
+	{
+		if (level >= ecds_logger.sinks[i]->level)
+			ecds_logger.sinks[i]->write(ecds_logger.sinks[i], &record);
+	}
+	ecds_logger.written++;
 }
 
-void ecds_log_set_level(int new_level)
+/* Called with logger_mutex held */
+static void _ecds_log_flush_sinks(void)
 {
-	if (new_level > ECDS_FATAL)
+	uint32_t i;
+
+	for (i = 0; i < ecds_logger.sink_count; i++)
 	{
-		ecds_log_error("Invalid log level specified");
+		if (ecds_logger.sinks[i]->flush)
+			ecds_logger.sinks[i]->flush(ecds_logger.sinks[i]);
+	}
+}
+
+int ecds_log_add_sink(ecds_log_sink_t * sink)
+{
+	uint32_t i;
+
+	if (!sink || !sink->name || !sink->write)
+		return -1;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	_ecds_log_init_sinks();
+
+	for (i = 0; i < ecds_logger.sink_count; i++)
+	{
+		if (strcmp(ecds_logger.sinks[i]->name, sink->name) == 0)
+			break;
+	}
+
+	if (i < ecds_logger.sink_count || ecds_logger.sink_count == ECDS_LOG_MAX_SINKS)
+	{
+		pthread_mutex_unlock(ecds_logger.logger_mutex);
+		return -1;
+	}
+
+	ecds_logger.sinks[ecds_logger.sink_count++] = sink;
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	return 0;
+}
+
+int ecds_log_remove_sink(const char * name)
+{
+	ecds_log_sink_t * sink = NULL;
+	uint32_t i;
+
+	if (!name)
+		return -1;
+
+	ecds_log_flush();
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	_ecds_log_init_sinks();
+
+	for (i = 0; i < ecds_logger.sink_count; i++)
+	{
+		if (strcmp(ecds_logger.sinks[i]->name, name) == 0)
+		{
+			sink = ecds_logger.sinks[i];
+			memmove(&ecds_logger.sinks[i], &ecds_logger.sinks[i + 1], (ecds_logger.sink_count - i - 1) * sizeof(ecds_log_sink_t *));
+			ecds_logger.sink_count--;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	if (!sink)
+		return -1;
+
+	if (sink->close)
+		sink->close(sink);
+	return 0;
+}
+
+//=================================== 8< ====================================//
+//	Rings																	 //
+//===========================================================================//
+
+/* Free a ring that is no longer in the list */
+static void _ecds_log_free_ring(ecds_log_ring_t * ring)
+{
+	free(ring->entries);
+	free(ring);
+}
+
+/* Unlink a ring, called with logger_mutex held */
+static void _ecds_log_unlink_ring(ecds_log_ring_t * ring)
+{
+	ecds_log_ring_t ** link;
+
+	for (link = &ecds_logger.rings; *link; link = &(*link)->next)
+	{
+		if (*link == ring)
+		{
+			ecds_atomic_store(link, ring->next);
+			ecds_logger.ring_count--;
+			ecds_logger.dropped += ecds_atomic_load(&ring->dropped) - ring->reported;
+			return;
+		}
+	}
+}
+
+static void _ecds_log_thread_exit(void * data)
+{
+	ecds_log_ring_t * ring = (ecds_log_ring_t *)data;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+
+	if (ecds_atomic_load(&ring->head) == ecds_atomic_load(&ring->tail) && !ecds_logger.running)
+	{
+		_ecds_log_unlink_ring(ring);
+		_ecds_log_free_ring(ring);
+	}
+	else
+		/* The background thread frees it once it is drained */
+		ecds_atomic_store(&ring->closed, true);
+
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+}
+
+static void _ecds_log_create_key(void)
+{
+	pthread_key_create(&ecds_logger.ring_key, _ecds_log_thread_exit);
+}
+
+/* Get the ring of the calling thread, creating it on the first call */
+static ecds_log_ring_t * _ecds_log_get_ring(void)
+{
+	ecds_log_ring_t * ring;
+
+	pthread_once(&ecds_logger.key_once, _ecds_log_create_key);
+	if ((ring = (ecds_log_ring_t *)pthread_getspecific(ecds_logger.ring_key)))
+		return ring;
+
+	if (!(ring = (ecds_log_ring_t *)calloc(1, sizeof(ecds_log_ring_t))))
+		return NULL;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	ring->thread = ++ecds_logger.thread_count;
+	ring->next = ecds_logger.rings;
+	ecds_atomic_store(&ecds_logger.rings, ring);
+	ecds_logger.ring_count++;
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	pthread_setspecific(ecds_logger.ring_key, ring);
+
+	return ring;
+}
+
+/* Queue a message, returns false if it has to be written directly */
+static bool _ecds_log_enqueue(uint64_t timestamp, int level, const char * domain, const char * fmt, va_list arguments)
+{
+	ecds_log_ring_t * ring;
+	ecds_log_entry_t * entry;
+	uint64_t head, tail;
+	uint32_t slots;
+
+	if (!(ring = _ecds_log_get_ring()))
+		return false;
+
+	if (!ring->entries)
+	{
+		slots = ecds_atomic_load(&ecds_logger.ring_slots);
+		if (!(ring->entries = (ecds_log_entry_t *)malloc(slots * sizeof(ecds_log_entry_t))))
+			return false;
+		ring->mask = slots - 1;
+	}
+
+	head = ring->head;
+	tail = ecds_atomic_load(&ring->tail);
+	if (head - tail > ring->mask)
+	{
+		/* Reported by the background thread */
+		ecds_atomic_increment(&ring->dropped);
+		return true;
+	}
+
+	entry = &ring->entries[head & ring->mask];
+	entry->timestamp = timestamp;
+	entry->domain = domain;
+	entry->fmt = fmt;
+	entry->level = (int16_t)level;
+	entry->length = 0;
+	entry->truncated = false;
+	if (!_ecds_log_capture(entry, fmt, arguments))
+		/* The entry is not published until head moves */
+		return false;
+	ecds_atomic_store(&ring->head, head + 1);
+
+	if ((level >= ECDS_WARN || head + 1 - tail == (ring->mask >> 1) + 1) && ecds_atomic_load_relaxed(&ecds_logger.sleeping))
+	{
+		pthread_mutex_lock(ecds_logger.wake_mutex);
+		pthread_cond_signal(ecds_logger.wake_cond);
+		pthread_mutex_unlock(ecds_logger.wake_mutex);
+	}
+
+	return true;
+}
+
+/* Write out everything that was queued when the pass started, called with logger_mutex held */
+static void _ecds_log_drain(void)
+{
+	char message[ECDS_LOG_MESSAGE_SIZE], note[64];
+	ecds_log_ring_t * ring, * best, * next;
+	ecds_log_entry_t * entry;
+	uint64_t dropped;
+	size_t length;
+	bool complete;
+
+	for (ring = ecds_atomic_load(&ecds_logger.rings); ring; ring = ring->next)
+	{
+		ring->target = ecds_atomic_load(&ring->head);
+
+		dropped = ecds_atomic_load(&ring->dropped);
+		if (dropped != ring->reported)
+		{
+			length = (size_t)snprintf(note, sizeof(note), "%llu messages dropped by thread %u",
+				(unsigned long long)(dropped - ring->reported), ring->thread);
+			_ecds_log_dispatch(_ecds_log_now(), ring->thread, ECDS_WARN, ECDS_LOG_DOMAIN, note, length, false);
+			ecds_logger.dropped += dropped - ring->reported;
+			ring->reported = dropped;
+		}
+	}
+
+	/* Merge the rings by timestamp */
+	for (;;)
+	{
+		best = NULL;
+		for (ring = ecds_atomic_load(&ecds_logger.rings); ring; ring = ring->next)
+		{
+			if (ring->tail != ring->target &&
+				(!best || ring->entries[ring->tail & ring->mask].timestamp < best->entries[best->tail & best->mask].timestamp))
+				best = ring;
+		}
+
+		if (!best)
+			break;
+
+		entry = &best->entries[best->tail & best->mask];
+		complete = _ecds_log_format_entry(entry, message, &length);
+		_ecds_log_dispatch(entry->timestamp, best->thread, entry->level, entry->domain, message, length, entry->truncated || !complete);
+		ecds_atomic_store(&best->tail, best->tail + 1);
+	}
+
+	/* Rings of threads that exited are not needed any more */
+	for (ring = ecds_atomic_load(&ecds_logger.rings); ring; ring = next)
+	{
+		next = ring->next;
+		if (ecds_atomic_load(&ring->closed) && ring->tail == ecds_atomic_load(&ring->head))
+		{
+			_ecds_log_unlink_ring(ring);
+			_ecds_log_free_ring(ring);
+		}
+	}
+}
+
+static bool _ecds_log_pending(void)
+{
+	ecds_log_ring_t * ring;
+
+	for (ring = ecds_atomic_load(&ecds_logger.rings); ring; ring = ecds_atomic_load(&ring->next))
+	{
+		if (ecds_atomic_load(&ring->head) != ecds_atomic_load(&ring->tail) ||
+			ecds_atomic_load(&ring->dropped) != ring->reported)
+			return true;
+	}
+
+	return false;
+}
+
+static void * _ecds_log_thread(void * data)
+{
+	struct timespec deadline;
+	uint64_t requests, until;
+	bool stopping;
+
+	(void)data;
+
+	for (;;)
+	{
+		pthread_mutex_lock(ecds_logger.logger_mutex);
+		requests = ecds_atomic_load(&ecds_logger.flush_requests);
+		stopping = ecds_logger.stopping;
+		_ecds_log_drain();
+		if (requests != ecds_logger.flushed)
+			_ecds_log_flush_sinks();
+		pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+		pthread_mutex_lock(ecds_logger.wake_mutex);
+		ecds_logger.flushed = requests;
+		pthread_cond_broadcast(ecds_logger.drained_cond);
+
+		if (stopping)
+		{
+			pthread_mutex_unlock(ecds_logger.wake_mutex);
+			break;
+		}
+
+		/* Producers check the flag after publishing their entry, so one of both sees the other */
+		ecds_atomic_store(&ecds_logger.sleeping, true);
+		if (!_ecds_log_pending() && ecds_atomic_load(&ecds_logger.flush_requests) == requests && !ecds_atomic_load(&ecds_logger.stopping))
+		{
+			until = _ecds_log_now() + ECDS_LOG_SLEEP_NS;
+			deadline.tv_sec = (time_t)(until / 1000000000ull);
+			deadline.tv_nsec = (long)(until % 1000000000ull);
+			pthread_cond_timedwait(ecds_logger.wake_cond, ecds_logger.wake_mutex, &deadline);
+		}
+		ecds_atomic_store(&ecds_logger.sleeping, false);
+		pthread_mutex_unlock(ecds_logger.wake_mutex);
+	}
+
+	return NULL;
+}
+
+static void _ecds_log_at_exit(void)
+{
+	ecds_log_stop();
+}
+
+int ecds_log_start(uint32_t ring_slots)
+{
+	uint32_t slots = 1;
+	int ret = 0;
+
+	if (!ring_slots)
+		ring_slots = ECDS_LOG_DEFAULT_RING_SLOTS;
+	while (slots < ring_slots && slots < (1u << 20))
+		slots <<= 1;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+
+	if (!ecds_logger.running)
+	{
+		/* Rings keep the size they were created with */
+		ecds_atomic_store(&ecds_logger.ring_slots, slots);
+		ecds_logger.stopping = false;
+		ecds_logger.flushed = ecds_atomic_load(&ecds_logger.flush_requests);
+
+		if (pthread_create(&ecds_logger.thread, NULL, _ecds_log_thread, NULL) != 0)
+			ret = -1;
+		else
+		{
+			ecds_atomic_store(&ecds_logger.running, true);
+			if (!ecds_logger.exit_registered)
+				ecds_logger.exit_registered = atexit(_ecds_log_at_exit) == 0;
+		}
+	}
+
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	if (ret < 0)
+		ecds_log_error("Cannot start the logging thread, messages are written directly");
+
+	return ret;
+}
+
+void ecds_log_stop(void)
+{
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+
+	if (!ecds_logger.running || ecds_logger.stopping)
+	{
+		pthread_mutex_unlock(ecds_logger.logger_mutex);
+		return;
+	}
+
+	ecds_atomic_store(&ecds_logger.stopping, true);
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	pthread_mutex_lock(ecds_logger.wake_mutex);
+	pthread_cond_signal(ecds_logger.wake_cond);
+	pthread_mutex_unlock(ecds_logger.wake_mutex);
+	pthread_join(ecds_logger.thread, NULL);
+
+	/* Exiting threads free their own rings once running is cleared, so the background thread must be gone */
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	ecds_atomic_store(&ecds_logger.running, false);
+
+	/* Threads that saw the logger running just before it stopped */
+	_ecds_log_drain();
+	_ecds_log_flush_sinks();
+	ecds_atomic_store(&ecds_logger.stopping, false);
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	/* Flushes requested after the last pass stop waiting */
+	pthread_mutex_lock(ecds_logger.wake_mutex);
+	pthread_cond_broadcast(ecds_logger.drained_cond);
+	pthread_mutex_unlock(ecds_logger.wake_mutex);
+}
+
+void ecds_log_flush(void)
+{
+	uint64_t request;
+
+	if (ecds_atomic_load(&ecds_logger.running))
+	{
+		request = ecds_atomic_increment(&ecds_logger.flush_requests);
+
+		pthread_mutex_lock(ecds_logger.wake_mutex);
+		pthread_cond_signal(ecds_logger.wake_cond);
+		while (ecds_logger.flushed < request && ecds_atomic_load(&ecds_logger.running))
+			pthread_cond_wait(ecds_logger.drained_cond, ecds_logger.wake_mutex);
+		pthread_mutex_unlock(ecds_logger.wake_mutex);
+	}
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	_ecds_log_flush_sinks();
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+}
+
+void ecds_log_get_stats(ecds_log_stats_t * stats)
+{
+	ecds_log_ring_t * ring;
+
+	if (!stats)
 		return;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+
+	stats->written = ecds_logger.written;
+	stats->dropped = ecds_logger.dropped;
+	stats->truncated = ecds_logger.truncated;
+	stats->rings = ecds_logger.ring_count;
+	for (ring = ecds_logger.rings; ring; ring = ring->next)
+		stats->dropped += ecds_atomic_load(&ring->dropped) - ring->reported;
+
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+}
+
+//=================================== 8< ====================================//
+
+void ecds_log(int level, const char * domain, const char* fmt, ...)
+{
+	char message[ECDS_LOG_MESSAGE_SIZE];
+	uint64_t timestamp;
+	va_list arguments;
+	ecds_log_ring_t * ring;
+	int length;
+
+	if (!fmt || !ecds_log_enabled(level, domain))
+		return;
+
+	timestamp = _ecds_log_now();
+
+	if (level >= ECDS_FATAL)
+		/* Everything that led up to this has to be out before the program ends */
+		ecds_log_stop();
+	else if (ecds_atomic_load(&ecds_logger.running))
+	{
+		va_start(arguments, fmt);
+		if (_ecds_log_enqueue(timestamp, level, domain, fmt, arguments))
+		{
+			va_end(arguments);
+			return;
+		}
+		va_end(arguments);
 	}
 
-	ecds_log_current_level = new_level;
-}
\ No newline at end of file
+	ring = _ecds_log_get_ring();
+
+	va_start(arguments, fmt);
+	length = vsnprintf(message, sizeof(message), fmt, arguments);
+	va_end(arguments);
+
+	if (length < 0)
+		length = 0;
+
+	pthread_mutex_lock(ecds_logger.logger_mutex);
+	_ecds_log_dispatch(timestamp, ring ? ring->thread : 0, level, domain, message,
+		(size_t)length < sizeof(message) ? (size_t)length : sizeof(message) - 1, (size_t)length >= sizeof(message));
+	if (level >= ECDS_FATAL)
+		_ecds_log_flush_sinks();
+	pthread_mutex_unlock(ecds_logger.logger_mutex);
+
+	if (level >= ECDS_FATAL)
+		exit(EXIT_FAILURE);
+}
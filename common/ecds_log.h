@@ -1,4 +1,33 @@
-#pragma once
+/*****************************************************************************/
+/*	@file ecds_log.h													 	 */
+/*	@brief ECDS logging.													 */
+/*																			 */
+/*	Every source file defines ECDS_LOG_DOMAIN and logs through the			 */
+/*	ecds_log_* macros. A message is only produced if its level reaches the	 */
+/*	level of its domain, which is the global level unless one was set for	 */
+/*	the domain. The macros compare against the lowest level of all domains	 */
+/*	before they evaluate their arguments, so a disabled debug message		 */
+/*	costs a load and a branch. Levels below ECDS_LOG_MIN_LEVEL, which the	 */
+/*	build sets, are not compiled in at all.									 */
+/*																			 */
+/*	Messages are written to the registered sinks, see ecds_log_sink.h. By	 */
+/*	default this happens on the calling thread. After ecds_log_start(),		 */
+/*	the calling thread only copies the format pointer and the arguments		 */
+/*	into a ring buffer of its own, and a background thread formats and		 */
+/*	writes the messages. Formats and domains have to stay valid until the	 */
+/*	message is written, which string literals do; string arguments are		 */
+/*	copied. Messages that do not fit in a full ring are dropped and			 */
+/*	counted instead of blocking the caller.									 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_LOG_H
+#define _ECDS_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <common/ecds_atomic.h>
 
 #define ECDS_DEBUG 0
 #define ECDS_INFO  1
@@ -6,22 +35,123 @@
 #define ECDS_ERROR 3
 #define ECDS_FATAL 4
 
+//!< Level of a domain that follows the global level, see ecds_log_set_domain_level().
+#define ECDS_LOG_INHERIT				(-1)
+
+#define ECDS_LOG_MESSAGE_SIZE			512		//!< Longest formatted message including the NUL, longer ones are truncated
+#define ECDS_LOG_MAX_DOMAINS			64		//!< Number of domains that can have their own level
+#define ECDS_LOG_MAX_SINKS				16
+#define ECDS_LOG_DEFAULT_RING_SLOTS		256		//!< Messages a thread can have queued before they are dropped
+
+//!< Lowest level that is compiled in. Calls below it are constant false and removed, fatal messages are always kept.
+#ifndef ECDS_LOG_MIN_LEVEL
+	#define ECDS_LOG_MIN_LEVEL			ECDS_DEBUG
+#endif
+
+//!< Lowest level that any domain logs at, maintained by the level setters.
+extern int ecds_log_threshold;
+
+//!< @brief Whether a message of a level would be produced in the domain of the current file.
+#define ECDS_LOG_ENABLED(level) \
+	( (level) >= ECDS_LOG_MIN_LEVEL && (level) >= ecds_atomic_load_relaxed(&ecds_log_threshold) && \
+		ecds_log_enabled((level), ECDS_LOG_DOMAIN) )
+
 #define ecds_log_fatal(...) ( ecds_log(ECDS_FATAL, ECDS_LOG_DOMAIN, __VA_ARGS__) )
-#define ecds_log_error(...) ( ecds_log(ECDS_ERROR, ECDS_LOG_DOMAIN, __VA_ARGS__) )
-#define ecds_log_warning(...) ( ecds_log(ECDS_WARN, ECDS_LOG_DOMAIN, __VA_ARGS__) )
-#define ecds_log_info(...) ( ecds_log(ECDS_INFO, ECDS_LOG_DOMAIN, __VA_ARGS__) )
-#define ecds_log_debug(...) ( ecds_log(ECDS_DEBUG, ECDS_LOG_DOMAIN, __VA_ARGS__) )
+#define ecds_log_error(...) ( ECDS_LOG_ENABLED(ECDS_ERROR) ? ecds_log(ECDS_ERROR, ECDS_LOG_DOMAIN, __VA_ARGS__) : (void)0 )
+#define ecds_log_warning(...) ( ECDS_LOG_ENABLED(ECDS_WARN) ? ecds_log(ECDS_WARN, ECDS_LOG_DOMAIN, __VA_ARGS__) : (void)0 )
+#define ecds_log_info(...) ( ECDS_LOG_ENABLED(ECDS_INFO) ? ecds_log(ECDS_INFO, ECDS_LOG_DOMAIN, __VA_ARGS__) : (void)0 )
+#define ecds_log_debug(...) ( ECDS_LOG_ENABLED(ECDS_DEBUG) ? ecds_log(ECDS_DEBUG, ECDS_LOG_DOMAIN, __VA_ARGS__) : (void)0 )
+
+typedef struct _ecds_log_record_t ecds_log_record_t;
+typedef struct _ecds_log_sink_t ecds_log_sink_t;
+typedef struct _ecds_log_stats_t ecds_log_stats_t;
+
+//!< A formatted message as handed to the sinks.
+struct _ecds_log_record_t {
+	uint64_t timestamp;					//!< Nanoseconds since the epoch when the message was logged
+	uint32_t thread;					//!< Number of the logging thread, in the order threads first logged
+	int level;
+	const char * domain;
+	const char * message;				//!< NUL-terminated, without a trailing newline
+	uint32_t length;					//!< Length of message
+};
+
+/**
+ * A destination for log messages. Sinks are only called by one thread at a time: the background thread, or the
+ * logging threads one after another while no background thread runs. They must not log themselves.
+ */
+struct _ecds_log_sink_t {
+	const char * name;					//!< Unique in the registry
+	int level;							//!< Messages below this level are not written to the sink
+	void (* write)(ecds_log_sink_t * sink, const ecds_log_record_t * record);
+	void (* flush)(ecds_log_sink_t * sink);		//!< May be NULL
+	void (* close)(ecds_log_sink_t * sink);		//!< Releases the sink, may be NULL
+};
+
+struct _ecds_log_stats_t {
+	uint64_t written;					//!< Messages handed to the sinks
+	uint64_t dropped;					//!< Messages lost because the ring of their thread was full
+	uint64_t truncated;					//!< Messages cut off at ECDS_LOG_MESSAGE_SIZE or at the size of a ring slot
+	uint32_t rings;						//!< Threads that have a ring
+};
 
 /**
- * @brief Function prototype for custom log handlers
- * ecds_log_format_func is a function that can be defined if handlers want to define their own custom
- * output format for log messages, it takes the log level and sprintf syntax to output into a target string.
- *
- * ecds_log_output_func is a function that can output log text into a different channel. Each handler can define either
- * one of these functions, if they are set to NULL, the default will be used which outputs standard format to the console.
+ * @brief Log a message. Use the ecds_log_* macros instead, which skip disabled levels without evaluating arguments.
+ * @param level One of the ECDS_ level constants. ECDS_FATAL writes all pending messages and exits the program.
+ * @param domain The domain of the message.
+ * @param fmt A printf format. %n is not supported.
  */
-typedef void (* ecds_log_format_func)(char * target, int level, const char* fmt, va_list arguments);
-typedef void (* ecds_log_output_func)(char * message);
+void ecds_log(int level, const char * domain, const char * fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+	__attribute__((format(printf, 3, 4)))
+#endif
+	;
+
+//!< @brief Whether a message of a level would be produced in a domain.
+bool ecds_log_enabled(int level, const char * domain);
+
+//!< @brief Set the level of all domains that do not have their own.
+void ecds_log_set_level(int new_level);
+
+/**
+ * @brief Give a domain its own level.
+ * @param domain The domain, copied.
+ * @param level The level, or ECDS_LOG_INHERIT to follow the global level again.
+ * @return 0 on success, or a negative value if the level is invalid or too many domains have their own level.
+ */
+int ecds_log_set_domain_level(const char * domain, int level);
+
+//!< @brief Get the level messages of a domain need to reach.
+int ecds_log_get_level(const char * domain);
+
+/**
+ * @brief Add a sink to the registry. The registry starts out with the "stdout" sink.
+ * @param sink The sink, which belongs to the registry from now on.
+ * @return 0 on success, or a negative value if a sink of the same name exists or the registry is full.
+ */
+int ecds_log_add_sink(ecds_log_sink_t * sink);
+
+/**
+ * @brief Remove a sink from the registry and close it. Pending messages are written first.
+ * @param name The name of the sink.
+ * @return 0 on success, or a negative value if there is no such sink.
+ */
+int ecds_log_remove_sink(const char * name);
+
+/**
+ * @brief Start the background thread. Messages are queued from now on instead of written by the caller.
+ * @param ring_slots Messages each thread can have queued, rounded up to a power of two, 0 for ECDS_LOG_DEFAULT_RING_SLOTS.
+ * @return 0 on success, or a negative value if the thread could not be started.
+ */
+int ecds_log_start(uint32_t ring_slots);
+
+//!< @brief Write all pending messages and stop the background thread. Also called at exit.
+void ecds_log_stop(void);
+
+//!< @brief Wait until all messages queued so far have been written and flush the sinks.
+void ecds_log_flush(void);
+
+//!< @brief Get the counters of the logger.
+void ecds_log_get_stats(ecds_log_stats_t * stats);
 
-void ecds_log(int level, const char * domain, const char * fmt, ...);
-void ecds_log_set_level(int new_level);
\ No newline at end of file
+#endif /* _ECDS_LOG_H */
@@ -0,0 +1,436 @@
+/*****************************************************************************/
+/*	@file ecds_log_sink.c												 	 */
+/*	@brief Built-in log sinks.												 */
+/*																			 */
+/*	Sinks allocate with malloc() rather than ecds_memory_alloc(), because	 */
+/*	the memory manager logs itself.											 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <common/ecds_log_sink.h>
+
+#define ECDS_LOG_DOMAIN "ecds-log"
+
+typedef struct _ecds_log_stdout_sink_t ecds_log_stdout_sink_t;
+typedef struct _ecds_log_file_sink_t ecds_log_file_sink_t;
+typedef struct _ecds_log_memory_sink_t ecds_log_memory_sink_t;
+typedef struct _ecds_log_binary_sink_t ecds_log_binary_sink_t;
+
+struct _ecds_log_file_sink_t {
+	ecds_log_sink_t sink;
+	char * name;
+	char * path;
+	FILE * file;
+	size_t size;						//!< Bytes in the current file
+	size_t max_size;
+	uint32_t max_files;
+};
+
+//!< Lines are kept in a circular buffer and always start right after a newline.
+struct _ecds_log_memory_sink_t {
+	ecds_log_sink_t sink;
+	char * name;
+	char * text;
+	size_t capacity;
+	size_t start;						//!< Offset of the oldest byte
+	size_t length;						//!< Number of bytes held
+	pthread_mutex_t sink_mutex[1];		//!< Protects text, start and length against readers
+};
+
+struct _ecds_log_binary_sink_t {
+	ecds_log_sink_t sink;
+	char * name;
+	FILE * file;
+};
+
+static const char ecds_log_level_letters[] = "DIWEF";
+
+size_t ecds_log_format_record(const ecds_log_record_t * record, char * buffer, size_t size)
+{
+	time_t seconds = (time_t)(record->timestamp / 1000000000ull);
+	unsigned int milliseconds = (unsigned int)(record->timestamp / 1000000ull % 1000);
+	char level = record->level >= ECDS_DEBUG && record->level <= ECDS_FATAL ? ecds_log_level_letters[record->level] : '?';
+	struct tm local;
+	int length;
+
+	if (!size)
+		return 0;
+
+	localtime_r(&seconds, &local);
+	length = snprintf(buffer, size, "%04d-%02d-%02d %02d:%02d:%02d.%03u [%s] %c: %s",
+		local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec, milliseconds,
+		record->domain, level, record->message);
+
+	return length < 0 ? 0 : (size_t)length;
+}
+
+//=================================== 8< ====================================//
+//	Standard output															 //
+//===========================================================================//
+
+static void _ecds_log_stdout_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	char line[ECDS_LOG_MESSAGE_SIZE + 64];
+
+	(void)sink;
+	ecds_log_format_record(record, line, sizeof(line));
+	puts(line);
+}
+
+static void _ecds_log_stdout_flush(ecds_log_sink_t * sink)
+{
+	(void)sink;
+	fflush(stdout);
+}
+
+static void _ecds_log_stdout_close(ecds_log_sink_t * sink)
+{
+	fflush(stdout);
+	free(sink);
+}
+
+ecds_log_sink_t * ecds_log_stdout_sink_new(int level)
+{
+	ecds_log_sink_t * sink;
+
+	if (!(sink = (ecds_log_sink_t *)calloc(1, sizeof(ecds_log_sink_t))))
+		return NULL;
+
+	sink->name = "stdout";
+	sink->level = level;
+	sink->write = _ecds_log_stdout_write;
+	sink->flush = _ecds_log_stdout_flush;
+	sink->close = _ecds_log_stdout_close;
+
+	return sink;
+}
+
+//=================================== 8< ====================================//
+//	Rotating file															 //
+//===========================================================================//
+
+/* Shift path.1 .. path.n-1 up by one and make the current file path.1 */
+static void _ecds_log_file_rotate(ecds_log_file_sink_t * fs)
+{
+	size_t length = strlen(fs->path) + 16;
+	char * from = (char *)malloc(length), * to = (char *)malloc(length);
+	uint32_t i;
+
+	fclose(fs->file);
+	fs->file = NULL;
+
+	if (from && to && fs->max_files)
+	{
+		snprintf(to, length, "%s.%u", fs->path, fs->max_files);
+		remove(to);
+		for (i = fs->max_files - 1; i > 0; i--)
+		{
+			snprintf(from, length, "%s.%u", fs->path, i);
+			snprintf(to, length, "%s.%u", fs->path, i + 1);
+			rename(from, to);
+		}
+		snprintf(to, length, "%s.1", fs->path);
+		rename(fs->path, to);
+	}
+
+	free(from);
+	free(to);
+
+	fs->file = fopen(fs->path, "w");
+	fs->size = 0;
+}
+
+static void _ecds_log_file_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	ecds_log_file_sink_t * fs = (ecds_log_file_sink_t *)sink;
+	char line[ECDS_LOG_MESSAGE_SIZE + 64];
+	size_t length = ecds_log_format_record(record, line, sizeof(line) - 1);
+
+	if (length > sizeof(line) - 2)
+		length = sizeof(line) - 2;
+	line[length++] = '\n';
+
+	if (fs->max_size && fs->size && fs->size + length > fs->max_size)
+		_ecds_log_file_rotate(fs);
+
+	/* Rotation can fail to reopen the file, later messages are lost then */
+	if (fs->file && fwrite(line, 1, length, fs->file) == length)
+		fs->size += length;
+}
+
+static void _ecds_log_file_flush(ecds_log_sink_t * sink)
+{
+	ecds_log_file_sink_t * fs = (ecds_log_file_sink_t *)sink;
+
+	if (fs->file)
+		fflush(fs->file);
+}
+
+static void _ecds_log_file_close(ecds_log_sink_t * sink)
+{
+	ecds_log_file_sink_t * fs = (ecds_log_file_sink_t *)sink;
+
+	if (fs->file)
+		fclose(fs->file);
+	free(fs->name);
+	free(fs->path);
+	free(fs);
+}
+
+ecds_log_sink_t * ecds_log_file_sink_new(const char * name, const char * path, size_t max_size, uint32_t max_files, int level)
+{
+	ecds_log_file_sink_t * fs;
+	long size;
+
+	if (!name || !path || !(fs = (ecds_log_file_sink_t *)calloc(1, sizeof(ecds_log_file_sink_t))))
+		return NULL;
+
+	fs->name = strdup(name);
+	fs->path = strdup(path);
+	if (!fs->name || !fs->path || !(fs->file = fopen(path, "a")))
+	{
+		_ecds_log_file_close(&fs->sink);
+		return NULL;
+	}
+
+	/* Appending positions at the end only on the first write, so seek to find the size */
+	fseek(fs->file, 0, SEEK_END);
+	size = ftell(fs->file);
+	fs->size = size > 0 ? (size_t)size : 0;
+	fs->max_size = max_size;
+	fs->max_files = max_files;
+
+	fs->sink.name = fs->name;
+	fs->sink.level = level;
+	fs->sink.write = _ecds_log_file_write;
+	fs->sink.flush = _ecds_log_file_flush;
+	fs->sink.close = _ecds_log_file_close;
+
+	return &fs->sink;
+}
+
+//=================================== 8< ====================================//
+//	Memory ring																 //
+//===========================================================================//
+
+static void _ecds_log_memory_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	ecds_log_memory_sink_t * ms = (ecds_log_memory_sink_t *)sink;
+	char line[ECDS_LOG_MESSAGE_SIZE + 64];
+	size_t length = ecds_log_format_record(record, line, sizeof(line) - 1), i, end;
+	const char * from = line;
+
+	if (length > sizeof(line) - 2)
+		length = sizeof(line) - 2;
+	line[length++] = '\n';
+
+	/* A line longer than the whole buffer keeps its end */
+	if (length > ms->capacity)
+	{
+		from += length - ms->capacity;
+		length = ms->capacity;
+	}
+
+	pthread_mutex_lock(ms->sink_mutex);
+
+	if (ms->length + length > ms->capacity)
+	{
+		/* Discard whole lines from the front until the new line fits */
+		ms->start = (ms->start + ms->length + length - ms->capacity) % ms->capacity;
+		ms->length = ms->capacity - length;
+		while (ms->length && ms->text[(ms->start + ms->capacity - 1) % ms->capacity] != '\n')
+		{
+			ms->start = (ms->start + 1) % ms->capacity;
+			ms->length--;
+		}
+	}
+
+	end = (ms->start + ms->length) % ms->capacity;
+	for (i = 0; i < length; i++)
+		ms->text[(end + i) % ms->capacity] = from[i];
+	ms->length += length;
+
+	pthread_mutex_unlock(ms->sink_mutex);
+}
+
+static void _ecds_log_memory_close(ecds_log_sink_t * sink)
+{
+	ecds_log_memory_sink_t * ms = (ecds_log_memory_sink_t *)sink;
+
+	pthread_mutex_destroy(ms->sink_mutex);
+	free(ms->text);
+	free(ms->name);
+	free(ms);
+}
+
+ecds_log_sink_t * ecds_log_memory_sink_new(const char * name, size_t capacity, int level)
+{
+	ecds_log_memory_sink_t * ms;
+
+	if (!name || !capacity || !(ms = (ecds_log_memory_sink_t *)calloc(1, sizeof(ecds_log_memory_sink_t))))
+		return NULL;
+
+	pthread_mutex_init(ms->sink_mutex, NULL);
+	ms->name = strdup(name);
+	ms->text = (char *)malloc(capacity);
+	ms->capacity = capacity;
+	if (!ms->name || !ms->text)
+	{
+		_ecds_log_memory_close(&ms->sink);
+		return NULL;
+	}
+
+	ms->sink.name = ms->name;
+	ms->sink.level = level;
+	ms->sink.write = _ecds_log_memory_write;
+	ms->sink.close = _ecds_log_memory_close;
+
+	return &ms->sink;
+}
+
+size_t ecds_log_memory_sink_read(ecds_log_sink_t * sink, char * buffer, size_t size)
+{
+	ecds_log_memory_sink_t * ms = (ecds_log_memory_sink_t *)sink;
+	size_t length, skip, i;
+
+	if (!ms || !buffer || !size)
+		return 0;
+
+	pthread_mutex_lock(ms->sink_mutex);
+
+	length = ms->length < size - 1 ? ms->length : size - 1;
+	skip = ms->length - length;
+	for (i = 0; i < length; i++)
+		buffer[i] = ms->text[(ms->start + skip + i) % ms->capacity];
+	buffer[length] = '\0';
+
+	pthread_mutex_unlock(ms->sink_mutex);
+
+	return length;
+}
+
+//=================================== 8< ====================================//
+//	Binary records															 //
+//===========================================================================//
+
+static void _ecds_log_put_le(uint8_t * target, uint64_t value, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		target[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint64_t _ecds_log_get_le(const uint8_t * source, int bytes)
+{
+	uint64_t value = 0;
+	int i;
+
+	for (i = bytes - 1; i >= 0; i--)
+		value = value << 8 | source[i];
+
+	return value;
+}
+
+static void _ecds_log_binary_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	ecds_log_binary_sink_t * bs = (ecds_log_binary_sink_t *)sink;
+	uint8_t header[ECDS_LOG_BINARY_HEADER_SIZE];
+	size_t domain_size = strlen(record->domain) + 1, message_size = (size_t)record->length + 1;
+
+	if (domain_size > UINT16_MAX)
+		return;
+
+	_ecds_log_put_le(header, ECDS_LOG_BINARY_HEADER_SIZE + domain_size + message_size, 4);
+	_ecds_log_put_le(header + 4, record->timestamp, 8);
+	_ecds_log_put_le(header + 12, record->thread, 4);
+	header[16] = (uint8_t)record->level;
+	header[17] = 0;
+	_ecds_log_put_le(header + 18, domain_size, 2);
+	_ecds_log_put_le(header + 20, message_size, 4);
+
+	fwrite(header, 1, sizeof(header), bs->file);
+	fwrite(record->domain, 1, domain_size, bs->file);
+	fwrite(record->message, 1, message_size, bs->file);
+}
+
+static void _ecds_log_binary_flush(ecds_log_sink_t * sink)
+{
+	fflush(((ecds_log_binary_sink_t *)sink)->file);
+}
+
+static void _ecds_log_binary_close(ecds_log_sink_t * sink)
+{
+	ecds_log_binary_sink_t * bs = (ecds_log_binary_sink_t *)sink;
+
+	if (bs->file)
+		fclose(bs->file);
+	free(bs->name);
+	free(bs);
+}
+
+ecds_log_sink_t * ecds_log_binary_sink_new(const char * name, const char * path, int level)
+{
+	ecds_log_binary_sink_t * bs;
+
+	if (!name || !path || !(bs = (ecds_log_binary_sink_t *)calloc(1, sizeof(ecds_log_binary_sink_t))))
+		return NULL;
+
+	if (!(bs->name = strdup(name)) || !(bs->file = fopen(path, "wb")) ||
+		fwrite(ECDS_LOG_BINARY_MAGIC, 1, 8, bs->file) != 8)
+	{
+		_ecds_log_binary_close(&bs->sink);
+		return NULL;
+	}
+
+	bs->sink.name = bs->name;
+	bs->sink.level = level;
+	bs->sink.write = _ecds_log_binary_write;
+	bs->sink.flush = _ecds_log_binary_flush;
+	bs->sink.close = _ecds_log_binary_close;
+
+	return &bs->sink;
+}
+
+bool ecds_log_binary_decode(const uint8_t * data, size_t length, size_t * offset, ecds_log_record_t * record)
+{
+	const uint8_t * header;
+	size_t size, domain_size, message_size;
+
+	if (!data || !offset || !record || length < 8 || memcmp(data, ECDS_LOG_BINARY_MAGIC, 8) != 0)
+		return false;
+
+	if (*offset < 8)
+		*offset = 8;
+	if (*offset > length || length - *offset < ECDS_LOG_BINARY_HEADER_SIZE)
+		return false;
+
+	header = data + *offset;
+	size = (size_t)_ecds_log_get_le(header, 4);
+	domain_size = (size_t)_ecds_log_get_le(header + 18, 2);
+	message_size = (size_t)_ecds_log_get_le(header + 20, 4);
+
+	/* Reject records that do not add up or whose strings are not terminated */
+	if (size > length - *offset || !domain_size || !message_size ||
+		size != ECDS_LOG_BINARY_HEADER_SIZE + domain_size + message_size ||
+		header[ECDS_LOG_BINARY_HEADER_SIZE + domain_size - 1] != '\0' || header[size - 1] != '\0')
+		return false;
+
+	record->timestamp = _ecds_log_get_le(header + 4, 8);
+	record->thread = (uint32_t)_ecds_log_get_le(header + 12, 4);
+	record->level = header[16];
+	record->domain = (const char *)header + ECDS_LOG_BINARY_HEADER_SIZE;
+	record->message = record->domain + domain_size;
+	record->length = (uint32_t)(message_size - 1);
+	*offset += size;
+
+	return true;
+}
@@ -0,0 +1,87 @@
+/*****************************************************************************/
+/*	@file ecds_log_sink.h												 	 */
+/*	@brief Built-in log sinks.												 */
+/*																			 */
+/*	The text sinks write one line per message in the format of				 */
+/*	ecds_log_format_record(). The binary sink writes structured records		 */
+/*	for tools to filter, after an 8-byte file header "ECDSLOG" 0x01:		 */
+/*																			 */
+/*		uint32_t size			whole record including this field			 */
+/*		uint64_t timestamp		nanoseconds since the epoch					 */
+/*		uint32_t thread														 */
+/*		uint8_t level														 */
+/*		uint8_t reserved													 */
+/*		uint16_t domain_size	including the NUL							 */
+/*		uint32_t message_size	including the NUL							 */
+/*		char domain[domain_size]											 */
+/*		char message[message_size]											 */
+/*																			 */
+/*	All numbers are little endian.											 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_LOG_SINK_H
+#define _ECDS_LOG_SINK_H
+
+#include <ecds.h>
+
+#define ECDS_LOG_BINARY_MAGIC			"ECDSLOG\x01"
+#define ECDS_LOG_BINARY_HEADER_SIZE		24		//!< Bytes of a binary record before the domain
+
+/**
+ * @brief Format a record as a line of text without the newline: "2026-01-31 12:00:00.000 [domain] I: message".
+ * @param record The record to format.
+ * @param buffer, size Receives the line, always NUL-terminated if size is not 0.
+ * @return The length of the line, which was truncated if it is size or more.
+ */
+size_t ecds_log_format_record(const ecds_log_record_t * record, char * buffer, size_t size);
+
+//!< @brief Create the "stdout" sink, which the registry starts out with.
+ecds_log_sink_t * ecds_log_stdout_sink_new(int level);
+
+/**
+ * @brief Create a sink that appends to a text file and rotates it when it grows too large.
+ * @param name The name of the sink in the registry, copied.
+ * @param path The file to write, copied. Rotated files are called path.1 (the newest) to path.max_files.
+ * @param max_size The size in bytes at which the file is rotated, 0 for no rotation.
+ * @param max_files The number of rotated files to keep, 0 to start over in the same file.
+ * @param level Messages below this level are not written.
+ * @return The sink, or NULL if the file could not be opened.
+ */
+ecds_log_sink_t * ecds_log_file_sink_new(const char * name, const char * path, size_t max_size, uint32_t max_files, int level);
+
+/**
+ * @brief Create a sink that keeps the most recent lines in memory, for example to attach them to a crash report.
+ * @param name The name of the sink in the registry, copied.
+ * @param capacity The number of bytes to keep. Older lines are discarded as a whole.
+ * @param level Messages below this level are not kept.
+ * @return The sink, or NULL if memory ran out.
+ */
+ecds_log_sink_t * ecds_log_memory_sink_new(const char * name, size_t capacity, int level);
+
+/**
+ * @brief Copy the lines a memory sink holds, oldest first and separated by newlines. Safe while messages are logged.
+ * @param sink A sink created by ecds_log_memory_sink_new().
+ * @param buffer, size Receives the text, NUL-terminated if size is not 0. If it is too small, the newest text is kept.
+ * @return The number of bytes copied, without the NUL.
+ */
+size_t ecds_log_memory_sink_read(ecds_log_sink_t * sink, char * buffer, size_t size);
+
+/**
+ * @brief Create a sink that writes binary records to a file, see the top of this file.
+ * @param name The name of the sink in the registry, copied.
+ * @param path The file to write, which is replaced.
+ * @param level Messages below this level are not written.
+ * @return The sink, or NULL if the file could not be created.
+ */
+ecds_log_sink_t * ecds_log_binary_sink_new(const char * name, const char * path, int level);
+
+/**
+ * @brief Read a record of a binary log.
+ * @param data, length The contents of the file, including the file header.
+ * @param offset The position of the record, 0 for the first one. Advanced to the next record.
+ * @param record Receives the record. domain and message point into data.
+ * @return true if a record was read, false at the end of the data or if it is not a valid log.
+ */
+bool ecds_log_binary_decode(const uint8_t * data, size_t length, size_t * offset, ecds_log_record_t * record);
+
+#endif /* _ECDS_LOG_SINK_H */
@@ -0,0 +1,63 @@
+/*****************************************************************************/
+/*	@file ecds_message.c												 	 */
+/*	@brief ECDS message descriptor.											 */
+/*																			 */
+/*	A message holds a reference on its payload, which is released when the	 */
+/*	message is disposed after the last subscriber has handled it.			 */
+/*																			 */
+/*****************************************************************************/
+
+#include <common/ecds_message.h>
+#include <common/ecds_payload.h>
+
+#include <core/ecds_object.h>
+#include <core/ecds_dispatcher.h>
+
+#define ECDS_LOG_DOMAIN "ecds-message"
+
+static void _message_dispose(ecds_object_t * obj)
+{
+	ecds_message_t * msg = (ecds_message_t *)obj;
+
+	ecds_object_unref(ECDS_OBJECT(msg->payload));
+	msg->payload = NULL;
+}
+
+ecds_message_t * ecds_message_new()
+{
+	ecds_message_t * ret;
+
+	ret = (ecds_message_t *)ecds_object_new(NULL, sizeof(ecds_message_t), ECDS_TYPE_MESSAGE);
+	if (!ret)
+		return NULL;
+
+	ret->obj.dispose = _message_dispose;
+
+	return ret;
+}
+
+ecds_message_t * ecds_message_build(uint16_t bus_number, uint16_t label, ecds_payload_t * payload)
+{
+	ecds_message_t * ret = ecds_message_new();
+
+	if (!ret)
+		return NULL;
+
+	ret->event_id = ECDS_MESSAGE_EVENT_ID(bus_number, label);
+	ecds_message_set_payload(ret, payload);
+
+	return ret;
+}
+
+void ecds_message_set_payload(ecds_message_t * msg, ecds_payload_t * payload)
+{
+	if (!msg)
+		return;
+
+	ecds_object_ref(ECDS_OBJECT(payload));
+	ecds_object_unref(ECDS_OBJECT(msg->payload));
+
+	msg->payload = payload;
+	msg->user_data = (void *)ecds_payload_get_data(payload);
+	msg->user_data_length = ecds_payload_get_length(payload);
+}
@@ -11,6 +11,12 @@
 #define _ECDS_MESSAGE_H
 
 #include <ecds.h>
+#include <common/ecds_payload.h>
+
+#define ECDS_TYPE_MESSAGE			0x10000000
+
+//!<	Combine a bus number and a label into the event ID a message is routed by.
+#define ECDS_MESSAGE_EVENT_ID(bus_number, label)	(((uint32_t)(bus_number) << 16) | (uint16_t)(label))
 
 typedef struct _ecds_message_t ecds_message_t;
 
@@ -21,7 +27,17 @@ ecds_message_t * ecds_message_new();
 
 /**
  * @brief Construct a message with the given parameters.
+ * @param bus_number The bus the message is posted on.
+ * @param label The label of the message on the bus.
+ * @param payload The data for the message, or NULL. The message takes its own reference on the
+ *		  payload, so the same payload can be attached to any number of messages without copying.
+ */
+ecds_message_t * ecds_message_build(uint16_t bus_number, uint16_t label, ecds_payload_t * payload);
+
+/**
+ * @brief Attach a payload to a message, replacing any data it carried before.
+ *		  The message's user_data and user_data_length describe the payload afterwards.
  */
-ecds_message_t * ecds_message_build(uint16_t bus_number, uint16_t label, void * data);
+void ecds_message_set_payload(ecds_message_t * msg, ecds_payload_t * payload);
 
 #endif
@@ -0,0 +1,72 @@
+/*****************************************************************************/
+/*	@file ecds_payload.c												 	 */
+/*	@brief ECDS shared message payload.										 */
+/*																			 */
+/*	The data follows the payload header in the same allocation. Payloads	 */
+/*	that do not fit the largest pool size class are passed on to the heap	 */
+/*	by the memory manager, so the length is only limited by 32 bits.		 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#include <common/ecds_atomic.h>
+#include <common/ecds_payload.h>
+
+#include <core/ecds_object.h>
+
+#define ECDS_LOG_DOMAIN "ecds-payload"
+
+struct _ecds_payload_t
+{
+	ecds_object_t obj;
+
+	uint32_t length;
+	_Alignas(max_align_t) uint8_t data[];
+};
+
+ecds_payload_t * ecds_payload_new(const void * data, uint32_t length)
+{
+	ecds_payload_t * ret;
+
+	ret = (ecds_payload_t *)ecds_object_new(NULL, sizeof(ecds_payload_t) + length, ECDS_TYPE_PAYLOAD);
+	if (!ret)
+		return NULL;
+
+	ret->length = length;
+	if (data && length)
+		memcpy(ret->data, data, length);
+
+	return ret;
+}
+
+const void * ecds_payload_get_data(ecds_payload_t * payload)
+{
+	return payload ? payload->data : NULL;
+}
+
+uint32_t ecds_payload_get_length(ecds_payload_t * payload)
+{
+	return payload ? payload->length : 0;
+}
+
+void * ecds_payload_make_writable(ecds_payload_t ** payload)
+{
+	ecds_payload_t * copy;
+
+	if (!payload || !*payload)
+		return NULL;
+
+	/* Nobody else can see the data, it can be modified in place */
+	if (ecds_atomic_load(&(*payload)->obj.refcnt) == 1)
+		return (*payload)->data;
+
+	if (!(copy = ecds_payload_new((*payload)->data, (*payload)->length)))
+		return NULL;
+
+	ecds_object_unref(ECDS_OBJECT(*payload));
+	*payload = copy;
+
+	return copy->data;
+}
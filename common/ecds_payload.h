@@ -0,0 +1,47 @@
+/*****************************************************************************/
+/*	@file ecds_payload.h												 	 */
+/*	@brief ECDS shared message payload.										 */
+/*																			 */
+/*	A payload is an immutable, reference counted block of message data.	 */
+/*	The data is copied once when the payload is created, after which every	 */
+/*	message and every subscriber that receives it shares the same block		 */
+/*	read-only. A holder that needs to modify the data calls					 */
+/*	ecds_payload_make_writable(), which only copies the block if somebody	 */
+/*	else still holds a reference on it.										 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_PAYLOAD_H
+#define _ECDS_PAYLOAD_H
+
+#include <ecds.h>
+
+#define ECDS_TYPE_PAYLOAD			0x10000001
+
+typedef struct _ecds_payload_t ecds_payload_t;
+
+/**
+ * @brief Create a payload holding a copy of a block of data, and take a reference on it.
+ * @param data The data to copy, or NULL to create a zero-filled payload.
+ * @param length The length of the data in bytes.
+ * @return The new payload, or NULL if it could not be allocated.
+ */
+ecds_payload_t * ecds_payload_new(const void * data, uint32_t length);
+
+//!< @brief Get a read-only pointer to the data of a payload.
+const void * ecds_payload_get_data(ecds_payload_t * payload);
+
+//!< @brief Get the length of a payload in bytes.
+uint32_t ecds_payload_get_length(ecds_payload_t * payload);
+
+/**
+ * @brief Get a writable pointer to the data of a payload, copying it first if it is shared.
+ * @param payload The payload to modify, through a pointer that holds the caller's own reference.
+ *		  If the payload is shared, that reference is released and the pointer is replaced with a
+ *		  private copy. Do not pass the payload pointer of a received message, which holds the
+ *		  message's reference: take a reference into a local pointer and pass that instead.
+ * @return A pointer to the data that only the caller references, or NULL if the copy failed.
+ */
+void * ecds_payload_make_writable(ecds_payload_t ** payload);
+
+#endif /* _ECDS_PAYLOAD_H */
@@ -10,7 +10,12 @@ struct _ecds_queue_t
 
 ecds_queue_t * ecds_queue_new()
 {
-	return (ecds_queue_t *)ecds_object_new("ecds-queue", sizeof(ecds_queue_t), ECDS_TYPE_QUEUE);
+	ecds_queue_t * queue = (ecds_queue_t *)ecds_object_new("ecds-queue", sizeof(ecds_queue_t), ECDS_TYPE_QUEUE);
+
+	if (queue)
+		queue->list.obj.dispose = ecds_list_dispose_object;
+
+	return queue;
 }
 
 void ecds_queue_dispose(ecds_queue_t * queue)
@@ -40,10 +45,8 @@ ecds_list_item_t * ecds_queue_dequeue_item(ecds_queue_t * queue)
 	first = ecds_list_first_item((ecds_list_t *)queue);
 
 	if (first)
-	{
+		/* Only invalidates the indices, dequeuing never walks the queue */
 		ecds_list_drop_item(first);
-		//	_ecds_list_reorder((ecds_list_t *)queue);
-	}
 
 	return first;
 }
@@ -0,0 +1,339 @@
+/*****************************************************************************/
+/*	@file ecds_ring_queue.c												 	 */
+/*	@brief ECDS bounded ring buffer queue.									 */
+/*																			 */
+/*	Every slot carries a sequence number that tells producers and consumers	 */
+/*	whose turn it is: a slot at position p is free for the producer that	 */
+/*	claimed p when its sequence equals p, and holds an object for the		 */
+/*	consumer that claimed p when its sequence equals p + 1. Positions are	 */
+/*	claimed with a compare-and-swap, which also makes it safe for a			 */
+/*	producer to discard the oldest object under ECDS_RING_QUEUE_DROP_OLDEST. */
+/*																			 */
+/*****************************************************************************/
+
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <common/ecds_ring_queue.h>
+#include <common/ecds_atomic.h>
+
+#include <core/ecds_object.h>
+#include <core/ecds_list_internal.h>
+
+#define ECDS_LOG_DOMAIN "ecds-ring-queue"
+
+typedef struct _ecds_ring_queue_slot_t ecds_ring_queue_slot_t;
+
+struct _ecds_ring_queue_slot_t
+{
+	uint64_t sequence;
+	ecds_object_t * data;
+};
+
+struct _ecds_ring_queue_t
+{
+	ecds_object_t obj;
+
+	ecds_ring_queue_slot_t * slots;
+	uint64_t mask;
+	ecds_ring_queue_policy_t policy;
+
+	uint64_t enqueue_position;			//!<	Next position to be claimed by a producer
+	uint64_t dequeue_position;			//!<	Next position to be claimed by the consumer
+
+	bool closed;
+	int consumers_waiting;
+	int producers_waiting;
+
+	pthread_mutex_t queue_mutex[1];
+	pthread_cond_t not_empty_cond[1];
+	pthread_cond_t not_full_cond[1];
+
+	uint32_t peak_depth;
+	uint64_t enqueued;
+	uint64_t dequeued;
+	uint64_t dropped;
+	uint64_t rejected;
+	uint64_t blocked;
+};
+
+static void _ring_queue_dispose(ecds_object_t * obj)
+{
+	ecds_ring_queue_t * queue = (ecds_ring_queue_t *)obj;
+	ecds_object_t * item;
+
+	while ((item = ecds_ring_queue_dequeue(queue)))
+		ecds_object_unref(item);
+
+	pthread_cond_destroy(queue->not_full_cond);
+	pthread_cond_destroy(queue->not_empty_cond);
+	pthread_mutex_destroy(queue->queue_mutex);
+
+	ecds_memory_free(queue->slots);
+	queue->slots = NULL;
+}
+
+ecds_ring_queue_t * ecds_ring_queue_new(uint32_t capacity, ecds_ring_queue_policy_t policy)
+{
+	ecds_ring_queue_t * ret;
+	uint64_t size = 2;
+
+	while (size < capacity)
+		size <<= 1;
+
+	ret = (ecds_ring_queue_t *)ecds_object_new("ecds-ring-queue", sizeof(ecds_ring_queue_t), ECDS_TYPE_RING_QUEUE);
+	if (!ret)
+		return NULL;
+
+	ret->slots = (ecds_ring_queue_slot_t *)ecds_memory_alloc(size * sizeof(ecds_ring_queue_slot_t));
+	if (!ret->slots)
+	{
+		ecds_log_error("Out of memory when allocating %u queue slots", (unsigned int)size);
+		ecds_object_unref(ECDS_OBJECT(ret));
+		return NULL;
+	}
+
+	for (uint64_t i = 0; i < size; i++)
+		ret->slots[i].sequence = i;
+
+	ret->mask = size - 1;
+	ret->policy = policy;
+
+	pthread_mutex_init(ret->queue_mutex, 0);
+	pthread_cond_init(ret->not_empty_cond, 0);
+	pthread_cond_init(ret->not_full_cond, 0);
+
+	ret->obj.dispose = _ring_queue_dispose;
+
+	return ret;
+}
+
+void ecds_ring_queue_dispose(ecds_ring_queue_t * queue)
+{
+	if (!queue)
+		return;
+
+	ecds_ring_queue_close(queue);
+	ecds_object_unref(ECDS_OBJECT(queue));
+}
+
+static bool _ring_queue_try_enqueue(ecds_ring_queue_t * queue, ecds_object_t * obj)
+{
+	ecds_ring_queue_slot_t * slot;
+	uint64_t position = ecds_atomic_load(&queue->enqueue_position);
+
+	for (;;)
+	{
+		slot = &queue->slots[position & queue->mask];
+		int64_t diff = (int64_t)ecds_atomic_load(&slot->sequence) - (int64_t)position;
+
+		if (diff == 0)
+		{
+			/* Slot is free, try to claim it */
+			if (ecds_atomic_compare_exchange(&queue->enqueue_position, &position, position + 1))
+				break;
+		}
+		else if (diff < 0)
+			/* Consumer has not released this slot yet, queue is full */
+			return false;
+		else
+			/* Another producer claimed this position first */
+			position = ecds_atomic_load(&queue->enqueue_position);
+	}
+
+	slot->data = obj;
+	ecds_atomic_store(&slot->sequence, position + 1);
+
+	return true;
+}
+
+/* Take the oldest object out of the queue without counting it as dequeued */
+static ecds_object_t * _ring_queue_try_dequeue(ecds_ring_queue_t * queue)
+{
+	ecds_ring_queue_slot_t * slot;
+	ecds_object_t * ret;
+	uint64_t position;
+
+	position = ecds_atomic_load(&queue->dequeue_position);
+	for (;;)
+	{
+		slot = &queue->slots[position & queue->mask];
+		int64_t diff = (int64_t)ecds_atomic_load(&slot->sequence) - (int64_t)(position + 1);
+
+		if (diff == 0)
+		{
+			if (ecds_atomic_compare_exchange(&queue->dequeue_position, &position, position + 1))
+				break;
+		}
+		else if (diff < 0)
+			/* Nothing published at this position yet, queue is empty */
+			return NULL;
+		else
+			position = ecds_atomic_load(&queue->dequeue_position);
+	}
+
+	ret = slot->data;
+	slot->data = NULL;
+	ecds_atomic_store(&slot->sequence, position + queue->mask + 1);
+
+	return ret;
+}
+
+static void _ring_queue_update_peak(ecds_ring_queue_t * queue)
+{
+	uint32_t depth = ecds_ring_queue_depth(queue);
+	uint32_t peak = ecds_atomic_load(&queue->peak_depth);
+
+	while (depth > peak && !ecds_atomic_compare_exchange(&queue->peak_depth, &peak, depth))
+		;
+}
+
+bool ecds_ring_queue_enqueue(ecds_ring_queue_t * queue, ecds_object_t * obj)
+{
+	bool counted_block = false;
+
+	if (!queue || !obj)
+		return false;
+
+	ecds_object_ref(obj);
+
+	while (!ecds_atomic_load(&queue->closed))
+	{
+		if (_ring_queue_try_enqueue(queue, obj))
+		{
+			ecds_atomic_increment(&queue->enqueued);
+			_ring_queue_update_peak(queue);
+
+			if (ecds_atomic_load(&queue->consumers_waiting))
+			{
+				pthread_mutex_lock(queue->queue_mutex);
+				pthread_cond_signal(queue->not_empty_cond);
+				pthread_mutex_unlock(queue->queue_mutex);
+			}
+			return true;
+		}
+
+		/* Queue is full, apply back-pressure policy */
+		switch (queue->policy)
+		{
+		case ECDS_RING_QUEUE_DROP_OLDEST:
+		{
+			/* A dropped object is counted as dropped only, never as dequeued */
+			ecds_object_t * oldest = _ring_queue_try_dequeue(queue);
+			if (oldest)
+			{
+				ecds_atomic_increment(&queue->dropped);
+				ecds_object_unref(oldest);
+			}
+			break;
+		}
+		case ECDS_RING_QUEUE_BLOCK:
+			if (!counted_block)
+			{
+				ecds_atomic_increment(&queue->blocked);
+				counted_block = true;
+			}
+
+			pthread_mutex_lock(queue->queue_mutex);
+			ecds_atomic_increment(&queue->producers_waiting);
+			while (ecds_ring_queue_depth(queue) > queue->mask && !ecds_atomic_load(&queue->closed))
+				pthread_cond_wait(queue->not_full_cond, queue->queue_mutex);
+			ecds_atomic_decrement(&queue->producers_waiting);
+			pthread_mutex_unlock(queue->queue_mutex);
+			break;
+		case ECDS_RING_QUEUE_FAIL:
+		default:
+			ecds_atomic_increment(&queue->rejected);
+			ecds_object_unref(obj);
+			return false;
+		}
+	}
+
+	/* Queue was closed */
+	ecds_atomic_increment(&queue->rejected);
+	ecds_object_unref(obj);
+	return false;
+}
+
+ecds_object_t * ecds_ring_queue_dequeue(ecds_ring_queue_t * queue)
+{
+	ecds_object_t * ret;
+
+	if (!queue)
+		return NULL;
+
+	if (!(ret = _ring_queue_try_dequeue(queue)))
+		return NULL;
+
+	ecds_atomic_increment(&queue->dequeued);
+
+	if (ecds_atomic_load(&queue->producers_waiting))
+	{
+		pthread_mutex_lock(queue->queue_mutex);
+		pthread_cond_broadcast(queue->not_full_cond);
+		pthread_mutex_unlock(queue->queue_mutex);
+	}
+
+	return ret;
+}
+
+bool ecds_ring_queue_wait(ecds_ring_queue_t * queue)
+{
+	bool ret;
+
+	if (!queue)
+		return false;
+
+	pthread_mutex_lock(queue->queue_mutex);
+	ecds_atomic_increment(&queue->consumers_waiting);
+	while (ecds_ring_queue_depth(queue) == 0 && !ecds_atomic_load(&queue->closed))
+		pthread_cond_wait(queue->not_empty_cond, queue->queue_mutex);
+	ecds_atomic_decrement(&queue->consumers_waiting);
+	ret = ecds_ring_queue_depth(queue) > 0;
+	pthread_mutex_unlock(queue->queue_mutex);
+
+	return ret;
+}
+
+void ecds_ring_queue_close(ecds_ring_queue_t * queue)
+{
+	if (!queue)
+		return;
+
+	pthread_mutex_lock(queue->queue_mutex);
+	ecds_atomic_store(&queue->closed, true);
+	pthread_cond_broadcast(queue->not_empty_cond);
+	pthread_cond_broadcast(queue->not_full_cond);
+	pthread_mutex_unlock(queue->queue_mutex);
+}
+
+uint32_t ecds_ring_queue_depth(ecds_ring_queue_t * queue)
+{
+	uint64_t head, tail;
+
+	if (!queue)
+		return 0;
+
+	tail = ecds_atomic_load(&queue->dequeue_position);
+	head = ecds_atomic_load(&queue->enqueue_position);
+
+	/* A position is claimed before the slot is filled, so this may briefly overestimate */
+	return (head > tail) ? (uint32_t)(head - tail) : 0;
+}
+
+void ecds_ring_queue_get_stats(ecds_ring_queue_t * queue, ecds_ring_queue_stats_t * stats)
+{
+	if (!queue || !stats)
+		return;
+
+	stats->capacity = (uint32_t)(queue->mask + 1);
+	stats->depth = ecds_ring_queue_depth(queue);
+	stats->peak_depth = ecds_atomic_load(&queue->peak_depth);
+	stats->enqueued = ecds_atomic_load(&queue->enqueued);
+	stats->dequeued = ecds_atomic_load(&queue->dequeued);
+	stats->dropped = ecds_atomic_load(&queue->dropped);
+	stats->rejected = ecds_atomic_load(&queue->rejected);
+	stats->blocked = ecds_atomic_load(&queue->blocked);
+}
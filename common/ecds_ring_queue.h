@@ -0,0 +1,95 @@
+/*****************************************************************************/
+/*	@file ecds_ring_queue.h												 	 */
+/*	@brief ECDS bounded ring buffer queue.									 */
+/*																			 */
+/*	The ring queue is an alternative to ecds_queue_t for hot paths where	 */
+/*	several threads post objects that are consumed by one thread (or a few), */
+/*	such as the dispatcher's message queue. It is backed by a fixed-size array of slots	 */
+/*	with per-slot sequence numbers, so enqueueing and dequeueing only take	 */
+/*	atomic operations and never wait for each other. A mutex is only used	 */
+/*	to put a consumer to sleep when the queue is empty, or a producer when	 */
+/*	the queue is full and the back-pressure policy says to block.			 */
+/*																			 */
+/*	Like ecds_queue_t, the queue takes a reference on every object that is	 */
+/*	enqueued. The reference is handed to the caller of the dequeue function, */
+/*	which has to release it with ecds_object_unref() when done.				 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_RING_QUEUE_H
+#define _ECDS_RING_QUEUE_H
+
+#include <ecds.h>
+
+typedef struct _ecds_ring_queue_t ecds_ring_queue_t;
+typedef struct _ecds_ring_queue_stats_t ecds_ring_queue_stats_t;
+
+/**
+ * Back-pressure policy, decides what happens when an object is posted to a full queue.
+ */
+typedef enum
+{
+	ECDS_RING_QUEUE_BLOCK = 0,			//!<	Wait until the consumer has made room
+	ECDS_RING_QUEUE_DROP_OLDEST = 1,	//!<	Discard the oldest queued object to make room
+	ECDS_RING_QUEUE_FAIL = 2			//!<	Reject the new object
+} ecds_ring_queue_policy_t;
+
+struct _ecds_ring_queue_stats_t
+{
+	uint32_t capacity;		//!<	Number of slots in the queue
+	uint32_t depth;			//!<	Number of objects currently queued
+	uint32_t peak_depth;	//!<	Highest depth seen since the queue was created
+	uint64_t enqueued;		//!<	Number of objects accepted
+	uint64_t dequeued;		//!<	Number of objects handed to the consumer
+	uint64_t dropped;		//!<	Number of objects discarded by ECDS_RING_QUEUE_DROP_OLDEST
+	uint64_t rejected;		//!<	Number of objects refused by ECDS_RING_QUEUE_FAIL or after closing
+	uint64_t blocked;		//!<	Number of times a producer had to wait for room
+};
+
+/**
+ * @brief Create a new, empty ring queue.
+ * @param capacity The number of slots, rounded up to the next power of two.
+ * @param policy What to do when an object is posted to a full queue.
+ * @return The new queue, or NULL if it could not be allocated.
+ */
+ecds_ring_queue_t * ecds_ring_queue_new(uint32_t capacity, ecds_ring_queue_policy_t policy);
+
+/**
+ * @brief Dispose a ring queue, releasing the references on any objects still queued.
+ */
+void ecds_ring_queue_dispose(ecds_ring_queue_t * queue);
+
+/**
+ * @brief Post an object to the queue and take a reference on it.
+ * @param queue The queue to act on.
+ * @param obj The object to enqueue.
+ * @return true if the object was queued, false if it was rejected.
+ */
+bool ecds_ring_queue_enqueue(ecds_ring_queue_t * queue, ecds_object_t * obj);
+
+/**
+ * @brief Take the oldest object from the queue without waiting.
+ * @param queue The queue to act on.
+ * @return The object, whose reference now belongs to the caller, or NULL if the queue is empty.
+ */
+ecds_object_t * ecds_ring_queue_dequeue(ecds_ring_queue_t * queue);
+
+/**
+ * @brief Wait until the queue contains at least one object.
+ * @param queue The queue to act on.
+ * @return true if objects are available, false if the queue was closed and is empty.
+ */
+bool ecds_ring_queue_wait(ecds_ring_queue_t * queue);
+
+/**
+ * @brief Close the queue. Further objects are rejected and all waiting threads are woken up.
+ */
+void ecds_ring_queue_close(ecds_ring_queue_t * queue);
+
+//!< @brief Get the number of objects currently queued.
+uint32_t ecds_ring_queue_depth(ecds_ring_queue_t * queue);
+
+//!< @brief Get the depth and throughput counters of a queue.
+void ecds_ring_queue_get_stats(ecds_ring_queue_t * queue, ecds_ring_queue_stats_t * stats);
+
+#endif /* _ECDS_RING_QUEUE_H */
@@ -23,8 +23,20 @@
 /*  - Once the Service objects are created you can attach them to the        */
 /*    dispatcher and they will begin receiving messages.                     */
 /*                                                                           */
-/*  As each of the services will receive their own individual copy of a      */
-/*  message there is no risk of corrupting shared memory between threads.    */
+/*  The data of a message is an immutable payload that all services share    */
+/*  without copying. Handlers must treat it as read-only. A service whose    */
+/*  dispatch callback wants to change it takes its own reference first, so   */
+/*  that ecds_payload_make_writable() copies the data instead of changing    */
+/*  the payload the message and the other services still see:                */
+/*                                                                           */
+/*      ecds_payload_t * payload = msg->payload;                             */
+/*                                                                           */
+/*      ecds_object_ref(ECDS_OBJECT(payload));                               */
+/*      data = ecds_payload_make_writable(&payload);                         */
+/*      ...                                                                  */
+/*      ecds_object_unref(ECDS_OBJECT(payload));                             */
+/*                                                                           */
+/*  Never pass &msg->payload, the message is shared by every subscriber.     */
 /*                                                                           */
 /*****************************************************************************/
 #ifndef _ECDS_SERVICE_H
@@ -36,22 +48,22 @@
 #include <core/ecds_dispatcher.h>
 
 #define ECDS_IS_SERVICE 0x20000000
+#define ECDS_TYPE_SERVICE_HANDLER 0x20000001
 
 /**
  * @brief Universal service handler prototype.
- * @param user_data_length The number of bytes of data that was copied from
- *						   the dispatched message.
- * @param user_data A pointer to a copy of the user-specified data structure
- *					that was passed on to the dispatcher.
+ * @param user_data_length The number of bytes of data carried by the
+ *						   dispatched message.
+ * @param user_data A read-only pointer to the data of the message, which is
+ *					shared with every other handler receiving it.
  */
 typedef void(* ecds_handler_func)( uint32_t user_data_length, 
 								   void * user_data );
 
 /**
  * @brief Dispatches a message to one of the handlers registered within this service.
- *		  The message is copied into the service's memory before being passed on
- *		  to the registered handlers. If there are no handlers registered, the dispatch
- *		  is ignored.
+ *		  The handlers receive the message data in place, without a copy. If there are
+ *		  no handlers registered, the dispatch is ignored.
  * @param service The service to act on.
  * @param dispatcher The dispatcher which was responsible for sending the message.
  * @msg The actual message that is being dispatched.
@@ -60,21 +72,63 @@ void ecds_service_dispatch_message(ecds_service_t * service, ecds_dispatcher_t *
 
 /**
  * @brief Registers a new handler into a service.
+ *		  Dispatchers the service is subscribed to rebuild their routing tables to include the handler.
  * @param service The service to modify.
  * @param event_id One of the ECDS_EVENT constants for event bus types, or a user-defined bus number.
  * @user_function A pointer to the handler function which performs an action on this event type.
+ * @note Dispatchers are not referenced. ecds_dispatcher_destroy() must not run while handlers are added
+ *		 to a service subscribed to that dispatcher.
  */
 void ecds_service_add_handler(ecds_service_t * service, uint32_t event_id, ecds_handler_func user_function);
 
+/**
+ * @brief Collect the handlers a service has registered for a specific event.
+ * @param service The service to inspect.
+ * @param event_id The event ID to look for.
+ * @param handlers An array receiving the handler functions, or NULL to only count them.
+ * @param capacity The number of functions handlers can hold. Handlers beyond it are counted but not stored.
+ * @return The number of handlers registered for the event, which may be more than capacity.
+ * @note Handlers can be added from other threads at any time, so a count taken earlier may be too low.
+ */
+uint32_t ecds_service_get_handlers(ecds_service_t * service, uint32_t event_id, ecds_handler_func * handlers, uint32_t capacity);
+
+/**
+ * @brief Record that a dispatcher routes messages to a service, so it rebuilds its routes when handlers change.
+ *		  Called by the dispatcher when the service subscribes.
+ * @param service The service to modify.
+ * @param dispatcher The dispatcher, which is not referenced since dispatchers are unmanaged.
+ */
+void ecds_service_attach_dispatcher(ecds_service_t * service, ecds_dispatcher_t * dispatcher);
+
+/**
+ * @brief Forget a dispatcher recorded with ecds_service_attach_dispatcher().
+ *		  Called by the dispatcher when it is destroyed.
+ * @param service The service to modify.
+ * @param dispatcher The dispatcher to forget.
+ */
+void ecds_service_detach_dispatcher(ecds_service_t * service, ecds_dispatcher_t * dispatcher);
+
 struct _ecds_service_t
 {
 	ecds_object_t obj;
 
 	ecds_list_t * handler_list;
+	ecds_list_t * dispatcher_list;		//!<	Dispatchers this service is subscribed to
+	int service_lock;					//!<	Protects handler_list and dispatcher_list, 0 when free so zero-filled services work
 
 	void (* dispatch)(ecds_service_t * service, 
 				  ecds_dispatcher_t * dispatcher,
 				  ecds_message_t * msg);		//!<	Called when the service receives a bus message.
+
+	/**
+	 * Called instead of dispatch with several bus messages at once, in the order they were posted.
+	 * The handlers registered for each message run after the batch handler returns. The array and
+	 * the messages are only valid for the duration of the call.
+	 */
+	void (* dispatch_batch)(ecds_service_t * service,
+							ecds_dispatcher_t * dispatcher,
+							ecds_message_t ** msgs,
+							uint32_t count);
 };
 
 #endif /* _ECDS_SERVICE_H */
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*****************************************************************************/
+/*	@file ecds_atom.c														 */
+/*	@brief ECDS interned strings											 */
+/*																			 */
+/*	Every atom is a single block holding a small header followed by the		 */
+/*	characters. The table maps the characters to the atom, so interning a	 */
+/*	name that is already in use is one hash lookup and no allocation.		 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <common/ecds_hash_table.h>
+
+#include <core/ecds_atom.h>
+
+#define ECDS_LOG_DOMAIN "ecds-atom"
+
+typedef struct _ecds_atom_t ecds_atom_t;
+
+struct _ecds_atom_t
+{
+	int refcnt;				//!<	Only modified with atom_mutex held
+	char str[];
+};
+
+const char ECDS_ATOM_ANONYMOUS[] = "object";
+
+static ecds_hash_table_t atom_table;
+static bool atom_table_initialized = false;
+static pthread_mutex_t atom_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define _ATOM(str)		((ecds_atom_t *)((char *)(str) - offsetof(ecds_atom_t, str)))
+
+const char * ecds_atom_intern(const char * str)
+{
+	ecds_atom_t * atom;
+	size_t length;
+
+	if (str == NULL || str == ECDS_ATOM_ANONYMOUS)
+		return ECDS_ATOM_ANONYMOUS;
+
+	pthread_mutex_lock(&atom_mutex);
+
+	if (!atom_table_initialized)
+	{
+		ecds_hash_table_initialize(&atom_table, ecds_hash_string, ecds_hash_string_equal);
+		atom_table_initialized = true;
+	}
+
+	if ((atom = (ecds_atom_t *)ecds_hash_table_lookup(&atom_table, str)))
+	{
+		atom->refcnt++;
+		pthread_mutex_unlock(&atom_mutex);
+		return atom->str;
+	}
+
+	length = strlen(str) + 1;
+	atom = (ecds_atom_t *)ecds_memory_alloc(sizeof(ecds_atom_t) + length);
+	if (!atom)
+	{
+		pthread_mutex_unlock(&atom_mutex);
+		ecds_log_error("Out of memory when interning %s", str);
+		return ECDS_ATOM_ANONYMOUS;
+	}
+
+	atom->refcnt = 1;
+	memcpy(atom->str, str, length);
+
+	if (!ecds_hash_table_insert(&atom_table, atom->str, atom))
+	{
+		pthread_mutex_unlock(&atom_mutex);
+		ecds_memory_free(atom);
+		return ECDS_ATOM_ANONYMOUS;
+	}
+
+	pthread_mutex_unlock(&atom_mutex);
+	return atom->str;
+}
+
+const char * ecds_atom_ref(const char * str)
+{
+	if (str == NULL || str == ECDS_ATOM_ANONYMOUS)
+		return ECDS_ATOM_ANONYMOUS;
+
+	pthread_mutex_lock(&atom_mutex);
+	_ATOM(str)->refcnt++;
+	pthread_mutex_unlock(&atom_mutex);
+
+	return str;
+}
+
+void ecds_atom_release(const char * str)
+{
+	ecds_atom_t * atom;
+
+	if (str == NULL || str == ECDS_ATOM_ANONYMOUS)
+		return;
+
+	atom = _ATOM(str);
+
+	pthread_mutex_lock(&atom_mutex);
+	if (--atom->refcnt > 0)
+	{
+		pthread_mutex_unlock(&atom_mutex);
+		return;
+	}
+
+	ecds_hash_table_remove(&atom_table, atom->str);
+	pthread_mutex_unlock(&atom_mutex);
+
+	ecds_memory_free(atom);
+}
+
+uint32_t ecds_atom_get_count()
+{
+	uint32_t count;
+
+	pthread_mutex_lock(&atom_mutex);
+	count = atom_table.count;
+	pthread_mutex_unlock(&atom_mutex);
+
+	return count;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************/
+/*	@file ecds_atom.h														 */
+/*	@brief ECDS interned strings											 */
+/*																			 */
+/*	Object names are interned: every distinct name is stored once as an		 */
+/*	immutable atom that is shared by all objects carrying that name. Atoms	 */
+/*	are reference counted and released when the last object using them is	 */
+/*	disposed or renamed, so the table only holds names that are in use.		 */
+/*																			 */
+/*	Objects created without a name share ECDS_ATOM_ANONYMOUS, which lives	 */
+/*	outside of the table and costs nothing to assign or release.			 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_ATOM_H
+#define _ECDS_ATOM_H
+
+#include <ecds.h>
+
+//!<	Name shared by all objects that were created without one.
+extern const char ECDS_ATOM_ANONYMOUS[];
+
+/**
+ * @brief Get the atom for a string, taking a reference on it.
+ * @param str The string to intern, or NULL for ECDS_ATOM_ANONYMOUS.
+ * @return The atom, which stays valid until it is passed to ecds_atom_release().
+ */
+const char * ecds_atom_intern(const char * str);
+
+//!< @brief Take an additional reference on an atom.
+const char * ecds_atom_ref(const char * atom);
+
+//!< @brief Release a reference on an atom obtained from ecds_atom_intern() or ecds_atom_ref().
+void ecds_atom_release(const char * atom);
+
+//!< @brief Get the number of distinct atoms currently interned.
+uint32_t ecds_atom_get_count();
+
+#endif /* _ECDS_ATOM_H */
@@ -14,9 +14,14 @@
 
 #define ECDS_LOG_DOMAIN "ecds_class_handler"
 
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
 #include <ecds.h>
-#include <common/ecds_list.h>
+#include <common/ecds_array.h>
+#include <common/ecds_hash_table.h>
 
+#include <core/ecds_atom.h>
 #include <core/ecds_memory_manager.h>
 #include <core/ecds_class_handler.h>
 
@@ -28,13 +33,18 @@ struct _ecds_class_handler_entry_t {
 
 	uint32_t class_uid;
 	char * class_name;
+	char * default_object_name;		//!<	Name given to objects constructed without one
 	ecds_object_t * (* constructor)(const char * object_name);
 };
 
 struct _ecds_class_handler_t {
 	ecds_object_t obj;
 
-	ecds_list_t * classes;	//!<	List of registered classes
+	ecds_array_t * classes;				//!<	Registered classes in the order they were registered
+	ecds_hash_table_t classes_by_name;	//!<	Registered classes indexed by class name
+	ecds_hash_table_t classes_by_uid;	//!<	Registered classes indexed by type UID
+
+	pthread_mutex_t class_mutex[1];		//!<	Protects the class array and both indices
 };
 
 static ecds_class_handler_t * ecds_class_handler_default = NULL;
@@ -45,92 +55,144 @@ ecds_class_handler_t * ecds_class_handler_get_default()
 	{
 		ecds_log_info("Creating default class handler");
 		ecds_class_handler_default = (ecds_class_handler_t *)ecds_object_new("ecds-class-handler-default", sizeof(ecds_class_handler_t), ECDS_TYPE_CLASS_HANDLER);
-		ecds_class_handler_default->classes = ecds_list_new();
+		ecds_class_handler_default->classes = ecds_array_new();
+		ecds_hash_table_initialize(&ecds_class_handler_default->classes_by_name, ecds_hash_string, ecds_hash_string_equal);
+		ecds_hash_table_initialize(&ecds_class_handler_default->classes_by_uid, ecds_hash_uint32, ecds_hash_uint32_equal);
+		pthread_mutex_init(ecds_class_handler_default->class_mutex, 0);
 	}
 
 	return ecds_class_handler_default;
 }
 
+static ecds_class_handler_entry_t * _class_handler_find_by_name(ecds_class_handler_t * class_handler, const char * type_name)
+{
+	ecds_class_handler_entry_t * entry;
+
+	pthread_mutex_lock(class_handler->class_mutex);
+	entry = (ecds_class_handler_entry_t *)ecds_hash_table_lookup(&class_handler->classes_by_name, type_name);
+	pthread_mutex_unlock(class_handler->class_mutex);
+
+	return entry;
+}
+
+static ecds_class_handler_entry_t * _class_handler_find_by_uid(ecds_class_handler_t * class_handler, uint32_t type_uid)
+{
+	ecds_class_handler_entry_t * entry;
+
+	pthread_mutex_lock(class_handler->class_mutex);
+	entry = (ecds_class_handler_entry_t *)ecds_hash_table_lookup(&class_handler->classes_by_uid, ECDS_HASH_UINT32_KEY(type_uid));
+	pthread_mutex_unlock(class_handler->class_mutex);
+
+	return entry;
+}
+
 uint32_t ecds_register_class(
 	const char * type_name,
 	uint32_t type_uid,
 	ecds_object_t * (*construct)(const char * object_name))
 {
 	char class_entry_name[120];
-	ecds_list_item_t * item = NULL;
+	char default_object_name[128];
 	ecds_class_handler_entry_t * entry = NULL;
 	ecds_class_handler_t * class_handler = ecds_class_handler_get_default();
 
+	if (!type_name)
+		return 0;
+
+	pthread_mutex_lock(class_handler->class_mutex);
+
 	/* Search if the class is already registered first */
-	for (item = ecds_list_first_item(class_handler->classes); item; item = ecds_list_next_item(item))
+	if ((entry = (ecds_class_handler_entry_t *)ecds_hash_table_lookup(&class_handler->classes_by_name, type_name)))
+	{
+		pthread_mutex_unlock(class_handler->class_mutex);
+		return entry->class_uid;
+	}
+
+	if (type_uid != 0 && ecds_hash_table_lookup(&class_handler->classes_by_uid, ECDS_HASH_UINT32_KEY(type_uid)))
 	{
-		entry = (ecds_class_handler_entry_t *)ecds_list_get_item(class_handler->classes, item);
-		if (strcmp(type_name, entry->class_name) == 0)
-			/* Class is already registered */
-			return entry->class_uid;
+		pthread_mutex_unlock(class_handler->class_mutex);
+		ecds_log_error("Unable to register class %s: Type UID %08X is already in use", type_name, type_uid);
+		return 0;
 	}
 
-	sprintf(class_entry_name, "class_entry_%s", type_name);
+	snprintf(class_entry_name, sizeof(class_entry_name), "class_entry_%s", type_name);
 	entry = (ecds_class_handler_entry_t *)ecds_object_new(class_entry_name, sizeof(ecds_class_handler_entry_t), ECDS_TYPE_CLASS_HANDLER_ENTRY);
+	if (!entry)
+	{
+		pthread_mutex_unlock(class_handler->class_mutex);
+		ecds_log_error("Out of memory when registering class %s", type_name);
+		return 0;
+	}
+
+	/* Names are built once here instead of on every construction */
+	snprintf(default_object_name, sizeof(default_object_name), "%s-obj", type_name);
+	entry->class_name = ecds_memory_strdup(type_name);
+	entry->default_object_name = ecds_memory_strdup(default_object_name);
+	if (!entry->class_name || !entry->default_object_name)
+	{
+		pthread_mutex_unlock(class_handler->class_mutex);
+		ecds_log_error("Out of memory when registering class %s", type_name);
+
+		/* Entries are unmanaged, so nobody else frees them */
+		ecds_memory_free(entry->class_name);
+		ecds_memory_free(entry->default_object_name);
+		ecds_atom_release(entry->obj.name);
+		ecds_memory_free(entry);
+		return 0;
+	}
 
-	entry->class_name = strdup(type_name);
 	if (type_uid == 0)
-		entry->class_uid = (uint32_t)rand() & 0x00FFFFFF;
-	else
-		entry->class_uid = type_uid;
+	{
+		/* Pick a random UID that is not taken yet */
+		do {
+			type_uid = (uint32_t)rand() & 0x00FFFFFF;
+		} while (type_uid == 0 || ecds_hash_table_lookup(&class_handler->classes_by_uid, ECDS_HASH_UINT32_KEY(type_uid)));
+	}
+	entry->class_uid = type_uid;
 	entry->constructor = construct;
 
 	ecds_log_info("Registering class: %s", type_name);
-	ecds_list_add_item(class_handler->classes, ECDS_OBJECT(entry));
+	ecds_array_append(class_handler->classes, ECDS_OBJECT(entry));
+	ecds_hash_table_insert(&class_handler->classes_by_name, entry->class_name, entry);
+	ecds_hash_table_insert(&class_handler->classes_by_uid, ECDS_HASH_UINT32_KEY(entry->class_uid), entry);
+
+	pthread_mutex_unlock(class_handler->class_mutex);
 
 	return entry->class_uid;
 }
 
 uint32_t ecds_get_class_uid(const char * type_name)
 {
-	ecds_list_item_t * item = NULL;
 	ecds_class_handler_entry_t * entry = NULL;
-	ecds_class_handler_t * class_handler = ecds_class_handler_get_default();
 
-	/* Search if the class is already registered first */
-	for (item = ecds_list_first_item(class_handler->classes); item; item = ecds_list_next_item(item))
-	{
-		entry = (ecds_class_handler_entry_t *)ecds_list_get_item(class_handler->classes, item);
-		if (strcmp(type_name, entry->class_name) == 0)
-			/* Class is already registered */
-			return entry->class_uid;
-	}
+	if (!type_name)
+		return 0;
+
+	entry = _class_handler_find_by_name(ecds_class_handler_get_default(), type_name);
 
-	return 0;
+	return entry ? entry->class_uid : 0;
 }
 
 ecds_object_t * ecds_object_construct(const char * type_name, const char * object_name)
 {
-	ecds_list_item_t * item = NULL;
 	ecds_class_handler_entry_t * entry = NULL;
-	ecds_class_handler_t * class_handler = ecds_class_handler_get_default();
-	ecds_object_t * ret = NULL;
 
-	for (item = ecds_list_first_item(class_handler->classes); item; item = ecds_list_next_item(item))
-	{
-		entry = (ecds_class_handler_entry_t *)ecds_list_get_item(class_handler->classes, item);
-		if (strcmp(type_name, entry->class_name) == 0)
-		{
-			if (object_name == NULL)
-			{
-				char temp_name[128];
-				sprintf(temp_name, "%s-obj", type_name);
-				ret = entry->constructor(temp_name);
-			}
-			else
-				ret = entry->constructor(object_name);
-
-			return ret;
-		}
-	}
+	if (type_name && (entry = _class_handler_find_by_name(ecds_class_handler_get_default(), type_name)))
+		return entry->constructor(object_name ? object_name : entry->default_object_name);
 
 	/* Class type name was not found */
 	ecds_log_warning("Unable to construct object of type %s: Type not registered", type_name);
 	return NULL;
 }
 
+ecds_object_t * ecds_construct_object_by_uid(uint32_t type_uid)
+{
+	ecds_class_handler_entry_t * entry = NULL;
+
+	if ((entry = _class_handler_find_by_uid(ecds_class_handler_get_default(), type_uid)))
+		return entry->constructor(entry->default_object_name);
+
+	/* Class type UID was not found */
+	ecds_log_warning("Unable to construct object of type %08X: Type not registered", type_uid);
+	return NULL;
+}
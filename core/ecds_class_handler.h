@@ -39,11 +39,12 @@ void ecds_set_property(ecds_object_t * obj, const char * property_name, void * v
 void * ecds_get_property(ecds_object_t * obj, const char * property_name);
 
 /**
- * @brief Construct a new object of a given type UID and take a reference on it. Constructing by UID is marginally faster.
+ * @brief Construct a new object of a given type UID and take a reference on it. Constructing by UID skips
+ *		  hashing the class name, and the object gets the default name for its class.
  * @param type_uid The type UID to use.
  * @return A pointer to the new object, or NULL if the construction failed.
  */
-ecds_object_t * ecds_construct_object_by_uid(const char * type_uid);
+ecds_object_t * ecds_construct_object_by_uid(uint32_t type_uid);
 
 ecds_class_handler_t * ecds_class_handler_get_default();
 
@@ -1,148 +1,984 @@
 #include <stdio.h>
+#include <string.h>
 
 #define HAVE_STRUCT_TIMESPEC
 #include <pthread.h>
 
 #define ECDS_LOG_DOMAIN "ecds-dispatcher"
 
-#include <common/ecds_queue.h>
+#include <common/ecds_atomic.h>
+#include <common/ecds_list.h>
+#include <common/ecds_array.h>
+#include <common/ecds_ring_queue.h>
 #include <common/ecds_service.h>
 #include <common/ecds_log.h>
 
+#include <core/ecds_atom.h>
 #include <core/ecds_process.h>
 #include <core/ecds_dispatcher.h>
+#include <core/ecds_work_deque.h>
 
-static ecds_dispatcher_t * default_dispatcher = NULL;
+#define ECDS_DISPATCHER_SUBSCRIBER 0xFFFFFFAB
+
+//!<	Number of messages a worker delivers to one service before looking for other work.
+#define ECDS_DISPATCHER_SERVICE_BUDGET	32
+
+//!<	Number of scheduled services a worker takes from the ready queue at once.
+#define ECDS_DISPATCHER_WORKER_BATCH	8
 
-void ecds_dispatcher_dispatch_message(ecds_dispatcher_t * disp, ecds_message_t * msg);
+static ecds_dispatcher_t * default_dispatcher = NULL;
 
 typedef struct _ecds_dispatcher_event_t ecds_dispatcher_event_t;
 struct _ecds_dispatcher_event_t {
 	ecds_object_t obj;
 	uint32_t event_id;
-	ecds_list_t * service_list;
+	ecds_array_t * service_list;	//!<	Array of ecds_dispatcher_subscriber_t
+};
+
+/**
+ * A service as seen by one dispatcher. With a worker pool, messages for the service are
+ * collected in its mailbox and the subscriber is scheduled on one worker at a time, which
+ * keeps the messages for a single service in order.
+ */
+typedef struct _ecds_dispatcher_subscriber_t ecds_dispatcher_subscriber_t;
+struct _ecds_dispatcher_subscriber_t {
+	ecds_object_t obj;
+	ecds_service_t * service;
+	ecds_ring_queue_t * mailbox;	//!<	Messages waiting for the service (worker pool only)
+	int scheduled;					//!<	Non-zero while queued for or running on a worker
+	int batch_group;				//!<	Group of the batch being routed, -1 if none (dispatcher thread only)
+};
+
+typedef struct _ecds_dispatcher_worker_t ecds_dispatcher_worker_t;
+struct _ecds_dispatcher_worker_t {
+	ecds_dispatcher_t * disp;
+	uint32_t index;
+	uint64_t * reader_epoch;
+	ecds_work_deque_t deque;
+	pthread_t worker_thread[1];
+};
+
+//=================================== 8< ====================================//
+//								ROUTING TABLE								 //
+//===========================================================================//
+/*	The event list is the authoritative record of subscriptions, but it is	 */
+/*	only used to build the routing table. The routing table is an immutable	 */
+/*	snapshot that maps an event ID to a contiguous array of subscribed		 */
+/*	services, each with the handlers it registered for that event. Every	 */
+/*	change to the subscriptions builds a new table and swaps it in, so the	 */
+/*	dispatcher thread never takes a lock to route a message.				 */
+/*																			 */
+/*	Old tables cannot be freed as long as a reader may still be using them. */
+/*	Readers publish the route epoch they started with (0 when idle), a		 */
+/*	retired table is freed once every busy reader started after it was		 */
+/*	retired.																 */
+/*===========================================================================*/
+typedef struct _ecds_dispatcher_route_entry_t ecds_dispatcher_route_entry_t;
+typedef struct _ecds_dispatcher_route_t ecds_dispatcher_route_t;
+typedef struct _ecds_dispatcher_route_table_t ecds_dispatcher_route_table_t;
+
+struct _ecds_dispatcher_route_entry_t {
+	ecds_dispatcher_subscriber_t * subscriber;
+	uint32_t handler_count;
+	ecds_handler_func * handlers;
+};
+
+struct _ecds_dispatcher_route_t {
+	uint32_t event_id;
+	uint32_t entry_count;					//!<	0 marks an unused slot
+	ecds_dispatcher_route_entry_t * entries;
+};
+
+struct _ecds_dispatcher_route_table_t {
+	uint32_t mask;							//!<	Number of slots minus one, slots are a power of two
+	ecds_dispatcher_route_t * slots;
+
+	uint64_t retire_epoch;
+	ecds_dispatcher_route_table_t * next_retired;	//!<	Next table waiting to be freed
+};
+
+//=================================== 8< ====================================//
+//								   BATCHING									 //
+//===========================================================================//
+/*	The dispatcher thread drains up to batch_size messages at once and		 */
+/*	groups them by destination service, so every service gets its share of	 */
+/*	the batch as one contiguous array. Grouping is a counting sort: the		 */
+/*	first pass assigns each subscriber a group and counts its messages, the	 */
+/*	second pass places each delivery at its group's offset, which keeps the	 */
+/*	messages for one service in the order they were posted.					 */
+/*===========================================================================*/
+typedef struct _ecds_dispatcher_batch_group_t ecds_dispatcher_batch_group_t;
+typedef struct _ecds_dispatcher_batch_t ecds_dispatcher_batch_t;
+
+struct _ecds_dispatcher_batch_group_t {
+	ecds_dispatcher_subscriber_t * subscriber;
+	uint32_t offset;						//!<	First delivery of this group
+	uint32_t count;
+};
+
+struct _ecds_dispatcher_batch_t {
+	uint32_t size;							//!<	Maximum number of messages drained at once
+	ecds_message_t ** messages;				//!<	Drained messages, in posting order
+	ecds_dispatcher_route_t ** routes;		//!<	Route of every drained message, or NULL
+
+	uint32_t delivery_capacity;
+	ecds_message_t ** deliveries;			//!<	Messages grouped by subscriber
+	ecds_dispatcher_route_entry_t ** delivery_entries;
+
+	uint32_t group_capacity;
+	ecds_dispatcher_batch_group_t * groups;
 };
 
 struct _ecds_dispatcher_t {
 	ecds_process_t proc;
-	ecds_queue_t * message_queue;
-	ecds_list_t * event_list;
+	ecds_ring_queue_t * message_queue;
+	ecds_array_t * event_list;
+	ecds_array_t * subscriber_list;
+	ecds_dispatcher_batch_t batch;					//!<	Scratch space of the dispatcher thread
 
 	bool running;
 
+	ecds_dispatcher_route_table_t * routes;			//!<	Current routing table, replaced atomically
+	ecds_dispatcher_route_table_t * retired_routes;	//!<	Replaced tables that may still be in use
+	uint64_t route_epoch;							//!<	Incremented every time a table is retired
+	uint64_t * reader_epochs;						//!<	Epoch each reader started reading at, 0 when idle
+
+	uint32_t worker_count;							//!<	Number of pool workers, 0 to dispatch on the dispatcher thread
+	uint32_t mailbox_capacity;
+	ecds_dispatcher_worker_t * workers;
+	ecds_ring_queue_t * ready_queue;				//!<	Subscribers that were scheduled by the dispatcher thread
+	int idle_workers;
+	bool closing;
+
 	pthread_t dispatcher_thread[1];
-	pthread_mutex_t dispatcher_mutex[1];
-	pthread_cond_t dispatcher_cond[1];
+	pthread_mutex_t dispatcher_mutex[1];	//!<	Protects subscriptions, never taken to dispatch
+	pthread_mutex_t pool_mutex[1];			//!<	Only taken to put workers to sleep or wake them up
+	pthread_cond_t pool_cond[1];
 };
 
-static void * _dispatcher_thread(void * arg)
+static inline uint32_t _route_hash(uint32_t event_id)
 {
-	ecds_dispatcher_t * disp = (ecds_dispatcher_t *)arg;
-	bool running = true;
+	/* Event IDs are bus/label pairs, mix the halves before masking */
+	return (event_id ^ (event_id >> 16)) * 0x9E3779B1u;
+}
+
+static ecds_dispatcher_route_t * _route_lookup(ecds_dispatcher_route_table_t * table, uint32_t event_id)
+{
+	if (!table)
+		return NULL;
+
+	for (uint32_t i = _route_hash(event_id) & table->mask; ; i = (i + 1) & table->mask)
+	{
+		ecds_dispatcher_route_t * route = &table->slots[i];
+
+		if (route->entry_count == 0)
+			return NULL;
+		if (route->event_id == event_id)
+			return route;
+	}
+}
+
+static ecds_dispatcher_route_table_t * _route_table_build(ecds_dispatcher_t * disp)
+{
+	ecds_dispatcher_route_table_t * table;
+	ecds_dispatcher_route_entry_t * entries;
+	ecds_handler_func * handlers;
+	uint32_t event_count = 0, entry_count = 0, handler_count = 0, slot_count = 8;
+	size_t size;
 
-	while (running)
+	/* Size everything first so the table is a single allocation */
+	event_count = ecds_array_count(disp->event_list);
+	for (uint32_t e = 0; e < event_count; e++)
 	{
-		pthread_mutex_lock(disp->dispatcher_mutex);
+		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_array_get(disp->event_list, e);
+		uint32_t sub_count = ecds_array_count(evt->service_list);
 
-		/* Wait for messages to become available */
-		while (ecds_queue_peek(disp->message_queue) == NULL) {
-			pthread_cond_wait(disp->dispatcher_cond, 
-							  disp->dispatcher_mutex);
+		entry_count += sub_count;
+		for (uint32_t s = 0; s < sub_count; s++)
+		{
+			ecds_dispatcher_subscriber_t * sub = (ecds_dispatcher_subscriber_t *)ecds_array_get(evt->service_list, s);
+
+			handler_count += ecds_service_get_handlers(sub->service, evt->event_id, NULL, 0);
 		}
+	}
+
+	/* Keep the load factor at or below one half so probing always ends at an empty slot */
+	while (slot_count < event_count * 2)
+		slot_count <<= 1;
+
+	size = sizeof(ecds_dispatcher_route_table_t) 
+		 + slot_count * sizeof(ecds_dispatcher_route_t)
+		 + entry_count * sizeof(ecds_dispatcher_route_entry_t)
+		 + handler_count * sizeof(ecds_handler_func);
 
-		for (ecds_list_item_t * iter = ecds_queue_dequeue_item(disp->message_queue);
-			iter; 
-			iter = ecds_queue_dequeue_item(disp->message_queue))
+	table = (ecds_dispatcher_route_table_t *)ecds_memory_alloc(size);
+	if (!table)
+	{
+		ecds_log_error("Out of memory when building routing table for %s", disp->proc.obj.name);
+		return NULL;
+	}
+
+	table->mask = slot_count - 1;
+	table->slots = (ecds_dispatcher_route_t *)(table + 1);
+	entries = (ecds_dispatcher_route_entry_t *)(table->slots + slot_count);
+	handlers = (ecds_handler_func *)(entries + entry_count);
+
+	for (uint32_t e = 0; e < event_count; e++)
+	{
+		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_array_get(disp->event_list, e);
+		ecds_dispatcher_route_t * route = NULL;
+		uint32_t sub_count = ecds_array_count(evt->service_list);
+		uint32_t i;
+
+		if (sub_count == 0)
+			continue;
+
+		for (i = _route_hash(evt->event_id) & table->mask; table->slots[i].entry_count; i = (i + 1) & table->mask)
+			;
+		route = &table->slots[i];
+		route->event_id = evt->event_id;
+		route->entries = entries;
+
+		for (uint32_t s = 0; s < sub_count; s++)
 		{
-			/* Extract message and dequeue the next */
-			ecds_message_t * msg = (ecds_message_t *)ecds_list_get_item(ECDS_LIST(disp->message_queue), iter);
-			ecds_dispatcher_dispatch_message(disp, msg);
-			ecds_list_dispose_item(iter);
+			ecds_dispatcher_route_entry_t * entry = &route->entries[route->entry_count++];
+
+			entry->subscriber = (ecds_dispatcher_subscriber_t *)ecds_array_get(evt->service_list, s);
+			entry->handlers = handlers;
+			entry->handler_count = ecds_service_get_handlers(entry->subscriber->service, evt->event_id, handlers, handler_count);
+
+			/* A handler added since sizing is left out, adding it triggers another rebuild */
+			if (entry->handler_count > handler_count)
+				entry->handler_count = handler_count;
+			handlers += entry->handler_count;
+			handler_count -= entry->handler_count;
 		}
 
-		running = disp->running;
-		
-		pthread_mutex_unlock(disp->dispatcher_mutex);
+		entries += route->entry_count;
+	}
+
+	return table;
+}
+
+static void _route_table_reclaim(ecds_dispatcher_t * disp)
+{
+	ecds_dispatcher_route_table_t ** link = &disp->retired_routes;
+	uint64_t oldest = UINT64_MAX;
+
+	/* Find the oldest epoch any busy reader (dispatcher thread or worker) started at */
+	for (uint32_t i = 0; i <= disp->worker_count; i++)
+	{
+		uint64_t reader = ecds_atomic_load(&disp->reader_epochs[i]);
+		if (reader != 0 && reader < oldest)
+			oldest = reader;
+	}
+
+	while (*link)
+	{
+		ecds_dispatcher_route_table_t * table = *link;
+
+		if (oldest >= table->retire_epoch)
+		{
+			/* No reader can still hold this table */
+			*link = table->next_retired;
+			ecds_memory_free(table);
+		}
+		else
+			link = &table->next_retired;
+	}
+}
+
+static void _route_table_publish(ecds_dispatcher_t * disp)
+{
+	ecds_dispatcher_route_table_t * table = _route_table_build(disp);
+	ecds_dispatcher_route_table_t * old;
+
+	if (!table)
+		return;
+
+	old = ecds_atomic_exchange(&disp->routes, table);
+	if (old)
+	{
+		old->retire_epoch = ecds_atomic_increment(&disp->route_epoch);
+		old->next_retired = disp->retired_routes;
+		disp->retired_routes = old;
+	}
+
+	_route_table_reclaim(disp);
+}
+
+static inline ecds_dispatcher_route_table_t * _route_table_acquire(ecds_dispatcher_t * disp, uint64_t * reader_epoch)
+{
+	ecds_atomic_store(reader_epoch, ecds_atomic_load(&disp->route_epoch));
+	return ecds_atomic_load(&disp->routes);
+}
+
+static inline void _route_table_release(uint64_t * reader_epoch)
+{
+	ecds_atomic_store(reader_epoch, 0);
+}
+
+//=================================== 8< ====================================//
+//								 DISPATCHING								 //
+//===========================================================================//
+static void _dispatcher_deliver(ecds_dispatcher_t * disp, ecds_service_t * service,
+								ecds_message_t ** msgs, ecds_dispatcher_route_entry_t ** entries, uint32_t count)
+{
+	if (service->dispatch_batch)
+	{
+		/* Hand the whole batch to the service, then run the handlers */
+		service->dispatch_batch(service, disp, msgs, count);
+
+		for (uint32_t i = 0; i < count; i++)
+			for (uint32_t h = 0; h < entries[i]->handler_count; h++)
+				(* entries[i]->handlers[h])(msgs[i]->user_data_length, msgs[i]->user_data);
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		/* Dispatch message to the service itself */
+		if (service->dispatch)
+			service->dispatch(service, disp, msgs[i]);
+
+		/* Dispatch message to the handlers registered for this event */
+		for (uint32_t h = 0; h < entries[i]->handler_count; h++)
+			(* entries[i]->handlers[h])(msgs[i]->user_data_length, msgs[i]->user_data);
+	}
+}
+
+static bool _batch_initialize(ecds_dispatcher_batch_t * batch, uint32_t size)
+{
+	batch->size = size;
+	batch->messages = (ecds_message_t **)ecds_memory_alloc(size * sizeof(ecds_message_t *));
+	batch->routes = (ecds_dispatcher_route_t **)ecds_memory_alloc(size * sizeof(ecds_dispatcher_route_t *));
+
+	return batch->messages && batch->routes;
+}
+
+static void _batch_dispose(ecds_dispatcher_batch_t * batch)
+{
+	ecds_memory_free(batch->messages);
+	ecds_memory_free(batch->routes);
+	ecds_memory_free(batch->deliveries);
+	ecds_memory_free(batch->delivery_entries);
+	ecds_memory_free(batch->groups);
+	memset(batch, 0, sizeof(ecds_dispatcher_batch_t));
+}
+
+static bool _batch_reserve(ecds_dispatcher_batch_t * batch, uint32_t deliveries, uint32_t groups)
+{
+	if (deliveries > batch->delivery_capacity)
+	{
+		uint32_t capacity = batch->delivery_capacity ? batch->delivery_capacity : 64;
+
+		while (capacity < deliveries)
+			capacity <<= 1;
+
+		ecds_memory_free(batch->deliveries);
+		ecds_memory_free(batch->delivery_entries);
+		batch->deliveries = (ecds_message_t **)ecds_memory_alloc(capacity * sizeof(ecds_message_t *));
+		batch->delivery_entries = (ecds_dispatcher_route_entry_t **)ecds_memory_alloc(capacity * sizeof(ecds_dispatcher_route_entry_t *));
+		batch->delivery_capacity = (batch->deliveries && batch->delivery_entries) ? capacity : 0;
+	}
+
+	if (groups > batch->group_capacity)
+	{
+		uint32_t capacity = batch->group_capacity ? batch->group_capacity : 16;
+
+		while (capacity < groups)
+			capacity <<= 1;
+
+		ecds_memory_free(batch->groups);
+		batch->groups = (ecds_dispatcher_batch_group_t *)ecds_memory_alloc(capacity * sizeof(ecds_dispatcher_batch_group_t));
+		batch->group_capacity = batch->groups ? capacity : 0;
+	}
+
+	return deliveries <= batch->delivery_capacity && groups <= batch->group_capacity;
+}
+
+static void _dispatcher_deliver_batch(ecds_dispatcher_t * disp, ecds_dispatcher_route_table_t * routes, uint32_t count)
+{
+	ecds_dispatcher_batch_t * batch = &disp->batch;
+	uint32_t delivery_count = 0;
+	uint32_t group_count = 0;
+	uint32_t offset = 0;
+
+	/* First pass: look up routes and size the groups */
+	for (uint32_t m = 0; m < count; m++)
+	{
+		ecds_dispatcher_route_t * route = _route_lookup(routes, batch->messages[m]->event_id);
+
+		batch->routes[m] = route;
+		if (route)
+			delivery_count += route->entry_count;
+	}
+
+	/* A batch can never reach more groups than there are deliveries */
+	if (!_batch_reserve(batch, delivery_count, delivery_count))
+	{
+		ecds_log_error("Out of memory when grouping %u deliveries for %s", delivery_count, disp->proc.obj.name);
+		return;
+	}
+
+	for (uint32_t m = 0; m < count; m++)
+	{
+		ecds_dispatcher_route_t * route = batch->routes[m];
+
+		for (uint32_t e = 0; route && e < route->entry_count; e++)
+		{
+			ecds_dispatcher_subscriber_t * sub = route->entries[e].subscriber;
+
+			if (sub->batch_group < 0)
+			{
+				sub->batch_group = group_count++;
+				batch->groups[sub->batch_group].subscriber = sub;
+				batch->groups[sub->batch_group].count = 0;
+			}
+			batch->groups[sub->batch_group].count++;
+		}
+	}
+
+	for (uint32_t g = 0; g < group_count; g++)
+	{
+		batch->groups[g].offset = offset;
+		offset += batch->groups[g].count;
+		batch->groups[g].count = 0;
+	}
+
+	/* Second pass: place every delivery in its group */
+	for (uint32_t m = 0; m < count; m++)
+	{
+		ecds_dispatcher_route_t * route = batch->routes[m];
+
+		for (uint32_t e = 0; route && e < route->entry_count; e++)
+		{
+			ecds_dispatcher_batch_group_t * group = &batch->groups[route->entries[e].subscriber->batch_group];
+			uint32_t d = group->offset + group->count++;
+
+			batch->deliveries[d] = batch->messages[m];
+			batch->delivery_entries[d] = &route->entries[e];
+		}
+	}
+
+	for (uint32_t g = 0; g < group_count; g++)
+	{
+		ecds_dispatcher_batch_group_t * group = &batch->groups[g];
+
+		group->subscriber->batch_group = -1;
+		_dispatcher_deliver(disp, group->subscriber->service, &batch->deliveries[group->offset],
+							&batch->delivery_entries[group->offset], group->count);
+	}
+}
+
+//=================================== 8< ====================================//
+//								 WORKER POOL								 //
+//===========================================================================//
+/*	With a worker pool the dispatcher thread only routes: it appends each	 */
+/*	message to the mailbox of every subscribed service and schedules the	 */
+/*	services that were idle on the ready queue. Workers take batches of		 */
+/*	scheduled services from the ready queue into their own deque, and idle	 */
+/*	workers steal from the other deques. A service stays scheduled while a	 */
+/*	worker drains its mailbox, so it never runs on two workers at once.		 */
+/*===========================================================================*/
+static bool _pool_has_work(ecds_dispatcher_t * disp)
+{
+	if (ecds_ring_queue_depth(disp->ready_queue) > 0)
+		return true;
+
+	for (uint32_t i = 0; i < disp->worker_count; i++)
+	{
+		ecds_work_deque_t * deque = &disp->workers[i].deque;
+		if (ecds_atomic_load(&deque->bottom) > ecds_atomic_load(&deque->top))
+			return true;
+	}
+
+	return false;
+}
+
+static void _pool_wake(ecds_dispatcher_t * disp)
+{
+	if (ecds_atomic_load(&disp->idle_workers) == 0)
+		return;
+
+	pthread_mutex_lock(disp->pool_mutex);
+	pthread_cond_signal(disp->pool_cond);
+	pthread_mutex_unlock(disp->pool_mutex);
+}
+
+static void _pool_schedule(ecds_dispatcher_t * disp, ecds_dispatcher_subscriber_t * sub, ecds_message_t * msg)
+{
+	int expected = 0;
+
+	ecds_ring_queue_enqueue(sub->mailbox, ECDS_OBJECT(msg));
+
+	if (ecds_atomic_compare_exchange(&sub->scheduled, &expected, 1))
+	{
+		/* Service was idle, hand it to the workers */
+		ecds_ring_queue_enqueue(disp->ready_queue, ECDS_OBJECT(sub));
+		_pool_wake(disp);
+	}
+}
+
+static ecds_dispatcher_subscriber_t * _worker_find_work(ecds_dispatcher_worker_t * worker)
+{
+	ecds_dispatcher_t * disp = worker->disp;
+	ecds_dispatcher_subscriber_t * sub = NULL;
+
+	/* Own work first */
+	if ((sub = (ecds_dispatcher_subscriber_t *)ecds_work_deque_pop(&worker->deque)))
+		return sub;
+
+	/* Take a batch of newly scheduled services, keep one and expose the others to thieves.
+	   Our deque is empty here, so the batch always fits. */
+	if ((sub = (ecds_dispatcher_subscriber_t *)ecds_ring_queue_dequeue(disp->ready_queue)))
+	{
+		ecds_object_t * next = NULL;
+		bool pushed = false;
+
+		for (int i = 1; i < ECDS_DISPATCHER_WORKER_BATCH && (next = ecds_ring_queue_dequeue(disp->ready_queue)); i++)
+			pushed = ecds_work_deque_push(&worker->deque, next);
+
+		if (pushed)
+			_pool_wake(disp);
+
+		return sub;
+	}
+
+	/* Steal from the other workers, starting with the next one */
+	for (uint32_t i = 1; i < disp->worker_count; i++)
+	{
+		ecds_dispatcher_worker_t * victim = &disp->workers[(worker->index + i) % disp->worker_count];
+
+		if ((sub = (ecds_dispatcher_subscriber_t *)ecds_work_deque_steal(&victim->deque)))
+			return sub;
+	}
+
+	return NULL;
+}
+
+static void _worker_run_subscriber(ecds_dispatcher_worker_t * worker, ecds_dispatcher_subscriber_t * sub)
+{
+	ecds_dispatcher_t * disp = worker->disp;
+	ecds_message_t * msgs[ECDS_DISPATCHER_SERVICE_BUDGET];
+	ecds_message_t * deliveries[ECDS_DISPATCHER_SERVICE_BUDGET];
+	ecds_dispatcher_route_entry_t * entries[ECDS_DISPATCHER_SERVICE_BUDGET];
+	ecds_dispatcher_route_table_t * routes;
+	uint32_t count = 0;
+	uint32_t delivery_count = 0;
+	int expected = 0;
+
+	/* Everything in the mailbox is for this service, so it is delivered as a single batch */
+	while (count < ECDS_DISPATCHER_SERVICE_BUDGET && (msgs[count] = (ecds_message_t *)ecds_ring_queue_dequeue(sub->mailbox)))
+		count++;
+
+	/* Look up the handlers in the current table, the service may have added some since routing */
+	routes = _route_table_acquire(disp, worker->reader_epoch);
+	for (uint32_t m = 0; m < count; m++)
+	{
+		ecds_dispatcher_route_t * route = _route_lookup(routes, msgs[m]->event_id);
+
+		for (uint32_t i = 0; route && i < route->entry_count; i++)
+		{
+			if (route->entries[i].subscriber == sub)
+			{
+				deliveries[delivery_count] = msgs[m];
+				entries[delivery_count++] = &route->entries[i];
+				break;
+			}
+		}
+	}
+
+	if (delivery_count)
+		_dispatcher_deliver(disp, sub->service, deliveries, entries, delivery_count);
+	_route_table_release(worker->reader_epoch);
+
+	for (uint32_t m = 0; m < count; m++)
+		ecds_object_unref(ECDS_OBJECT(msgs[m]));
+
+	if (ecds_ring_queue_depth(sub->mailbox) == 0)
+	{
+		/* Mailbox is empty, let the dispatcher thread schedule the service again. Check once
+		   more afterwards, a message may have arrived before the flag was cleared. */
+		ecds_atomic_store(&sub->scheduled, 0);
+		if (ecds_ring_queue_depth(sub->mailbox) == 0 || !ecds_atomic_compare_exchange(&sub->scheduled, &expected, 1))
+			return;
+	}
+
+	/* More messages are waiting, keep the service on this worker and let others steal it */
+	ecds_work_deque_push(&worker->deque, sub);
+	_pool_wake(disp);
+}
+
+static void * _worker_thread(void * arg)
+{
+	ecds_dispatcher_worker_t * worker = (ecds_dispatcher_worker_t *)arg;
+	ecds_dispatcher_t * disp = worker->disp;
+	ecds_dispatcher_subscriber_t * sub = NULL;
+	bool done = false;
+
+	while (!done)
+	{
+		if ((sub = _worker_find_work(worker)))
+		{
+			_worker_run_subscriber(worker, sub);
+			continue;
+		}
+
+		/* Nothing to do, sleep until work is published or the pool is closed */
+		pthread_mutex_lock(disp->pool_mutex);
+		ecds_atomic_increment(&disp->idle_workers);
+		while (!_pool_has_work(disp) && !ecds_atomic_load(&disp->closing))
+			pthread_cond_wait(disp->pool_cond, disp->pool_mutex);
+		ecds_atomic_decrement(&disp->idle_workers);
+		done = ecds_atomic_load(&disp->closing) && !_pool_has_work(disp);
+		pthread_mutex_unlock(disp->pool_mutex);
+	}
+
+	return NULL;
+}
+
+static void * _dispatcher_thread(void * arg)
+{
+	ecds_dispatcher_t * disp = (ecds_dispatcher_t *)arg;
+	ecds_dispatcher_batch_t * batch = &disp->batch;
+	ecds_dispatcher_route_table_t * routes = NULL;
+	uint32_t count;
+
+	/* Wait for messages to become available, until the queue is closed and drained */
+	while (ecds_ring_queue_wait(disp->message_queue))
+	{
+		for (;;)
+		{
+			count = 0;
+			while (count < batch->size && (batch->messages[count] = (ecds_message_t *)ecds_ring_queue_dequeue(disp->message_queue)))
+				count++;
+
+			if (count == 0)
+				break;
+
+			routes = _route_table_acquire(disp, &disp->reader_epochs[0]);
+
+			if (disp->worker_count)
+			{
+				/* Messages nobody is subscribed to are dropped */
+				for (uint32_t m = 0; m < count; m++)
+				{
+					ecds_dispatcher_route_t * route = _route_lookup(routes, batch->messages[m]->event_id);
+
+					for (uint32_t i = 0; route && i < route->entry_count; i++)
+						_pool_schedule(disp, route->entries[i].subscriber, batch->messages[m]);
+				}
+			}
+			else
+				_dispatcher_deliver_batch(disp, routes, count);
+
+			_route_table_release(&disp->reader_epochs[0]);
+
+			/* Release the references taken when the messages were queued */
+			for (uint32_t m = 0; m < count; m++)
+				ecds_object_unref(ECDS_OBJECT(batch->messages[m]));
+		}
 	}
 
 	return NULL;
 }
 
-static void _dispatcher_init(ecds_dispatcher_t * disp)
+/* Let the first count workers finish what was routed to them and join them */
+static void _pool_close(ecds_dispatcher_t * disp, uint32_t count)
+{
+	pthread_mutex_lock(disp->pool_mutex);
+	ecds_atomic_store(&disp->closing, true);
+	pthread_cond_broadcast(disp->pool_cond);
+	pthread_mutex_unlock(disp->pool_mutex);
+
+	for (uint32_t i = 0; i < count; i++)
+		pthread_join(disp->workers[i].worker_thread[0], NULL);
+}
+
+/* Start the workers and the dispatcher thread, stops the threads already started if one cannot be created */
+static bool _dispatcher_init(ecds_dispatcher_t * disp)
 {
+	uint32_t started;
+
+	disp->route_epoch = 1;
+	disp->running = true;
+
 	pthread_mutex_init(disp->dispatcher_mutex, 0);
-	pthread_create(disp->dispatcher_thread, 0, 
-				   _dispatcher_thread, disp);
+	pthread_mutex_init(disp->pool_mutex, 0);
+	pthread_cond_init(disp->pool_cond, 0);
+
+	/* Every deque is ready before the first worker can steal from it */
+	for (uint32_t i = 0; i < disp->worker_count; i++)
+	{
+		ecds_dispatcher_worker_t * worker = &disp->workers[i];
+
+		worker->disp = disp;
+		worker->index = i;
+		worker->reader_epoch = &disp->reader_epochs[i + 1];
+		ecds_work_deque_initialize(&worker->deque);
+	}
+
+	for (started = 0; started < disp->worker_count; started++)
+	{
+		if (pthread_create(disp->workers[started].worker_thread, 0, _worker_thread, &disp->workers[started]) != 0)
+			break;
+	}
+
+	if (started == disp->worker_count &&
+		pthread_create(disp->dispatcher_thread, 0, _dispatcher_thread, disp) == 0)
+		return true;
+
+	if (started < disp->worker_count)
+		ecds_log_error("Could only start %u of %u workers of dispatcher %s", started, disp->worker_count, ecds_object_get_name(ECDS_OBJECT(disp)));
+	else
+		ecds_log_error("Cannot start the thread of dispatcher %s", ecds_object_get_name(ECDS_OBJECT(disp)));
+
+	/* Nothing was queued yet, so the workers exit right away */
+	_pool_close(disp, started);
+	disp->running = false;
+
+	pthread_cond_destroy(disp->pool_cond);
+	pthread_mutex_destroy(disp->pool_mutex);
+	pthread_mutex_destroy(disp->dispatcher_mutex);
+
+	return false;
+}
+
+static void _dispatcher_stop(ecds_dispatcher_t * disp)
+{
+	if (!disp->running)
+		return;
+	disp->running = false;
+
+	/* Closing the queue lets the dispatcher thread drain it and exit */
+	ecds_ring_queue_close(disp->message_queue);
+	pthread_join(disp->dispatcher_thread[0], NULL);
+
+	/* Workers exit once everything routed to them has been delivered */
+	_pool_close(disp, disp->worker_count);
+
+	pthread_cond_destroy(disp->pool_cond);
+	pthread_mutex_destroy(disp->pool_mutex);
+	pthread_mutex_destroy(disp->dispatcher_mutex);
+
+	/* All readers are gone, so no table is in use anymore */
+	ecds_memory_free(disp->routes);
+	disp->routes = NULL;
+	_route_table_reclaim(disp);
+
+	for (uint32_t i = 0; i < ecds_array_count(disp->subscriber_list); i++)
+	{
+		ecds_dispatcher_subscriber_t * sub = (ecds_dispatcher_subscriber_t *)ecds_array_get(disp->subscriber_list, i);
+
+		ecds_ring_queue_dispose(sub->mailbox);
+		sub->mailbox = NULL;
+	}
+
+	ecds_ring_queue_dispose(disp->ready_queue);
+	disp->ready_queue = NULL;
+	ecds_ring_queue_dispose(disp->message_queue);
+	disp->message_queue = NULL;
+
+	ecds_memory_free(disp->workers);
+	disp->workers = NULL;
+	ecds_memory_free(disp->reader_epochs);
+	disp->reader_epochs = NULL;
+	_batch_dispose(&disp->batch);
+}
+
+/* Events, subscribers and the dispatcher itself are unmanaged, so nobody else frees them */
+static void _dispatcher_free_object(ecds_object_t * obj)
+{
+	ecds_atom_release(obj->name);
+	ecds_memory_free(obj);
 }
 
-static void _dispatcher_dispose(ecds_dispatcher_t * disp)
+static void _dispatcher_release_array(ecds_array_t * array)
 {
-	int retval;
+	ecds_array_dispose(array);
+	ecds_object_unref(ECDS_OBJECT(array));
+}
 
+void ecds_dispatcher_destroy(ecds_dispatcher_t * disp)
+{
+	if (!disp)
+		return;
+
+	/* Services must not rebuild our routes anymore, detach them while the mutex still exists */
 	pthread_mutex_lock(disp->dispatcher_mutex);
-	disp->running = false;
+	for (uint32_t i = 0; i < ecds_array_count(disp->subscriber_list); i++)
+	{
+		ecds_dispatcher_subscriber_t * sub = (ecds_dispatcher_subscriber_t *)ecds_array_get(disp->subscriber_list, i);
+
+		ecds_service_detach_dispatcher(sub->service, disp);
+	}
 	pthread_mutex_unlock(disp->dispatcher_mutex);
 
-	pthread_join(disp->dispatcher_thread[0], (void **)&retval);
-	pthread_mutex_destroy(disp->dispatcher_mutex);
+	_dispatcher_stop(disp);
+
+	for (uint32_t i = 0; i < ecds_array_count(disp->event_list); i++)
+	{
+		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_array_get(disp->event_list, i);
+
+		_dispatcher_release_array(evt->service_list);
+		_dispatcher_free_object(ECDS_OBJECT(evt));
+	}
+
+	for (uint32_t i = 0; i < ecds_array_count(disp->subscriber_list); i++)
+	{
+		ecds_dispatcher_subscriber_t * sub = (ecds_dispatcher_subscriber_t *)ecds_array_get(disp->subscriber_list, i);
+
+		ecds_object_unref(ECDS_OBJECT(sub->service));
+		_dispatcher_free_object(ECDS_OBJECT(sub));
+	}
 
+	_dispatcher_release_array(disp->event_list);
+	_dispatcher_release_array(disp->subscriber_list);
+
+	if (default_dispatcher == disp)
+		default_dispatcher = NULL;
+
+	ecds_log_info("Destroyed dispatcher: %s", ecds_object_get_name(ECDS_OBJECT(disp)));
+	_dispatcher_free_object(ECDS_OBJECT(disp));
+}
+
+/* Undo a partial construction, no thread is running */
+static ecds_object_t * _dispatcher_construct_failed(ecds_dispatcher_t * disp)
+{
+	ecds_log_error("Cannot construct dispatcher %s", ecds_object_get_name(ECDS_OBJECT(disp)));
+
+	ecds_ring_queue_dispose(disp->ready_queue);
+	ecds_ring_queue_dispose(disp->message_queue);
+	ecds_memory_free(disp->workers);
+	ecds_memory_free(disp->reader_epochs);
+	_batch_dispose(&disp->batch);
+	_dispatcher_release_array(disp->event_list);
+	_dispatcher_release_array(disp->subscriber_list);
+	_dispatcher_free_object(ECDS_OBJECT(disp));
+
+	return NULL;
 }
 
 ecds_object_t * ecds_dispatcher_construct(const char * name) 
+{
+	return ecds_dispatcher_construct_with_config(name, NULL);
+}
+
+ecds_object_t * ecds_dispatcher_construct_with_config(const char * name, const ecds_dispatcher_config_t * config)
 {
 	char queue_name[80];
-	ecds_dispatcher_t * ret = (ecds_dispatcher_t *)ecds_object_new(name, sizeof(ecds_dispatcher_t), ECDS_DISPATCHER);
+	ecds_dispatcher_config_t default_config = { ECDS_DISPATCHER_DEFAULT_QUEUE_CAPACITY, ECDS_RING_QUEUE_BLOCK, 0, ECDS_DISPATCHER_DEFAULT_MAILBOX_CAPACITY, ECDS_DISPATCHER_DEFAULT_BATCH_SIZE };
+	ecds_dispatcher_t * ret = NULL;
 
-	sprintf(queue_name, "%s-queue", name);
-	ret->message_queue = ecds_queue_new();
+	if (!config)
+		config = &default_config;
+
+	ret = (ecds_dispatcher_t *)ecds_object_new(name, sizeof(ecds_dispatcher_t), ECDS_DISPATCHER);
+	if (!ret)
+		return NULL;
+
+	ret->message_queue = ecds_ring_queue_new(config->queue_capacity, config->queue_policy);
+	if (!ret->message_queue)
+		return _dispatcher_construct_failed(ret);
+
+	snprintf(queue_name, sizeof(queue_name), "%s-queue", ecds_object_get_name(ECDS_OBJECT(ret)));
 	ecds_object_rename(ECDS_OBJECT(ret->message_queue), queue_name);
 
-	ecds_log_info("Constructing new dispatcher: %s", ecds_object_get_name(ECDS_OBJECT(ret)));
+	ret->event_list = ecds_array_new();
+	ret->subscriber_list = ecds_array_new();
+	if (!ret->event_list || !ret->subscriber_list)
+		return _dispatcher_construct_failed(ret);
+
+	ret->worker_count = config->worker_count;
+	ret->mailbox_capacity = config->mailbox_capacity ? config->mailbox_capacity : ECDS_DISPATCHER_DEFAULT_MAILBOX_CAPACITY;
+	ret->reader_epochs = (uint64_t *)ecds_memory_alloc((ret->worker_count + 1) * sizeof(uint64_t));
+	if (!ret->reader_epochs)
+		return _dispatcher_construct_failed(ret);
+
+	if (!_batch_initialize(&ret->batch, config->batch_size ? config->batch_size : ECDS_DISPATCHER_DEFAULT_BATCH_SIZE))
+		return _dispatcher_construct_failed(ret);
+
+	if (ret->worker_count)
+	{
+		ret->workers = (ecds_dispatcher_worker_t *)ecds_memory_alloc(ret->worker_count * sizeof(ecds_dispatcher_worker_t));
+		ret->ready_queue = ecds_ring_queue_new(ECDS_DISPATCHER_DEFAULT_QUEUE_CAPACITY, ECDS_RING_QUEUE_BLOCK);
+		if (!ret->workers || !ret->ready_queue)
+			return _dispatcher_construct_failed(ret);
+	}
+
+	if (!_dispatcher_init(ret))
+		return _dispatcher_construct_failed(ret);
+
+	ecds_log_info("Constructing new dispatcher: %s (%u workers)", ecds_object_get_name(ECDS_OBJECT(ret)), ret->worker_count);
 
 	return (ecds_object_t *)ret;
 }
 
-void ecds_dispatcher_queue_message(ecds_dispatcher_t * disp, ecds_message_t * msg) 
+bool ecds_dispatcher_queue_message(ecds_dispatcher_t * disp, ecds_message_t * msg) 
 {
-	pthread_mutex_lock(disp->dispatcher_mutex);
-	ecds_queue_enqueue(disp->message_queue, ECDS_OBJECT(msg));
-	pthread_mutex_unlock(disp->dispatcher_mutex);
+	if (!disp || !msg)
+		return false;
+
+	return ecds_ring_queue_enqueue(disp->message_queue, ECDS_OBJECT(msg));
 }
 
-void ecds_dispatcher_subscribe(ecds_dispatcher_t * disp,
-							   unsigned int event_id, 
-							   ecds_service_t * service)
+void ecds_dispatcher_get_queue_stats(ecds_dispatcher_t * disp, ecds_ring_queue_stats_t * stats)
+{
+	if (!disp)
+		return;
+
+	ecds_ring_queue_get_stats(disp->message_queue, stats);
+}
+
+static ecds_dispatcher_subscriber_t * _dispatcher_get_subscriber(ecds_dispatcher_t * disp, ecds_service_t * service)
 {
-	for (ecds_list_item_t * iter = ecds_list_first_item(disp->event_list); iter; iter = ecds_list_next_item(iter))
+	ecds_dispatcher_subscriber_t * sub = NULL;
+
+	for (uint32_t i = 0; i < ecds_array_count(disp->subscriber_list); i++)
 	{
-		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_list_get_item(disp->event_list, iter);
-		if (evt->event_id == event_id)
-		{
-			/* Existing event found, subscribe */
-			ecds_list_add_item(evt->service_list, ECDS_OBJECT(service));
-			ecds_log_info("Adding service %s for event ID %08X", ecds_object_get_name(ECDS_OBJECT(service)), event_id);
-		}
+		sub = (ecds_dispatcher_subscriber_t *)ecds_array_get(disp->subscriber_list, i);
+		if (sub->service == service)
+			return sub;
 	}
 
-	/* Event type was not found, add new */
-	char event_name[128];
-	sprintf(event_name, "%s-event-%8X", ecds_object_get_name(ECDS_OBJECT(disp)), event_id);
+	sub = (ecds_dispatcher_subscriber_t *)ecds_object_new(NULL, sizeof(ecds_dispatcher_subscriber_t), ECDS_DISPATCHER_SUBSCRIBER);
+	if (!sub)
+		return NULL;
+
+	ecds_object_ref(ECDS_OBJECT(service));
+	sub->service = service;
+	sub->batch_group = -1;
+
+	if (disp->worker_count)
+		sub->mailbox = ecds_ring_queue_new(disp->mailbox_capacity, ECDS_RING_QUEUE_BLOCK);
 
-	ecds_log_info("Adding new event ID %08X", event_id);
-	ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_object_new(event_name, sizeof(ecds_dispatcher_event_t), ECDS_DISPATCHER_EVENT);
-	evt->service_list = ecds_list_new();
-	ecds_list_add_item(evt->service_list, ECDS_OBJECT(service));
-	ecds_log_info("Adding service %s for event ID %08X", ecds_object_get_name(ECDS_OBJECT(service)), event_id);
+	ecds_array_append(disp->subscriber_list, ECDS_OBJECT(sub));
+
+	/* Let the service tell us when its handlers change */
+	ecds_service_attach_dispatcher(service, disp);
+
+	return sub;
 }
 
-void ecds_dispatcher_dispatch_message(ecds_dispatcher_t * disp, ecds_message_t * msg)
+void ecds_dispatcher_subscribe(ecds_dispatcher_t * disp,
+							   unsigned int event_id, 
+							   ecds_service_t * service)
 {
 	ecds_dispatcher_event_t * event = NULL;
+	ecds_dispatcher_subscriber_t * sub = NULL;
+	if (!disp)
+		disp = default_dispatcher;
+	if (!disp || !service)
+		return;
+
+	pthread_mutex_lock(disp->dispatcher_mutex);
 
-	for (ecds_list_item_t * iter = ecds_list_first_item(disp->event_list); iter; iter = ecds_list_next_item(iter))
+	for (uint32_t i = 0; i < ecds_array_count(disp->event_list); i++)
 	{
-		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_list_get_item(disp->event_list, iter);
-		if (evt->event_id == msg->event_id)
+		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_array_get(disp->event_list, i);
+		if (evt->event_id == event_id)
 		{
 			event = evt;
 			break;
@@ -151,19 +987,51 @@ void ecds_dispatcher_dispatch_message(ecds_dispatcher_t * disp, ecds_message_t *
 
 	if (event == NULL)
 	{
-		/* No handlers found, register new event type only */
+		/* Event type was not found, add new */
 		char event_name[128];
-		sprintf(event_name, "%s-event-%8X", ecds_object_get_name(ECDS_OBJECT(disp)), msg->event_id);
+		snprintf(event_name, sizeof(event_name), "%s-event-%08X", disp->proc.obj.name, event_id);
 
-		ecds_log_info("Received message with unknown event ID %08X, registering for future dispatch", msg->event_id);
-		ecds_dispatcher_event_t * evt = (ecds_dispatcher_event_t *)ecds_object_new(event_name, sizeof(ecds_dispatcher_event_t), ECDS_DISPATCHER_EVENT);
-		evt->service_list = ecds_list_new();
-		return;
+		ecds_log_info("Adding new event ID %08X", event_id);
+		event = (ecds_dispatcher_event_t *)ecds_object_new(event_name, sizeof(ecds_dispatcher_event_t), ECDS_DISPATCHER_EVENT);
+		if (!event)
+		{
+			ecds_log_error("Out of memory when adding event ID %08X", event_id);
+			pthread_mutex_unlock(disp->dispatcher_mutex);
+			return;
+		}
+
+		event->event_id = event_id;
+		if (!(event->service_list = ecds_array_new()) || ecds_array_append(disp->event_list, ECDS_OBJECT(event)) < 0)
+		{
+			ecds_log_error("Out of memory when adding event ID %08X", event_id);
+			if (event->service_list)
+				_dispatcher_release_array(event->service_list);
+			_dispatcher_free_object(ECDS_OBJECT(event));
+			pthread_mutex_unlock(disp->dispatcher_mutex);
+			return;
+		}
 	}
 
-	for (ecds_list_item_t * iter = ecds_list_first_item(event->service_list); iter; iter = ecds_list_next_item(iter))
+	sub = _dispatcher_get_subscriber(disp, service);
+
+	if (sub && ecds_array_find(event->service_list, ECDS_OBJECT(sub)) < 0)
 	{
-		ecds_service_t * svc = (ecds_service_t *)ecds_list_get_item(event->service_list, iter);
-		ecds_service_dispatch_message(svc, disp, msg);
+		/* Service is not subscribed to this event yet */
+		ecds_array_append(event->service_list, ECDS_OBJECT(sub));
+		ecds_log_info("Adding service %s for event ID %08X", ECDS_OBJECT(service)->name, event_id);
+
+		_route_table_publish(disp);
 	}
+
+	pthread_mutex_unlock(disp->dispatcher_mutex);
+}
+
+void ecds_dispatcher_rebuild_routes(ecds_dispatcher_t * disp)
+{
+	if (!disp)
+		return;
+
+	pthread_mutex_lock(disp->dispatcher_mutex);
+	_route_table_publish(disp);
+	pthread_mutex_unlock(disp->dispatcher_mutex);
 }
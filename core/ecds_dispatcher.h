@@ -9,14 +9,68 @@
 
 #include <ecds.h>
 
+#include <common/ecds_payload.h>
+#include <common/ecds_ring_queue.h>
 #include <core/ecds_object.h>
 
 #define ECDS_DISPATCHER 0xFFFFFFFA
 #define ECDS_DISPATCHER_EVENT 0xFFFFFFAA
+
+//!<	Number of messages that can be pending in a dispatcher queue by default.
+#define ECDS_DISPATCHER_DEFAULT_QUEUE_CAPACITY	1024
+
+//!<	Number of messages that can be pending for a single service in worker pool mode by default.
+#define ECDS_DISPATCHER_DEFAULT_MAILBOX_CAPACITY	256
+
+//!<	Number of messages the dispatcher thread drains and groups at once by default.
+#define ECDS_DISPATCHER_DEFAULT_BATCH_SIZE		32
+
 typedef struct _ecds_dispatcher_t ecds_dispatcher_t;
+typedef struct _ecds_dispatcher_config_t ecds_dispatcher_config_t;
+
+/**
+ * Construction parameters for a dispatcher.
+ */
+struct _ecds_dispatcher_config_t {
+	uint32_t queue_capacity;					//!<	Maximum number of pending messages
+	ecds_ring_queue_policy_t queue_policy;		//!<	What ecds_dispatcher_queue_message() does when the queue is full
+
+	/**
+	 * Number of worker threads that run service handlers. With 0 workers all services run on
+	 * the dispatcher thread. With a worker pool, messages for one service are still delivered
+	 * in order and never concurrently, but different services run in parallel.
+	 */
+	uint32_t worker_count;
+	uint32_t mailbox_capacity;					//!<	Messages pending per service before the dispatcher waits, 0 for the default
+
+	/**
+	 * Maximum number of messages the dispatcher thread takes from the queue at once. The messages
+	 * are grouped by service and services with a dispatch_batch entry point receive their share
+	 * as one array. 1 delivers every message on its own, 0 selects the default.
+	 */
+	uint32_t batch_size;
+};
 
+/**
+ * @brief Construct a dispatcher with the default configuration.
+ * @param name The name for the new dispatcher.
+ */
 ecds_object_t * ecds_dispatcher_construct(const char * name);
 
+/**
+ * @brief Construct a dispatcher with a specific configuration.
+ * @param name The name for the new dispatcher.
+ * @param config The configuration to use, or NULL to use the defaults.
+ */
+ecds_object_t * ecds_dispatcher_construct_with_config(const char * name, const ecds_dispatcher_config_t * config);
+
+/**
+ * @brief Stop a dispatcher and free it. Messages already queued are delivered first.
+ *		  Subscribed services are released and no longer refer to the dispatcher.
+ * @param disp The dispatcher to destroy, which must not be used afterwards.
+ */
+void ecds_dispatcher_destroy(ecds_dispatcher_t * disp);
+
 /**
  * @brief Attach a subscription to the dispatcher for a specific event class.
  * @param disp The dispatcher to manipulate. When NULL is passed, the default dispatcher is used.
@@ -26,19 +80,34 @@ ecds_object_t * ecds_dispatcher_construct(const char * name);
 void ecds_dispatcher_subscribe(ecds_dispatcher_t * disp, unsigned int event_id, ecds_service_t * service);
 
 /**
-* @brief Attach a subscription to the dispatcher for a specific event class.
-* @param disp The dispatcher to manipulate.
-* @param event_id The event type ID (virtual bus number) of the event to subscribe to.
-* @param service The service to attach to the dispatcher.
+ * @brief Rebuild the routing table of a dispatcher from its subscriptions.
+ *		  This is done automatically on subscription and when a subscribed service registers a handler.
+ * @param disp The dispatcher to act on.
+ */
+void ecds_dispatcher_rebuild_routes(ecds_dispatcher_t * disp);
+
+/**
+* @brief Post a message to the dispatcher, to be dispatched on the dispatcher thread.
+*		 The dispatcher takes a reference on the message. Posting never waits for handlers
+*		 to run, only for room in the queue if the queue policy is ECDS_RING_QUEUE_BLOCK.
+* @param disp The dispatcher to post to.
+* @param msg The message to post.
+* @return true if the message was queued, false if it was rejected by the queue policy.
+*/
+bool ecds_dispatcher_queue_message(ecds_dispatcher_t * disp, ecds_message_t * msg);
+
+/**
+* @brief Get the depth and throughput counters of the dispatcher's message queue.
 */
-void ecds_dispatcher_queue_message(ecds_dispatcher_t * disp, ecds_message_t * msg);
+void ecds_dispatcher_get_queue_stats(ecds_dispatcher_t * disp, ecds_ring_queue_stats_t * stats);
 
 struct _ecds_message_t {
 	ecds_object_t obj;
 
 	uint32_t event_id;
-	uint16_t user_data_length;
-	void * user_data;
+	uint32_t user_data_length;
+	void * user_data;				//!<	Points into the payload if there is one, which must not be modified
+	ecds_payload_t * payload;		//!<	Shared data of the message, NULL if user_data is a plain pointer
 };
 
 #endif
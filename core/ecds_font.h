@@ -0,0 +1,49 @@
+/*****************************************************************************/
+/*	@file ecds_font.h													 	 */
+/*	@brief Built-in bitmap font for renderer implementations.				 */
+/*																			 */
+/*	A fixed 5x7 pixel font covering printable ASCII, so that text can be	 */
+/*	drawn without any font files. Every glyph is stored as one byte per		 */
+/*	row, top row first, with bit 4 being the leftmost column.				 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_FONT_H
+#define _ECDS_FONT_H
+
+#include <ecds.h>
+
+#define ECDS_FONT_GLYPH_WIDTH		5		//!< Width of a glyph bitmap in pixels
+#define ECDS_FONT_GLYPH_HEIGHT		7		//!< Height of a glyph bitmap in pixels
+#define ECDS_FONT_ADVANCE			6		//!< Horizontal distance between the origins of two glyphs
+#define ECDS_FONT_LINE_HEIGHT		9		//!< Vertical distance between two lines of text
+
+#define ECDS_FONT_BUILTIN			0		//!< ID of the built-in font
+
+typedef struct _ecds_font_t ecds_font_t;
+
+/**
+ * Description of a bitmap font, for code that works with any font such as layout and glyph caches.
+ */
+struct _ecds_font_t {
+	uint32_t id;						//!< Identifies the font in caches
+	const char * name;
+	uint32_t glyph_width;				//!< Width of a glyph bitmap in pixels, at most 8
+	uint32_t glyph_height;				//!< Height of a glyph bitmap in pixels
+	uint32_t advance;					//!< Horizontal distance between the origins of two glyphs
+	uint32_t line_height;				//!< Vertical distance between two lines of text
+
+	//!< Get glyph_height rows of a glyph, bit glyph_width - 1 being the leftmost column.
+	const uint8_t * (*get_glyph)(uint32_t character);
+};
+
+/**
+ * @brief Get the bitmap of a character.
+ * @param character The character to look up.
+ * @return ECDS_FONT_GLYPH_HEIGHT rows of the glyph. Characters outside printable ASCII map to '?'.
+ */
+const uint8_t * ecds_font_get_glyph(uint32_t character);
+
+//!< @brief Get the description of the built-in font.
+const ecds_font_t * ecds_font_get_builtin(void);
+
+#endif /* _ECDS_FONT_H */
@@ -24,6 +24,7 @@ int main(int argc, char** argv)
 	ecds_dispatcher_t * disp = NULL;
 
 	ecds_log_set_level(ECDS_DEBUG);
+	ecds_log_start(0);
 	ecds_log_info("ECDS version %d.%d.%d starting up", ECDS_VERSION_MAJOR, ECDS_VERSION_MINOR, ECDS_VERSION_BUILD);
 
 	ecds_register_class("ecds-dispatcher-class", ECDS_DISPATCHER, ecds_dispatcher_construct);
@@ -5,6 +5,8 @@
 
 #define ECDS_TYPE_LIST				0x0F000000
 #define ECDS_TYPE_QUEUE				0x0E000000
+#define ECDS_TYPE_RING_QUEUE		0x0D000000
+#define ECDS_TYPE_ARRAY				0x0C000000
 
 struct _ecds_list_item_t
 {
@@ -26,7 +28,20 @@ struct _ecds_list_t
 	ecds_list_item_t * first;
 	ecds_list_item_t * last;
 
-	ecds_object_t ** list_array;
+	ecds_object_t ** list_array;		//!<	Objects of the indexed items, followed by NULL
+	ecds_list_item_t ** item_array;		//!<	The indexed items by index
+	uint32_t indexed_count;				//!<	Number of leading items whose index and array entries are current
+	uint32_t array_capacity;			//!<	Entries allocated in both arrays, NULL if no indexed access happened yet
+};
+
+struct _ecds_array_t
+{
+	ecds_object_t obj;
+
+	uint32_t count;
+	uint32_t capacity;				//!<	Number of objects the storage can hold
+
+	ecds_object_t ** items;			//!<	Storage, allocated from the memory manager
 };
 
 #endif
\ No newline at end of file
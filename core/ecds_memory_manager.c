@@ -16,10 +16,14 @@
 #include <stdio.h>
 
 #include <ecds.h>
-#include <common/ecds_list.h>
+#include <common/ecds_array.h>
 
+#include <common/ecds_atomic.h>
+
+#include <core/ecds_atom.h>
 #include <core/ecds_memory_manager.h>
 #include <core/ecds_object.h>
+#include <core/ecds_list_internal.h>
 
 #define ECDS_LOG_DOMAIN "ecds-memory-manager"
 
@@ -36,36 +40,51 @@ void _dispose_object(ecds_object_t * obj)
 	if(obj->dispose)
 		(* obj->dispose)(obj);
 	
-	free(obj->name);
-	free(obj);
+	ecds_atom_release(obj->name);
+	ecds_memory_free(obj);
 }
 
 void _memory_manager_init(ecds_object_t * obj)
 {
 	ecds_memory_manager_t * mmgr = (ecds_memory_manager_t *)obj;
 	
-	mmgr->memory_entry_list = ecds_list_new();
-	ecds_list_initialize(mmgr->memory_entry_list);
+	pthread_mutex_init(mmgr->memory_mutex, 0);
+	ecds_memory_pool_initialize(mmgr->pools);
+	ecds_hash_table_initialize(&mmgr->name_index, ecds_hash_string, ecds_hash_string_equal);
+
+	/* The entry list is owned by the manager and must not register in itself */
+	mmgr->memory_entry_list = (ecds_array_t *)ecds_object_new("memory-entry-list", sizeof(ecds_array_t), ECDS_TYPE_MEMORY_MANAGER_LIST);
 }
 
 void _memory_manager_dispose(ecds_object_t * obj)
 {
 	ecds_memory_manager_t * mmgr = (ecds_memory_manager_t *)obj;
-	ecds_list_item_t * list_entry = NULL;
+	uint32_t count;
 	
-	/* Dispose every single object in the manager before destroying self */
-	for(list_entry = ecds_list_first_item(mmgr->memory_entry_list); list_entry; list_entry = ecds_list_next_item(list_entry))
+	/* Dispose every single object in the manager before destroying self, newest first */
+	while((count = ecds_array_count(mmgr->memory_entry_list)))
 	{
-		struct _ecds_memory_entry_t * ent = (struct _ecds_memory_entry_t *)ecds_list_get_item(mmgr->memory_entry_list, list_entry);
+		struct _ecds_memory_entry_t * ent = (struct _ecds_memory_entry_t *)ecds_array_remove_fast(mmgr->memory_entry_list, count - 1);
 		
+		/* The entry is out of the array before the destructor can release other objects */
+		ent->entry->memory_entry = NULL;
 		_dispose_object(ent->entry);
-		free(ent);
-		
-		ecds_list_drop_item(list_entry);
-		free(list_entry);
+		ecds_memory_free(ent);
 	}
-	
-	free(obj->name);
+	mmgr->object_count = 0;
+	ecds_hash_table_clear(&mmgr->name_index);
+
+	ecds_atom_release(obj->name);
+	obj->name = NULL;
+	ecds_array_dispose(mmgr->memory_entry_list);
+	ecds_memory_free(mmgr->memory_entry_list);
+
+	if (default_memory_manager == mmgr)
+		default_memory_manager = NULL;
+
+	/* No block handed out by this manager may be used beyond this point */
+	ecds_memory_pool_dispose(mmgr->pools);
+	pthread_mutex_destroy(mmgr->memory_mutex);
 }
 
 ecds_memory_manager_t * _memory_manager_create_default()
@@ -83,19 +102,95 @@ ecds_memory_manager_t * _memory_manager_create_default()
 		ecds_log_fatal("Cannot create default memory manager");
 	}
 	
-	ret->process.obj.name = strdup("memory-manager-default");
 	default_memory_manager = ret;
 
 	_memory_manager_init((ecds_object_t *)ret);
+	ecds_object_rename((ecds_object_t *)ret, "memory-manager-default");
 
 	ecds_log_info("Creating default memory manager");
 	return ret;
 }
 
+/* Both index functions expect memory_mutex to be held */
+static void _memory_manager_index_name(ecds_memory_manager_t * mgr, ecds_memory_entry_t * entry)
+{
+	ecds_memory_entry_t * head;
+
+	if (entry->entry->name == ECDS_ATOM_ANONYMOUS)
+		return;
+
+	head = (ecds_memory_entry_t *)ecds_hash_table_lookup(&mgr->name_index, entry->entry->name);
+
+	entry->previous_named = NULL;
+	entry->next_named = head;
+	if (head)
+		head->previous_named = entry;
+
+	ecds_hash_table_insert(&mgr->name_index, entry->entry->name, entry);
+}
+
+static void _memory_manager_unindex_name(ecds_memory_manager_t * mgr, ecds_memory_entry_t * entry)
+{
+	if (entry->entry->name == ECDS_ATOM_ANONYMOUS)
+		return;
+
+	if (entry->next_named)
+		entry->next_named->previous_named = entry->previous_named;
+
+	if (entry->previous_named)
+		entry->previous_named->next_named = entry->next_named;
+	else if (entry->next_named)
+		ecds_hash_table_insert(&mgr->name_index, entry->next_named->entry->name, entry->next_named);
+	else
+		ecds_hash_table_remove(&mgr->name_index, entry->entry->name);
+
+	entry->next_named = entry->previous_named = NULL;
+}
+
+static void _memory_manager_register(ecds_memory_manager_t * mgr, ecds_object_t * obj)
+{
+	ecds_memory_entry_t * entry = NULL;
+
+	entry = (ecds_memory_entry_t *)ecds_object_new(NULL, sizeof(ecds_memory_entry_t), ECDS_TYPE_MEMORY_MANAGER_ENTRY);
+	entry->entry = obj;
+	entry->uid = (uint32_t)rand();
+
+	obj->uid = entry->uid;
+	obj->refcnt = 1;
+	obj->memory_entry = entry;
+	
+	if(!obj->name)
+		obj->name = ECDS_ATOM_ANONYMOUS;
+	
+	pthread_mutex_lock(mgr->memory_mutex);
+	entry->index = (uint32_t)ecds_array_append(mgr->memory_entry_list, (ecds_object_t *)(entry));
+	_memory_manager_index_name(mgr, entry);
+	mgr->object_count++;
+	pthread_mutex_unlock(mgr->memory_mutex);
+
+	ecds_log_debug("Object %s (%08X) added to memory manager", obj->name, obj->uid);
+}
+
+static void _memory_manager_unregister(ecds_memory_manager_t * mgr, ecds_object_t * obj)
+{
+	ecds_memory_entry_t * entry = obj->memory_entry;
+
+	pthread_mutex_lock(mgr->memory_mutex);
+	_memory_manager_unindex_name(mgr, entry);
+	ecds_array_remove_fast(mgr->memory_entry_list, entry->index);
+	if (entry->index < ecds_array_count(mgr->memory_entry_list))
+		/* The last entry took the place of the removed one */
+		((ecds_memory_entry_t *)ecds_array_get(mgr->memory_entry_list, entry->index))->index = entry->index;
+	mgr->object_count--;
+	pthread_mutex_unlock(mgr->memory_mutex);
+
+	obj->memory_entry = NULL;
+	ecds_memory_free(entry);
+}
+
 void ecds_object_ref(ecds_object_t * obj)
 {
-	ecds_list_item_t * iter = NULL;
-	struct _ecds_memory_entry_t * entry = NULL;
+	int refcnt;
 	
 	if(!obj)
 		/* User is trying to pull our leg. */
@@ -105,6 +200,14 @@ void ecds_object_ref(ecds_object_t * obj)
 		/* Unmanaged object (e.g. memory entry or core object). Ignore. */
 		return;
 	
+	if(obj->memory_entry)
+	{
+		/* Already managed, increase reference count */
+		refcnt = ecds_atomic_increment(&obj->refcnt);
+		ecds_log_debug("Reference count for object %s increased to %d", obj->name, refcnt);
+		return;
+	}
+
 	if(!obj->manager)
 	{
 		/* Object does not have a manager yet, set it to default */
@@ -114,73 +217,34 @@ void ecds_object_ref(ecds_object_t * obj)
 		obj->manager = default_memory_manager;
 	}
 	
-	for(iter = ecds_list_first_item(obj->manager->memory_entry_list); iter; iter=ecds_list_next_item(iter))
-	{
-		struct _ecds_memory_entry_t * entry = (struct _ecds_memory_entry_t *)ecds_list_get_item(obj->manager->memory_entry_list, iter);
-		if(entry->entry == obj)
-		{
-			/* Already managed, increase reference count */
-			entry->refcnt++;
-			ecds_log_debug("Reference count for object %s increased to %d", obj->name, entry->refcnt);
-			return;
-		}
-	}
-	
-	entry = (ecds_memory_entry_t *)ecds_object_new(NULL, sizeof(ecds_memory_entry_t), ECDS_TYPE_MEMORY_MANAGER_ENTRY);
-	entry->entry = obj;
-	entry->uid = (uint32_t)rand();
-	entry->refcnt++;
-	
-	if(!obj->name)
-	{
-		obj->name = malloc(16);
-		sprintf(obj->name, "object-%8X", entry->uid);
-	}
-	
-	ecds_log_debug("Object %s added to memory manager", obj->name, entry->refcnt);
-
-	ecds_list_add_item(obj->manager->memory_entry_list, (ecds_object_t *)(entry) );
+	_memory_manager_register(obj->manager, obj);
 }
 
 void ecds_object_unref(ecds_object_t * obj)
 {
+	int refcnt;
+
 	if(!obj)
 		return;
 	
 	if(obj->type_uid > ECDS_TYPE_UNMANAGED)
 		return;
 	
-	if(!obj->manager)
-	{
-		/* Object does not have a manager yet, set it to default */
-		if(!default_memory_manager)
-			return;
-		obj->manager = default_memory_manager;
-	}
+	if(!obj->memory_entry)
+		/* Object was never referenced, nothing to release */
+		return;
 	
-	for(ecds_list_item_t * iter = ecds_list_first_item(obj->manager->memory_entry_list); iter; iter = ecds_list_next_item(iter))
-	{
-		ecds_memory_entry_t * entry = (ecds_memory_entry_t *)ecds_list_get_item(obj->manager->memory_entry_list, iter);
-		if(entry->entry == obj)
-		{
-			entry->refcnt--;
-			ecds_log_debug("Reference count for object %s decreased to %d", obj->name, entry->refcnt);
-
-			if(entry->refcnt <= 0)
-			{
-				ecds_log_debug("Disposing object %s (reference count: %d)", obj->name, entry->refcnt);
-				/* Refcount exhausted, dispose object */
-				if(obj->dispose)
-					(* obj->dispose)(obj);
-				free(obj->name);
-				free(obj);
-				
-				ecds_list_dispose_item(iter);
-				free(entry);
-				break;
-			}
-		}
-	}
+	/* Log before releasing the reference, another thread may dispose the object right after */
+	ecds_log_debug("Reference count for object %s decreased to %d", obj->name, ecds_atomic_load(&obj->refcnt) - 1);
+	refcnt = ecds_atomic_decrement(&obj->refcnt);
+
+	if(refcnt > 0)
+		return;
+
+	/* Refcount exhausted, dispose object */
+	ecds_log_debug("Disposing object %s (reference count: %d)", obj->name, refcnt);
+	_memory_manager_unregister(obj->manager, obj);
+	_dispose_object(obj);
 }
 
 //!< Construct a new object of a specified size and take a reference on it.
@@ -192,7 +256,7 @@ ecds_object_t * ecds_object_new(const char * name, size_t size, uint32_t type)
 		/* Invalid argument */
 		return NULL;
 
-	ret = (ecds_object_t *)calloc(1, size);
+	ret = (ecds_object_t *)ecds_memory_alloc(size);
 
 	if (ret == NULL)
 	{
@@ -201,8 +265,7 @@ ecds_object_t * ecds_object_new(const char * name, size_t size, uint32_t type)
 		return NULL;
 	}
 
-	if (name != 0)
-		ret->name = strdup(name);
+	ret->name = ecds_atom_intern(name);
 
 	if (type != 0)
 		ret->type_uid = type;
@@ -213,20 +276,145 @@ ecds_object_t * ecds_object_new(const char * name, size_t size, uint32_t type)
 	return ret;
 }
 
-char * ecds_object_get_name(ecds_object_t * obj)
+const char * ecds_object_get_name(ecds_object_t * obj)
 {
 	if (obj == NULL)
 		return NULL;
 
-	return strdup(obj->name);
+	return obj->name;
 }
 
 void ecds_object_rename(ecds_object_t * obj, const char * new_name)
 {
+	const char * old_name;
+
 	if (obj == NULL)
 		return;
 
-	obj->name = strdup(new_name);
+	old_name = obj->name;
+
+	if (obj->memory_entry)
+	{
+		/* Move the object to its new name in the index */
+		pthread_mutex_lock(obj->manager->memory_mutex);
+		_memory_manager_unindex_name(obj->manager, obj->memory_entry);
+		obj->name = ecds_atom_intern(new_name);
+		_memory_manager_index_name(obj->manager, obj->memory_entry);
+		pthread_mutex_unlock(obj->manager->memory_mutex);
+	}
+	else
+		obj->name = ecds_atom_intern(new_name);
+
+	ecds_atom_release(old_name);
+}
+
+ecds_object_t * ecds_object_find(const char * object_name)
+{
+	ecds_memory_manager_t * mgr = default_memory_manager;
+	ecds_object_t * ret = NULL;
+
+	if (mgr == NULL || object_name == NULL)
+		return NULL;
+
+	pthread_mutex_lock(mgr->memory_mutex);
+	for (ecds_memory_entry_t * entry = (ecds_memory_entry_t *)ecds_hash_table_lookup(&mgr->name_index, object_name); entry; entry = entry->next_named)
+	{
+		int refcnt = ecds_atomic_load(&entry->entry->refcnt);
+
+		/* Skip objects whose last reference is being released, they cannot be revived */
+		while (refcnt > 0 && !ecds_atomic_compare_exchange(&entry->entry->refcnt, &refcnt, refcnt + 1))
+			;
+
+		if (refcnt > 0)
+		{
+			ret = entry->entry;
+			break;
+		}
+	}
+	pthread_mutex_unlock(mgr->memory_mutex);
+
+	return ret;
+}
+
+void ecds_memory_manager_foreach(ecds_memory_manager_t * mgr, void (* operation)(ecds_object_t * obj, int refcnt))
+{
+	if (mgr == NULL)
+		mgr = default_memory_manager;
+	if (mgr == NULL || operation == NULL)
+		return;
+
+	pthread_mutex_lock(mgr->memory_mutex);
+	for (uint32_t i = 0; i < ecds_array_count(mgr->memory_entry_list); i++)
+	{
+		ecds_memory_entry_t * entry = (ecds_memory_entry_t *)ecds_array_get(mgr->memory_entry_list, i);
+		(* operation)(entry->entry, ecds_atomic_load(&entry->entry->refcnt));
+	}
+	pthread_mutex_unlock(mgr->memory_mutex);
+}
+
+uint32_t ecds_memory_manager_get_object_count(ecds_memory_manager_t * mgr)
+{
+	if (mgr == NULL)
+		mgr = default_memory_manager;
+	if (mgr == NULL)
+		return 0;
+
+	return mgr->object_count;
+}
+
+void * ecds_memory_manager_alloc(ecds_memory_manager_t * mgr, size_t size)
+{
+	if (mgr == NULL)
+		mgr = default_memory_manager;
+	if (mgr == NULL)
+		/* Nothing to allocate from yet, this only happens while bootstrapping */
+		return ecds_memory_pool_alloc(NULL, size);
+
+	return ecds_memory_pool_alloc(mgr->pools, size);
+}
+
+int ecds_memory_manager_get_pool_stats(ecds_memory_manager_t * mgr, ecds_memory_pool_stats_t * stats, int max_entries)
+{
+	int count = 0;
+
+	if (mgr == NULL)
+		mgr = default_memory_manager;
+	if (mgr == NULL || stats == NULL)
+		return 0;
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES && count < max_entries; i++)
+		ecds_memory_pool_get_stats(&mgr->pools[i], &stats[count++]);
+
+	if (count < max_entries)
+		ecds_memory_pool_get_stats(NULL, &stats[count++]);
+
+	return count;
+}
+
+void * ecds_memory_alloc(size_t size)
+{
+	return ecds_memory_manager_alloc(NULL, size);
+}
+
+void ecds_memory_free(void * ptr)
+{
+	ecds_memory_pool_free(ptr);
+}
+
+char * ecds_memory_strdup(const char * str)
+{
+	size_t length;
+	char * ret;
+
+	if (str == NULL)
+		return NULL;
+
+	length = strlen(str) + 1;
+	ret = (char *)ecds_memory_alloc(length);
+	if (ret)
+		memcpy(ret, str, length);
+
+	return ret;
 }
 
 //!< Find the UID of an object in the memory manager's memory.
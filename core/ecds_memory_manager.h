@@ -16,8 +16,13 @@
 
 #include <ecds.h>
 
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
 #include <core/ecds_process.h>
 #include <core/ecds_object.h>
+#include <core/ecds_memory_pool.h>
+#include <common/ecds_hash_table.h>
 
 typedef struct _ecds_memory_manager_t ecds_memory_manager_t;
 
@@ -27,22 +32,32 @@ typedef struct _ecds_memory_manager_t ecds_memory_manager_t;
 #define ECDS_TYPE_MEMORY_MANAGER_LIST		0xFFFFFFFD
 #define ECDS_TYPE_UNMANAGED					0xFFFFFF00
 
+/**
+ * Bookkeeping record for a single managed object. The reference count itself lives in the
+ * object so it can be changed without looking up the entry; the entry only exists so that
+ * the manager can enumerate and dispose every live object.
+ */
 struct _ecds_memory_entry_t
 {
 	ecds_object_t obj;
 	ecds_object_t * entry;
 	uint32_t uid;
-	int refcnt;
+	uint32_t index;						//!<	Position of this entry in the memory entry list
+	ecds_memory_entry_t * next_named;	//!<	Next entry for an object with the same name
+	ecds_memory_entry_t * previous_named;
 };
 
 struct _ecds_memory_manager_t
 {
 	ecds_process_t process;				//!<	The memory manager itself is a process so it can register in the scheduler.
 	
-	ecds_list_t * memory_entry_list;	//!<	List of memory entries
-};
+	ecds_array_t * memory_entry_list;	//!<	Array of memory entries, in no particular order
+	uint32_t object_count;				//!<	Number of entries in memory_entry_list
+	pthread_mutex_t memory_mutex[1];	//!<	Protects memory_entry_list and name_index, reference counts do not need it
+	ecds_hash_table_t name_index;		//!<	First entry for every object name, anonymous objects are not indexed
 
-typedef struct _ecds_memory_entry_t ecds_memory_entry_t;
+	ecds_memory_pool_t pools[ECDS_MEMORY_POOL_CLASSES];	//!<	Size-class pools backing all allocations
+};
 
 ecds_memory_manager_t * ecds_memory_manager_construct();
 
@@ -58,6 +73,30 @@ uint32_t ecds_memory_manager_find_object(ecds_memory_manager_t * mgr, const char
 //!< Find an object by UID, and take a reference on it.
 ecds_object_t * ecds_memory_manager_fetch_object(ecds_memory_manager_t * mgr, uint32_t object_id);
 
+/**
+ * @brief Call a function for every object that is alive in a memory manager.
+ * @param mgr The memory manager to inspect, or NULL for the default memory manager.
+ * @param operation The function to call. It receives the object and its current reference count.
+ * @note The memory manager is locked while enumerating, so the operation must not create or dispose objects.
+ */
+void ecds_memory_manager_foreach(ecds_memory_manager_t * mgr, void (* operation)(ecds_object_t * obj, int refcnt));
+
+//!< Get the number of objects that are alive in a memory manager.
+uint32_t ecds_memory_manager_get_object_count(ecds_memory_manager_t * mgr);
+
+//!< Allocate a zero-filled block from the pools of a memory manager (NULL for the default).
+void * ecds_memory_manager_alloc(ecds_memory_manager_t * mgr, size_t size);
+
+/**
+ * @brief Get the occupancy statistics for the pools of a memory manager.
+ * @param mgr The memory manager to inspect, or NULL for the default memory manager.
+ * @param stats An array receiving one entry per size class, followed by one entry (with a block
+ *		  size of 0) for allocations that were passed on to the system heap.
+ * @param max_entries The number of entries available in stats.
+ * @return The number of entries written.
+ */
+int ecds_memory_manager_get_pool_stats(ecds_memory_manager_t * mgr, ecds_memory_pool_stats_t * stats, int max_entries);
+
 
 //=================================== 8< ====================================//
 //				GENERAL MEMORY MANAGEMENT FUNCTIONS FOR ECDS				 //
@@ -73,7 +112,11 @@ ecds_object_t * ecds_memory_manager_fetch_object(ecds_memory_manager_t * mgr, ui
  */
 ecds_object_t * ecds_object_new(const char * name, size_t size, uint32_t type);
 
-//!< Find an object with a specific name in the memory manager's memory.
+/**
+ * @brief Find an object with a specific name in the default memory manager and take a reference on it.
+ *		  If several objects share the name, the one that was named most recently is returned.
+ * @return The object, or NULL if no live object has that name.
+ */
 ecds_object_t * ecds_object_find(const char * object_name);
 
 //!< Take an additional reference on an object.
@@ -0,0 +1,215 @@
+/*****************************************************************************/
+/*	@file ecds_memory_pool.c												 */
+/*	@brief Size-class pool allocator for the ECDS memory manager			 */
+/*																			 */
+/*	Each block handed out is preceded by a header holding a pointer to the	 */
+/*	pool that owns it (NULL for blocks that came from the system heap).		 */
+/*	Free blocks are linked through their first word, slabs are linked		 */
+/*	through their first word as well so they can be released on disposal.	 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+
+#include <core/ecds_memory_pool.h>
+
+#define ECDS_LOG_DOMAIN "ecds-memory-pool"
+
+//!<	Size of the block header, keeps the payload aligned for any fundamental type.
+#define ECDS_MEMORY_BLOCK_HEADER			16
+
+//!<	Minimum number of blocks carved out of a single slab.
+#define ECDS_MEMORY_POOL_MIN_BLOCKS			32
+
+static const size_t ecds_memory_pool_sizes[ECDS_MEMORY_POOL_CLASSES] = 
+{
+	32, 48, 64, 96, 128, 192, 256, 512
+};
+
+static uint64_t heap_allocations = 0;
+static uint32_t heap_blocks_in_use = 0;
+
+static inline ecds_memory_pool_t ** _block_owner(void * ptr)
+{
+	return (ecds_memory_pool_t **)((char *)ptr - ECDS_MEMORY_BLOCK_HEADER);
+}
+
+static bool _pool_grow(ecds_memory_pool_t * pool)
+{
+	size_t stride = pool->block_size + ECDS_MEMORY_BLOCK_HEADER;
+	size_t slab_size = ECDS_MEMORY_POOL_SLAB_SIZE;
+	uint32_t block_count;
+	char * slab;
+
+	if (slab_size < ECDS_MEMORY_BLOCK_HEADER + stride * ECDS_MEMORY_POOL_MIN_BLOCKS)
+		slab_size = ECDS_MEMORY_BLOCK_HEADER + stride * ECDS_MEMORY_POOL_MIN_BLOCKS;
+
+	slab = (char *)malloc(slab_size);
+	if (!slab)
+		return false;
+
+	/* The first header-sized chunk links the slab into the pool's slab list */
+	*(void **)slab = pool->slab_list;
+	pool->slab_list = slab;
+
+	block_count = (uint32_t)((slab_size - ECDS_MEMORY_BLOCK_HEADER) / stride);
+	for (uint32_t i = 0; i < block_count; i++)
+	{
+		void * block = slab + ECDS_MEMORY_BLOCK_HEADER + i * stride + ECDS_MEMORY_BLOCK_HEADER;
+		
+		*_block_owner(block) = pool;
+		*(void **)block = pool->free_list;
+		pool->free_list = block;
+	}
+
+	pool->slab_count++;
+	pool->blocks_total += block_count;
+
+	return true;
+}
+
+void ecds_memory_pool_initialize(ecds_memory_pool_t * pools)
+{
+	if (!pools)
+		return;
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+	{
+		memset(&pools[i], 0, sizeof(ecds_memory_pool_t));
+		pools[i].block_size = ecds_memory_pool_sizes[i];
+		pthread_mutex_init(pools[i].pool_mutex, 0);
+	}
+}
+
+void ecds_memory_pool_dispose(ecds_memory_pool_t * pools)
+{
+	if (!pools)
+		return;
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+	{
+		ecds_memory_pool_t * pool = &pools[i];
+
+		if (pool->blocks_in_use)
+			ecds_log_warning("Releasing pool of %u byte blocks with %u blocks still in use", (unsigned int)pool->block_size, pool->blocks_in_use);
+
+		while (pool->slab_list)
+		{
+			void * slab = pool->slab_list;
+			pool->slab_list = *(void **)slab;
+			free(slab);
+		}
+
+		pool->free_list = NULL;
+		pool->slab_count = 0;
+		pool->blocks_total = 0;
+		pool->blocks_in_use = 0;
+
+		pthread_mutex_destroy(pool->pool_mutex);
+	}
+}
+
+void * ecds_memory_pool_alloc(ecds_memory_pool_t * pools, size_t size)
+{
+	ecds_memory_pool_t * pool = NULL;
+	void * block = NULL;
+
+	if (pools)
+	{
+		for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+		{
+			if (size <= pools[i].block_size)
+			{
+				pool = &pools[i];
+				break;
+			}
+		}
+	}
+
+	if (!pool)
+	{
+		/* No pool available or too big for any size class, use the heap */
+		char * mem = (char *)calloc(1, size + ECDS_MEMORY_BLOCK_HEADER);
+		if (!mem)
+			return NULL;
+
+		block = mem + ECDS_MEMORY_BLOCK_HEADER;
+		*_block_owner(block) = NULL;
+
+		ecds_atomic_increment(&heap_allocations);
+		ecds_atomic_increment(&heap_blocks_in_use);
+		return block;
+	}
+
+	pthread_mutex_lock(pool->pool_mutex);
+
+	if (!pool->free_list && !_pool_grow(pool))
+	{
+		pthread_mutex_unlock(pool->pool_mutex);
+		return NULL;
+	}
+
+	block = pool->free_list;
+	pool->free_list = *(void **)block;
+
+	pool->allocations++;
+	pool->blocks_in_use++;
+	if (pool->blocks_in_use > pool->blocks_peak)
+		pool->blocks_peak = pool->blocks_in_use;
+
+	pthread_mutex_unlock(pool->pool_mutex);
+
+	memset(block, 0, pool->block_size);
+	return block;
+}
+
+void ecds_memory_pool_free(void * ptr)
+{
+	ecds_memory_pool_t * pool;
+
+	if (!ptr)
+		return;
+
+	pool = *_block_owner(ptr);
+	if (!pool)
+	{
+		ecds_atomic_decrement(&heap_blocks_in_use);
+		free((char *)ptr - ECDS_MEMORY_BLOCK_HEADER);
+		return;
+	}
+
+	pthread_mutex_lock(pool->pool_mutex);
+	*(void **)ptr = pool->free_list;
+	pool->free_list = ptr;
+	pool->blocks_in_use--;
+	pthread_mutex_unlock(pool->pool_mutex);
+}
+
+void ecds_memory_pool_get_stats(ecds_memory_pool_t * pool, ecds_memory_pool_stats_t * stats)
+{
+	if (!stats)
+		return;
+
+	memset(stats, 0, sizeof(ecds_memory_pool_stats_t));
+
+	if (!pool)
+	{
+		/* Describe the system heap fallback */
+		stats->blocks_in_use = ecds_atomic_load(&heap_blocks_in_use);
+		stats->allocations = ecds_atomic_load(&heap_allocations);
+		return;
+	}
+
+	pthread_mutex_lock(pool->pool_mutex);
+	stats->block_size = pool->block_size;
+	stats->slab_count = pool->slab_count;
+	stats->blocks_total = pool->blocks_total;
+	stats->blocks_in_use = pool->blocks_in_use;
+	stats->blocks_peak = pool->blocks_peak;
+	stats->allocations = pool->allocations;
+	pthread_mutex_unlock(pool->pool_mutex);
+}
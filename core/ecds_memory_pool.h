@@ -0,0 +1,97 @@
+/*****************************************************************************/
+/*	@file ecds_memory_pool.h												 */
+/*	@brief Size-class pool allocator for the ECDS memory manager			 */
+/*																			 */
+/*	Objects, list items, memory entries, messages and object names are all	 */
+/*	small, short-lived allocations of a handful of distinct sizes. Instead	 */
+/*	of going to the system heap for each of them, every memory manager owns	 */
+/*	a set of pools, one per size class. A pool carves fixed-size blocks out */
+/*	of large slabs and keeps freed blocks on a free list, so that after the	 */
+/*	working set has been reached no allocation touches the heap anymore.	 */
+/*																			 */
+/*	Requests larger than the biggest size class are passed on to the		 */
+/*	system heap. Every block carries a small header that records the pool	 */
+/*	it came from, so blocks can be released without knowing their size.	 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_MEMORY_POOL_H
+#define _ECDS_MEMORY_POOL_H
+
+#include <ecds.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+//!<	Number of size classes served by each memory manager.
+#define ECDS_MEMORY_POOL_CLASSES			8
+
+//!<	Preferred size of a single slab in bytes.
+#define ECDS_MEMORY_POOL_SLAB_SIZE			16384
+
+typedef struct _ecds_memory_pool_t ecds_memory_pool_t;
+typedef struct _ecds_memory_pool_stats_t ecds_memory_pool_stats_t;
+
+struct _ecds_memory_pool_t
+{
+	size_t block_size;					//!<	Usable size of each block in bytes
+	void * free_list;					//!<	Singly linked list of recycled blocks
+	void * slab_list;					//!<	Singly linked list of slabs owned by this pool
+
+	uint32_t slab_count;				//!<	Number of slabs allocated from the heap
+	uint32_t blocks_total;				//!<	Number of blocks carved out of the slabs
+	uint32_t blocks_in_use;				//!<	Number of blocks currently handed out
+	uint32_t blocks_peak;				//!<	Highest value blocks_in_use has reached
+	uint64_t allocations;				//!<	Total number of allocations served
+
+	pthread_mutex_t pool_mutex[1];
+};
+
+/**
+ * Occupancy statistics for a single size class. A block_size of 0 describes the
+ * system heap fallback for allocations that do not fit any size class.
+ */
+struct _ecds_memory_pool_stats_t
+{
+	size_t block_size;
+	uint32_t slab_count;
+	uint32_t blocks_total;
+	uint32_t blocks_in_use;
+	uint32_t blocks_peak;
+	uint64_t allocations;
+};
+
+/**
+ * @brief Initialize the pools for all size classes.
+ * @param pools An array of ECDS_MEMORY_POOL_CLASSES pools.
+ */
+void ecds_memory_pool_initialize(ecds_memory_pool_t * pools);
+
+/**
+ * @brief Release all slabs owned by a set of pools. Blocks that are still in use become invalid.
+ * @param pools An array of ECDS_MEMORY_POOL_CLASSES pools.
+ */
+void ecds_memory_pool_dispose(ecds_memory_pool_t * pools);
+
+/**
+ * @brief Allocate a zero-filled block from the smallest size class that fits.
+ * @param pools An array of ECDS_MEMORY_POOL_CLASSES pools, or NULL to allocate from the system heap.
+ * @param size The number of bytes required.
+ * @return A pointer to the new block, or NULL if the system is out of memory.
+ */
+void * ecds_memory_pool_alloc(ecds_memory_pool_t * pools, size_t size);
+
+/**
+ * @brief Return a block to the pool it was allocated from.
+ * @param ptr A block obtained from ecds_memory_pool_alloc(), or NULL.
+ */
+void ecds_memory_pool_free(void * ptr);
+
+/**
+ * @brief Copy the statistics for a single size class.
+ * @param pool The pool to inspect.
+ * @param stats The structure to fill in.
+ */
+void ecds_memory_pool_get_stats(ecds_memory_pool_t * pool, ecds_memory_pool_stats_t * stats);
+
+#endif /* _ECDS_MEMORY_POOL_H */
@@ -32,7 +32,7 @@ void ecds_load_module(const char * path)
 	HMODULE dl_handle = LoadLibraryA(path);
 	if(dl_handle == NULL)
 	{
-		ecds_log(ECDS_WARN, "Unable to load module from %s", path);
+		ecds_log_warning("Unable to load module from %s", path);
 		return;
 	}
 
@@ -42,21 +42,21 @@ void ecds_load_module(const char * path)
 	void * dl_handle = dlopen(path, RTLD_LAZY);
 	if(!dl_handle)
 	{
-		ecds_log(ECDS_WARN, "Unable to load module from %s", path);
+		ecds_log_warning("Unable to load module from %s", path);
 		return;
 	}
 	ecds_module_constructor_t ecds_module_construct = (ecds_module_constructor_t)dlsym(dl_handle, "ecds_module_construct");
 #endif
 	if(!ecds_module_construct)
 	{
-		ecds_log(ECDS_WARN, "Library file at %s is not an ECDS module", path);
+		ecds_log_warning("Library file at %s is not an ECDS module", path);
 		return;
 	}	
 	
 	ecds_module_t * module = ecds_module_construct();
 	if(!module)
 	{
-		ecds_log(ECDS_WARN, "Error loading module at %s", path);
+		ecds_log_warning("Error loading module at %s", path);
 		return;
 	}	
 		
@@ -9,10 +9,12 @@
 #include <ecds.h>
 
 struct _ecds_object_t {
-	char * name;		//!<	Object instance name
+	const char * name;	//!<	Object instance name, an interned atom shared with other objects of the same name
 	uint32_t uid;		//!<	Object instance unique identifier
 	uint32_t type_uid;	//!<	Object type unique identifier
 	ecds_memory_manager_t * manager;
+	ecds_memory_entry_t * memory_entry;	//!<	Entry in the manager's object list (NULL if not managed yet)
+	int refcnt;			//!<	Reference count, only to be modified atomically
 		
 	//!< @brief Object constructor, called when the object is newly created.
 	void (* construct)(ecds_object_t * obj);
@@ -0,0 +1,1193 @@
+/*****************************************************************************/
+/*	@file ecds_render_stream.c											 	 */
+/*	@brief Streaming of render buffers to remote renderers.					 */
+/*																			 */
+/*	The sender keeps a copy of every buffer as it was last sent. Deltas		 */
+/*	are found by comparing instructions from the front and from the back	 */
+/*	of that copy and the current buffer, which catches the common case of	 */
+/*	a few values changing in an otherwise static buffer.					 */
+/*																			 */
+/*	On the socket every frame is preceded by its length as a 32-bit			 */
+/*	little-endian integer.													 */
+/*																			 */
+/*****************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define ECDS_RENDER_STREAM_SOCKETS
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+#include <ecds.h>
+#include <common/ecds_list.h>
+#include <common/ecds_log.h>
+
+#include <core/ecds_render_stream.h>
+
+#define ECDS_LOG_DOMAIN "ecds-render-stream"
+
+#define ECDS_RENDER_STREAM_MAGIC		0xEC
+
+#define ECDS_RENDER_STREAM_FULL			0		//!<	Buffer mode: all instructions follow
+#define ECDS_RENDER_STREAM_DELTA		1		//!<	Buffer mode: instructions replace the middle of the previous buffer
+
+//!<	Largest frame accepted from a socket.
+#define ECDS_RENDER_STREAM_MAX_FRAME	(64u * 1024u * 1024u)
+
+//!<	Largest gap of buffer IDs a frame may create on the receiver.
+#define ECDS_RENDER_STREAM_MAX_NEW_BUFFERS	1024
+
+typedef struct _ecds_render_bytes_t ecds_render_bytes_t;
+typedef struct _ecds_render_reader_t ecds_render_reader_t;
+typedef struct _ecds_render_sent_buffer_t ecds_render_sent_buffer_t;
+
+struct _ecds_render_bytes_t {
+	uint8_t * data;
+	size_t length;
+	size_t capacity;
+	bool failed;						//!<	Set when memory ran out, the content is incomplete
+};
+
+struct _ecds_render_reader_t {
+	const uint8_t * data;
+	const uint8_t * end;
+	bool failed;						//!<	Set when the data ended early or was malformed
+};
+
+/* A buffer as the receiver has it */
+struct _ecds_render_sent_buffer_t {
+	unsigned int buffer_id;
+	uint32_t revision;
+	ecds_render_bytes_t copy;
+};
+
+struct _ecds_render_sender_t {
+	ecds_object_t obj;
+
+	ecds_renderer_t * source;
+	ecds_render_stream_config_t config;
+
+	ecds_render_sent_buffer_t * sent;
+	uint32_t sent_count;
+	uint32_t sent_capacity;
+
+	ecds_render_bytes_t frame;			//!<	Encoding scratch, reused for every frame
+	ecds_render_bytes_t old_offsets;	//!<	Instruction offsets of the previous buffer, as size_t
+	ecds_render_bytes_t new_offsets;	//!<	Instruction offsets of the current buffer, as size_t
+	uint64_t frame_number;
+
+	int socket;
+	ecds_render_sender_stats_t stats;
+};
+
+struct _ecds_render_receiver_t {
+	ecds_object_t obj;
+
+	ecds_renderer_t * target;
+
+	ecds_render_bytes_t old_buffer;		//!<	Copy of the buffer a delta is applied to
+	ecds_render_bytes_t old_offsets;
+	ecds_render_bytes_t instruction;	//!<	Decoding scratch for one instruction
+
+	int listen_socket;
+	int socket;
+	ecds_render_bytes_t received;		//!<	Bytes read from the socket that do not form a complete frame yet
+
+	ecds_render_receiver_stats_t stats;
+};
+
+const ecds_render_stream_config_t ecds_render_stream_default_config = {
+	ECDS_RENDER_VERTEX_FIXED,
+	16.0,
+	true,
+	300
+};
+
+//=================================== 8< ====================================//
+//	Encoding primitives														 //
+//===========================================================================//
+
+static bool _ecds_render_bytes_reserve(ecds_render_bytes_t * bytes, size_t size)
+{
+	size_t capacity;
+	uint8_t * data;
+
+	if (bytes->failed)
+		return false;
+	if (bytes->length + size <= bytes->capacity)
+		return true;
+
+	capacity = bytes->capacity ? bytes->capacity : 256;
+	while (capacity < bytes->length + size)
+		capacity *= 2;
+
+	if (!(data = (uint8_t *)ecds_memory_alloc(capacity)))
+	{
+		ecds_log_error("Out of memory when growing a stream buffer to %zu bytes", capacity);
+		bytes->failed = true;
+		return false;
+	}
+
+	if (bytes->length)
+		memcpy(data, bytes->data, bytes->length);
+	ecds_memory_free(bytes->data);
+
+	bytes->data = data;
+	bytes->capacity = capacity;
+
+	return true;
+}
+
+static void _ecds_render_bytes_free(ecds_render_bytes_t * bytes)
+{
+	ecds_memory_free(bytes->data);
+	memset(bytes, 0, sizeof(ecds_render_bytes_t));
+}
+
+static inline void _ecds_render_put_bytes(ecds_render_bytes_t * bytes, const void * data, size_t length)
+{
+	if (!_ecds_render_bytes_reserve(bytes, length))
+		return;
+
+	if (length)
+		memcpy(bytes->data + bytes->length, data, length);
+	bytes->length += length;
+}
+
+static inline void _ecds_render_put_byte(ecds_render_bytes_t * bytes, uint8_t value)
+{
+	_ecds_render_put_bytes(bytes, &value, 1);
+}
+
+static void _ecds_render_put_varint(ecds_render_bytes_t * bytes, uint64_t value)
+{
+	uint8_t encoded[10];
+	size_t length = 0;
+
+	do
+	{
+		encoded[length] = (uint8_t)(value & 0x7F);
+		value >>= 7;
+		if (value)
+			encoded[length] |= 0x80;
+		length++;
+	} while (value);
+
+	_ecds_render_put_bytes(bytes, encoded, length);
+}
+
+static uint64_t _ecds_render_get_varint(ecds_render_reader_t * reader)
+{
+	uint64_t value = 0;
+	int shift;
+
+	for (shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte;
+
+		if (reader->data >= reader->end)
+			break;
+
+		byte = *reader->data++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return value;
+	}
+
+	reader->failed = true;
+	return 0;
+}
+
+static const uint8_t * _ecds_render_get_bytes(ecds_render_reader_t * reader, size_t length)
+{
+	const uint8_t * ret = reader->data;
+
+	if (reader->failed || (size_t)(reader->end - reader->data) < length)
+	{
+		reader->failed = true;
+		return NULL;
+	}
+
+	reader->data += length;
+	return ret;
+}
+
+static uint16_t _ecds_render_float_to_half(float value)
+{
+	uint32_t bits, sign, mantissa;
+	int32_t exponent;
+	uint16_t half;
+
+	memcpy(&bits, &value, sizeof(bits));
+	sign = (bits >> 16) & 0x8000;
+	exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		/* Infinity and NaN */
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+	if (exponent >= 31)
+		/* Too large, saturate to infinity */
+		return (uint16_t)(sign | 0x7C00);
+
+	if (exponent <= 0)
+	{
+		/* Subnormal half or zero */
+		if (exponent < -10)
+			return (uint16_t)sign;
+
+		mantissa |= 0x800000;
+		half = (uint16_t)(mantissa >> (14 - exponent));
+		if ((mantissa >> (13 - exponent)) & 1)
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	/* Rounding may carry into the exponent, which is still the correct result */
+	half = (uint16_t)(sign | ((uint32_t)exponent << 10) | (mantissa >> 13));
+	if (mantissa & 0x1000)
+		half++;
+
+	return half;
+}
+
+static float _ecds_render_half_to_float(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+	float value;
+
+	if (exponent == 0)
+	{
+		value = ldexpf((float)mantissa, -24);
+		return sign ? -value : value;
+	}
+
+	if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void _ecds_render_put_value(ecds_render_bytes_t * bytes, const ecds_render_stream_config_t * config, double value)
+{
+	uint8_t encoded[8];
+	uint64_t bits64;
+	uint32_t bits32;
+	uint16_t bits16;
+	double scaled;
+	int64_t fixed;
+	int i;
+
+	switch (config->vertex_format)
+	{
+	case ECDS_RENDER_VERTEX_FLOAT32:
+	{
+		float single = (float)value;
+
+		memcpy(&bits32, &single, sizeof(bits32));
+		for (i = 0; i < 4; i++)
+			encoded[i] = (uint8_t)(bits32 >> (i * 8));
+		_ecds_render_put_bytes(bytes, encoded, 4);
+		return;
+	}
+
+	case ECDS_RENDER_VERTEX_FLOAT16:
+		bits16 = _ecds_render_float_to_half((float)value);
+		encoded[0] = (uint8_t)bits16;
+		encoded[1] = (uint8_t)(bits16 >> 8);
+		_ecds_render_put_bytes(bytes, encoded, 2);
+		return;
+
+	case ECDS_RENDER_VERTEX_FIXED:
+		/* Zigzag encoding keeps small negative values short */
+		scaled = value * config->fixed_point_scale;
+		if (!(scaled == scaled))
+			scaled = 0.0;
+		fixed = scaled >= 9.2e18 ? INT64_MAX : scaled <= -9.2e18 ? INT64_MIN : (int64_t)llround(scaled);
+		_ecds_render_put_varint(bytes, ((uint64_t)fixed << 1) ^ (uint64_t)(fixed >> 63));
+		return;
+
+	default:
+		memcpy(&bits64, &value, sizeof(bits64));
+		for (i = 0; i < 8; i++)
+			encoded[i] = (uint8_t)(bits64 >> (i * 8));
+		_ecds_render_put_bytes(bytes, encoded, 8);
+		return;
+	}
+}
+
+static double _ecds_render_get_value(ecds_render_reader_t * reader, ecds_render_vertex_format_t format, double fixed_point_scale)
+{
+	const uint8_t * encoded;
+	uint64_t bits64 = 0, zigzag;
+	uint32_t bits32 = 0;
+	double value;
+	float single;
+	int i;
+
+	switch (format)
+	{
+	case ECDS_RENDER_VERTEX_FLOAT32:
+		if (!(encoded = _ecds_render_get_bytes(reader, 4)))
+			return 0.0;
+		for (i = 0; i < 4; i++)
+			bits32 |= (uint32_t)encoded[i] << (i * 8);
+		memcpy(&single, &bits32, sizeof(single));
+		return single;
+
+	case ECDS_RENDER_VERTEX_FLOAT16:
+		if (!(encoded = _ecds_render_get_bytes(reader, 2)))
+			return 0.0;
+		return _ecds_render_half_to_float((uint16_t)(encoded[0] | (encoded[1] << 8)));
+
+	case ECDS_RENDER_VERTEX_FIXED:
+		zigzag = _ecds_render_get_varint(reader);
+		return (double)(int64_t)((zigzag >> 1) ^ (~(zigzag & 1) + 1)) / fixed_point_scale;
+
+	default:
+		if (!(encoded = _ecds_render_get_bytes(reader, 8)))
+			return 0.0;
+		for (i = 0; i < 8; i++)
+			bits64 |= (uint64_t)encoded[i] << (i * 8);
+		memcpy(&value, &bits64, sizeof(value));
+		return value;
+	}
+}
+
+/* Size of the values of parameters that are sent in the vertex format, 0 for everything else */
+static inline size_t _ecds_render_value_size(uint64_t opcode, uint64_t parameter)
+{
+	if (opcode != ECDS_RENDER_PARAMETER)
+		return 0;
+
+	switch (parameter)
+	{
+	case ECDS_RENDER_PARAM_VERTEX:
+	case ECDS_RENDER_PARAM_RECTANGLE:
+	case ECDS_RENDER_PARAM_ELLIPSE:
+	case ECDS_RENDER_PARAM_ARC:
+	case ECDS_RENDER_PARAM_TRANSFORM:
+	case ECDS_RENDER_PARAM_VERTEX_ARRAY:
+		return sizeof(double);
+	case ECDS_RENDER_PARAM_VERTEX_ARRAY_F32:
+		return sizeof(float);
+	default:
+		return 0;
+	}
+}
+
+static void _ecds_render_encode_instruction(ecds_render_bytes_t * bytes, const ecds_render_stream_config_t * config, const ecds_render_instruction_t * instr)
+{
+	const uint8_t * data = (const uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr);
+	ecds_render_stream_config_t single_config;
+	size_t value_size;
+	uint32_t i, count;
+	double value;
+	float single;
+
+	_ecds_render_put_varint(bytes, instr->opcode);
+	_ecds_render_put_varint(bytes, instr->parameter);
+
+	if ((value_size = _ecds_render_value_size(instr->opcode, instr->parameter)) && instr->length % value_size == 0)
+	{
+		/* Single precision values gain nothing from being sent as doubles */
+		if (value_size == sizeof(float) && config->vertex_format == ECDS_RENDER_VERTEX_FLOAT64)
+		{
+			single_config = *config;
+			single_config.vertex_format = ECDS_RENDER_VERTEX_FLOAT32;
+			config = &single_config;
+		}
+
+		count = instr->length / (uint32_t)value_size;
+		_ecds_render_put_varint(bytes, (uint64_t)count << 1);
+		for (i = 0; i < count; i++)
+		{
+			if (value_size == sizeof(float))
+			{
+				memcpy(&single, data + i * sizeof(float), sizeof(float));
+				value = single;
+			}
+			else
+				memcpy(&value, data + i * sizeof(double), sizeof(double));
+			_ecds_render_put_value(bytes, config, value);
+		}
+	}
+	else if (instr->opcode == ECDS_RENDER_PARAMETER && instr->parameter == ECDS_RENDER_PARAM_COLOUR &&
+		instr->length == 4 * sizeof(double) && config->vertex_format != ECDS_RENDER_VERTEX_FLOAT64)
+	{
+		_ecds_render_put_varint(bytes, 4 << 1);
+		for (i = 0; i < 4; i++)
+		{
+			memcpy(&value, data + i * sizeof(double), sizeof(double));
+			_ecds_render_put_byte(bytes, value <= 0.0 || !(value == value) ? 0 : value >= 1.0 ? 255 : (uint8_t)(value * 255.0 + 0.5));
+		}
+	}
+	else
+	{
+		_ecds_render_put_varint(bytes, ((uint64_t)instr->length << 1) | 1);
+		_ecds_render_put_bytes(bytes, data, instr->length);
+	}
+}
+
+/* Collect the offsets of the instructions in a buffer, returns the number of instructions */
+static uint32_t _ecds_render_index_instructions(ecds_render_bytes_t * offsets, const uint8_t * data, size_t length)
+{
+	const ecds_render_instruction_t * instr = (const ecds_render_instruction_t *)data;
+	const ecds_render_instruction_t * end = (const ecds_render_instruction_t *)(data + length);
+	size_t offset;
+
+	offsets->length = 0;
+	for (; instr < end; instr = ECDS_RENDER_INSTRUCTION_NEXT(instr))
+	{
+		offset = (size_t)((const uint8_t *)instr - data);
+		_ecds_render_put_bytes(offsets, &offset, sizeof(offset));
+	}
+
+	return (uint32_t)(offsets->length / sizeof(size_t));
+}
+
+static inline const ecds_render_instruction_t * _ecds_render_indexed(const ecds_render_bytes_t * offsets, const uint8_t * data, uint32_t index)
+{
+	return (const ecds_render_instruction_t *)(data + ((const size_t *)offsets->data)[index]);
+}
+
+static inline bool _ecds_render_instructions_equal(const ecds_render_instruction_t * a, const ecds_render_instruction_t * b)
+{
+	/* Padding is always zero, so whole instructions can be compared */
+	return a->length == b->length && memcmp(a, b, ECDS_RENDER_INSTRUCTION_SIZE(a->length)) == 0;
+}
+
+//=================================== 8< ====================================//
+//	Sender																	 //
+//===========================================================================//
+
+static ecds_render_sent_buffer_t * _ecds_render_sender_find(ecds_render_sender_t * sender, unsigned int buffer_id)
+{
+	uint32_t i;
+
+	for (i = 0; i < sender->sent_count; i++)
+	{
+		if (sender->sent[i].buffer_id == buffer_id)
+			return &sender->sent[i];
+	}
+
+	return NULL;
+}
+
+static void _ecds_render_sender_encode_buffer(ecds_render_sender_t * sender, ecds_render_buffer_t * buffer, ecds_render_sent_buffer_t * sent, bool full)
+{
+	ecds_render_bytes_t * frame = &sender->frame;
+	uint32_t old_count = 0, new_count, prefix = 0, suffix = 0, limit, i;
+
+	_ecds_render_put_varint(frame, buffer->id);
+
+	new_count = _ecds_render_index_instructions(&sender->new_offsets, buffer->data, buffer->length);
+	if (!full)
+	{
+		old_count = _ecds_render_index_instructions(&sender->old_offsets, sent->copy.data, sent->copy.length);
+		limit = old_count < new_count ? old_count : new_count;
+
+		while (prefix < limit && _ecds_render_instructions_equal(
+			_ecds_render_indexed(&sender->old_offsets, sent->copy.data, prefix),
+			_ecds_render_indexed(&sender->new_offsets, buffer->data, prefix)))
+			prefix++;
+
+		while (suffix < limit - prefix && _ecds_render_instructions_equal(
+			_ecds_render_indexed(&sender->old_offsets, sent->copy.data, old_count - 1 - suffix),
+			_ecds_render_indexed(&sender->new_offsets, buffer->data, new_count - 1 - suffix)))
+			suffix++;
+
+		full = prefix + suffix == 0;
+	}
+
+	if (full)
+	{
+		_ecds_render_put_varint(frame, ECDS_RENDER_STREAM_FULL);
+		sender->stats.buffers_full++;
+	}
+	else
+	{
+		_ecds_render_put_varint(frame, ECDS_RENDER_STREAM_DELTA);
+		_ecds_render_put_varint(frame, prefix);
+		_ecds_render_put_varint(frame, suffix);
+		sender->stats.buffers_delta++;
+	}
+
+	_ecds_render_put_varint(frame, new_count - prefix - suffix);
+	for (i = prefix; i < new_count - suffix; i++)
+		_ecds_render_encode_instruction(frame, &sender->config, _ecds_render_indexed(&sender->new_offsets, buffer->data, i));
+
+	/* Remember what the receiver has now */
+	sent->copy.length = 0;
+	_ecds_render_put_bytes(&sent->copy, buffer->data, buffer->length);
+	sent->revision = buffer->revision;
+	sender->stats.raw_bytes += buffer->length;
+}
+
+static bool _ecds_render_sender_reserve(ecds_render_sender_t * sender)
+{
+	ecds_render_sent_buffer_t * sent;
+	uint32_t capacity;
+
+	if (sender->sent_count < sender->sent_capacity)
+		return true;
+
+	capacity = sender->sent_capacity ? sender->sent_capacity * 2 : 8;
+	if (!(sent = (ecds_render_sent_buffer_t *)ecds_memory_alloc(capacity * sizeof(ecds_render_sent_buffer_t))))
+		return false;
+
+	if (sender->sent_count)
+		memcpy(sent, sender->sent, sender->sent_count * sizeof(ecds_render_sent_buffer_t));
+	ecds_memory_free(sender->sent);
+
+	sender->sent = sent;
+	sender->sent_capacity = capacity;
+
+	return true;
+}
+
+/* Encode the changed buffers into sender->frame */
+static int _ecds_render_sender_encode(ecds_render_sender_t * sender)
+{
+	ecds_renderer_private_t * priv = (ecds_renderer_private_t *)sender->source->process.private_data;
+	ecds_render_bytes_t * frame = &sender->frame;
+	ecds_list_item_t * i;
+	uint32_t changed = 0;
+	bool keyframe;
+
+	if (!priv)
+		return -1;
+
+	keyframe = sender->frame_number == 0 ||
+		(sender->config.keyframe_interval && sender->frame_number % sender->config.keyframe_interval == 0);
+
+	/* Make sure every buffer has a record, then count the ones that have to be sent */
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+	{
+		ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i);
+		ecds_render_sent_buffer_t * sent = _ecds_render_sender_find(sender, buffer->id);
+
+		if (!sent)
+		{
+			if (!_ecds_render_sender_reserve(sender))
+				return -1;
+			sent = &sender->sent[sender->sent_count++];
+			memset(sent, 0, sizeof(ecds_render_sent_buffer_t));
+			sent->buffer_id = buffer->id;
+			sent->revision = buffer->revision - 1;
+		}
+
+		if (keyframe || sent->revision != buffer->revision)
+			changed++;
+	}
+
+	frame->length = 0;
+	frame->failed = false;
+	_ecds_render_put_byte(frame, ECDS_RENDER_STREAM_MAGIC);
+	_ecds_render_put_byte(frame, ECDS_RENDER_STREAM_VERSION);
+	_ecds_render_put_varint(frame, sender->config.vertex_format);
+	if (sender->config.vertex_format == ECDS_RENDER_VERTEX_FIXED)
+	{
+		ecds_render_stream_config_t lossless = sender->config;
+
+		lossless.vertex_format = ECDS_RENDER_VERTEX_FLOAT64;
+		_ecds_render_put_value(frame, &lossless, sender->config.fixed_point_scale);
+	}
+	_ecds_render_put_varint(frame, sender->frame_number);
+	_ecds_render_put_varint(frame, changed);
+
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+	{
+		ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i);
+		ecds_render_sent_buffer_t * sent = _ecds_render_sender_find(sender, buffer->id);
+
+		if (!keyframe && sent->revision == buffer->revision)
+		{
+			sender->stats.buffers_skipped++;
+			continue;
+		}
+
+		_ecds_render_sender_encode_buffer(sender, buffer, sent, keyframe || !sender->config.delta_frames);
+	}
+
+	if (frame->failed)
+	{
+		/* The receiver would not get what the records say it has, start over with a keyframe */
+		sender->frame_number = 0;
+		return -1;
+	}
+
+	sender->frame_number++;
+	sender->stats.frames++;
+	sender->stats.bytes += frame->length;
+	sender->stats.last_frame_bytes = (uint32_t)frame->length;
+	if (frame->length > sender->stats.max_frame_bytes)
+		sender->stats.max_frame_bytes = (uint32_t)frame->length;
+
+	return (int)frame->length;
+}
+
+static void _ecds_render_sender_dispose(ecds_object_t * obj)
+{
+	ecds_render_sender_t * sender = (ecds_render_sender_t *)obj;
+	uint32_t i;
+
+#ifdef ECDS_RENDER_STREAM_SOCKETS
+	if (sender->socket >= 0)
+		close(sender->socket);
+#endif
+
+	for (i = 0; i < sender->sent_count; i++)
+		_ecds_render_bytes_free(&sender->sent[i].copy);
+	ecds_memory_free(sender->sent);
+	_ecds_render_bytes_free(&sender->frame);
+	_ecds_render_bytes_free(&sender->old_offsets);
+	_ecds_render_bytes_free(&sender->new_offsets);
+
+	ecds_object_unref(ECDS_OBJECT(sender->source));
+}
+
+ecds_render_sender_t * ecds_render_sender_new(ecds_renderer_t * source, const ecds_render_stream_config_t * config)
+{
+	ecds_render_sender_t * sender;
+
+	if (!source)
+		/* Invalid argument */
+		return NULL;
+
+	if (!config)
+		config = &ecds_render_stream_default_config;
+
+	if (config->vertex_format == ECDS_RENDER_VERTEX_FIXED && !(config->fixed_point_scale > 0.0))
+	{
+		ecds_log_error("Fixed point vertices need a positive scale");
+		return NULL;
+	}
+
+	sender = (ecds_render_sender_t *)ecds_object_new(NULL, sizeof(ecds_render_sender_t), ECDS_TYPE_RENDER_SENDER);
+	if (!sender)
+		return NULL;
+
+	sender->obj.dispose = _ecds_render_sender_dispose;
+	sender->config = *config;
+	sender->socket = -1;
+	sender->source = source;
+	ecds_object_ref(ECDS_OBJECT(source));
+
+	return sender;
+}
+
+ecds_payload_t * ecds_render_sender_encode_frame(ecds_render_sender_t * sender)
+{
+	if (!sender || _ecds_render_sender_encode(sender) < 0)
+		return NULL;
+
+	return ecds_payload_new(sender->frame.data, (uint32_t)sender->frame.length);
+}
+
+void ecds_render_sender_get_stats(ecds_render_sender_t * sender, ecds_render_sender_stats_t * stats)
+{
+	if (!stats)
+		return;
+
+	if (sender)
+		*stats = sender->stats;
+	else
+		memset(stats, 0, sizeof(ecds_render_sender_stats_t));
+}
+
+//=================================== 8< ====================================//
+//	Receiver																 //
+//===========================================================================//
+
+static bool _ecds_render_receiver_append_old(ecds_render_receiver_t * receiver, uint32_t from, uint32_t to)
+{
+	for (; from < to; from++)
+	{
+		if (ecds_renderer_append_instruction(receiver->target, _ecds_render_indexed(&receiver->old_offsets, receiver->old_buffer.data, from)) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+static bool _ecds_render_receiver_decode_instruction(ecds_render_receiver_t * receiver, ecds_render_reader_t * reader, ecds_render_vertex_format_t format, double fixed_point_scale)
+{
+	ecds_render_bytes_t * scratch = &receiver->instruction;
+	ecds_render_instruction_t header;
+	const uint8_t * raw;
+	uint64_t opcode, parameter, count;
+	uint32_t i;
+	double value;
+	float single;
+
+	opcode = _ecds_render_get_varint(reader);
+	parameter = _ecds_render_get_varint(reader);
+	count = _ecds_render_get_varint(reader);
+	if (reader->failed || opcode > UINT16_MAX || parameter > UINT16_MAX || (count >> 1) > UINT32_MAX / sizeof(double))
+		return false;
+
+	header.opcode = (uint16_t)opcode;
+	header.parameter = (uint16_t)parameter;
+
+	scratch->length = 0;
+	scratch->failed = false;
+	_ecds_render_put_bytes(scratch, &header, sizeof(header));
+
+	if (count & 1)
+	{
+		if (!(raw = _ecds_render_get_bytes(reader, (size_t)(count >> 1))))
+			return false;
+		_ecds_render_put_bytes(scratch, raw, (size_t)(count >> 1));
+	}
+	else if (opcode == ECDS_RENDER_PARAMETER && parameter == ECDS_RENDER_PARAM_COLOUR && format != ECDS_RENDER_VERTEX_FLOAT64)
+	{
+		if (count >> 1 != 4 || !(raw = _ecds_render_get_bytes(reader, 4)))
+			return false;
+		for (i = 0; i < 4; i++)
+		{
+			value = raw[i] / 255.0;
+			_ecds_render_put_bytes(scratch, &value, sizeof(value));
+		}
+	}
+	else
+	{
+		/* Every value takes at least one byte, which bounds count before anything is allocated */
+		if ((count >> 1) > (uint64_t)(reader->end - reader->data))
+			return false;
+		if (_ecds_render_value_size(opcode, parameter) == sizeof(float))
+		{
+			if (format == ECDS_RENDER_VERTEX_FLOAT64)
+				format = ECDS_RENDER_VERTEX_FLOAT32;
+			for (i = 0; i < (uint32_t)(count >> 1); i++)
+			{
+				single = (float)_ecds_render_get_value(reader, format, fixed_point_scale);
+				_ecds_render_put_bytes(scratch, &single, sizeof(single));
+			}
+		}
+		else
+		{
+			for (i = 0; i < (uint32_t)(count >> 1); i++)
+			{
+				value = _ecds_render_get_value(reader, format, fixed_point_scale);
+				_ecds_render_put_bytes(scratch, &value, sizeof(value));
+			}
+		}
+	}
+
+	if (reader->failed || scratch->failed)
+		return false;
+
+	((ecds_render_instruction_t *)scratch->data)->length = (uint32_t)(scratch->length - sizeof(header));
+
+	return ecds_renderer_append_instruction(receiver->target, (const ecds_render_instruction_t *)scratch->data) >= 0;
+}
+
+static bool _ecds_render_receiver_select(ecds_render_receiver_t * receiver, uint64_t buffer_id)
+{
+	uint32_t created = 0;
+
+	if (buffer_id == 0 || buffer_id > UINT32_MAX)
+		return false;
+
+	/* Buffer IDs are handed out in order, so missing buffers are created up to the one that is needed */
+	while (ecds_renderer_select_buffer(receiver->target, (unsigned int)buffer_id) < 0)
+	{
+		if (created++ == ECDS_RENDER_STREAM_MAX_NEW_BUFFERS || ecds_renderer_new_buffer(receiver->target) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+int ecds_render_receiver_apply_frame(ecds_render_receiver_t * receiver, const void * data, size_t length)
+{
+	ecds_render_reader_t reader;
+	const ecds_render_instruction_t * old;
+	const uint8_t * header;
+	uint64_t format, buffer_count, buffer_id, mode, prefix, suffix, count, b, i;
+	uint32_t old_count;
+	double fixed_point_scale = 1.0;
+
+	if (!receiver || !data)
+		return -1;
+
+	reader.data = (const uint8_t *)data;
+	reader.end = reader.data + length;
+	reader.failed = false;
+
+	if (!(header = _ecds_render_get_bytes(&reader, 2)) || header[0] != ECDS_RENDER_STREAM_MAGIC || header[1] != ECDS_RENDER_STREAM_VERSION)
+		goto error;
+
+	format = _ecds_render_get_varint(&reader);
+	if (format == ECDS_RENDER_VERTEX_FIXED)
+		fixed_point_scale = _ecds_render_get_value(&reader, ECDS_RENDER_VERTEX_FLOAT64, 0.0);
+	_ecds_render_get_varint(&reader);				/* Frame number */
+	buffer_count = _ecds_render_get_varint(&reader);
+	if (reader.failed || format > ECDS_RENDER_VERTEX_FIXED || !(fixed_point_scale > 0.0))
+		goto error;
+
+	for (b = 0; b < buffer_count; b++)
+	{
+		buffer_id = _ecds_render_get_varint(&reader);
+		mode = _ecds_render_get_varint(&reader);
+		prefix = suffix = 0;
+		if (mode == ECDS_RENDER_STREAM_DELTA)
+		{
+			prefix = _ecds_render_get_varint(&reader);
+			suffix = _ecds_render_get_varint(&reader);
+		}
+		count = _ecds_render_get_varint(&reader);
+		if (reader.failed || mode > ECDS_RENDER_STREAM_DELTA || !_ecds_render_receiver_select(receiver, buffer_id))
+			goto error;
+
+		/* Keep the instructions the delta refers to before the buffer is cleared */
+		receiver->old_buffer.length = 0;
+		receiver->old_buffer.failed = false;
+		if (mode == ECDS_RENDER_STREAM_DELTA)
+		{
+			size_t old_length = ecds_renderer_get_buffer_data(receiver->target, (unsigned int)buffer_id, &old);
+
+			_ecds_render_put_bytes(&receiver->old_buffer, old, old_length);
+			old_count = _ecds_render_index_instructions(&receiver->old_offsets, receiver->old_buffer.data, receiver->old_buffer.length);
+			if (receiver->old_buffer.failed || receiver->old_offsets.failed)
+				goto error;
+
+			/* Both come from the sender, checked one by one so that their sum cannot wrap */
+			if (prefix > old_count || suffix > old_count - prefix)
+				goto error;
+		}
+		else
+			old_count = 0;
+
+		ecds_renderer_clear_buffer(receiver->target, (unsigned int)buffer_id);
+
+		if (!_ecds_render_receiver_append_old(receiver, 0, (uint32_t)prefix))
+			goto error;
+		for (i = 0; i < count; i++)
+		{
+			if (!_ecds_render_receiver_decode_instruction(receiver, &reader, (ecds_render_vertex_format_t)format, fixed_point_scale))
+				goto error;
+		}
+		if (!_ecds_render_receiver_append_old(receiver, old_count - (uint32_t)suffix, old_count))
+			goto error;
+	}
+
+	ecds_renderer_commit(receiver->target);
+
+	receiver->stats.frames++;
+	receiver->stats.bytes += length;
+	return 0;
+
+error:
+	ecds_log_warning("Dropping a malformed render frame of %zu bytes", length);
+	receiver->stats.errors++;
+	return -1;
+}
+
+static void _ecds_render_receiver_dispose(ecds_object_t * obj)
+{
+	ecds_render_receiver_t * receiver = (ecds_render_receiver_t *)obj;
+
+#ifdef ECDS_RENDER_STREAM_SOCKETS
+	if (receiver->socket >= 0)
+		close(receiver->socket);
+	if (receiver->listen_socket >= 0)
+		close(receiver->listen_socket);
+#endif
+
+	_ecds_render_bytes_free(&receiver->old_buffer);
+	_ecds_render_bytes_free(&receiver->old_offsets);
+	_ecds_render_bytes_free(&receiver->instruction);
+	_ecds_render_bytes_free(&receiver->received);
+
+	ecds_object_unref(ECDS_OBJECT(receiver->target));
+}
+
+ecds_render_receiver_t * ecds_render_receiver_new(ecds_renderer_t * target)
+{
+	ecds_render_receiver_t * receiver;
+
+	if (!target)
+		/* Invalid argument */
+		return NULL;
+
+	receiver = (ecds_render_receiver_t *)ecds_object_new(NULL, sizeof(ecds_render_receiver_t), ECDS_TYPE_RENDER_RECEIVER);
+	if (!receiver)
+		return NULL;
+
+	receiver->obj.dispose = _ecds_render_receiver_dispose;
+	receiver->socket = -1;
+	receiver->listen_socket = -1;
+	receiver->target = target;
+	ecds_object_ref(ECDS_OBJECT(target));
+
+	return receiver;
+}
+
+void ecds_render_receiver_get_stats(ecds_render_receiver_t * receiver, ecds_render_receiver_stats_t * stats)
+{
+	if (!stats)
+		return;
+
+	if (receiver)
+		*stats = receiver->stats;
+	else
+		memset(stats, 0, sizeof(ecds_render_receiver_stats_t));
+}
+
+//=================================== 8< ====================================//
+//	Unix domain socket transport											 //
+//===========================================================================//
+
+#ifdef ECDS_RENDER_STREAM_SOCKETS
+
+static bool _ecds_render_socket_address(struct sockaddr_un * address, const char * path)
+{
+	if (!path || strlen(path) >= sizeof(address->sun_path))
+	{
+		ecds_log_error("Socket path %s is too long", path ? path : "(null)");
+		return false;
+	}
+
+	memset(address, 0, sizeof(struct sockaddr_un));
+	address->sun_family = AF_UNIX;
+	strcpy(address->sun_path, path);
+
+	return true;
+}
+
+int ecds_render_sender_connect(ecds_render_sender_t * sender, const char * path)
+{
+	struct sockaddr_un address;
+	int fd;
+
+	if (!sender || !_ecds_render_socket_address(&address, path))
+		return -1;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+	{
+		ecds_log_error("Could not connect to %s: %s", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	if (sender->socket >= 0)
+		close(sender->socket);
+	sender->socket = fd;
+
+	/* A new receiver has none of the buffers yet */
+	sender->frame_number = 0;
+
+	return 0;
+}
+
+int ecds_render_sender_send_frame(ecds_render_sender_t * sender)
+{
+	uint8_t prefix[4];
+	const uint8_t * data;
+	size_t remaining, length;
+	int ret;
+
+	if (!sender || sender->socket < 0)
+		return -1;
+
+	if ((ret = _ecds_render_sender_encode(sender)) < 0)
+		return ret;
+
+	length = sender->frame.length;
+	prefix[0] = (uint8_t)length;
+	prefix[1] = (uint8_t)(length >> 8);
+	prefix[2] = (uint8_t)(length >> 16);
+	prefix[3] = (uint8_t)(length >> 24);
+
+	for (int part = 0; part < 2; part++)
+	{
+		data = part ? sender->frame.data : prefix;
+		remaining = part ? length : sizeof(prefix);
+
+		while (remaining)
+		{
+			ssize_t sent = send(sender->socket, data, remaining, MSG_NOSIGNAL);
+
+			if (sent < 0 && errno == EINTR)
+				continue;
+			if (sent <= 0)
+			{
+				ecds_log_error("Could not send render frame: %s", strerror(errno));
+				close(sender->socket);
+				sender->socket = -1;
+				return -1;
+			}
+
+			data += sent;
+			remaining -= (size_t)sent;
+		}
+	}
+
+	return ret;
+}
+
+int ecds_render_receiver_listen(ecds_render_receiver_t * receiver, const char * path)
+{
+	struct sockaddr_un address;
+	int fd;
+
+	if (!receiver || !_ecds_render_socket_address(&address, path))
+		return -1;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return -1;
+
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 1) < 0)
+	{
+		ecds_log_error("Could not listen on %s: %s", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	if (receiver->listen_socket >= 0)
+		close(receiver->listen_socket);
+	receiver->listen_socket = fd;
+
+	return 0;
+}
+
+/* Apply every complete frame in the receive buffer */
+static int _ecds_render_receiver_consume(ecds_render_receiver_t * receiver)
+{
+	ecds_render_bytes_t * received = &receiver->received;
+	size_t offset = 0, length;
+	int frames = 0;
+
+	while (received->length - offset >= 4)
+	{
+		const uint8_t * prefix = received->data + offset;
+
+		length = (size_t)prefix[0] | (size_t)prefix[1] << 8 | (size_t)prefix[2] << 16 | (size_t)prefix[3] << 24;
+		if (length > ECDS_RENDER_STREAM_MAX_FRAME)
+			return -1;
+		if (received->length - offset - 4 < length)
+			break;
+
+		if (ecds_render_receiver_apply_frame(receiver, prefix + 4, length) == 0)
+			frames++;
+		offset += 4 + length;
+	}
+
+	memmove(received->data, received->data + offset, received->length - offset);
+	received->length -= offset;
+
+	return frames;
+}
+
+int ecds_render_receiver_poll(ecds_render_receiver_t * receiver, int timeout_ms)
+{
+	struct pollfd descriptor;
+	int frames;
+
+	if (!receiver)
+		return -1;
+
+	if (receiver->socket < 0)
+	{
+		if (receiver->listen_socket < 0)
+			return -1;
+
+		descriptor.fd = receiver->listen_socket;
+		descriptor.events = POLLIN;
+		if (poll(&descriptor, 1, timeout_ms) <= 0)
+			return 0;
+		if ((receiver->socket = accept(receiver->listen_socket, NULL, NULL)) < 0)
+			return 0;
+
+		/* A new sender starts with a keyframe */
+		receiver->received.length = 0;
+	}
+
+	descriptor.fd = receiver->socket;
+	descriptor.events = POLLIN;
+	if (poll(&descriptor, 1, timeout_ms) <= 0)
+		return 0;
+
+	for (;;)
+	{
+		ssize_t count;
+
+		if (!_ecds_render_bytes_reserve(&receiver->received, 65536))
+			return -1;
+
+		count = recv(receiver->socket, receiver->received.data + receiver->received.length, receiver->received.capacity - receiver->received.length, MSG_DONTWAIT);
+		if (count > 0)
+		{
+			receiver->received.length += (size_t)count;
+			continue;
+		}
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+
+		/* The sender went away, wait for the next one */
+		close(receiver->socket);
+		receiver->socket = -1;
+		break;
+	}
+
+	if ((frames = _ecds_render_receiver_consume(receiver)) < 0)
+	{
+		ecds_log_error("Render stream out of sync, dropping the connection");
+		if (receiver->socket >= 0)
+			close(receiver->socket);
+		receiver->socket = -1;
+		receiver->received.length = 0;
+	}
+
+	return frames;
+}
+
+#else
+
+int ecds_render_sender_connect(ecds_render_sender_t * sender, const char * path)
+{
+	ecds_log_error("Unix domain sockets are not available on this platform");
+	return -1;
+}
+
+int ecds_render_sender_send_frame(ecds_render_sender_t * sender)
+{
+	return -1;
+}
+
+int ecds_render_receiver_listen(ecds_render_receiver_t * receiver, const char * path)
+{
+	ecds_log_error("Unix domain sockets are not available on this platform");
+	return -1;
+}
+
+int ecds_render_receiver_poll(ecds_render_receiver_t * receiver, int timeout_ms)
+{
+	return -1;
+}
+
+#endif /* ECDS_RENDER_STREAM_SOCKETS */
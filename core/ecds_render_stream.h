@@ -0,0 +1,159 @@
+/*****************************************************************************/
+/*	@file ecds_render_stream.h											 	 */
+/*	@brief Streaming of render buffers to remote renderers.					 */
+/*																			 */
+/*	A sender encodes the render buffers of a renderer into frames, a		 */
+/*	receiver applies those frames to another renderer, so that a display	 */
+/*	node replays exactly what was recorded elsewhere. Frames are byte		 */
+/*	strings that can travel as message payloads on the message bus, or		 */
+/*	over the built-in Unix domain socket transport.							 */
+/*																			 */
+/*	Wire format, all integers are LEB128 varints:							 */
+/*																			 */
+/*	  frame:		0xEC version vertex_format [scale] frame_number			 */
+/*					buffer_count buffer*									 */
+/*	  buffer:		buffer_id mode [keep_prefix keep_suffix]				 */
+/*					instruction_count instruction*							 */
+/*	  instruction:	opcode parameter (count << 1 | raw) data				 */
+/*																			 */
+/*	A frame only contains the buffers that changed since the previous		 */
+/*	frame. A buffer is either sent in full, or as a delta that keeps the	 */
+/*	first keep_prefix and last keep_suffix instructions the receiver		 */
+/*	already has and replaces everything in between.							 */
+/*																			 */
+/*	Vertex, shape and transform parameters are sent as count values in		 */
+/*	the vertex format of the frame, colours in quantized formats as four	 */
+/*	bytes. Everything else is sent as count raw bytes. Fixed point frames	 */
+/*	carry their scale as a little-endian double after the vertex format.	 */
+/*	Single precision vertex arrays are sent as float32 in float64 frames.	 */
+/*																			 */
+/*	The receiver has to see every frame in order; the sender can be told	 */
+/*	to send full buffers periodically so a receiver can join late.			 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_RENDER_STREAM_H
+#define _ECDS_RENDER_STREAM_H
+
+#include <ecds.h>
+
+#include <common/ecds_payload.h>
+#include <core/ecds_renderer.h>
+
+#define ECDS_TYPE_RENDER_SENDER			0x30000010
+#define ECDS_TYPE_RENDER_RECEIVER		0x30000011
+
+#define ECDS_RENDER_STREAM_VERSION		1
+
+typedef struct _ecds_render_sender_t ecds_render_sender_t;
+typedef struct _ecds_render_receiver_t ecds_render_receiver_t;
+typedef struct _ecds_render_stream_config_t ecds_render_stream_config_t;
+typedef struct _ecds_render_sender_stats_t ecds_render_sender_stats_t;
+typedef struct _ecds_render_receiver_stats_t ecds_render_receiver_stats_t;
+
+/**
+ * Encoding of vertex, shape and transform values on the wire.
+ */
+typedef enum
+{
+	ECDS_RENDER_VERTEX_FLOAT64 = 0,		//!< Lossless, 8 bytes per value
+	ECDS_RENDER_VERTEX_FLOAT32 = 1,		//!< 4 bytes per value
+	ECDS_RENDER_VERTEX_FLOAT16 = 2,		//!< 2 bytes per value, about 3 significant digits
+	ECDS_RENDER_VERTEX_FIXED = 3		//!< Rounded to 1 / fixed_point_scale, 1 to 3 bytes for typical screen coordinates
+} ecds_render_vertex_format_t;
+
+struct _ecds_render_stream_config_t {
+	ecds_render_vertex_format_t vertex_format;
+	double fixed_point_scale;			//!< Steps per unit for ECDS_RENDER_VERTEX_FIXED, 16 gives 1/16 pixel
+	bool delta_frames;					//!< Send changed buffers as deltas against what the receiver has
+	uint32_t keyframe_interval;			//!< Send every buffer in full every this many frames, 0 for never
+};
+
+struct _ecds_render_sender_stats_t {
+	uint64_t frames;
+	uint64_t bytes;						//!< Encoded bytes of all frames
+	uint64_t raw_bytes;					//!< Render buffer bytes the frames describe
+	uint32_t last_frame_bytes;
+	uint32_t max_frame_bytes;
+	uint64_t buffers_full;				//!< Buffers sent in full
+	uint64_t buffers_delta;				//!< Buffers sent as deltas
+	uint64_t buffers_skipped;			//!< Unchanged buffers that were not sent
+};
+
+struct _ecds_render_receiver_stats_t {
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t errors;					//!< Frames that could not be decoded
+};
+
+//!< Default configuration: fixed point vertices at 1/16 pixel, delta frames, a full frame every 300 frames.
+extern const ecds_render_stream_config_t ecds_render_stream_default_config;
+
+/**
+ * @brief Create a sender that encodes the buffers of a renderer.
+ * @param source The renderer whose buffers are sent. The sender holds a reference on it.
+ * @param config The encoding to use, or NULL for ecds_render_stream_default_config.
+ * @return The new sender, or NULL on failure.
+ */
+ecds_render_sender_t * ecds_render_sender_new(ecds_renderer_t * source, const ecds_render_stream_config_t * config);
+
+/**
+ * @brief Encode the buffers that changed since the previous frame, usually right after ecds_renderer_commit().
+ * @param sender The sender to act on.
+ * @return A payload holding the frame, ready to be sent as a message, or NULL on failure. The caller owns the reference.
+ */
+ecds_payload_t * ecds_render_sender_encode_frame(ecds_render_sender_t * sender);
+
+/**
+ * @brief Connect the sender to a receiver listening on a Unix domain socket.
+ * @param sender The sender to act on.
+ * @param path The path of the socket.
+ * @return 0 on success or a negative value on failure.
+ */
+int ecds_render_sender_connect(ecds_render_sender_t * sender, const char * path);
+
+/**
+ * @brief Encode a frame and send it over the connected socket.
+ * @param sender The sender to act on.
+ * @return The number of bytes of the frame on success or a negative value on failure.
+ */
+int ecds_render_sender_send_frame(ecds_render_sender_t * sender);
+
+//!< @brief Get the bandwidth counters of a sender.
+void ecds_render_sender_get_stats(ecds_render_sender_t * sender, ecds_render_sender_stats_t * stats);
+
+/**
+ * @brief Create a receiver that applies frames to a renderer.
+ * @param target The renderer to replay frames on. The receiver holds a reference on it.
+ * @return The new receiver, or NULL on failure.
+ */
+ecds_render_receiver_t * ecds_render_receiver_new(ecds_renderer_t * target);
+
+/**
+ * @brief Apply one frame to the target renderer and commit it.
+ * @param receiver The receiver to act on.
+ * @param data, length The encoded frame.
+ * @return 0 on success or a negative value if the frame could not be decoded. A broken frame may leave
+ *		   changed buffers partially updated; the next full frame repairs them.
+ */
+int ecds_render_receiver_apply_frame(ecds_render_receiver_t * receiver, const void * data, size_t length);
+
+/**
+ * @brief Listen for a sender on a Unix domain socket. An existing socket file at path is replaced.
+ * @param receiver The receiver to act on.
+ * @param path The path of the socket.
+ * @return 0 on success or a negative value on failure.
+ */
+int ecds_render_receiver_listen(ecds_render_receiver_t * receiver, const char * path);
+
+/**
+ * @brief Accept a sender and apply all frames that arrive on the socket.
+ * @param receiver The receiver to act on.
+ * @param timeout_ms Time to wait for data in milliseconds, 0 to only take what is there, negative to wait indefinitely.
+ * @return The number of frames applied, or a negative value if the connection failed.
+ */
+int ecds_render_receiver_poll(ecds_render_receiver_t * receiver, int timeout_ms);
+
+//!< @brief Get the counters of a receiver.
+void ecds_render_receiver_get_stats(ecds_render_receiver_t * receiver, ecds_render_receiver_stats_t * stats);
+
+#endif /* _ECDS_RENDER_STREAM_H */
@@ -0,0 +1,727 @@
+/*****************************************************************************/
+/*	@file ecds_renderer.c													 */
+/*	@brief ECDS geometry renderer, render buffer recording and replay.		 */
+/*																			 */
+/*	Every render buffer is one contiguous, growable block of memory. An		 */
+/*	instruction is an 8-byte header followed by its data, so recording a	 */
+/*	vertex or a colour is a single copy to the end of the block and a		 */
+/*	redraw is a linear scan without any pointer chasing.					 */
+/*																			 */
+/*****************************************************************************/
+
+#include <limits.h>
+#include <string.h>
+
+#include <core/ecds_renderer.h>
+#include <common/ecds_list.h>
+
+#define ECDS_LOG_DOMAIN "ecds-renderer"
+
+//!< Initial capacity of a render buffer in bytes.
+#define ECDS_RENDER_BUFFER_INITIAL_CAPACITY		1024
+
+//=================================== 8< ====================================//
+
+static void _ecds_render_buffer_dispose(ecds_object_t * obj)
+{
+	ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)obj;
+
+	ecds_memory_free(buffer->data);
+	buffer->data = NULL;
+}
+
+static ecds_render_buffer_t * _ecds_render_buffer_new(unsigned int id)
+{
+	ecds_render_buffer_t * buffer;
+
+	buffer = (ecds_render_buffer_t *)ecds_object_new("ecds-render-buffer", sizeof(ecds_render_buffer_t), ECDS_TYPE_RENDER_BUFFER);
+	if (!buffer)
+		return NULL;
+
+	buffer->obj.dispose = _ecds_render_buffer_dispose;
+	buffer->id = id;
+
+	return buffer;
+}
+
+static void _ecds_render_buffer_reset(ecds_render_buffer_t * buffer)
+{
+	/* Keep the memory, the buffer is usually refilled with a similar amount of instructions */
+	if (buffer->length)
+		buffer->revision++;
+	buffer->length = 0;
+	buffer->instruction_count = 0;
+	buffer->geometry_depth = 0;
+	buffer->transform_depth = 0;
+}
+
+static bool _ecds_render_buffer_reserve(ecds_render_buffer_t * buffer, size_t size)
+{
+	size_t capacity;
+	uint8_t * data;
+
+	if (buffer->length + size <= buffer->capacity)
+		return true;
+
+	capacity = buffer->capacity ? buffer->capacity : ECDS_RENDER_BUFFER_INITIAL_CAPACITY;
+	while (capacity < buffer->length + size)
+		capacity *= 2;
+
+	if (!(data = (uint8_t *)ecds_memory_alloc(capacity)))
+	{
+		ecds_log_error("Out of memory when growing render buffer %u to %zu bytes", buffer->id, capacity);
+		return false;
+	}
+
+	if (buffer->length)
+		memcpy(data, buffer->data, buffer->length);
+	ecds_memory_free(buffer->data);
+
+	buffer->data = data;
+	buffer->capacity = capacity;
+
+	return true;
+}
+
+/* Append one instruction, data may be NULL when length is 0 */
+static int _ecds_render_buffer_append(ecds_render_buffer_t * buffer, uint16_t opcode, uint16_t parameter, const void * data, uint32_t length)
+{
+	ecds_render_instruction_t * instr;
+	size_t size = ECDS_RENDER_INSTRUCTION_SIZE(length);
+
+	if (!_ecds_render_buffer_reserve(buffer, size))
+		return -1;
+
+	buffer->last_instruction = buffer->length;
+	instr = (ecds_render_instruction_t *)(buffer->data + buffer->length);
+	instr->opcode = opcode;
+	instr->parameter = parameter;
+	instr->length = length;
+	if (length)
+	{
+		memcpy(ECDS_RENDER_INSTRUCTION_DATA(instr), data, length);
+
+		/* Clear the padding so copies of the buffer do not carry stale memory */
+		memset((uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr) + length, 0, size - sizeof(ecds_render_instruction_t) - length);
+	}
+
+	buffer->length += size;
+	buffer->instruction_count++;
+	buffer->revision++;
+
+	return (int)length;
+}
+
+/* Make room for count vertices of vertex_size bytes in a vertex array. The vertex array at the end of the buffer is
+   extended when it has the same parameter, otherwise a new one is started. Returns where the vertices go. */
+static uint8_t * _ecds_render_buffer_extend_array(ecds_render_buffer_t * buffer, uint16_t parameter, size_t vertex_size, uint32_t count)
+{
+	ecds_render_instruction_t * instr;
+	size_t length = (size_t)count * vertex_size, size;
+	uint32_t old_length;
+
+	if (buffer->instruction_count)
+	{
+		instr = (ecds_render_instruction_t *)(buffer->data + buffer->last_instruction);
+		if (instr->opcode == ECDS_RENDER_PARAMETER && instr->parameter == parameter && instr->length % vertex_size == 0 &&
+			length <= UINT32_MAX - instr->length)
+		{
+			old_length = instr->length;
+			size = ECDS_RENDER_INSTRUCTION_SIZE(old_length + length) - ECDS_RENDER_INSTRUCTION_SIZE(old_length);
+			if (!_ecds_render_buffer_reserve(buffer, size))
+				return NULL;
+
+			/* The reservation may have moved the buffer */
+			instr = (ecds_render_instruction_t *)(buffer->data + buffer->last_instruction);
+			instr->length = old_length + (uint32_t)length;
+			memset((uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr) + instr->length, 0,
+				ECDS_RENDER_INSTRUCTION_SIZE(instr->length) - sizeof(ecds_render_instruction_t) - instr->length);
+
+			buffer->length += size;
+			buffer->revision++;
+
+			return (uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr) + old_length;
+		}
+	}
+
+	if (length > UINT32_MAX)
+		return NULL;
+
+	size = ECDS_RENDER_INSTRUCTION_SIZE(length);
+	if (!_ecds_render_buffer_reserve(buffer, size))
+		return NULL;
+
+	buffer->last_instruction = buffer->length;
+	instr = (ecds_render_instruction_t *)(buffer->data + buffer->length);
+	instr->opcode = ECDS_RENDER_PARAMETER;
+	instr->parameter = parameter;
+	instr->length = (uint32_t)length;
+	memset((uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr) + length, 0, size - sizeof(ecds_render_instruction_t) - length);
+
+	buffer->length += size;
+	buffer->instruction_count++;
+	buffer->revision++;
+
+	return (uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr);
+}
+
+static ecds_render_buffer_t * _ecds_renderer_find_buffer(ecds_renderer_private_t * priv, unsigned int buffer_id)
+{
+	ecds_list_item_t * i;
+
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+	{
+		ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i);
+		if (buffer->id == buffer_id)
+			return buffer;
+	}
+
+	return NULL;
+}
+
+static inline ecds_renderer_private_t * _ecds_renderer_private(ecds_renderer_t * renderer)
+{
+	return renderer ? (ecds_renderer_private_t *)renderer->process.private_data : NULL;
+}
+
+/* The buffer that is being recorded into, or NULL if there is none */
+static inline ecds_render_buffer_t * _ecds_renderer_active(ecds_renderer_t * renderer)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+
+	return priv ? priv->active : NULL;
+}
+
+//=================================== 8< ====================================//
+
+static void _ecds_renderer_private_dispose(ecds_object_t * obj)
+{
+	ecds_renderer_private_t * priv = (ecds_renderer_private_t *)obj;
+
+	ecds_list_dispose(priv->buffers);
+	ecds_object_unref(ECDS_OBJECT(priv->buffers));
+	priv->buffers = NULL;
+	priv->active = NULL;
+}
+
+void ecds_renderer_dispose_object(ecds_object_t * obj)
+{
+	ecds_renderer_t * renderer = (ecds_renderer_t *)obj;
+
+	ecds_object_unref(renderer->process.private_data);
+	renderer->process.private_data = NULL;
+}
+
+ecds_renderer_t * ecds_renderer_new(const char * name, size_t size)
+{
+	ecds_renderer_t * renderer;
+	ecds_renderer_private_t * priv;
+	int buffer_id;
+
+	if (size < sizeof(ecds_renderer_t))
+		/* Invalid argument */
+		return NULL;
+
+	renderer = (ecds_renderer_t *)ecds_object_new(name, size, ECDS_TYPE_RENDERER);
+	if (!renderer)
+		return NULL;
+
+	renderer->process.obj.dispose = ecds_renderer_dispose_object;
+
+	priv = (ecds_renderer_private_t *)ecds_object_new(NULL, sizeof(ecds_renderer_private_t), ECDS_TYPE_RENDERER);
+	if (!priv)
+	{
+		ecds_object_unref(ECDS_OBJECT(renderer));
+		return NULL;
+	}
+
+	priv->obj.dispose = _ecds_renderer_private_dispose;
+	renderer->process.private_data = ECDS_OBJECT(priv);
+
+	if (!(priv->buffers = ecds_list_new()) || (buffer_id = ecds_renderer_new_buffer(renderer)) < 0)
+	{
+		ecds_object_unref(ECDS_OBJECT(renderer));
+		return NULL;
+	}
+
+	ecds_renderer_select_buffer(renderer, (unsigned int)buffer_id);
+
+	return renderer;
+}
+
+int ecds_renderer_set_vertex_storage(ecds_renderer_t * renderer, unsigned int storage)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+
+	if (!priv || (storage != ECDS_VERTEX_STORAGE_FLOAT64 && storage != ECDS_VERTEX_STORAGE_FLOAT32))
+		return -1;
+
+	priv->vertex_storage = storage;
+
+	return 0;
+}
+
+size_t ecds_renderer_get_buffer_data(ecds_renderer_t * renderer, unsigned int buffer_id, const ecds_render_instruction_t ** data)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer;
+
+	if (!priv || !(buffer = _ecds_renderer_find_buffer(priv, buffer_id)))
+	{
+		if (data)
+			*data = NULL;
+		return 0;
+	}
+
+	if (data)
+		*data = (const ecds_render_instruction_t *)buffer->data;
+
+	return buffer->length;
+}
+
+int ecds_renderer_append_instruction(ecds_renderer_t * renderer, const ecds_render_instruction_t * instruction)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	int ret;
+
+	if (!buffer || !instruction)
+		return -1;
+
+	if ((ret = _ecds_render_buffer_append(buffer, instruction->opcode, instruction->parameter, ECDS_RENDER_INSTRUCTION_DATA(instruction), instruction->length)) < 0)
+		return ret;
+
+	/* Keep the nesting counters consistent with what the instructions describe */
+	if (instruction->opcode == ECDS_RENDER_GEOMETRY_BEGIN)
+		buffer->geometry_depth++;
+	else if (instruction->opcode == ECDS_RENDER_GEOMETRY_END && buffer->geometry_depth > 0)
+		buffer->geometry_depth--;
+	else if (instruction->opcode == ECDS_RENDER_TRANSFORM_BEGIN)
+		buffer->transform_depth++;
+	else if (instruction->opcode == ECDS_RENDER_TRANSFORM_END && buffer->transform_depth > 0)
+		buffer->transform_depth--;
+
+	return ret;
+}
+
+int ecds_renderer_commit(ecds_renderer_t * renderer)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_list_item_t * i;
+	int dirty = 0;
+
+	if (!priv)
+		return -1;
+
+	if (renderer->commit)
+		renderer->commit(renderer);
+
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+	{
+		ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i);
+
+		if (buffer->revision != buffer->committed_revision)
+			dirty++;
+		buffer->committed_revision = buffer->revision;
+	}
+
+	return dirty;
+}
+
+bool ecds_renderer_buffer_is_dirty(ecds_renderer_t * renderer, unsigned int buffer_id)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer;
+
+	if (!priv || !(buffer = _ecds_renderer_find_buffer(priv, buffer_id)))
+		return false;
+
+	return buffer->revision != buffer->committed_revision;
+}
+
+//=================================== 8< ====================================//
+
+static void _ecds_renderer_replay(ecds_renderer_t * renderer, ecds_render_buffer_t * buffer)
+{
+	ecds_render_instruction_t * instr = (ecds_render_instruction_t *)buffer->data;
+	ecds_render_instruction_t * end = (ecds_render_instruction_t *)(buffer->data + buffer->length);
+	const uint8_t * vertex;
+	double values[4];
+	float singles[3];
+	uint32_t i;
+
+	for (; instr < end; instr = ECDS_RENDER_INSTRUCTION_NEXT(instr))
+	{
+		switch (instr->opcode)
+		{
+		case ECDS_RENDER_GEOMETRY_BEGIN:
+			if (renderer->begin_geometry)
+				renderer->begin_geometry(renderer, instr->parameter);
+			break;
+
+		case ECDS_RENDER_GEOMETRY_END:
+			if (renderer->end_geometry)
+				renderer->end_geometry(renderer);
+			break;
+
+		case ECDS_RENDER_TRANSFORM_BEGIN:
+			if (renderer->begin_transform)
+				renderer->begin_transform(renderer);
+			break;
+
+		case ECDS_RENDER_TRANSFORM_END:
+			if (renderer->end_transform)
+				renderer->end_transform(renderer);
+			break;
+
+		case ECDS_RENDER_PARAMETER:
+			if (instr->parameter == ECDS_RENDER_PARAM_VERTEX && renderer->new_vertex && instr->length >= 3 * sizeof(double))
+			{
+				memcpy(values, ECDS_RENDER_INSTRUCTION_DATA(instr), 3 * sizeof(double));
+				renderer->new_vertex(renderer, values[0], values[1], values[2]);
+			}
+			else if (instr->parameter == ECDS_RENDER_PARAM_COLOUR && renderer->set_colour && instr->length >= 4 * sizeof(double))
+			{
+				memcpy(values, ECDS_RENDER_INSTRUCTION_DATA(instr), 4 * sizeof(double));
+				renderer->set_colour(renderer, values[0], values[1], values[2], values[3]);
+			}
+			else if (instr->parameter == ECDS_RENDER_PARAM_VERTEX_ARRAY && renderer->new_vertex)
+			{
+				vertex = (const uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr);
+				for (i = 0; i < instr->length / sizeof(values[0]) / 3; i++, vertex += 3 * sizeof(values[0]))
+				{
+					memcpy(values, vertex, 3 * sizeof(values[0]));
+					renderer->new_vertex(renderer, values[0], values[1], values[2]);
+				}
+			}
+			else if (instr->parameter == ECDS_RENDER_PARAM_VERTEX_ARRAY_F32 && renderer->new_vertex)
+			{
+				vertex = (const uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr);
+				for (i = 0; i < instr->length / sizeof(singles); i++, vertex += sizeof(singles))
+				{
+					memcpy(singles, vertex, sizeof(singles));
+					renderer->new_vertex(renderer, singles[0], singles[1], singles[2]);
+				}
+			}
+			/* Other parameters are left to implementations that walk the buffer on their own */
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+void ecds_renderer_redraw(ecds_renderer_t * renderer)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_list_item_t * i;
+
+	if (!priv)
+		return;
+
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+		_ecds_renderer_replay(renderer, (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i));
+}
+
+void ecds_renderer_clear_buffer(ecds_renderer_t * renderer, unsigned int buffer_id)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer;
+	ecds_list_item_t * i;
+
+	if (!priv)
+		return;
+
+	if (buffer_id != 0)
+	{
+		if ((buffer = _ecds_renderer_find_buffer(priv, buffer_id)))
+			_ecds_render_buffer_reset(buffer);
+		return;
+	}
+
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+		_ecds_render_buffer_reset((ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i));
+}
+
+int ecds_renderer_new_buffer(ecds_renderer_t* renderer)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer;
+
+	if (!priv)
+		return -1;
+
+	/* Buffer ID 0 means all buffers, so the first buffer gets ID 1 */
+	if (!(buffer = _ecds_render_buffer_new(++priv->next_buffer_id)))
+		return -1;
+
+	ecds_list_add_item(priv->buffers, ECDS_OBJECT(buffer));
+	ecds_object_unref(ECDS_OBJECT(buffer));
+
+	return (int)buffer->id;
+}
+
+int ecds_renderer_select_buffer(ecds_renderer_t* renderer, unsigned int buffer_id)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer;
+
+	if (!priv || !(buffer = _ecds_renderer_find_buffer(priv, buffer_id)))
+		return -1;
+
+	priv->active = buffer;
+	priv->active_buffer = buffer_id;
+
+	return (int)buffer_id;
+}
+
+int ecds_renderer_begin_geometry(ecds_renderer_t* renderer, unsigned int draw_mode)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || _ecds_render_buffer_append(buffer, ECDS_RENDER_GEOMETRY_BEGIN, (uint16_t)draw_mode, NULL, 0) < 0)
+		return -1;
+
+	return ++buffer->geometry_depth;
+}
+
+int ecds_renderer_end_geometry(ecds_renderer_t* renderer)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || buffer->geometry_depth == 0)
+		return -1;
+
+	if (_ecds_render_buffer_append(buffer, ECDS_RENDER_GEOMETRY_END, 0, NULL, 0) < 0)
+		return -1;
+
+	return --buffer->geometry_depth;
+}
+
+int ecds_renderer_begin_transform(ecds_renderer_t* renderer, unsigned int transform_mode)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || _ecds_render_buffer_append(buffer, ECDS_RENDER_TRANSFORM_BEGIN, (uint16_t)transform_mode, NULL, 0) < 0)
+		return -1;
+
+	return ++buffer->transform_depth;
+}
+
+int ecds_renderer_end_transform(ecds_renderer_t* renderer)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || buffer->transform_depth == 0)
+		return -1;
+
+	if (_ecds_render_buffer_append(buffer, ECDS_RENDER_TRANSFORM_END, 0, NULL, 0) < 0)
+		return -1;
+
+	return --buffer->transform_depth;
+}
+
+int ecds_renderer_copy_buffer(ecds_renderer_t* renderer, unsigned int* buffer_length, ecds_render_instruction_t* target)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	unsigned int available;
+
+	if (!buffer || !buffer_length)
+		return -1;
+
+	available = *buffer_length;
+	*buffer_length = (unsigned int)buffer->length;
+
+	if (!target)
+		return 0;
+
+	if (available < buffer->length)
+		return -1;
+
+	memcpy(target, buffer->data, buffer->length);
+
+	return (int)buffer->length;
+}
+
+int ecds_renderer_parameter(
+			ecds_renderer_t * renderer,
+			int parameter_number,
+			int parameter_length,
+			void * parameter_data)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || parameter_number < 0 || parameter_number > UINT16_MAX || parameter_length < 0 || (parameter_length && !parameter_data))
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, (uint16_t)parameter_number, parameter_data, (uint32_t)parameter_length);
+}
+
+//=================================== 8< ====================================//
+
+int ecds_renderer_add_vertex(ecds_renderer_t* renderer, double x, double y, double z)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	double values[3] = { x, y, z };
+	float singles[3] = { (float)x, (float)y, (float)z };
+	uint8_t * target;
+
+	if (!buffer)
+		return -1;
+
+	if (priv->vertex_storage == ECDS_VERTEX_STORAGE_FLOAT64)
+		return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_VERTEX, values, sizeof(values));
+
+	if (!(target = _ecds_render_buffer_extend_array(buffer, ECDS_RENDER_PARAM_VERTEX_ARRAY_F32, sizeof(singles), 1)))
+		return -1;
+
+	memcpy(target, singles, sizeof(singles));
+
+	return (int)sizeof(singles);
+}
+
+//!< Vertices converted per vertex array extension, bounds the size of a single instruction.
+#define ECDS_RENDER_VERTEX_BATCH		65536
+
+/* Record count vertices whose coordinates are found every stride values from x, y and z. The source is an array of
+   floats when single is set, of doubles otherwise. z may be NULL. */
+static int _ecds_renderer_add_vertices(ecds_renderer_t * renderer, const void * x, const void * y, const void * z, size_t stride, bool single, size_t count)
+{
+	ecds_renderer_private_t * priv = _ecds_renderer_private(renderer);
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	bool store_single;
+	size_t done, batch, i, at;
+	uint8_t * target;
+	double values[3];
+	float singles[3];
+
+	if (!buffer || !x || !y || count > INT_MAX)
+		return -1;
+
+	store_single = priv->vertex_storage == ECDS_VERTEX_STORAGE_FLOAT32;
+
+	for (done = 0; done < count; done += batch)
+	{
+		batch = count - done < ECDS_RENDER_VERTEX_BATCH ? count - done : ECDS_RENDER_VERTEX_BATCH;
+
+		if (store_single)
+			target = _ecds_render_buffer_extend_array(buffer, ECDS_RENDER_PARAM_VERTEX_ARRAY_F32, sizeof(singles), (uint32_t)batch);
+		else
+			target = _ecds_render_buffer_extend_array(buffer, ECDS_RENDER_PARAM_VERTEX_ARRAY, sizeof(values), (uint32_t)batch);
+		if (!target)
+			return -1;
+
+		for (i = 0, at = done * stride; i < batch; i++, at += stride)
+		{
+			if (single)
+			{
+				values[0] = ((const float *)x)[at];
+				values[1] = ((const float *)y)[at];
+				values[2] = z ? ((const float *)z)[at] : 0.0;
+			}
+			else
+			{
+				values[0] = ((const double *)x)[at];
+				values[1] = ((const double *)y)[at];
+				values[2] = z ? ((const double *)z)[at] : 0.0;
+			}
+
+			if (store_single)
+			{
+				singles[0] = (float)values[0];
+				singles[1] = (float)values[1];
+				singles[2] = (float)values[2];
+				memcpy(target, singles, sizeof(singles));
+				target += sizeof(singles);
+			}
+			else
+			{
+				memcpy(target, values, sizeof(values));
+				target += sizeof(values);
+			}
+		}
+	}
+
+	return (int)count;
+}
+
+int ecds_renderer_add_vertices(ecds_renderer_t * renderer, const double * vertices, size_t count)
+{
+	if (!vertices)
+		return -1;
+
+	return _ecds_renderer_add_vertices(renderer, vertices, vertices + 1, vertices + 2, 3, false, count);
+}
+
+int ecds_renderer_add_vertices_f32(ecds_renderer_t * renderer, const float * vertices, size_t count)
+{
+	if (!vertices)
+		return -1;
+
+	return _ecds_renderer_add_vertices(renderer, vertices, vertices + 1, vertices + 2, 3, true, count);
+}
+
+int ecds_renderer_add_vertices_soa(ecds_renderer_t * renderer, const double * x, const double * y, const double * z, size_t count)
+{
+	return _ecds_renderer_add_vertices(renderer, x, y, z, 1, false, count);
+}
+
+int ecds_renderer_add_vertices_soa_f32(ecds_renderer_t * renderer, const float * x, const float * y, const float * z, size_t count)
+{
+	return _ecds_renderer_add_vertices(renderer, x, y, z, 1, true, count);
+}
+
+int ecds_renderer_rectangle(ecds_renderer_t* renderer, double width, double height)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	double values[2] = { width, height };
+
+	if (!buffer)
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_RECTANGLE, values, sizeof(values));
+}
+
+int ecds_renderer_ellipse(ecds_renderer_t* renderer, double width, double height)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	double values[2] = { width, height };
+
+	if (!buffer)
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_ELLIPSE, values, sizeof(values));
+}
+
+int ecds_renderer_arc(ecds_renderer_t* renderer, double width, double height, double start_angle, double end_angle)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	double values[4] = { width, height, start_angle, end_angle };
+
+	if (!buffer)
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_ARC, values, sizeof(values));
+}
+
+int ecds_renderer_text(ecds_renderer_t* renderer, const char * text)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+
+	if (!buffer || !text)
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_TEXT, text, (uint32_t)strlen(text) + 1);
+}
+
+int ecds_renderer_set_colour(ecds_renderer_t* renderer, double alpha, double red, double green, double blue)
+{
+	ecds_render_buffer_t * buffer = _ecds_renderer_active(renderer);
+	double values[4] = { alpha, red, green, blue };
+
+	if (!buffer)
+		return -1;
+
+	return _ecds_render_buffer_append(buffer, ECDS_RENDER_PARAMETER, ECDS_RENDER_PARAM_COLOUR, values, sizeof(values));
+}
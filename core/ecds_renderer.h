@@ -18,13 +18,32 @@
 
 #include <core/ecds_process.h>
 typedef struct _ecds_render_instruction_t ecds_render_instruction_t;
+typedef struct _ecds_render_buffer_t ecds_render_buffer_t;
 
-struct _ecds_render_buffer_entry_t {
-	unsigned int	opcode;		//!< Instruction opcode, for the definition of those constants, see below.
-	unsigned int	length;		//!< Length of render buffer entry in bytes
-	void * data;				//!< User data belonging to instruction
+#define ECDS_TYPE_RENDERER				0x30000000
+#define ECDS_TYPE_RENDER_BUFFER			0x30000001
+
+/**
+ * Header of a single instruction in a render buffer. A render buffer is one contiguous block of
+ * memory in which every instruction header is directly followed by its data, padded so that the
+ * next header starts on an 8-byte boundary. Walking a buffer is a linear scan with
+ * ECDS_RENDER_INSTRUCTION_NEXT(), and the whole buffer can be copied or sent as is.
+ */
+struct _ecds_render_instruction_t {
+	uint16_t opcode;			//!< Instruction opcode, for the definition of those constants, see below.
+	uint16_t parameter;			//!< Parameter number for ECDS_RENDER_PARAMETER, mode for the begin instructions
+	uint32_t length;			//!< Length of the instruction data in bytes, excluding header and padding
 };
 
+//!< Size of an instruction including its header and padding.
+#define ECDS_RENDER_INSTRUCTION_SIZE(length)	(sizeof(ecds_render_instruction_t) + (((length) + 7u) & ~(size_t)7u))
+
+//!< Pointer to the data following an instruction header.
+#define ECDS_RENDER_INSTRUCTION_DATA(instr)		((void *)((ecds_render_instruction_t *)(instr) + 1))
+
+//!< Pointer to the instruction following an instruction header.
+#define ECDS_RENDER_INSTRUCTION_NEXT(instr)		((ecds_render_instruction_t *)((uint8_t *)(instr) + ECDS_RENDER_INSTRUCTION_SIZE((instr)->length)))
+
 typedef struct _ecds_renderer_t ecds_renderer_t;
 typedef struct _ecds_renderer_private_t ecds_renderer_private_t;
 
@@ -39,6 +58,9 @@ struct _ecds_renderer_t {
 	int (*end_transform)(ecds_renderer_t* renderer);								//!< glPopMatrix()
 	int (*new_vertex)(ecds_renderer_t* renderer, double x, double y, double z);
 	int (*set_colour)(ecds_renderer_t* renderer, double a, double r, double g, double b);
+
+	//!< Called by ecds_renderer_commit() before the changed buffers are marked clean, may be NULL.
+	int (*commit)(ecds_renderer_t* renderer);
 };
 
 struct _ecds_renderer_private_t {
@@ -46,6 +68,24 @@ struct _ecds_renderer_private_t {
 
 	ecds_list_t* buffers;
 	unsigned int active_buffer;
+	ecds_render_buffer_t * active;		//!< The buffer with ID active_buffer, instructions are appended to it
+	unsigned int next_buffer_id;
+	unsigned int vertex_storage;		//!< One of the ECDS_VERTEX_STORAGE constants
+};
+
+struct _ecds_render_buffer_t {
+	ecds_object_t obj;
+
+	unsigned int id;
+	uint8_t * data;					//!< Instructions, back to back
+	size_t length;					//!< Bytes in use
+	size_t capacity;				//!< Bytes allocated, grows by doubling
+	uint32_t instruction_count;
+	size_t last_instruction;		//!< Offset of the last instruction, valid while instruction_count is not 0
+	uint32_t revision;				//!< Incremented on every change, lets implementations cache what they made of the buffer
+	uint32_t committed_revision;	//!< Revision at the last commit, the buffer is dirty while they differ
+	int geometry_depth;				//!< Number of geometry chains that are open
+	int transform_depth;			//!< Number of transforms that are open
 };
 
 
@@ -75,9 +115,98 @@ struct _ecds_renderer_private_t {
 #define ECDS_RENDER_COMMIT				254
 #define ECDS_RENDER_CLEAR				255
 
+//===========================================================================//
+//	Parameter numbers for ECDS_RENDER_PARAMETER								 //
+//===========================================================================//
+#define ECDS_RENDER_PARAM_VERTEX		1		//!< double x, y, z
+#define ECDS_RENDER_PARAM_COLOUR		2		//!< double alpha, red, green, blue
+#define ECDS_RENDER_PARAM_RECTANGLE		3		//!< double width, height
+#define ECDS_RENDER_PARAM_ELLIPSE		4		//!< double width, height
+#define ECDS_RENDER_PARAM_ARC			5		//!< double width, height, start_angle, end_angle
+#define ECDS_RENDER_PARAM_TEXT			6		//!< NUL-terminated string
+#define ECDS_RENDER_PARAM_TRANSFORM		7		//!< double values for the transform that is open
+#define ECDS_RENDER_PARAM_VERTEX_ARRAY	8		//!< double x, y, z for each of length / 24 vertices
+#define ECDS_RENDER_PARAM_VERTEX_ARRAY_F32	9	//!< float x, y, z for each of length / 12 vertices
+#define ECDS_RENDER_PARAM_USER			0x100	//!< First parameter number free for implementations
+
+//===========================================================================//
+//	Transform mode constants												 //
+//===========================================================================//
+#define ECDS_TRANSFORM_NONE				0		//!< Only save and restore the current transform
+#define ECDS_TRANSFORM_TRANSLATE		1		//!< ECDS_RENDER_PARAM_TRANSFORM: double x, y, z
+#define ECDS_TRANSFORM_ROTATE			2		//!< ECDS_RENDER_PARAM_TRANSFORM: double angle, x, y, z
+#define ECDS_TRANSFORM_SCALE			3		//!< ECDS_RENDER_PARAM_TRANSFORM: double x, y, z
+
+//===========================================================================//
+//	Vertex storage constants												 //
+//===========================================================================//
+#define ECDS_VERTEX_STORAGE_FLOAT64		0		//!< Vertices are recorded as doubles, one instruction per ecds_renderer_add_vertex()
+#define ECDS_VERTEX_STORAGE_FLOAT32		1		//!< Vertices are recorded as floats, consecutive vertices share one vertex array
+
 //===========================================================================//
 //	Immediate mode interaction functions									 //
 //===========================================================================//
+/*	Recording instructions is not thread-safe: a renderer is filled by one	 */
+/*	thread at a time, usually the process that owns it.						 */
+/*===========================================================================*/
+/**
+ * @brief Allocate a renderer object with its private data and a first, selected render buffer.
+ *		  Renderer implementations call this from their constructor and fill in the callbacks.
+ * @param name The name for the new renderer.
+ * @param size The size of the implementation's renderer structure, at least sizeof(ecds_renderer_t).
+ * @return The new renderer, or NULL if the allocation failed.
+ */
+ecds_renderer_t * ecds_renderer_new(const char * name, size_t size);
+
+/**
+ * @brief Choose how vertices are stored in the render buffers from now on. Float storage halves the memory taken
+ *		  by geometry and keeps the values in the precision rasterizers work in; vertices that were already recorded
+ *		  are not converted.
+ * @param renderer The renderer to act on.
+ * @param storage One of the ECDS_VERTEX_STORAGE constants.
+ * @return 0 on success or a negative value if the storage is not known.
+ */
+int ecds_renderer_set_vertex_storage(ecds_renderer_t * renderer, unsigned int storage);
+
+/**
+ * @brief Get the instructions recorded in a render buffer, for implementations that interpret them on their own.
+ * @param renderer The renderer to act on.
+ * @param buffer_id The buffer ID to inspect.
+ * @param data Receives a pointer to the first instruction. The pointer is valid until the buffer is modified.
+ * @return The length of the buffer in bytes, 0 if it is empty or does not exist.
+ */
+size_t ecds_renderer_get_buffer_data(ecds_renderer_t * renderer, unsigned int buffer_id, const ecds_render_instruction_t ** data);
+
+/**
+ * @brief Append a copy of an encoded instruction to the active buffer, for example one received from a remote renderer.
+ * @param renderer The renderer to act on.
+ * @param instruction The instruction header, followed by instruction->length bytes of data.
+ * @return The number of data bytes copied on success or a negative value on failure.
+ */
+int ecds_renderer_append_instruction(ecds_renderer_t * renderer, const ecds_render_instruction_t * instruction);
+
+/**
+ * @brief Mark the end of a frame. The renderer's commit callback processes the buffers that changed since the
+ *		  previous commit, then all buffers are marked clean.
+ * @param renderer The renderer to act on.
+ * @return The number of buffers that changed since the previous commit, or a negative value on failure.
+ */
+int ecds_renderer_commit(ecds_renderer_t * renderer);
+
+/**
+ * @brief Check whether a buffer changed since the last commit.
+ * @param renderer The renderer to act on.
+ * @param buffer_id The buffer ID to check.
+ * @return true if the buffer exists and changed since the last commit.
+ */
+bool ecds_renderer_buffer_is_dirty(ecds_renderer_t * renderer, unsigned int buffer_id);
+
+/**
+ * @brief Release the private data of a renderer. Implementations that install their own destructor call this from it.
+ * @param obj The renderer that is being disposed.
+ */
+void ecds_renderer_dispose_object(ecds_object_t * obj);
+
 /**
  * @brief Forcibly re-draw all geometry that exists in memory.
  */
@@ -135,6 +264,13 @@ int ecds_renderer_begin_transform(ecds_renderer_t* renderer, unsigned int transf
  */
 int ecds_renderer_end_transform(ecds_renderer_t* renderer);
 
+/**
+ * @brief Copy the instructions of the active buffer into memory provided by the caller.
+ * @param renderer The renderer to act on.
+ * @param buffer_length In: the number of bytes available at target. Out: the length of the active buffer.
+ * @param target The memory to copy to, or NULL to only query the length.
+ * @return The number of bytes copied on success or a negative value if target is too small.
+ */
 int ecds_renderer_copy_buffer(ecds_renderer_t* renderer, unsigned int* buffer_length, ecds_render_instruction_t* target);
 /**
  * @brief Generic parameter passing function.
@@ -161,6 +297,31 @@ int ecds_renderer_parameter(
  */
 int ecds_renderer_add_vertex(ecds_renderer_t* renderer, double x, double y, double z);
 
+/**
+ * @brief Add a batch of vertices stored as x, y, z triplets. The batch is recorded as one vertex array in the
+ *		  storage format of the renderer, and is merged with a vertex array that directly precedes it.
+ * @param renderer The renderer to act on.
+ * @param vertices count * 3 values.
+ * @param count The number of vertices.
+ * @return The number of vertices added on success or a negative value on failure.
+ */
+int ecds_renderer_add_vertices(ecds_renderer_t * renderer, const double * vertices, size_t count);
+
+//!< @brief Same as ecds_renderer_add_vertices() for single precision input.
+int ecds_renderer_add_vertices_f32(ecds_renderer_t * renderer, const float * vertices, size_t count);
+
+/**
+ * @brief Add a batch of vertices stored as separate arrays of coordinates.
+ * @param renderer The renderer to act on.
+ * @param x, y, z count values each, z may be NULL for flat geometry at z = 0.
+ * @param count The number of vertices.
+ * @return The number of vertices added on success or a negative value on failure.
+ */
+int ecds_renderer_add_vertices_soa(ecds_renderer_t * renderer, const double * x, const double * y, const double * z, size_t count);
+
+//!< @brief Same as ecds_renderer_add_vertices_soa() for single precision input.
+int ecds_renderer_add_vertices_soa_f32(ecds_renderer_t * renderer, const float * x, const float * y, const float * z, size_t count);
+
 /**
  * @brief Add a rectangle to the active rendering buffer with a given width and height.
  */
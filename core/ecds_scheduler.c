@@ -0,0 +1,624 @@
+/*****************************************************************************/
+/*	@file ecds_scheduler.c													 */
+/*	@brief ECDS cyclic process scheduler									 */
+/*																			 */
+/*	Every worker thread always runs the process with the earliest deadline	 */
+/*	among the processes placed on it. It sleeps with clock_nanosleep() on	 */
+/*	absolute CLOCK_MONOTONIC deadlines, so the time spent between reading	 */
+/*	the clock and going to sleep does not add up. Long sleeps are cut into	 */
+/*	slices so that new, moved and removed processes and disposal are picked */
+/*	up without a wakeup mechanism.											 */
+/*																			 */
+/*	Only the worker that owns a process calls its callbacks, and it does so */
+/*	without holding the scheduler mutex, so callbacks may add, move or		 */
+/*	remove processes. Ownership only changes hands on the owning worker,	 */
+/*	which is what keeps a process from ever running on two workers at once. */
+/*																			 */
+/*****************************************************************************/
+
+#ifdef __linux__
+	#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+#include <sched.h>
+
+#include <ecds.h>
+#include <common/ecds_link.h>
+#include <common/ecds_log.h>
+
+#include <core/ecds_atom.h>
+#include <core/ecds_scheduler.h>
+
+#define ECDS_LOG_DOMAIN "ecds-scheduler"
+
+//!<	Longest time a worker sleeps before checking for changes.
+#define ECDS_SCHEDULER_SLICE_NS		10000000ull
+
+//!<	Length of the window worker load is measured over.
+#define ECDS_SCHEDULER_LOAD_WINDOW_NS	1000000000ull
+
+typedef enum
+{
+	ECDS_SCHEDULER_ENTRY_NEW = 0,		//!<	Waiting to be initialized
+	ECDS_SCHEDULER_ENTRY_ACTIVE = 1,
+	ECDS_SCHEDULER_ENTRY_MOVING = 2,	//!<	Waiting to be handed to target_worker
+	ECDS_SCHEDULER_ENTRY_REMOVING = 3	//!<	Waiting to be shut down and removed
+} ecds_scheduler_entry_state_t;
+
+typedef struct _ecds_scheduler_entry_t ecds_scheduler_entry_t;
+typedef struct _ecds_scheduler_worker_t ecds_scheduler_worker_t;
+
+struct _ecds_scheduler_entry_t {
+	ecds_object_t obj;
+	ecds_link_t link;					//!<	Position in the entries of the scheduler
+	ecds_process_t * proc;
+	ecds_scheduler_entry_state_t state;
+	bool initialized;					//!<	Only accessed by the owning worker
+	int target_worker;					//!<	Worker to hand the process to when moving
+
+	uint64_t deadline_ns;				//!<	Absolute time the next frame is due
+	uint64_t jitter_total_ns;
+	ecds_scheduler_stats_t stats;		//!<	stats.worker is the owning worker
+};
+
+struct _ecds_scheduler_worker_t {
+	ecds_scheduler_t * sched;
+	int index;
+	ecds_scheduler_worker_config_t config;
+
+	uint64_t window_start_ns;
+	uint64_t window_busy_ns;
+	ecds_scheduler_worker_stats_t stats;
+
+	pthread_t worker_thread[1];
+};
+
+struct _ecds_scheduler_t {
+	ecds_process_t proc;
+
+	ecds_link_list_t entries;			//!<	Links of all ecds_scheduler_entry_t
+	bool running;
+
+	uint32_t worker_count;
+	ecds_scheduler_worker_t * workers;
+
+	pthread_mutex_t scheduler_mutex[1];	//!<	Protects the entries and worker stats, never held during callbacks
+	pthread_cond_t removed_cond[1];		//!<	Signalled when a worker removed an entry
+};
+
+static uint64_t _scheduler_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void _scheduler_sleep_until(uint64_t deadline_ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+	ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+static ecds_scheduler_entry_t * _scheduler_find(ecds_scheduler_t * sched, ecds_process_t * proc)
+{
+	for (ecds_link_t * iter = ecds_link_list_first(&sched->entries); iter; iter = ecds_link_next(iter))
+	{
+		ecds_scheduler_entry_t * entry = ECDS_LINK_CONTAINER(iter, ecds_scheduler_entry_t, link);
+		if (entry->proc == proc)
+			return entry;
+	}
+
+	return NULL;
+}
+
+//=================================== 8< ====================================//
+//							  WORKER THREAD SETUP							 //
+//===========================================================================//
+static int _worker_apply_affinity(ecds_scheduler_worker_t * worker)
+{
+	if (worker->config.cpu < 0)
+		return -1;
+
+#ifdef __linux__
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(worker->config.cpu, &cpus);
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) != 0)
+	{
+		ecds_log_warning("Unable to pin scheduler worker %d to CPU %d, leaving it floating", worker->index, worker->config.cpu);
+		return -1;
+	}
+
+	return worker->config.cpu;
+#else
+	ecds_log_warning("CPU affinity is not supported on this platform, scheduler worker %d is floating", worker->index);
+	return -1;
+#endif
+}
+
+static ecds_scheduler_class_t _worker_apply_priority(ecds_scheduler_worker_t * worker)
+{
+	struct sched_param param;
+
+	memset(&param, 0, sizeof(param));
+
+	switch (worker->config.priority_class)
+	{
+	case ECDS_SCHEDULER_CLASS_REALTIME:
+		param.sched_priority = worker->config.priority;
+		if (param.sched_priority < sched_get_priority_min(SCHED_FIFO))
+			param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+		if (param.sched_priority > sched_get_priority_max(SCHED_FIFO))
+			param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+		{
+			/* Usually missing privileges (CAP_SYS_NICE or an rtprio limit) */
+			ecds_log_warning("Unable to give scheduler worker %d real-time priority, using normal priority", worker->index);
+			return ECDS_SCHEDULER_CLASS_NORMAL;
+		}
+		break;
+
+	case ECDS_SCHEDULER_CLASS_BACKGROUND:
+#ifdef SCHED_IDLE
+		if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0)
+			break;
+#endif
+		ecds_log_warning("Background priority is not available, scheduler worker %d uses normal priority", worker->index);
+		return ECDS_SCHEDULER_CLASS_NORMAL;
+
+	default:
+		break;
+	}
+
+	return worker->config.priority_class;
+}
+
+//=================================== 8< ====================================//
+//								 WORKER LOOP								 //
+//===========================================================================//
+static void _worker_run_frame(ecds_scheduler_worker_t * worker, ecds_scheduler_entry_t * entry, uint64_t now)
+{
+	ecds_scheduler_t * sched = worker->sched;
+	uint64_t jitter = now - entry->deadline_ns;
+	uint64_t next_deadline;
+	uint64_t end;
+
+	if (entry->proc->run)
+		entry->proc->run(entry->proc);
+	end = _scheduler_now();
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+
+	entry->stats.frames++;
+	entry->stats.jitter_last_ns = jitter;
+	if (jitter > entry->stats.jitter_max_ns)
+		entry->stats.jitter_max_ns = jitter;
+	entry->jitter_total_ns += jitter;
+	entry->stats.jitter_mean_ns = entry->jitter_total_ns / entry->stats.frames;
+
+	entry->stats.run_time_last_ns = end - now;
+	if (end - now > entry->stats.run_time_max_ns)
+		entry->stats.run_time_max_ns = end - now;
+
+	worker->stats.frames++;
+	worker->stats.busy_ns += end - now;
+	worker->window_busy_ns += end - now;
+
+	/* Advance by exactly one period, so the schedule does not drift */
+	next_deadline = entry->deadline_ns + entry->stats.period_ns;
+
+	if (end > next_deadline)
+	{
+		entry->stats.overruns++;
+		worker->stats.overruns++;
+
+		/* The next frame runs late, frames that are a full period or more behind are skipped */
+		if (end - next_deadline >= entry->stats.period_ns)
+		{
+			uint64_t skipped = (end - next_deadline) / entry->stats.period_ns;
+
+			next_deadline += skipped * entry->stats.period_ns;
+			entry->stats.missed_frames += skipped;
+		}
+	}
+
+	entry->deadline_ns = next_deadline;
+
+	pthread_mutex_unlock(sched->scheduler_mutex);
+}
+
+static void _worker_update_load(ecds_scheduler_worker_t * worker, uint64_t now)
+{
+	if (now - worker->window_start_ns < ECDS_SCHEDULER_LOAD_WINDOW_NS)
+		return;
+
+	pthread_mutex_lock(worker->sched->scheduler_mutex);
+	worker->stats.load_permille = (uint32_t)(worker->window_busy_ns * 1000 / (now - worker->window_start_ns));
+	worker->window_busy_ns = 0;
+	worker->window_start_ns = now;
+	pthread_mutex_unlock(worker->sched->scheduler_mutex);
+}
+
+static void * _worker_thread(void * arg)
+{
+	ecds_scheduler_worker_t * worker = (ecds_scheduler_worker_t *)arg;
+	ecds_scheduler_t * sched = worker->sched;
+	ecds_scheduler_entry_t * entry;
+	ecds_link_t * iter;
+	uint64_t now;
+	int cpu = _worker_apply_affinity(worker);
+	ecds_scheduler_class_t priority_class = _worker_apply_priority(worker);
+
+	/* Report what the system actually granted */
+	pthread_mutex_lock(sched->scheduler_mutex);
+	worker->stats.cpu = cpu;
+	worker->stats.priority_class = priority_class;
+	worker->window_start_ns = _scheduler_now();
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	for (;;)
+	{
+		ecds_scheduler_entry_t * next = NULL;
+		ecds_scheduler_entry_t * pending = NULL;
+		ecds_scheduler_entry_state_t pending_state = ECDS_SCHEDULER_ENTRY_ACTIVE;
+
+		pthread_mutex_lock(sched->scheduler_mutex);
+		if (!sched->running)
+		{
+			pthread_mutex_unlock(sched->scheduler_mutex);
+			break;
+		}
+
+		for (iter = ecds_link_list_first(&sched->entries); iter && !pending; iter = ecds_link_next(iter))
+		{
+			entry = ECDS_LINK_CONTAINER(iter, ecds_scheduler_entry_t, link);
+
+			if (entry->stats.worker != worker->index)
+				continue;
+
+			if (entry->state != ECDS_SCHEDULER_ENTRY_ACTIVE)
+			{
+				pending = entry;
+				pending_state = entry->state;
+			}
+			else if (!next || entry->deadline_ns < next->deadline_ns)
+				next = entry;
+		}
+
+		if (pending && pending_state == ECDS_SCHEDULER_ENTRY_MOVING)
+		{
+			/* Hand the process over, the new worker initializes it if that did not happen yet */
+			worker->stats.process_count--;
+			sched->workers[pending->target_worker].stats.process_count++;
+			pending->stats.worker = pending->target_worker;
+			pending->state = pending->initialized ? ECDS_SCHEDULER_ENTRY_ACTIVE : ECDS_SCHEDULER_ENTRY_NEW;
+			pthread_mutex_unlock(sched->scheduler_mutex);
+			continue;
+		}
+		pthread_mutex_unlock(sched->scheduler_mutex);
+
+		if (pending && pending_state == ECDS_SCHEDULER_ENTRY_NEW)
+		{
+			/* First frame is due as soon as the process is initialized */
+			if (pending->proc->initialize)
+				pending->proc->initialize(pending->proc);
+			pending->initialized = true;
+
+			pthread_mutex_lock(sched->scheduler_mutex);
+			if (pending->state == ECDS_SCHEDULER_ENTRY_NEW)
+				pending->state = ECDS_SCHEDULER_ENTRY_ACTIVE;
+			pending->deadline_ns = _scheduler_now();
+			pthread_mutex_unlock(sched->scheduler_mutex);
+			continue;
+		}
+
+		if (pending)
+		{
+			if (pending->initialized && pending->proc->shutdown)
+				pending->proc->shutdown(pending->proc);
+
+			pthread_mutex_lock(sched->scheduler_mutex);
+			ecds_link_list_remove(&pending->link);
+			worker->stats.process_count--;
+			pthread_cond_broadcast(sched->removed_cond);
+			pthread_mutex_unlock(sched->scheduler_mutex);
+
+			ecds_object_unref(ECDS_OBJECT(pending->proc));
+			ecds_memory_free(pending);
+			continue;
+		}
+
+		now = _scheduler_now();
+		_worker_update_load(worker, now);
+
+		if (!next)
+			_scheduler_sleep_until(now + ECDS_SCHEDULER_SLICE_NS);
+		else if (next->deadline_ns > now)
+			_scheduler_sleep_until(next->deadline_ns - now > ECDS_SCHEDULER_SLICE_NS ? now + ECDS_SCHEDULER_SLICE_NS : next->deadline_ns);
+		else
+			_worker_run_frame(worker, next, now);
+	}
+
+	/* Shut down every process this worker initialized */
+	pthread_mutex_lock(sched->scheduler_mutex);
+	for (;;)
+	{
+		entry = NULL;
+		for (iter = ecds_link_list_first(&sched->entries); iter; iter = ecds_link_next(iter))
+		{
+			entry = ECDS_LINK_CONTAINER(iter, ecds_scheduler_entry_t, link);
+			if (entry->stats.worker == worker->index)
+				break;
+			entry = NULL;
+		}
+
+		if (!entry)
+			break;
+
+		ecds_link_list_remove(&entry->link);
+		worker->stats.process_count--;
+		pthread_mutex_unlock(sched->scheduler_mutex);
+
+		if (entry->initialized && entry->proc->shutdown)
+			entry->proc->shutdown(entry->proc);
+
+		ecds_object_unref(ECDS_OBJECT(entry->proc));
+		ecds_memory_free(entry);
+
+		pthread_mutex_lock(sched->scheduler_mutex);
+	}
+	pthread_cond_broadcast(sched->removed_cond);
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	return NULL;
+}
+
+//=================================== 8< ====================================//
+//								 PUBLIC API									 //
+//===========================================================================//
+void ecds_scheduler_destroy(ecds_scheduler_t * sched)
+{
+	if (!sched)
+		return;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+	sched->running = false;
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	for (uint32_t i = 0; i < sched->worker_count; i++)
+		pthread_join(sched->workers[i].worker_thread[0], NULL);
+
+	/* Every worker shut down and removed its own entries before exiting */
+	ecds_memory_free(sched->workers);
+	sched->workers = NULL;
+
+	pthread_cond_destroy(sched->removed_cond);
+	pthread_mutex_destroy(sched->scheduler_mutex);
+
+	ecds_log_info("Destroyed scheduler: %s", ecds_object_get_name(ECDS_OBJECT(sched)));
+
+	/* The scheduler is unmanaged, so nobody else frees it */
+	ecds_atom_release(sched->proc.obj.name);
+	ecds_memory_free(sched);
+}
+
+ecds_object_t * ecds_scheduler_construct(const char * name)
+{
+	return ecds_scheduler_construct_with_config(name, NULL);
+}
+
+ecds_object_t * ecds_scheduler_construct_with_config(const char * name, const ecds_scheduler_config_t * config)
+{
+	static const ecds_scheduler_worker_config_t default_worker = { -1, ECDS_SCHEDULER_CLASS_NORMAL, 0 };
+	ecds_scheduler_t * ret = NULL;
+	uint32_t worker_count = (config && config->worker_count) ? config->worker_count : 1;
+
+	if (worker_count > ECDS_SCHEDULER_MAX_WORKERS)
+		worker_count = ECDS_SCHEDULER_MAX_WORKERS;
+
+	ret = (ecds_scheduler_t *)ecds_object_new(name, sizeof(ecds_scheduler_t), ECDS_SCHEDULER);
+	if (!ret)
+		return NULL;
+
+	ret->workers = (ecds_scheduler_worker_t *)ecds_memory_alloc(worker_count * sizeof(ecds_scheduler_worker_t));
+	if (!ret->workers)
+	{
+		ecds_log_error("Out of memory when allocating %u scheduler workers", worker_count);
+		ecds_atom_release(ret->proc.obj.name);
+		ecds_memory_free(ret);
+		return NULL;
+	}
+
+	ecds_link_list_initialize(&ret->entries);
+	ret->worker_count = worker_count;
+	ret->running = true;
+
+	pthread_mutex_init(ret->scheduler_mutex, 0);
+	pthread_cond_init(ret->removed_cond, 0);
+
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		ecds_scheduler_worker_t * worker = &ret->workers[i];
+
+		worker->sched = ret;
+		worker->index = (int)i;
+		worker->config = (config && config->workers) ? config->workers[i] : default_worker;
+		worker->stats.cpu = worker->config.cpu;
+		worker->stats.priority_class = worker->config.priority_class;
+
+		if (pthread_create(worker->worker_thread, 0, _worker_thread, worker) != 0)
+		{
+			ecds_log_error("Could only start %u of %u workers of scheduler %s", i, worker_count, ecds_object_get_name(ECDS_OBJECT(ret)));
+
+			/* The workers started so far have no processes yet and exit once the scheduler stops */
+			ret->worker_count = i;
+			ecds_scheduler_destroy(ret);
+			return NULL;
+		}
+	}
+
+	ecds_log_info("Constructing new scheduler: %s (%u workers)", ecds_object_get_name(ECDS_OBJECT(ret)), worker_count);
+
+	return (ecds_object_t *)ret;
+}
+
+bool ecds_scheduler_add_process(ecds_scheduler_t * sched, ecds_process_t * proc, uint64_t period_ns)
+{
+	return ecds_scheduler_add_process_on(sched, proc, period_ns, ECDS_SCHEDULER_ANY_WORKER);
+}
+
+bool ecds_scheduler_add_process_on(ecds_scheduler_t * sched, ecds_process_t * proc, uint64_t period_ns, int worker)
+{
+	ecds_scheduler_entry_t * entry = NULL;
+
+	if (!sched || !proc || period_ns == 0 || worker >= (int)sched->worker_count)
+		return false;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+
+	if (!sched->running || _scheduler_find(sched, proc))
+	{
+		pthread_mutex_unlock(sched->scheduler_mutex);
+		return false;
+	}
+
+	if (worker < 0)
+	{
+		/* Pick the worker with the lowest measured load, then the fewest processes */
+		worker = 0;
+		for (uint32_t i = 1; i < sched->worker_count; i++)
+		{
+			ecds_scheduler_worker_stats_t * candidate = &sched->workers[i].stats;
+			ecds_scheduler_worker_stats_t * best = &sched->workers[worker].stats;
+
+			if (candidate->load_permille < best->load_permille ||
+				(candidate->load_permille == best->load_permille && candidate->process_count < best->process_count))
+				worker = (int)i;
+		}
+	}
+
+	/* Entries are only ever touched by the scheduler, they do not need to be managed */
+	entry = (ecds_scheduler_entry_t *)ecds_object_new(NULL, sizeof(ecds_scheduler_entry_t), ECDS_SCHEDULER_ENTRY);
+	if (!entry)
+	{
+		pthread_mutex_unlock(sched->scheduler_mutex);
+		return false;
+	}
+
+	ecds_object_ref(ECDS_OBJECT(proc));
+	entry->proc = proc;
+	entry->state = ECDS_SCHEDULER_ENTRY_NEW;
+	entry->stats.period_ns = period_ns;
+	entry->stats.worker = worker;
+	sched->workers[worker].stats.process_count++;
+	ecds_link_list_push_back(&sched->entries, &entry->link);
+
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	ecds_log_info("Scheduling process %s every %llu us on worker %d", ECDS_OBJECT(proc)->name, (unsigned long long)(period_ns / 1000), worker);
+	return true;
+}
+
+bool ecds_scheduler_move_process(ecds_scheduler_t * sched, ecds_process_t * proc, int worker)
+{
+	ecds_scheduler_entry_t * entry = NULL;
+	bool ret = false;
+
+	if (!sched || !proc || worker < 0 || worker >= (int)sched->worker_count)
+		return false;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+
+	/* The owning worker completes the move, so the process never runs on two workers at once */
+	if ((entry = _scheduler_find(sched, proc)) && entry->state != ECDS_SCHEDULER_ENTRY_REMOVING)
+	{
+		if (entry->stats.worker != worker)
+		{
+			entry->target_worker = worker;
+			entry->state = ECDS_SCHEDULER_ENTRY_MOVING;
+		}
+		ret = true;
+	}
+
+	pthread_mutex_unlock(sched->scheduler_mutex);
+	return ret;
+}
+
+bool ecds_scheduler_remove_process(ecds_scheduler_t * sched, ecds_process_t * proc)
+{
+	ecds_scheduler_entry_t * entry = NULL;
+	bool on_worker = false;
+
+	if (!sched || !proc)
+		return false;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+
+	if (!(entry = _scheduler_find(sched, proc)))
+	{
+		pthread_mutex_unlock(sched->scheduler_mutex);
+		return false;
+	}
+
+	entry->state = ECDS_SCHEDULER_ENTRY_REMOVING;
+
+	/* A process removing itself (or another one) from a callback cannot wait for the workers */
+	for (uint32_t i = 0; i < sched->worker_count; i++)
+		on_worker |= pthread_equal(pthread_self(), sched->workers[i].worker_thread[0]) != 0;
+
+	if (!on_worker)
+	{
+		while (_scheduler_find(sched, proc))
+			pthread_cond_wait(sched->removed_cond, sched->scheduler_mutex);
+	}
+
+	pthread_mutex_unlock(sched->scheduler_mutex);
+	return true;
+}
+
+bool ecds_scheduler_get_stats(ecds_scheduler_t * sched, ecds_process_t * proc, ecds_scheduler_stats_t * stats)
+{
+	ecds_scheduler_entry_t * entry = NULL;
+
+	if (!sched || !proc || !stats)
+		return false;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+	if ((entry = _scheduler_find(sched, proc)))
+		*stats = entry->stats;
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	return entry != NULL;
+}
+
+uint32_t ecds_scheduler_get_worker_count(ecds_scheduler_t * sched)
+{
+	return sched ? sched->worker_count : 0;
+}
+
+bool ecds_scheduler_get_worker_stats(ecds_scheduler_t * sched, int worker, ecds_scheduler_worker_stats_t * stats)
+{
+	if (!sched || !stats || worker < 0 || worker >= (int)sched->worker_count)
+		return false;
+
+	pthread_mutex_lock(sched->scheduler_mutex);
+	*stats = sched->workers[worker].stats;
+	pthread_mutex_unlock(sched->scheduler_mutex);
+
+	return true;
+}
@@ -0,0 +1,166 @@
+/*****************************************************************************/
+/*	@file ecds_scheduler.h													 */
+/*	@brief ECDS cyclic process scheduler									 */
+/*																			 */
+/*	The scheduler runs registered processes at a fixed rate, for example	 */
+/*	the renderer at 60 Hz and data acquisition at 20 Hz. Every process has	 */
+/*	an absolute deadline for its next frame, which is advanced by exactly	 */
+/*	one period per frame, so timing errors never accumulate into drift.		 */
+/*																			 */
+/*	A process that is still running when its next frame is due is counted	 */
+/*	as an overrun. The frames it missed are skipped rather than run back to	 */
+/*	back, so the process stays in phase with its original schedule.		 */
+/*																			 */
+/*	Processes are placed on worker threads. Each worker can be pinned to a	 */
+/*	CPU and given a priority class, so that for example rendering runs on	 */
+/*	its own core with real-time priority while housekeeping shares a		 */
+/*	background worker. Per-worker load statistics show when processes		 */
+/*	should be moved to another worker.										 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_SCHEDULER_H
+#define _ECDS_SCHEDULER_H
+
+#include <ecds.h>
+
+#include <core/ecds_object.h>
+#include <core/ecds_process.h>
+
+#define ECDS_SCHEDULER 0xFFFFFFF9
+#define ECDS_SCHEDULER_ENTRY 0xFFFFFFA9
+
+//!<	Period in nanoseconds for a process that runs at a given rate in Hz.
+#define ECDS_SCHEDULER_HZ(rate)		(1000000000ull / (rate))
+
+//!<	Maximum number of worker threads per scheduler.
+#define ECDS_SCHEDULER_MAX_WORKERS	64
+
+//!<	Worker index that lets the scheduler pick the least loaded worker.
+#define ECDS_SCHEDULER_ANY_WORKER	(-1)
+
+typedef struct _ecds_scheduler_t ecds_scheduler_t;
+typedef struct _ecds_scheduler_stats_t ecds_scheduler_stats_t;
+typedef struct _ecds_scheduler_config_t ecds_scheduler_config_t;
+typedef struct _ecds_scheduler_worker_config_t ecds_scheduler_worker_config_t;
+typedef struct _ecds_scheduler_worker_stats_t ecds_scheduler_worker_stats_t;
+
+/**
+ * Priority class of a worker thread.
+ */
+typedef enum
+{
+	ECDS_SCHEDULER_CLASS_NORMAL = 0,		//!<	SCHED_OTHER at the default priority
+	ECDS_SCHEDULER_CLASS_REALTIME = 1,		//!<	SCHED_FIFO, falls back to SCHED_OTHER if not permitted
+	ECDS_SCHEDULER_CLASS_BACKGROUND = 2		//!<	SCHED_IDLE where available, for housekeeping
+} ecds_scheduler_class_t;
+
+struct _ecds_scheduler_worker_config_t {
+	int cpu;								//!<	CPU to pin the worker to, or -1 to let it float
+	ecds_scheduler_class_t priority_class;
+	int priority;							//!<	SCHED_FIFO priority for ECDS_SCHEDULER_CLASS_REALTIME, 0 for the minimum
+};
+
+/**
+ * Construction parameters for a scheduler.
+ */
+struct _ecds_scheduler_config_t {
+	uint32_t worker_count;								//!<	Number of worker threads, 0 for one
+	const ecds_scheduler_worker_config_t * workers;		//!<	One entry per worker, or NULL for floating normal priority workers
+};
+
+/**
+ * Load statistics of a single worker thread.
+ */
+struct _ecds_scheduler_worker_stats_t {
+	int cpu;								//!<	CPU the worker is pinned to, or -1
+	ecds_scheduler_class_t priority_class;	//!<	Priority class that is actually in effect
+	uint32_t process_count;
+	uint64_t frames;
+	uint64_t overruns;
+	uint64_t busy_ns;						//!<	Total time spent running processes
+	uint32_t load_permille;					//!<	Share of time spent running processes over the last second
+};
+
+/**
+ * Timing statistics of a single scheduled process. Jitter is the time between the deadline of
+ * a frame and the moment the process actually started running it.
+ */
+struct _ecds_scheduler_stats_t {
+	uint64_t period_ns;				//!<	Configured period of the process
+	int worker;						//!<	Index of the worker the process runs on
+	uint64_t frames;				//!<	Number of frames that were run
+	uint64_t overruns;				//!<	Number of frames that ended after the next frame was due
+	uint64_t missed_frames;			//!<	Number of frames skipped because of overruns
+	uint64_t jitter_last_ns;
+	uint64_t jitter_max_ns;
+	uint64_t jitter_mean_ns;
+	uint64_t run_time_last_ns;		//!<	Time spent in the run callback during the last frame
+	uint64_t run_time_max_ns;
+};
+
+/**
+ * @brief Construct a new scheduler with a single worker. The worker starts right away and waits for processes.
+ * @param name The name for the new scheduler.
+ */
+ecds_object_t * ecds_scheduler_construct(const char * name);
+
+/**
+ * @brief Construct a scheduler with a specific set of workers.
+ * @param name The name for the new scheduler.
+ * @param config The configuration to use, or NULL to use the defaults.
+ */
+ecds_object_t * ecds_scheduler_construct_with_config(const char * name, const ecds_scheduler_config_t * config);
+
+/**
+ * @brief Stop all workers and free the scheduler. Every scheduled process is shut down on its worker first.
+ * @param sched The scheduler to destroy, which must not be used afterwards.
+ */
+void ecds_scheduler_destroy(ecds_scheduler_t * sched);
+
+/**
+ * @brief Run a process cyclically on the least loaded worker. The process is initialized on its worker
+ *		  before its first frame, and shut down when it is removed or the scheduler is destroyed.
+ * @param sched The scheduler to add the process to.
+ * @param proc The process to run. Its run callback is called once per period.
+ * @param period_ns The period in nanoseconds, see ECDS_SCHEDULER_HZ().
+ * @return true if the process was added, false if it is already scheduled or the arguments are invalid.
+ */
+bool ecds_scheduler_add_process(ecds_scheduler_t * sched, ecds_process_t * proc, uint64_t period_ns);
+
+/**
+ * @brief Run a process cyclically on a specific worker.
+ * @param worker The index of the worker, or ECDS_SCHEDULER_ANY_WORKER.
+ * @see ecds_scheduler_add_process()
+ */
+bool ecds_scheduler_add_process_on(ecds_scheduler_t * sched, ecds_process_t * proc, uint64_t period_ns, int worker);
+
+/**
+ * @brief Move a scheduled process to another worker. The process keeps its schedule and statistics,
+ *		  and is not initialized again.
+ * @return true if the move was requested, false if the process is not scheduled or the worker does not exist.
+ */
+bool ecds_scheduler_move_process(ecds_scheduler_t * sched, ecds_process_t * proc, int worker);
+
+/**
+ * @brief Stop running a process. Returns once the process is no longer running and has been shut down.
+ * @return true if the process was removed, false if it was not scheduled.
+ */
+bool ecds_scheduler_remove_process(ecds_scheduler_t * sched, ecds_process_t * proc);
+
+/**
+ * @brief Get the timing statistics of a scheduled process.
+ * @return true if the statistics were filled in, false if the process is not scheduled.
+ */
+bool ecds_scheduler_get_stats(ecds_scheduler_t * sched, ecds_process_t * proc, ecds_scheduler_stats_t * stats);
+
+//!< @brief Get the number of worker threads of a scheduler.
+uint32_t ecds_scheduler_get_worker_count(ecds_scheduler_t * sched);
+
+/**
+ * @brief Get the load statistics of a worker thread.
+ * @return true if the statistics were filled in, false if the worker does not exist.
+ */
+bool ecds_scheduler_get_worker_stats(ecds_scheduler_t * sched, int worker, ecds_scheduler_worker_stats_t * stats);
+
+#endif /* _ECDS_SCHEDULER_H */
@@ -1,7 +1,15 @@
-
 #include <ecds.h>
 #include <common/ecds_service.h>
 #include <common/ecds_list.h>
+#include <common/ecds_atomic.h>
+
+#include <sched.h>
+#include <string.h>
+
+#define ECDS_LOG_DOMAIN "ecds-service"
+
+//!<	Handlers a dispatch collects on the stack before it allocates.
+#define ECDS_SERVICE_LOCAL_HANDLERS		16
 
 struct _ecds_service_handler_t {
 	ecds_object_t obj;
@@ -9,9 +17,47 @@ struct _ecds_service_handler_t {
 	ecds_handler_func user_function;
 };
 
-void ecds_service_dispatch_message(ecds_service_t * service, ecds_dispatcher_t * dispatcher, ecds_message_t * msg)
+/*
+ * Services are plain objects that callers allocate zero-filled, without a constructor that could
+ * initialize a mutex. The lists are only held for a few pointer updates, so a spin lock on a field
+ * that starts out as 0 is enough. No callback runs and no other lock is taken while it is held.
+ */
+static void _service_lock(ecds_service_t * service)
+{
+	while (ecds_atomic_exchange(&service->service_lock, 1))
+		sched_yield();
+}
+
+static void _service_unlock(ecds_service_t * service)
+{
+	ecds_atomic_store(&service->service_lock, 0);
+}
+
+/* Expects the service lock to be held */
+static uint32_t _service_collect_handlers(ecds_service_t * service, uint32_t event_id, ecds_handler_func * handlers, uint32_t capacity)
 {
 	ecds_list_item_t * i;
+	uint32_t count = 0;
+
+	for (i = ecds_list_first_item(service->handler_list); i; i = ecds_list_next_item(i))
+	{
+		struct _ecds_service_handler_t * handler = (struct _ecds_service_handler_t *)ecds_list_get_item(service->handler_list, i);
+		if (handler->event_id != event_id)
+			continue;
+
+		if (handlers && count < capacity)
+			handlers[count] = handler->user_function;
+		count++;
+	}
+
+	return count;
+}
+
+void ecds_service_dispatch_message(ecds_service_t * service, ecds_dispatcher_t * dispatcher, ecds_message_t * msg)
+{
+	ecds_handler_func local_handlers[ECDS_SERVICE_LOCAL_HANDLERS];
+	ecds_handler_func * handlers = local_handlers;
+	uint32_t count;
 
 	if (service == NULL)
 		/* Throw a fatal error here */
@@ -21,11 +67,110 @@ void ecds_service_dispatch_message(ecds_service_t * service, ecds_dispatcher_t *
 	if(service->dispatch)
 		service->dispatch(service, dispatcher, msg);
 
+	/* Take the handlers out first, they must be able to add handlers themselves */
+	_service_lock(service);
+	count = _service_collect_handlers(service, msg->event_id, handlers, ECDS_SERVICE_LOCAL_HANDLERS);
+	if (count > ECDS_SERVICE_LOCAL_HANDLERS && (handlers = (ecds_handler_func *)ecds_memory_alloc(count * sizeof(ecds_handler_func))))
+		_service_collect_handlers(service, msg->event_id, handlers, count);
+	_service_unlock(service);
+
+	if (!handlers)
+	{
+		/* Out of memory, run the ones we have */
+		handlers = local_handlers;
+		count = ECDS_SERVICE_LOCAL_HANDLERS;
+	}
+
 	/* Dispatch message to any appropriate listeners */
-	for (i = ecds_list_first_item(service->handler_list); i; i = ecds_list_next_item(i))
+	for (uint32_t i = 0; i < count; i++)
+		(*handlers[i])(msg->user_data_length, msg->user_data);
+
+	if (handlers != local_handlers)
+		ecds_memory_free(handlers);
+}
+
+void ecds_service_add_handler(ecds_service_t * service, uint32_t event_id, ecds_handler_func user_function)
+{
+	struct _ecds_service_handler_t * handler;
+	ecds_object_t ** dispatchers = NULL;
+	ecds_object_t ** current;
+	uint32_t dispatcher_count = 0;
+
+	if (service == NULL || user_function == NULL)
+		return;
+
+	handler = (struct _ecds_service_handler_t *)ecds_object_new(NULL, sizeof(struct _ecds_service_handler_t), ECDS_TYPE_SERVICE_HANDLER);
+	if (!handler)
+		return;
+
+	handler->event_id = event_id;
+	handler->user_function = user_function;
+
+	_service_lock(service);
+	if (!service->handler_list)
+		service->handler_list = ecds_list_new();
+	ecds_list_add_item(service->handler_list, ECDS_OBJECT(handler));
+
+	/* Rebuilding takes the dispatcher mutex and reads the handlers again, so it happens unlocked on a copy.
+	   Dispatchers are unmanaged and cannot be referenced, the caller keeps them alive (see ecds_service.h) */
+	if ((current = ecds_list_to_array(service->dispatcher_list)))
 	{
-		struct _ecds_service_handler_t * handler = (struct _ecds_service_handler_t *)ecds_list_get_item(service->handler_list, i);
-		if (handler->event_id == msg->event_id)
-			(*handler->user_function)(msg->user_data_length, msg->user_data);
+		while (current[dispatcher_count])
+			dispatcher_count++;
+		if (dispatcher_count && (dispatchers = (ecds_object_t **)ecds_memory_alloc(dispatcher_count * sizeof(ecds_object_t *))))
+			memcpy(dispatchers, current, dispatcher_count * sizeof(ecds_object_t *));
 	}
+	_service_unlock(service);
+
+	ecds_object_unref(ECDS_OBJECT(handler));
+
+	/* Make the new handler visible to dispatchers that route to this service */
+	for (uint32_t d = 0; dispatchers && d < dispatcher_count; d++)
+		ecds_dispatcher_rebuild_routes((ecds_dispatcher_t *)dispatchers[d]);
+	ecds_memory_free(dispatchers);
+}
+
+void ecds_service_attach_dispatcher(ecds_service_t * service, ecds_dispatcher_t * dispatcher)
+{
+	if (service == NULL || dispatcher == NULL)
+		return;
+
+	_service_lock(service);
+	if (!service->dispatcher_list)
+		service->dispatcher_list = ecds_list_new();
+	ecds_list_add_item(service->dispatcher_list, ECDS_OBJECT(dispatcher));
+	_service_unlock(service);
+}
+
+void ecds_service_detach_dispatcher(ecds_service_t * service, ecds_dispatcher_t * dispatcher)
+{
+	ecds_list_item_t * i;
+
+	if (service == NULL || dispatcher == NULL)
+		return;
+
+	_service_lock(service);
+	for (i = ecds_list_first_item(service->dispatcher_list); i; i = ecds_list_next_item(i))
+	{
+		if (ecds_list_get_item(service->dispatcher_list, i) == ECDS_OBJECT(dispatcher))
+		{
+			ecds_list_dispose_item(i);
+			break;
+		}
+	}
+	_service_unlock(service);
+}
+
+uint32_t ecds_service_get_handlers(ecds_service_t * service, uint32_t event_id, ecds_handler_func * handlers, uint32_t capacity)
+{
+	uint32_t count;
+
+	if (service == NULL)
+		return 0;
+
+	_service_lock(service);
+	count = _service_collect_handlers(service, event_id, handlers, capacity);
+	_service_unlock(service);
+
+	return count;
 }
\ No newline at end of file
@@ -0,0 +1,1316 @@
+/*****************************************************************************/
+/*	@file ecds_soft_renderer.c											 	 */
+/*	@brief Software rasterizer implementation of ecds_renderer_t.			 */
+/*																			 */
+/*	A frame is rendered in two steps. First the instructions of all render	 */
+/*	buffers are assembled into a list of screen space triangles on the		 */
+/*	calling thread; lines, points, shapes and text all end up as			 */
+/*	triangles. Every triangle is binned into the tiles its bounding box		 */
+/*	touches, in submission order. Then the tiles are rasterized in			 */
+/*	parallel by the calling thread and the worker threads, each tile by		 */
+/*	exactly one thread, so no pixel is ever written by two threads.			 */
+/*																			 */
+/*	Frames are retained. The triangles of every render buffer are cached	 */
+/*	together with the revision of the buffer they were made from, so only	 */
+/*	buffers that changed are assembled again. Only the tiles covered by		 */
+/*	the old or new triangles of those buffers are rasterized again, all		 */
+/*	other tiles keep their pixels from the previous frame.					 */
+/*																			 */
+/*	Triangles are rasterized with edge functions evaluated at pixel			 */
+/*	centres. Shared edges follow a fill rule so that adjacent triangles		 */
+/*	neither overlap nor leave gaps. With SSE2, four pixels are tested and	 */
+/*	filled or blended at once.												 */
+/*																			 */
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+	#define ECDS_SOFT_RENDERER_SSE2
+#endif
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <common/ecds_list.h>
+#include <common/ecds_log.h>
+
+#include <core/ecds_font.h>
+#include <core/ecds_soft_renderer.h>
+#include <core/ecds_tessellation.h>
+#include <core/ecds_text.h>
+#include <core/ecds_transform.h>
+
+#define ECDS_LOG_DOMAIN "ecds-soft-renderer"
+
+typedef struct _ecds_soft_vertex_t ecds_soft_vertex_t;
+typedef struct _ecds_soft_triangle_t ecds_soft_triangle_t;
+typedef struct _ecds_soft_bin_t ecds_soft_bin_t;
+typedef struct _ecds_soft_cache_t ecds_soft_cache_t;
+
+struct _ecds_soft_vertex_t {
+	float x;
+	float y;
+	uint32_t colour;
+};
+
+/* Edge i is a[i] * x + b[i] * y + c[i], positive inside the triangle */
+struct _ecds_soft_triangle_t {
+	float a[3];
+	float b[3];
+	float c[3];
+	bool inclusive[3];					//!<	Whether pixel centres exactly on the edge are covered
+	uint32_t colour;
+	int32_t min_x, min_y;				//!<	Bounding box in pixels, clipped to the framebuffer
+	int32_t max_x, max_y;				//!<	Inclusive
+};
+
+struct _ecds_soft_bin_t {
+	const ecds_soft_triangle_t ** triangles;	//!<	Triangles touching the tile, in submission order
+	uint32_t count;
+	uint32_t capacity;
+};
+
+/* Screen space triangles of one render buffer, reused until the buffer changes */
+struct _ecds_soft_cache_t {
+	unsigned int buffer_id;
+	uint32_t revision;					//!<	Revision of the buffer the triangles were made from
+	bool valid;
+	bool seen;							//!<	Whether the buffer still exists, only used during a frame
+	ecds_soft_triangle_t * triangles;
+	uint32_t triangle_count;
+	uint32_t triangle_capacity;
+};
+
+struct _ecds_soft_raster_t {
+	/* Assembly state, only used by the rendering thread */
+	ecds_transform_stack_t transform;
+	ecds_affine_t affine;				//!<	2D part of the current transform
+	uint32_t colour;
+	bool in_geometry;
+	unsigned int draw_mode;
+
+	ecds_soft_vertex_t * chain;			//!<	Vertices of the open geometry chain, transformed
+	uint32_t chain_count;
+	uint32_t chain_capacity;
+	float * points;						//!<	Transformed x, y pairs of a vertex array or shape
+	uint32_t points_capacity;
+	ecds_soft_vertex_t * shape;			//!<	Outline of the shape that is being drawn, transformed
+	uint32_t shape_capacity;
+	ecds_tessellation_cache_t tessellation;
+	ecds_text_cache_t text;
+	uint32_t text_ordinal;				//!<	Number of texts assembled so far in the current buffer
+
+	ecds_soft_cache_t * caches;			//!<	One per render buffer, in the order of the buffers
+	uint32_t cache_count;
+	uint32_t cache_capacity;
+	ecds_soft_cache_t * current;		//!<	Cache that assembled triangles are added to
+
+	uint32_t tiles_x;
+	uint32_t tiles_y;
+	ecds_soft_bin_t * bins;
+	bool * dirty_tiles;					//!<	Tiles whose content changed since the last frame
+	uint32_t * tile_list;				//!<	Dirty tiles of the current frame
+	uint32_t tile_list_count;
+	bool full_redraw;					//!<	Set until the whole framebuffer has been drawn once
+	uint32_t drawn_clear_colour;
+
+	ecds_soft_renderer_stats_t stats;
+
+	/* Tile distribution */
+	uint32_t next_tile;					//!<	Next entry of tile_list to rasterize, claimed atomically
+
+	uint32_t thread_count;
+	pthread_t * threads;
+	pthread_mutex_t raster_mutex[1];	//!<	Protects frame, busy and running
+	pthread_cond_t work_cond[1];		//!<	Signalled when a frame is ready to be rasterized
+	pthread_cond_t done_cond[1];		//!<	Signalled when the last worker finished its tiles
+	uint64_t frame;
+	uint32_t busy;
+	bool running;
+};
+
+//=================================== 8< ====================================//
+//	Helpers																	 //
+//===========================================================================//
+
+static bool _ecds_soft_reserve(void ** data, uint32_t * capacity, uint32_t needed, size_t element_size)
+{
+	uint32_t new_capacity;
+	void * new_data;
+
+	if (needed <= *capacity)
+		return true;
+
+	new_capacity = *capacity ? *capacity : 64;
+	while (new_capacity < needed)
+		new_capacity *= 2;
+
+	if (!(new_data = ecds_memory_alloc(new_capacity * element_size)))
+	{
+		ecds_log_error("Out of memory when growing rasterizer storage to %u elements", new_capacity);
+		return false;
+	}
+
+	if (*data)
+	{
+		memcpy(new_data, *data, *capacity * element_size);
+		ecds_memory_free(*data);
+	}
+
+	*data = new_data;
+	*capacity = new_capacity;
+
+	return true;
+}
+
+static inline uint8_t _ecds_soft_channel(double value)
+{
+	if (!(value > 0.0))
+		return 0;
+	if (value >= 1.0)
+		return 255;
+
+	return (uint8_t)(value * 255.0 + 0.5);
+}
+
+static inline void _ecds_soft_transform_point(ecds_soft_raster_t * raster, double x, double y, ecds_soft_vertex_t * out)
+{
+	const float * m = raster->affine.m;
+	float fx = (float)x, fy = (float)y;
+
+	/* Same precision and order as ecds_transform_points(), so vertex arrays land on the same pixels */
+	out->x = m[0] * fx + m[2] * fy + m[4];
+	out->y = m[1] * fx + m[3] * fy + m[5];
+	out->colour = raster->colour;
+}
+
+//=================================== 8< ====================================//
+//	Primitive assembly														 //
+//===========================================================================//
+
+static void _ecds_soft_emit_triangle(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * v0, const ecds_soft_vertex_t * v1, const ecds_soft_vertex_t * v2, uint32_t colour)
+{
+	ecds_soft_cache_t * cache = sr->raster->current;
+	ecds_soft_triangle_t * tri;
+	const ecds_soft_vertex_t * v[3];
+	float area, min_x, min_y, max_x, max_y;
+	int i;
+
+	area = (v1->x - v0->x) * (v2->y - v0->y) - (v2->x - v0->x) * (v1->y - v0->y);
+	if (!(area != 0.0f) || !isfinite(area))
+		/* Degenerate */
+		return;
+
+	/* Order the vertices so that the edge functions are positive inside */
+	v[0] = v0;
+	v[1] = area > 0.0f ? v1 : v2;
+	v[2] = area > 0.0f ? v2 : v1;
+
+	min_x = fminf(v0->x, fminf(v1->x, v2->x));
+	max_x = fmaxf(v0->x, fmaxf(v1->x, v2->x));
+	min_y = fminf(v0->y, fminf(v1->y, v2->y));
+	max_y = fmaxf(v0->y, fmaxf(v1->y, v2->y));
+
+	/* Pixel x is sampled at x + 0.5 */
+	if (max_x < 0.5f || max_y < 0.5f || min_x > (float)sr->width - 0.5f || min_y > (float)sr->height - 0.5f)
+		return;
+
+	if (!_ecds_soft_reserve((void **)&cache->triangles, &cache->triangle_capacity, cache->triangle_count + 1, sizeof(ecds_soft_triangle_t)))
+		return;
+
+	tri = &cache->triangles[cache->triangle_count++];
+	for (i = 0; i < 3; i++)
+	{
+		const ecds_soft_vertex_t * p = v[(i + 1) % 3];
+		const ecds_soft_vertex_t * q = v[(i + 2) % 3];
+
+		/* Edge from p to q, the remaining vertex lies on its positive side */
+		tri->a[i] = p->y - q->y;
+		tri->b[i] = q->x - p->x;
+		tri->c[i] = p->x * q->y - p->y * q->x;
+
+		/* Of two triangles sharing this edge exactly one sees it with a positive a, or b for horizontal edges */
+		tri->inclusive[i] = tri->a[i] > 0.0f || (tri->a[i] == 0.0f && tri->b[i] > 0.0f);
+	}
+
+	/* Only pixels whose centre lies within the bounds can be covered */
+	tri->colour = colour;
+	tri->min_x = min_x < 0.5f ? 0 : (int32_t)ceilf(min_x - 0.5f);
+	tri->min_y = min_y < 0.5f ? 0 : (int32_t)ceilf(min_y - 0.5f);
+	tri->max_x = max_x > (float)sr->width - 0.5f ? (int32_t)sr->width - 1 : (int32_t)floorf(max_x - 0.5f);
+	tri->max_y = max_y > (float)sr->height - 0.5f ? (int32_t)sr->height - 1 : (int32_t)floorf(max_y - 0.5f);
+}
+
+static void _ecds_soft_emit_quad(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * v0, const ecds_soft_vertex_t * v1, const ecds_soft_vertex_t * v2, const ecds_soft_vertex_t * v3, uint32_t colour)
+{
+	_ecds_soft_emit_triangle(sr, v0, v1, v2, colour);
+	_ecds_soft_emit_triangle(sr, v0, v2, v3, colour);
+}
+
+static void _ecds_soft_emit_point(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * p)
+{
+	ecds_soft_vertex_t q[4] = {
+		{ p->x - 0.5f, p->y - 0.5f, 0 },
+		{ p->x + 0.5f, p->y - 0.5f, 0 },
+		{ p->x + 0.5f, p->y + 0.5f, 0 },
+		{ p->x - 0.5f, p->y + 0.5f, 0 }
+	};
+
+	_ecds_soft_emit_quad(sr, &q[0], &q[1], &q[2], &q[3], p->colour);
+}
+
+/* A line is a one pixel wide quad, extended by half a pixel at both ends to cover its end points */
+static void _ecds_soft_emit_line(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * p, const ecds_soft_vertex_t * q, uint32_t colour)
+{
+	ecds_soft_vertex_t corners[4];
+	float dx = q->x - p->x;
+	float dy = q->y - p->y;
+	float length = sqrtf(dx * dx + dy * dy);
+	float ux, uy;
+
+	if (!(length > 0.0f))
+	{
+		_ecds_soft_emit_point(sr, q);
+		return;
+	}
+
+	ux = dx / length * 0.5f;
+	uy = dy / length * 0.5f;
+
+	corners[0].x = p->x - ux - uy;	corners[0].y = p->y - uy + ux;
+	corners[1].x = q->x + ux - uy;	corners[1].y = q->y + uy + ux;
+	corners[2].x = q->x + ux + uy;	corners[2].y = q->y + uy - ux;
+	corners[3].x = p->x - ux + uy;	corners[3].y = p->y - uy - ux;
+
+	_ecds_soft_emit_quad(sr, &corners[0], &corners[1], &corners[2], &corners[3], colour);
+}
+
+/* Emit a closed outline or a filled fan of transformed points, the fan is centred on the first point */
+static void _ecds_soft_emit_outline(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * points, uint32_t count, bool closed)
+{
+	uint32_t i;
+
+	for (i = 0; i + 1 < count; i++)
+		_ecds_soft_emit_line(sr, &points[i], &points[i + 1], points[i + 1].colour);
+
+	if (closed && count > 2)
+		_ecds_soft_emit_line(sr, &points[count - 1], &points[0], points[0].colour);
+}
+
+static void _ecds_soft_emit_fan(ecds_soft_renderer_t * sr, const ecds_soft_vertex_t * points, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 1; i + 1 < count; i++)
+		_ecds_soft_emit_triangle(sr, &points[0], &points[i], &points[i + 1], points[i + 1].colour);
+}
+
+static void _ecds_soft_emit_chain(ecds_soft_renderer_t * sr)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	ecds_soft_vertex_t * v = raster->chain;
+	uint32_t n = raster->chain_count;
+	uint32_t i;
+
+	switch (raster->draw_mode)
+	{
+	case ECDS_DRAW_MODE_VERTICES:
+		for (i = 0; i < n; i++)
+			_ecds_soft_emit_point(sr, &v[i]);
+		break;
+
+	case ECDS_DRAW_MODE_LINE:
+		for (i = 0; i + 1 < n; i += 2)
+			_ecds_soft_emit_line(sr, &v[i], &v[i + 1], v[i + 1].colour);
+		break;
+
+	case ECDS_DRAW_MODE_LINE_LOOP:
+	case ECDS_DRAW_MODE_LINE_STRIP:
+		_ecds_soft_emit_outline(sr, v, n, raster->draw_mode == ECDS_DRAW_MODE_LINE_LOOP);
+		break;
+
+	case ECDS_DRAW_MODE_POLYGON:
+		_ecds_soft_emit_fan(sr, v, n);
+		break;
+
+	case ECDS_DRAW_MODE_TRIANGLE:
+		for (i = 0; i + 2 < n; i += 3)
+			_ecds_soft_emit_triangle(sr, &v[i], &v[i + 1], &v[i + 2], v[i + 2].colour);
+		break;
+
+	case ECDS_DRAW_MODE_QUAD:
+		for (i = 0; i + 3 < n; i += 4)
+			_ecds_soft_emit_quad(sr, &v[i], &v[i + 1], &v[i + 2], &v[i + 3], v[i + 3].colour);
+		break;
+
+	default:
+		/* Text chains only position strings through transforms */
+		break;
+	}
+
+	raster->chain_count = 0;
+}
+
+/* Shapes are outlined in the line and vertex modes and filled everywhere else */
+static inline bool _ecds_soft_shape_filled(ecds_soft_raster_t * raster)
+{
+	return !raster->in_geometry || raster->draw_mode > ECDS_DRAW_MODE_LINE_STRIP;
+}
+
+static void _ecds_soft_shape(ecds_soft_renderer_t * sr, unsigned int primitive, double width, double height, double start_angle, double end_angle)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	const ecds_tessellation_t * outline;
+	const float * m = raster->affine.m;
+	const float * point;
+	bool filled = _ecds_soft_shape_filled(raster);
+	uint32_t count, i;
+	double scale;
+
+	/* The longer axis of the transform decides how many segments keep the outline within tolerance */
+	scale = sqrt(fmax(m[0] * m[0] + m[1] * m[1], m[2] * m[2] + m[3] * m[3]));
+
+	if (!(outline = ecds_tessellation_cache_get(&raster->tessellation, primitive, width, height, start_angle, end_angle, scale)))
+		return;
+
+	/* Filled arcs are pie slices around the centre */
+	count = outline->point_count + (filled && !outline->closed ? 1 : 0);
+	if (!_ecds_soft_reserve((void **)&raster->shape, &raster->shape_capacity, count, sizeof(ecds_soft_vertex_t)) ||
+		!_ecds_soft_reserve((void **)&raster->points, &raster->points_capacity, outline->point_count, 2 * sizeof(float)))
+		return;
+
+	ecds_transform_points(&raster->affine, outline->points, outline->point_count, raster->points);
+
+	i = 0;
+	if (count > outline->point_count)
+		_ecds_soft_transform_point(raster, 0.0, 0.0, &raster->shape[i++]);
+	for (point = raster->points; i < count; i++, point += 2)
+	{
+		raster->shape[i].x = point[0];
+		raster->shape[i].y = point[1];
+		raster->shape[i].colour = raster->colour;
+	}
+
+	if (filled)
+		_ecds_soft_emit_fan(sr, raster->shape, count);
+	else
+		_ecds_soft_emit_outline(sr, raster->shape, count, outline->closed);
+}
+
+static void _ecds_soft_text(ecds_soft_renderer_t * sr, const char * text, uint32_t length)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	ecds_soft_vertex_t corners[4];
+	const ecds_text_run_t * run;
+	const ecds_text_glyph_t * placed;
+	const ecds_glyph_rect_t * rect;
+	uint64_t slot;
+	uint32_t i, r;
+	float x, y;
+
+	/* The text parameter is padded with NULs */
+	length = (uint32_t)strnlen(text, length);
+
+	/* The n-th text of a buffer most likely shows the same thing as in the last frame */
+	slot = (uint64_t)(raster->current ? raster->current->buffer_id : 0) << 32 | ++raster->text_ordinal;
+	if (!(run = ecds_text_cache_layout(&raster->text, ecds_font_get_builtin(), text, length, slot)))
+		return;
+
+	for (i = 0, placed = run->glyphs; i < run->glyph_count; i++, placed++)
+	{
+		if (!placed->glyph)
+			continue;
+
+		for (r = 0, rect = placed->glyph->rects; r < placed->glyph->rect_count; r++, rect++)
+		{
+			x = placed->x + rect->x;
+			y = placed->y + rect->y;
+			_ecds_soft_transform_point(raster, x, y, &corners[0]);
+			_ecds_soft_transform_point(raster, x + rect->width, y, &corners[1]);
+			_ecds_soft_transform_point(raster, x + rect->width, y + rect->height, &corners[2]);
+			_ecds_soft_transform_point(raster, x, y + rect->height, &corners[3]);
+			_ecds_soft_emit_quad(sr, &corners[0], &corners[1], &corners[2], &corners[3], raster->colour);
+		}
+	}
+}
+
+static void _ecds_soft_reset_state(ecds_soft_raster_t * raster)
+{
+	ecds_transform_stack_reset(&raster->transform);
+	ecds_transform_stack_get_affine(&raster->transform, &raster->affine);
+	raster->colour = 0xFFFFFFFF;
+	raster->in_geometry = false;
+	raster->chain_count = 0;
+	raster->text_ordinal = 0;
+}
+
+/* Append the vertices of a vertex array to the open geometry chain */
+static void _ecds_soft_vertex_array(ecds_soft_raster_t * raster, const ecds_render_instruction_t * instr)
+{
+	bool single = instr->parameter == ECDS_RENDER_PARAM_VERTEX_ARRAY_F32;
+	uint32_t i, count = (uint32_t)(instr->length / (single ? 3 * sizeof(float) : 3 * sizeof(double)));
+	ecds_soft_vertex_t * out;
+	const float * point;
+
+	if (!raster->in_geometry || !count || count > UINT32_MAX / 2 - raster->chain_count ||
+		!_ecds_soft_reserve((void **)&raster->chain, &raster->chain_capacity, raster->chain_count + count, sizeof(ecds_soft_vertex_t)) ||
+		!_ecds_soft_reserve((void **)&raster->points, &raster->points_capacity, count, 2 * sizeof(float)))
+		return;
+
+	/* Instruction data is 8-byte aligned, so the vertices can be read in place */
+	if (single)
+		ecds_transform_points(&raster->affine, (const float *)ECDS_RENDER_INSTRUCTION_DATA(instr), count, raster->points);
+	else
+		ecds_transform_points_f64(&raster->affine, (const double *)ECDS_RENDER_INSTRUCTION_DATA(instr), count, raster->points);
+
+	out = raster->chain + raster->chain_count;
+	for (i = 0, point = raster->points; i < count; i++, point += 2, out++)
+	{
+		out->x = point[0];
+		out->y = point[1];
+		out->colour = raster->colour;
+	}
+	raster->chain_count += count;
+}
+
+static void _ecds_soft_assemble_buffer(ecds_soft_renderer_t * sr, const ecds_render_instruction_t * instr, size_t length)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	const ecds_render_instruction_t * end = (const ecds_render_instruction_t *)((const uint8_t *)instr + length);
+	double values[4];
+
+	_ecds_soft_reset_state(raster);
+
+	for (; instr < end; instr = ECDS_RENDER_INSTRUCTION_NEXT(instr))
+	{
+		const void * data = ECDS_RENDER_INSTRUCTION_DATA(instr);
+		uint32_t count = instr->length / sizeof(double);
+
+		switch (instr->opcode)
+		{
+		case ECDS_RENDER_GEOMETRY_BEGIN:
+			/* Chains do not nest, a new one closes the open one */
+			if (raster->in_geometry)
+				_ecds_soft_emit_chain(sr);
+			raster->in_geometry = true;
+			raster->draw_mode = instr->parameter;
+			break;
+
+		case ECDS_RENDER_GEOMETRY_END:
+			if (raster->in_geometry)
+				_ecds_soft_emit_chain(sr);
+			raster->in_geometry = false;
+			break;
+
+		case ECDS_RENDER_TRANSFORM_BEGIN:
+			if (ecds_transform_stack_push(&raster->transform, instr->parameter) < 0)
+				ecds_log_warning("Transform stack overflow, transform ignored");
+			break;
+
+		case ECDS_RENDER_TRANSFORM_END:
+			if (ecds_transform_stack_pop(&raster->transform) >= 0)
+				ecds_transform_stack_get_affine(&raster->transform, &raster->affine);
+			break;
+
+		case ECDS_RENDER_PARAMETER:
+			if (instr->parameter == ECDS_RENDER_PARAM_VERTEX_ARRAY || instr->parameter == ECDS_RENDER_PARAM_VERTEX_ARRAY_F32)
+			{
+				_ecds_soft_vertex_array(raster, instr);
+				break;
+			}
+
+			if (count > 4)
+				count = 4;
+			memcpy(values, data, count * sizeof(double));
+
+			switch (instr->parameter)
+			{
+			case ECDS_RENDER_PARAM_VERTEX:
+				if (count < 3 || !raster->in_geometry)
+					break;
+				if (!_ecds_soft_reserve((void **)&raster->chain, &raster->chain_capacity, raster->chain_count + 1, sizeof(ecds_soft_vertex_t)))
+					break;
+				_ecds_soft_transform_point(raster, values[0], values[1], &raster->chain[raster->chain_count++]);
+				break;
+
+			case ECDS_RENDER_PARAM_COLOUR:
+				if (count < 4)
+					break;
+				raster->colour = (uint32_t)_ecds_soft_channel(values[0]) << 24 | (uint32_t)_ecds_soft_channel(values[1]) << 16 |
+					(uint32_t)_ecds_soft_channel(values[2]) << 8 | (uint32_t)_ecds_soft_channel(values[3]);
+				break;
+
+			case ECDS_RENDER_PARAM_RECTANGLE:
+			case ECDS_RENDER_PARAM_ELLIPSE:
+				if (count >= 2)
+					_ecds_soft_shape(sr, instr->parameter, values[0], values[1], 0.0, 0.0);
+				break;
+
+			case ECDS_RENDER_PARAM_ARC:
+				if (count >= 4)
+					_ecds_soft_shape(sr, instr->parameter, values[0], values[1], values[2], values[3]);
+				break;
+
+			case ECDS_RENDER_PARAM_TEXT:
+				_ecds_soft_text(sr, (const char *)data, instr->length);
+				break;
+
+			case ECDS_RENDER_PARAM_TRANSFORM:
+				if (ecds_transform_stack_apply(&raster->transform, values, count) == 0)
+					ecds_transform_stack_get_affine(&raster->transform, &raster->affine);
+				break;
+
+			default:
+				break;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/* Unterminated chains are drawn as if they were closed */
+	if (raster->in_geometry)
+		_ecds_soft_emit_chain(sr);
+}
+
+static void _ecds_soft_mark_tiles(ecds_soft_raster_t * raster, const ecds_soft_cache_t * cache)
+{
+	uint32_t t, x, y;
+
+	for (t = 0; t < cache->triangle_count; t++)
+	{
+		const ecds_soft_triangle_t * tri = &cache->triangles[t];
+
+		for (y = (uint32_t)tri->min_y / ECDS_SOFT_RENDERER_TILE_SIZE; y <= (uint32_t)tri->max_y / ECDS_SOFT_RENDERER_TILE_SIZE; y++)
+			for (x = (uint32_t)tri->min_x / ECDS_SOFT_RENDERER_TILE_SIZE; x <= (uint32_t)tri->max_x / ECDS_SOFT_RENDERER_TILE_SIZE; x++)
+				raster->dirty_tiles[y * raster->tiles_x + x] = true;
+	}
+}
+
+/* Only dirty tiles are binned, the others keep the pixels of the previous frame */
+static void _ecds_soft_bin_triangles(ecds_soft_renderer_t * sr)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	uint32_t c, t, x, y;
+
+	for (t = 0; t < raster->tiles_x * raster->tiles_y; t++)
+		raster->bins[t].count = 0;
+
+	for (c = 0; c < raster->cache_count; c++)
+	{
+		const ecds_soft_cache_t * cache = &raster->caches[c];
+
+		for (t = 0; t < cache->triangle_count; t++)
+		{
+			const ecds_soft_triangle_t * tri = &cache->triangles[t];
+
+			for (y = (uint32_t)tri->min_y / ECDS_SOFT_RENDERER_TILE_SIZE; y <= (uint32_t)tri->max_y / ECDS_SOFT_RENDERER_TILE_SIZE; y++)
+			{
+				for (x = (uint32_t)tri->min_x / ECDS_SOFT_RENDERER_TILE_SIZE; x <= (uint32_t)tri->max_x / ECDS_SOFT_RENDERER_TILE_SIZE; x++)
+				{
+					ecds_soft_bin_t * bin = &raster->bins[y * raster->tiles_x + x];
+
+					if (!raster->dirty_tiles[y * raster->tiles_x + x])
+						continue;
+					if (!_ecds_soft_reserve((void **)&bin->triangles, &bin->capacity, bin->count + 1, sizeof(const ecds_soft_triangle_t *)))
+						continue;
+					bin->triangles[bin->count++] = tri;
+				}
+			}
+		}
+	}
+}
+
+//=================================== 8< ====================================//
+//	Rasterization															 //
+//===========================================================================//
+
+static inline uint32_t _ecds_soft_blend(uint32_t dst, uint32_t src, uint32_t alpha)
+{
+	uint32_t ret = 0;
+	int shift;
+
+	/* Straight alpha, the source alpha channel counts as fully covered */
+	src |= 0xFF000000;
+	for (shift = 0; shift < 32; shift += 8)
+	{
+		uint32_t value = ((src >> shift) & 0xFF) * alpha + ((dst >> shift) & 0xFF) * (255 - alpha) + 128;
+		ret |= ((value + (value >> 8)) >> 8) << shift;
+	}
+
+	return ret;
+}
+
+/*
+ * Both span functions evaluate the edge functions as a * px + (b * py + c) for every pixel instead of
+ * stepping them, so they cover exactly the same pixels and images do not depend on the instruction set.
+ */
+static void _ecds_soft_raster_span_scalar(uint32_t * row, int32_t x0, int32_t x1, const ecds_soft_triangle_t * tri, float py)
+{
+	float row_term[3];
+	uint32_t alpha = tri->colour >> 24;
+	int32_t x;
+	int i;
+
+	for (i = 0; i < 3; i++)
+		row_term[i] = tri->b[i] * py + tri->c[i];
+
+	for (x = x0; x <= x1; x++)
+	{
+		float px = (float)x + 0.5f;
+		bool inside = true;
+
+		for (i = 0; i < 3; i++)
+		{
+			float w = tri->a[i] * px + row_term[i];
+			inside = inside && (w > 0.0f || (w == 0.0f && tri->inclusive[i]));
+		}
+
+		if (!inside)
+			continue;
+
+		row[x] = alpha == 255 ? tri->colour : _ecds_soft_blend(row[x], tri->colour, alpha);
+	}
+}
+
+#ifdef ECDS_SOFT_RENDERER_SSE2
+static void _ecds_soft_raster_span_sse2(uint32_t * row, int32_t x0, int32_t x1, const ecds_soft_triangle_t * tri, float py)
+{
+	const __m128 lanes = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i lane_index = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i last = _mm_set1_epi32(x1);
+	const __m128i colour = _mm_set1_epi32((int)tri->colour);
+	uint32_t alpha = tri->colour >> 24;
+	__m128 a[3], row_term[3], inclusive[3];
+	__m128i source_lo, source_hi, inverse_alpha;
+	int32_t x;
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		a[i] = _mm_set1_ps(tri->a[i]);
+		row_term[i] = _mm_set1_ps(tri->b[i] * py + tri->c[i]);
+		inclusive[i] = _mm_castsi128_ps(_mm_set1_epi32(tri->inclusive[i] ? -1 : 0));
+	}
+
+	/* Source colour times alpha per 16-bit channel, with the alpha channel as fully covered */
+	source_lo = _mm_unpacklo_epi8(_mm_set1_epi32((int)(tri->colour | 0xFF000000)), _mm_setzero_si128());
+	source_lo = _mm_mullo_epi16(source_lo, _mm_set1_epi16((short)alpha));
+	source_lo = _mm_add_epi16(source_lo, _mm_set1_epi16(128));
+	source_hi = source_lo;
+	inverse_alpha = _mm_set1_epi16((short)(255 - alpha));
+
+	for (x = x0; x <= x1; x += 4)
+	{
+		__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		__m128i mask, pixels, result;
+
+		for (i = 0; i < 3; i++)
+		{
+			__m128 w = _mm_add_ps(_mm_mul_ps(a[i], px), row_term[i]);
+			inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(w, zero), _mm_and_ps(_mm_cmpeq_ps(w, zero), inclusive[i])));
+		}
+
+		/* Drop the lanes past the end of the span */
+		mask = _mm_and_si128(_mm_castps_si128(inside), _mm_cmplt_epi32(_mm_add_epi32(lane_index, _mm_set1_epi32(x)), _mm_add_epi32(last, _mm_set1_epi32(1))));
+		if (_mm_movemask_epi8(mask) == 0)
+			continue;
+
+		if (x + 3 > x1)
+		{
+			/* The tail is finished lane by lane so nothing is read or written past the span */
+			_ecds_soft_raster_span_scalar(row, x, x1, tri, py);
+			break;
+		}
+
+		pixels = _mm_loadu_si128((const __m128i *)(row + x));
+		if (alpha == 255)
+			result = colour;
+		else
+		{
+			__m128i lo = _mm_unpacklo_epi8(pixels, _mm_setzero_si128());
+			__m128i hi = _mm_unpackhi_epi8(pixels, _mm_setzero_si128());
+
+			lo = _mm_add_epi16(_mm_mullo_epi16(lo, inverse_alpha), source_lo);
+			hi = _mm_add_epi16(_mm_mullo_epi16(hi, inverse_alpha), source_hi);
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+			result = _mm_packus_epi16(lo, hi);
+		}
+
+		result = _mm_or_si128(_mm_and_si128(mask, result), _mm_andnot_si128(mask, pixels));
+		_mm_storeu_si128((__m128i *)(row + x), result);
+	}
+}
+#endif
+
+static void _ecds_soft_raster_tile(ecds_soft_renderer_t * sr, uint32_t tile)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	ecds_soft_bin_t * bin = &raster->bins[tile];
+	int32_t tile_x0 = (int32_t)(tile % raster->tiles_x) * ECDS_SOFT_RENDERER_TILE_SIZE;
+	int32_t tile_y0 = (int32_t)(tile / raster->tiles_x) * ECDS_SOFT_RENDERER_TILE_SIZE;
+	int32_t tile_x1 = tile_x0 + ECDS_SOFT_RENDERER_TILE_SIZE - 1;
+	int32_t tile_y1 = tile_y0 + ECDS_SOFT_RENDERER_TILE_SIZE - 1;
+	int32_t x, y;
+	uint32_t i;
+
+	if (tile_x1 >= (int32_t)sr->width)
+		tile_x1 = (int32_t)sr->width - 1;
+	if (tile_y1 >= (int32_t)sr->height)
+		tile_y1 = (int32_t)sr->height - 1;
+
+	for (y = tile_y0; y <= tile_y1; y++)
+		for (x = tile_x0; x <= tile_x1; x++)
+			sr->pixels[(size_t)y * sr->width + x] = sr->clear_colour;
+
+	for (i = 0; i < bin->count; i++)
+	{
+		const ecds_soft_triangle_t * tri = bin->triangles[i];
+		int32_t x0 = tri->min_x > tile_x0 ? tri->min_x : tile_x0;
+		int32_t x1 = tri->max_x < tile_x1 ? tri->max_x : tile_x1;
+		int32_t y0 = tri->min_y > tile_y0 ? tri->min_y : tile_y0;
+		int32_t y1 = tri->max_y < tile_y1 ? tri->max_y : tile_y1;
+
+		for (y = y0; y <= y1; y++)
+		{
+#ifdef ECDS_SOFT_RENDERER_SSE2
+			_ecds_soft_raster_span_sse2(sr->pixels + (size_t)y * sr->width, x0, x1, tri, (float)y + 0.5f);
+#else
+			_ecds_soft_raster_span_scalar(sr->pixels + (size_t)y * sr->width, x0, x1, tri, (float)y + 0.5f);
+#endif
+		}
+	}
+}
+
+static void _ecds_soft_raster_tiles(ecds_soft_renderer_t * sr)
+{
+	ecds_soft_raster_t * raster = sr->raster;
+	uint32_t index;
+
+	while ((index = ecds_atomic_fetch_add(&raster->next_tile, 1)) < raster->tile_list_count)
+		_ecds_soft_raster_tile(sr, raster->tile_list[index]);
+}
+
+static void * _ecds_soft_worker(void * arg)
+{
+	ecds_soft_renderer_t * sr = (ecds_soft_renderer_t *)arg;
+	ecds_soft_raster_t * raster = sr->raster;
+	uint64_t frame = 0;
+
+	pthread_mutex_lock(raster->raster_mutex);
+	for (;;)
+	{
+		while (raster->running && raster->frame == frame)
+			pthread_cond_wait(raster->work_cond, raster->raster_mutex);
+		if (!raster->running)
+			break;
+		frame = raster->frame;
+		pthread_mutex_unlock(raster->raster_mutex);
+
+		_ecds_soft_raster_tiles(sr);
+
+		pthread_mutex_lock(raster->raster_mutex);
+		if (--raster->busy == 0)
+			pthread_cond_signal(raster->done_cond);
+	}
+	pthread_mutex_unlock(raster->raster_mutex);
+
+	return NULL;
+}
+
+//=================================== 8< ====================================//
+//	Public interface														 //
+//===========================================================================//
+
+static ecds_soft_cache_t * _ecds_soft_get_cache(ecds_soft_raster_t * raster, uint32_t position, unsigned int buffer_id)
+{
+	ecds_soft_cache_t * cache;
+	uint32_t c;
+
+	/* Buffers are only ever appended, so the cache is normally found right at its position */
+	for (c = position; c < raster->cache_count; c++)
+	{
+		if (raster->caches[c].buffer_id != buffer_id)
+			continue;
+
+		if (c != position)
+		{
+			ecds_soft_cache_t found = raster->caches[c];
+
+			memmove(&raster->caches[position + 1], &raster->caches[position], (c - position) * sizeof(ecds_soft_cache_t));
+			raster->caches[position] = found;
+		}
+		return &raster->caches[position];
+	}
+
+	if (!_ecds_soft_reserve((void **)&raster->caches, &raster->cache_capacity, raster->cache_count + 1, sizeof(ecds_soft_cache_t)))
+		return NULL;
+
+	memmove(&raster->caches[position + 1], &raster->caches[position], (raster->cache_count - position) * sizeof(ecds_soft_cache_t));
+	raster->cache_count++;
+
+	cache = &raster->caches[position];
+	memset(cache, 0, sizeof(ecds_soft_cache_t));
+	cache->buffer_id = buffer_id;
+
+	return cache;
+}
+
+void ecds_soft_renderer_render(ecds_soft_renderer_t * sr)
+{
+	ecds_renderer_private_t * priv;
+	ecds_soft_raster_t * raster;
+	ecds_list_item_t * i;
+	uint32_t position = 0, c, t;
+
+	if (!sr || !(raster = sr->raster) || !(priv = (ecds_renderer_private_t *)sr->renderer.process.private_data))
+		return;
+
+	raster->stats.frames++;
+
+	/* Assemble the buffers that changed since the last frame, keeping the caches in buffer order */
+	for (i = ecds_list_first_item(priv->buffers); i; i = ecds_list_next_item(i))
+	{
+		ecds_render_buffer_t * buffer = (ecds_render_buffer_t *)ecds_list_get_item(priv->buffers, i);
+		ecds_soft_cache_t * cache;
+
+		if (!(cache = _ecds_soft_get_cache(raster, position, buffer->id)))
+			continue;
+		position++;
+
+		if (cache->valid && cache->revision == buffer->revision)
+		{
+			raster->stats.buffers_skipped++;
+			continue;
+		}
+
+		/* Both where the buffer was drawn and where it is drawn now must be redrawn */
+		_ecds_soft_mark_tiles(raster, cache);
+		cache->triangle_count = 0;
+		raster->current = cache;
+		_ecds_soft_assemble_buffer(sr, (const ecds_render_instruction_t *)buffer->data, buffer->length);
+		_ecds_soft_mark_tiles(raster, cache);
+
+		cache->revision = buffer->revision;
+		cache->valid = true;
+		raster->stats.buffers_redrawn++;
+	}
+
+	/* Drop the caches of buffers that no longer exist */
+	for (c = position; c < raster->cache_count; c++)
+	{
+		_ecds_soft_mark_tiles(raster, &raster->caches[c]);
+		ecds_memory_free(raster->caches[c].triangles);
+	}
+	raster->cache_count = position;
+	raster->current = NULL;
+
+	if (raster->full_redraw || raster->drawn_clear_colour != sr->clear_colour)
+		memset(raster->dirty_tiles, 1, raster->tiles_x * raster->tiles_y * sizeof(bool));
+	raster->full_redraw = false;
+	raster->drawn_clear_colour = sr->clear_colour;
+
+	raster->tile_list_count = 0;
+	for (t = 0; t < raster->tiles_x * raster->tiles_y; t++)
+	{
+		if (raster->dirty_tiles[t])
+			raster->tile_list[raster->tile_list_count++] = t;
+	}
+
+	raster->stats.tiles_rasterized += raster->tile_list_count;
+	raster->stats.tiles_skipped += raster->tiles_x * raster->tiles_y - raster->tile_list_count;
+	if (raster->tile_list_count == 0)
+		/* Nothing changed, the framebuffer already shows this frame */
+		return;
+
+	_ecds_soft_bin_triangles(sr);
+
+	ecds_atomic_store(&raster->next_tile, 0);
+	if (raster->thread_count)
+	{
+		pthread_mutex_lock(raster->raster_mutex);
+		raster->frame++;
+		raster->busy = raster->thread_count;
+		pthread_cond_broadcast(raster->work_cond);
+		pthread_mutex_unlock(raster->raster_mutex);
+	}
+
+	_ecds_soft_raster_tiles(sr);
+
+	if (raster->thread_count)
+	{
+		pthread_mutex_lock(raster->raster_mutex);
+		while (raster->busy)
+			pthread_cond_wait(raster->done_cond, raster->raster_mutex);
+		pthread_mutex_unlock(raster->raster_mutex);
+	}
+
+	memset(raster->dirty_tiles, 0, raster->tiles_x * raster->tiles_y * sizeof(bool));
+}
+
+void ecds_soft_renderer_invalidate(ecds_soft_renderer_t * sr)
+{
+	if (sr && sr->raster)
+		sr->raster->full_redraw = true;
+}
+
+void ecds_soft_renderer_get_stats(ecds_soft_renderer_t * sr, ecds_soft_renderer_stats_t * stats)
+{
+	if (!stats)
+		return;
+
+	if (sr && sr->raster)
+	{
+		*stats = sr->raster->stats;
+		stats->shapes_cached = sr->raster->tessellation.hits;
+		stats->shapes_tessellated = sr->raster->tessellation.misses;
+		stats->texts_cached = sr->raster->text.runs_cached;
+		stats->texts_laid_out = sr->raster->text.runs_laid_out;
+		stats->characters_reused = sr->raster->text.characters_reused;
+	}
+	else
+		memset(stats, 0, sizeof(ecds_soft_renderer_stats_t));
+}
+
+void ecds_soft_renderer_set_tessellation(ecds_soft_renderer_t * sr, double tolerance, size_t memory_limit)
+{
+	ecds_soft_raster_t * raster;
+	uint32_t c;
+
+	if (!sr || !(raster = sr->raster))
+		return;
+
+	ecds_tessellation_cache_configure(&raster->tessellation, tolerance, memory_limit);
+
+	/* Shapes that were already assembled used the old tolerance */
+	for (c = 0; c < raster->cache_count; c++)
+		raster->caches[c].valid = false;
+}
+
+static void _ecds_soft_renderer_run(ecds_process_t * proc)
+{
+	ecds_soft_renderer_render((ecds_soft_renderer_t *)proc);
+}
+
+static int _ecds_soft_renderer_commit(ecds_renderer_t * renderer)
+{
+	ecds_soft_renderer_render((ecds_soft_renderer_t *)renderer);
+	return 0;
+}
+
+static void _ecds_soft_renderer_dispose(ecds_object_t * obj)
+{
+	ecds_soft_renderer_t * sr = (ecds_soft_renderer_t *)obj;
+	ecds_soft_raster_t * raster = sr->raster;
+	uint32_t i;
+
+	if (raster)
+	{
+		pthread_mutex_lock(raster->raster_mutex);
+		raster->running = false;
+		pthread_cond_broadcast(raster->work_cond);
+		pthread_mutex_unlock(raster->raster_mutex);
+
+		for (i = 0; i < raster->thread_count; i++)
+			pthread_join(raster->threads[i], NULL);
+
+		pthread_cond_destroy(raster->done_cond);
+		pthread_cond_destroy(raster->work_cond);
+		pthread_mutex_destroy(raster->raster_mutex);
+
+		for (i = 0; raster->bins && i < raster->tiles_x * raster->tiles_y; i++)
+			ecds_memory_free(raster->bins[i].triangles);
+		for (i = 0; i < raster->cache_count; i++)
+			ecds_memory_free(raster->caches[i].triangles);
+		ecds_memory_free(raster->bins);
+		ecds_memory_free(raster->dirty_tiles);
+		ecds_memory_free(raster->tile_list);
+		ecds_memory_free(raster->caches);
+		ecds_memory_free(raster->chain);
+		ecds_memory_free(raster->points);
+		ecds_memory_free(raster->shape);
+		ecds_tessellation_cache_clear(&raster->tessellation);
+		ecds_text_cache_clear(&raster->text);
+		ecds_memory_free(raster->threads);
+		ecds_transform_stack_release(&raster->transform);
+		ecds_memory_free(raster);
+		sr->raster = NULL;
+	}
+
+	ecds_memory_free(sr->pixels);
+	sr->pixels = NULL;
+
+	ecds_renderer_dispose_object(obj);
+}
+
+ecds_soft_renderer_t * ecds_soft_renderer_new(const char * name, uint32_t width, uint32_t height, uint32_t thread_count)
+{
+	ecds_soft_renderer_t * sr;
+	ecds_soft_raster_t * raster;
+	uint32_t i;
+
+	if (width == 0 || height == 0)
+		/* Invalid argument */
+		return NULL;
+
+	if (!(sr = (ecds_soft_renderer_t *)ecds_renderer_new(name, sizeof(ecds_soft_renderer_t))))
+		return NULL;
+
+	sr->renderer.process.obj.type_uid = ECDS_TYPE_SOFT_RENDERER;
+	sr->renderer.process.obj.dispose = _ecds_soft_renderer_dispose;
+	sr->renderer.process.run = _ecds_soft_renderer_run;
+	sr->renderer.commit = _ecds_soft_renderer_commit;
+	sr->width = width;
+	sr->height = height;
+	sr->clear_colour = 0xFF000000;
+
+	if (!(sr->pixels = (uint32_t *)ecds_memory_alloc((size_t)width * height * sizeof(uint32_t))) ||
+		!(raster = sr->raster = (ecds_soft_raster_t *)ecds_memory_alloc(sizeof(ecds_soft_raster_t))))
+	{
+		ecds_log_error("Out of memory when allocating a %ux%u framebuffer", width, height);
+		ecds_object_unref(ECDS_OBJECT(sr));
+		return NULL;
+	}
+
+	raster->tiles_x = (width + ECDS_SOFT_RENDERER_TILE_SIZE - 1) / ECDS_SOFT_RENDERER_TILE_SIZE;
+	raster->tiles_y = (height + ECDS_SOFT_RENDERER_TILE_SIZE - 1) / ECDS_SOFT_RENDERER_TILE_SIZE;
+	pthread_mutex_init(raster->raster_mutex, NULL);
+	pthread_cond_init(raster->work_cond, NULL);
+	pthread_cond_init(raster->done_cond, NULL);
+	raster->running = true;
+	raster->full_redraw = true;
+	ecds_transform_stack_init(&raster->transform);
+	ecds_tessellation_cache_initialize(&raster->tessellation, 0.0, 0);
+	ecds_text_cache_initialize(&raster->text, 0);
+
+	if (!(raster->bins = (ecds_soft_bin_t *)ecds_memory_alloc(raster->tiles_x * raster->tiles_y * sizeof(ecds_soft_bin_t))) ||
+		!(raster->dirty_tiles = (bool *)ecds_memory_alloc(raster->tiles_x * raster->tiles_y * sizeof(bool))) ||
+		!(raster->tile_list = (uint32_t *)ecds_memory_alloc(raster->tiles_x * raster->tiles_y * sizeof(uint32_t))) ||
+		(thread_count && !(raster->threads = (pthread_t *)ecds_memory_alloc(thread_count * sizeof(pthread_t)))))
+	{
+		ecds_object_unref(ECDS_OBJECT(sr));
+		return NULL;
+	}
+
+	for (i = 0; i < thread_count; i++)
+	{
+		if (pthread_create(&raster->threads[i], NULL, _ecds_soft_worker, sr) != 0)
+		{
+			ecds_log_warning("Could only start %u of %u rasterizer threads", i, thread_count);
+			break;
+		}
+		raster->thread_count++;
+	}
+
+	return sr;
+}
+
+//=================================== 8< ====================================//
+//	Image output															 //
+//===========================================================================//
+
+int ecds_soft_renderer_write_ppm(ecds_soft_renderer_t * sr, const char * path)
+{
+	uint8_t * row;
+	uint32_t x, y;
+	FILE * file;
+	int ret = 0;
+
+	if (!sr || !sr->pixels || !path)
+		return -1;
+
+	if (!(file = fopen(path, "wb")))
+	{
+		ecds_log_error("Could not open %s for writing", path);
+		return -1;
+	}
+
+	if (!(row = (uint8_t *)ecds_memory_alloc((size_t)sr->width * 3)))
+	{
+		fclose(file);
+		return -1;
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", sr->width, sr->height);
+	for (y = 0; y < sr->height && ret == 0; y++)
+	{
+		const uint32_t * pixels = sr->pixels + (size_t)y * sr->width;
+
+		for (x = 0; x < sr->width; x++)
+		{
+			row[x * 3 + 0] = (uint8_t)(pixels[x] >> 16);
+			row[x * 3 + 1] = (uint8_t)(pixels[x] >> 8);
+			row[x * 3 + 2] = (uint8_t)pixels[x];
+		}
+
+		if (fwrite(row, 3, sr->width, file) != sr->width)
+			ret = -1;
+	}
+
+	ecds_memory_free(row);
+	if (fclose(file) != 0)
+		ret = -1;
+
+	if (ret)
+		ecds_log_error("Could not write %s", path);
+
+	return ret;
+}
+
+static void _ecds_soft_put_u32(uint8_t * target, uint32_t value)
+{
+	target[0] = (uint8_t)(value >> 24);
+	target[1] = (uint8_t)(value >> 16);
+	target[2] = (uint8_t)(value >> 8);
+	target[3] = (uint8_t)value;
+}
+
+static uint32_t _ecds_soft_crc32(const uint32_t * table, uint32_t crc, const uint8_t * data, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+static bool _ecds_soft_write_chunk(FILE * file, const uint32_t * crc_table, const char * type, const uint8_t * data, size_t length)
+{
+	uint8_t header[8];
+	uint8_t trailer[4];
+	uint32_t crc;
+
+	_ecds_soft_put_u32(header, (uint32_t)length);
+	memcpy(header + 4, type, 4);
+
+	crc = _ecds_soft_crc32(crc_table, 0xFFFFFFFF, header + 4, 4);
+	crc = _ecds_soft_crc32(crc_table, crc, data, length) ^ 0xFFFFFFFF;
+	_ecds_soft_put_u32(trailer, crc);
+
+	return fwrite(header, 1, 8, file) == 8 &&
+		(length == 0 || fwrite(data, 1, length, file) == length) &&
+		fwrite(trailer, 1, 4, file) == 4;
+}
+
+int ecds_soft_renderer_write_png(ecds_soft_renderer_t * sr, const char * path)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	uint32_t crc_table[256];
+	uint8_t ihdr[13];
+	uint8_t * idat, * out;
+	size_t row_length, raw_length, idat_length, offset;
+	uint32_t adler_a = 1, adler_b = 0;
+	uint32_t x, y, n;
+	FILE * file;
+	bool ok;
+
+	if (!sr || !sr->pixels || !path)
+		return -1;
+
+	for (n = 0; n < 256; n++)
+	{
+		uint32_t c = n;
+		int k;
+
+		for (k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+
+	/* Each row starts with filter type 0, the image data is stored without compression in blocks of at most 65535 bytes */
+	row_length = 1 + (size_t)sr->width * 4;
+	raw_length = row_length * sr->height;
+	idat_length = 2 + raw_length + 5 * ((raw_length + 65534) / 65535) + 4;
+
+	if (!(idat = (uint8_t *)ecds_memory_alloc(idat_length)))
+		return -1;
+
+	out = idat;
+	*out++ = 0x78;
+	*out++ = 0x01;
+
+	offset = 0;
+	for (y = 0; y < sr->height; y++)
+	{
+		const uint32_t * pixels = sr->pixels + (size_t)y * sr->width;
+
+		for (x = 0; x < row_length; x++)
+		{
+			uint32_t argb = x ? pixels[(x - 1) / 4] : 0;
+			uint8_t value;
+
+			switch (x ? (x - 1) % 4 : 4)
+			{
+			case 0: value = (uint8_t)(argb >> 16); break;
+			case 1: value = (uint8_t)(argb >> 8); break;
+			case 2: value = (uint8_t)argb; break;
+			case 3: value = (uint8_t)(argb >> 24); break;
+			default: value = 0; break;
+			}
+
+			if (offset % 65535 == 0)
+			{
+				uint16_t block = (uint16_t)(raw_length - offset < 65535 ? raw_length - offset : 65535);
+
+				*out++ = raw_length - offset <= 65535 ? 1 : 0;
+				*out++ = (uint8_t)block;
+				*out++ = (uint8_t)(block >> 8);
+				*out++ = (uint8_t)~block;
+				*out++ = (uint8_t)((uint16_t)~block >> 8);
+			}
+
+			*out++ = value;
+			offset++;
+
+			adler_a = (adler_a + value) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+	}
+
+	_ecds_soft_put_u32(out, (adler_b << 16) | adler_a);
+	out += 4;
+
+	_ecds_soft_put_u32(ihdr, sr->width);
+	_ecds_soft_put_u32(ihdr + 4, sr->height);
+	ihdr[8] = 8;		/* Bits per channel */
+	ihdr[9] = 6;		/* RGBA */
+	ihdr[10] = 0;		/* Deflate */
+	ihdr[11] = 0;		/* Adaptive filtering */
+	ihdr[12] = 0;		/* Not interlaced */
+
+	if (!(file = fopen(path, "wb")))
+	{
+		ecds_log_error("Could not open %s for writing", path);
+		ecds_memory_free(idat);
+		return -1;
+	}
+
+	ok = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+		_ecds_soft_write_chunk(file, crc_table, "IHDR", ihdr, sizeof(ihdr)) &&
+		_ecds_soft_write_chunk(file, crc_table, "IDAT", idat, (size_t)(out - idat)) &&
+		_ecds_soft_write_chunk(file, crc_table, "IEND", NULL, 0);
+
+	ecds_memory_free(idat);
+	if (fclose(file) != 0)
+		ok = false;
+
+	if (!ok)
+	{
+		ecds_log_error("Could not write %s", path);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************/
+/*	@file ecds_soft_renderer.h											 	 */
+/*	@brief Software rasterizer implementation of ecds_renderer_t.			 */
+/*																			 */
+/*	Renders all render buffers into a framebuffer in memory, so displays	 */
+/*	can be drawn and checked against golden images without a GPU.			 */
+/*																			 */
+/*	Coordinates are in pixels with the origin in the top left corner of		 */
+/*	the framebuffer and y pointing down, z is ignored. Geometry is filled	 */
+/*	with the colour of the last vertex of each primitive, lines and points	 */
+/*	are one pixel wide. Rectangles, ellipses, arcs and text are drawn at	 */
+/*	the origin of the current transform; they are outlined inside the line	 */
+/*	and vertex draw modes and filled otherwise.								 */
+/*																			 */
+/*	Every buffer starts out with an identity transform and opaque white,	 */
+/*	buffers do not affect each other.										 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_SOFT_RENDERER_H
+#define _ECDS_SOFT_RENDERER_H
+
+#include <ecds.h>
+
+#include <core/ecds_renderer.h>
+
+#define ECDS_TYPE_SOFT_RENDERER			0x30000002
+
+#define ECDS_SOFT_RENDERER_TILE_SIZE	64		//!< Width and height of the tiles the framebuffer is split into
+
+typedef struct _ecds_soft_renderer_t ecds_soft_renderer_t;
+typedef struct _ecds_soft_raster_t ecds_soft_raster_t;
+typedef struct _ecds_soft_renderer_stats_t ecds_soft_renderer_stats_t;
+
+struct _ecds_soft_renderer_stats_t {
+	uint64_t frames;					//!< Number of calls to ecds_soft_renderer_render()
+	uint64_t buffers_redrawn;			//!< Buffers assembled again because they changed
+	uint64_t buffers_skipped;			//!< Buffers whose cached triangles were reused
+	uint64_t tiles_rasterized;
+	uint64_t tiles_skipped;				//!< Tiles that kept their pixels because nothing in them changed
+	uint64_t shapes_cached;				//!< Rectangles, ellipses and arcs whose outline was found in the tessellation cache
+	uint64_t shapes_tessellated;		//!< Outlines that had to be computed
+	uint64_t texts_cached;				//!< Texts whose layout was found in the text cache
+	uint64_t texts_laid_out;			//!< Texts that had to be laid out
+	uint64_t characters_reused;			//!< Characters of laid out texts taken over from the last frame
+};
+
+struct _ecds_soft_renderer_t {
+	ecds_renderer_t renderer;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t * pixels;					//!< Framebuffer as 0xAARRGGBB, row by row without padding
+	uint32_t clear_colour;				//!< Colour every frame starts with, 0xAARRGGBB
+
+	ecds_soft_raster_t * raster;		//!< Rasterizer state and worker threads
+};
+
+/**
+ * @brief Create a software renderer.
+ * @param name The name for the new renderer.
+ * @param width, height The size of the framebuffer in pixels.
+ * @param thread_count The number of worker threads that rasterize tiles next to the calling thread, 0 to render on the calling thread only.
+ * @return The new renderer, or NULL if it could not be created.
+ */
+ecds_soft_renderer_t * ecds_soft_renderer_new(const char * name, uint32_t width, uint32_t height, uint32_t thread_count);
+
+/**
+ * @brief Bring the framebuffer up to date with the render buffers. Only buffers that changed since the previous
+ *		  frame are processed. This is also the run and commit callback of the renderer.
+ * @param renderer The renderer to act on.
+ */
+void ecds_soft_renderer_render(ecds_soft_renderer_t * renderer);
+
+/**
+ * @brief Make the next frame redraw the whole framebuffer, for example after the pixels were modified directly.
+ * @param renderer The renderer to act on.
+ */
+void ecds_soft_renderer_invalidate(ecds_soft_renderer_t * renderer);
+
+/**
+ * @brief Get the counters of the renderer since it was created.
+ * @param renderer The renderer to act on.
+ * @param stats Receives the counters.
+ */
+void ecds_soft_renderer_get_stats(ecds_soft_renderer_t * renderer, ecds_soft_renderer_stats_t * stats);
+
+/**
+ * @brief Configure how ellipses and arcs are tessellated. Buffers are assembled again with the new settings.
+ * @param renderer The renderer to act on.
+ * @param tolerance Maximum distance in pixels between an outline and the real curve, 0 for the default of
+ *		  ECDS_TESSELLATION_DEFAULT_TOLERANCE. Smaller values give smoother curves made of more triangles.
+ * @param memory_limit Bytes the tessellation cache may take, 0 for the default of ECDS_TESSELLATION_DEFAULT_LIMIT.
+ */
+void ecds_soft_renderer_set_tessellation(ecds_soft_renderer_t * renderer, double tolerance, size_t memory_limit);
+
+/**
+ * @brief Write the framebuffer to a binary PPM file, dropping the alpha channel.
+ * @param renderer The renderer to act on.
+ * @param path The file to write.
+ * @return 0 on success or a negative value if the file could not be written.
+ */
+int ecds_soft_renderer_write_ppm(ecds_soft_renderer_t * renderer, const char * path);
+
+/**
+ * @brief Write the framebuffer to an uncompressed RGBA PNG file.
+ * @param renderer The renderer to act on.
+ * @param path The file to write.
+ * @return 0 on success or a negative value if the file could not be written.
+ */
+int ecds_soft_renderer_write_png(ecds_soft_renderer_t * renderer, const char * path);
+
+#endif /* _ECDS_SOFT_RENDERER_H */
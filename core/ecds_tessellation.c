@@ -0,0 +1,265 @@
+/*****************************************************************************/
+/*	@file ecds_tessellation.c											 	 */
+/*	@brief Tessellation cache for rectangles, ellipses and arcs.			 */
+/*																			 */
+/*	A chord of a circle with radius r that spans the angle a strays			 */
+/*	r (1 - cos(a / 2)) from the circle, so a tolerance t allows segments	 */
+/*	of 2 acos(1 - t / r). Segment counts of full ellipses are rounded up	 */
+/*	to a multiple of four, which keeps outlines symmetric and lets a shape	 */
+/*	that is slowly zoomed reuse its entry over a range of scales.			 */
+/*																			 */
+/*****************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include <core/ecds_tessellation.h>
+
+#define ECDS_LOG_DOMAIN "ecds-tessellation"
+
+#define ECDS_TESSELLATION_PI				3.14159265358979323846
+
+//=================================== 8< ====================================//
+
+static uint32_t _ecds_tessellation_hash(const void * key)
+{
+	const ecds_tessellation_key_t * k = (const ecds_tessellation_key_t *)key;
+	const double values[4] = { k->width, k->height, k->start_angle, k->end_angle };
+	const unsigned char * bytes = (const unsigned char *)values;
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	/* FNV-1a over the fields, the padding of the key is left out */
+	hash = (hash ^ k->primitive) * 16777619u;
+	hash = (hash ^ k->segments) * 16777619u;
+	for (i = 0; i < sizeof(values); i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+
+	return hash;
+}
+
+static bool _ecds_tessellation_equal(const void * a, const void * b)
+{
+	const ecds_tessellation_key_t * ka = (const ecds_tessellation_key_t *)a;
+	const ecds_tessellation_key_t * kb = (const ecds_tessellation_key_t *)b;
+
+	/* Bitwise, so that NaN keys still find themselves */
+	return ka->primitive == kb->primitive && ka->segments == kb->segments &&
+		memcmp(&ka->width, &kb->width, sizeof(double)) == 0 && memcmp(&ka->height, &kb->height, sizeof(double)) == 0 &&
+		memcmp(&ka->start_angle, &kb->start_angle, sizeof(double)) == 0 && memcmp(&ka->end_angle, &kb->end_angle, sizeof(double)) == 0;
+}
+
+static void _ecds_tessellation_unlink(ecds_tessellation_cache_t * cache, ecds_tessellation_t * entry)
+{
+	if (entry->newer)
+		entry->newer->older = entry->older;
+	else
+		cache->newest = entry->older;
+
+	if (entry->older)
+		entry->older->newer = entry->newer;
+	else
+		cache->oldest = entry->newer;
+
+	entry->newer = entry->older = NULL;
+}
+
+static void _ecds_tessellation_link_newest(ecds_tessellation_cache_t * cache, ecds_tessellation_t * entry)
+{
+	entry->older = cache->newest;
+	entry->newer = NULL;
+
+	if (cache->newest)
+		cache->newest->newer = entry;
+	else
+		cache->oldest = entry;
+	cache->newest = entry;
+}
+
+static void _ecds_tessellation_evict(ecds_tessellation_cache_t * cache, ecds_tessellation_t * entry)
+{
+	_ecds_tessellation_unlink(cache, entry);
+	ecds_hash_table_remove(&cache->table, &entry->key);
+	cache->memory -= entry->size;
+	cache->evictions++;
+	ecds_memory_free(entry);
+}
+
+/* Evict the least recently used entries until the cache fits its limit, keep is never evicted */
+static void _ecds_tessellation_trim(ecds_tessellation_cache_t * cache, const ecds_tessellation_t * keep)
+{
+	while (cache->memory > cache->memory_limit && cache->oldest && cache->oldest != keep)
+		_ecds_tessellation_evict(cache, cache->oldest);
+}
+
+//=================================== 8< ====================================//
+
+void ecds_tessellation_cache_initialize(ecds_tessellation_cache_t * cache, double tolerance, size_t memory_limit)
+{
+	if (!cache)
+		return;
+
+	memset(cache, 0, sizeof(ecds_tessellation_cache_t));
+	ecds_hash_table_initialize(&cache->table, _ecds_tessellation_hash, _ecds_tessellation_equal);
+	cache->tolerance = tolerance > 0.0 ? tolerance : ECDS_TESSELLATION_DEFAULT_TOLERANCE;
+	cache->memory_limit = memory_limit ? memory_limit : ECDS_TESSELLATION_DEFAULT_LIMIT;
+}
+
+void ecds_tessellation_cache_clear(ecds_tessellation_cache_t * cache)
+{
+	ecds_tessellation_t * entry;
+
+	if (!cache)
+		return;
+
+	while ((entry = cache->oldest))
+	{
+		_ecds_tessellation_unlink(cache, entry);
+		ecds_memory_free(entry);
+	}
+
+	ecds_hash_table_clear(&cache->table);
+	cache->memory = 0;
+}
+
+void ecds_tessellation_cache_configure(ecds_tessellation_cache_t * cache, double tolerance, size_t memory_limit)
+{
+	if (!cache)
+		return;
+
+	tolerance = tolerance > 0.0 ? tolerance : ECDS_TESSELLATION_DEFAULT_TOLERANCE;
+	if (tolerance != cache->tolerance)
+	{
+		/* Every segment count changes, nothing in the cache would be found again */
+		ecds_tessellation_cache_clear(cache);
+		cache->tolerance = tolerance;
+	}
+
+	cache->memory_limit = memory_limit ? memory_limit : ECDS_TESSELLATION_DEFAULT_LIMIT;
+	_ecds_tessellation_trim(cache, NULL);
+}
+
+uint32_t ecds_tessellation_segments(double width, double height, double sweep, double scale, double tolerance)
+{
+	double radius = 0.5 * fmax(fabs(width), fabs(height)) * fabs(scale);
+	double segments = ECDS_TESSELLATION_MIN_SEGMENTS;
+	uint32_t full;
+
+	if (radius > tolerance && tolerance > 0.0)
+		segments = ceil(2.0 * ECDS_TESSELLATION_PI / (2.0 * acos(1.0 - tolerance / radius)));
+
+	/* Also catches NaN */
+	if (!(segments >= ECDS_TESSELLATION_MIN_SEGMENTS))
+		segments = ECDS_TESSELLATION_MIN_SEGMENTS;
+	if (segments > ECDS_TESSELLATION_MAX_SEGMENTS)
+		segments = ECDS_TESSELLATION_MAX_SEGMENTS;
+	full = ((uint32_t)segments + 3) & ~3u;
+
+	sweep = fabs(sweep);
+	if (!(sweep < 360.0))
+		return full;
+
+	segments = ceil(full * sweep / 360.0);
+	return segments < 2.0 ? 2 : (uint32_t)segments;
+}
+
+const ecds_tessellation_t * ecds_tessellation_cache_get(ecds_tessellation_cache_t * cache, unsigned int primitive,
+	double width, double height, double start_angle, double end_angle, double scale)
+{
+	ecds_tessellation_key_t key;
+	ecds_tessellation_t * entry;
+	uint32_t count, i;
+	double sweep, angle;
+	float * point;
+	size_t size;
+
+	if (!cache)
+		return NULL;
+
+	memset(&key, 0, sizeof(key));
+	key.width = width;
+	key.height = height;
+
+	switch (primitive)
+	{
+	case ECDS_RENDER_PARAM_RECTANGLE:
+		key.primitive = primitive;
+		count = 4;
+		break;
+
+	case ECDS_RENDER_PARAM_ARC:
+		sweep = end_angle - start_angle;
+		if (fabs(sweep) < 360.0)
+		{
+			key.primitive = primitive;
+			key.start_angle = start_angle;
+			key.end_angle = end_angle;
+			key.segments = ecds_tessellation_segments(width, height, sweep, scale, cache->tolerance);
+			count = key.segments + 1;
+			break;
+		}
+		/* An arc all the way around is an ellipse */
+		/* fall through */
+	case ECDS_RENDER_PARAM_ELLIPSE:
+		key.primitive = ECDS_RENDER_PARAM_ELLIPSE;
+		key.segments = ecds_tessellation_segments(width, height, 360.0, scale, cache->tolerance);
+		count = key.segments;
+		break;
+
+	default:
+		return NULL;
+	}
+
+	if ((entry = (ecds_tessellation_t *)ecds_hash_table_lookup(&cache->table, &key)))
+	{
+		_ecds_tessellation_unlink(cache, entry);
+		_ecds_tessellation_link_newest(cache, entry);
+		cache->hits++;
+		return entry;
+	}
+
+	size = sizeof(ecds_tessellation_t) + (size_t)count * 3 * sizeof(float);
+	if (!(entry = (ecds_tessellation_t *)ecds_memory_alloc(size)))
+	{
+		ecds_log_error("Out of memory when tessellating a shape into %u points", count);
+		return NULL;
+	}
+
+	entry->key = key;
+	entry->size = size;
+	entry->point_count = count;
+	entry->points = point = (float *)(entry + 1);
+
+	if (key.primitive == ECDS_RENDER_PARAM_RECTANGLE)
+	{
+		point[3] = (float)width;
+		point[6] = (float)width;
+		point[7] = (float)height;
+		point[10] = (float)height;
+		entry->closed = true;
+	}
+	else
+	{
+		sweep = key.primitive == ECDS_RENDER_PARAM_ELLIPSE ? 360.0 : end_angle - start_angle;
+		for (i = 0; i < count; i++, point += 3)
+		{
+			angle = (key.start_angle + sweep * i / key.segments) * ECDS_TESSELLATION_PI / 180.0;
+			point[0] = (float)(width * 0.5 * cos(angle));
+			point[1] = (float)(height * 0.5 * sin(angle));
+		}
+		entry->closed = key.primitive == ECDS_RENDER_PARAM_ELLIPSE;
+	}
+
+	if (!ecds_hash_table_insert(&cache->table, &entry->key, entry))
+	{
+		ecds_memory_free(entry);
+		return NULL;
+	}
+
+	_ecds_tessellation_link_newest(cache, entry);
+	cache->memory += size;
+	cache->misses++;
+	_ecds_tessellation_trim(cache, entry);
+
+	return entry;
+}
@@ -0,0 +1,111 @@
+/*****************************************************************************/
+/*	@file ecds_tessellation.h											 	 */
+/*	@brief Tessellation cache for rectangles, ellipses and arcs.			 */
+/*																			 */
+/*	Renderer implementations that draw shapes as polygons look up their		 */
+/*	outline here instead of evaluating sines and cosines on every frame.	 */
+/*	The number of segments follows from the size of the shape on screen		 */
+/*	and a tolerance: the largest distance in pixels the polygon may stray	 */
+/*	from the real curve. Outlines are kept in the local coordinates of the	 */
+/*	shape, so one entry serves every position and rotation, and are			 */
+/*	evicted least recently used first once a memory limit is exceeded.		 */
+/*																			 */
+/*	Like the hash table, a cache is embedded in its owner and is not		 */
+/*	thread-safe.															 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_TESSELLATION_H
+#define _ECDS_TESSELLATION_H
+
+#include <ecds.h>
+
+#include <common/ecds_hash_table.h>
+#include <core/ecds_renderer.h>
+
+#define ECDS_TESSELLATION_DEFAULT_TOLERANCE		0.25		//!< Maximum deviation from the curve in pixels
+#define ECDS_TESSELLATION_DEFAULT_LIMIT			(1 << 20)	//!< Default memory limit in bytes
+#define ECDS_TESSELLATION_MIN_SEGMENTS			8			//!< Segments of a full ellipse, however small
+#define ECDS_TESSELLATION_MAX_SEGMENTS			1024		//!< Segments of a full ellipse, however large
+
+typedef struct _ecds_tessellation_t ecds_tessellation_t;
+typedef struct _ecds_tessellation_key_t ecds_tessellation_key_t;
+typedef struct _ecds_tessellation_cache_t ecds_tessellation_cache_t;
+
+struct _ecds_tessellation_key_t {
+	unsigned int primitive;				//!< ECDS_RENDER_PARAM_RECTANGLE, _ELLIPSE or _ARC
+	uint32_t segments;					//!< Follows from the tolerance and the size on screen, 0 for rectangles
+	double width;
+	double height;
+	double start_angle;					//!< Degrees, 0 for rectangles and full ellipses
+	double end_angle;
+};
+
+/**
+ * The outline of a shape. Rectangles start at the origin, ellipses and arcs are centred on it. Arcs run from
+ * start_angle to end_angle; a pie slice adds the origin in front of the points.
+ */
+struct _ecds_tessellation_t {
+	ecds_tessellation_key_t key;
+	bool closed;						//!< Whether the last point connects back to the first
+	uint32_t point_count;
+	float * points;						//!< x, y, z triplets with z = 0, as expected by ecds_transform_points()
+
+	size_t size;						//!< Bytes taken by the entry
+	ecds_tessellation_t * newer;		//!< Neighbours in the LRU order
+	ecds_tessellation_t * older;
+};
+
+struct _ecds_tessellation_cache_t {
+	ecds_hash_table_t table;			//!< ecds_tessellation_key_t to ecds_tessellation_t
+	ecds_tessellation_t * newest;
+	ecds_tessellation_t * oldest;
+	size_t memory;						//!< Bytes taken by all entries
+	size_t memory_limit;
+	double tolerance;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+/**
+ * @brief Set up an empty cache.
+ * @param cache The cache to initialize.
+ * @param tolerance Maximum deviation from the curve in pixels, 0 for ECDS_TESSELLATION_DEFAULT_TOLERANCE.
+ * @param memory_limit Bytes the entries may take, 0 for ECDS_TESSELLATION_DEFAULT_LIMIT.
+ */
+void ecds_tessellation_cache_initialize(ecds_tessellation_cache_t * cache, double tolerance, size_t memory_limit);
+
+//!< @brief Free all entries of a cache. The cache can be used again afterwards.
+void ecds_tessellation_cache_clear(ecds_tessellation_cache_t * cache);
+
+/**
+ * @brief Change the tolerance and memory limit of a cache, evicting entries that no longer fit.
+ * @param cache The cache to act on.
+ * @param tolerance, memory_limit As for ecds_tessellation_cache_initialize().
+ */
+void ecds_tessellation_cache_configure(ecds_tessellation_cache_t * cache, double tolerance, size_t memory_limit);
+
+/**
+ * @brief Compute the number of segments an ellipse is split into.
+ * @param width, height The size of the ellipse.
+ * @param sweep The angle covered in degrees, 360 for a full ellipse.
+ * @param scale The size of one unit on screen in pixels.
+ * @param tolerance Maximum deviation from the curve in pixels.
+ * @return The number of segments, at least 2 for arcs.
+ */
+uint32_t ecds_tessellation_segments(double width, double height, double sweep, double scale, double tolerance);
+
+/**
+ * @brief Get the outline of a shape, tessellating it if it is not in the cache yet.
+ * @param cache The cache to act on.
+ * @param primitive ECDS_RENDER_PARAM_RECTANGLE, ECDS_RENDER_PARAM_ELLIPSE or ECDS_RENDER_PARAM_ARC.
+ * @param width, height The size of the shape.
+ * @param start_angle, end_angle The angles of an arc in degrees, ignored for the other shapes.
+ * @param scale The size of one unit on screen in pixels, from the transform the shape is drawn with.
+ * @return The outline, valid until the next call on the cache, or NULL if the primitive is unknown or memory ran out.
+ */
+const ecds_tessellation_t * ecds_tessellation_cache_get(ecds_tessellation_cache_t * cache, unsigned int primitive,
+	double width, double height, double start_angle, double end_angle, double scale);
+
+#endif /* _ECDS_TESSELLATION_H */
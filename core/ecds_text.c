@@ -0,0 +1,476 @@
+/*****************************************************************************/
+/*	@file ecds_text.c													 	 */
+/*	@brief Glyph atlas and text layout cache for renderer implementations.	 */
+/*																			 */
+/*	Glyphs are placed in the atlas on shelves: left to right in rows as		 */
+/*	high as their tallest glyph, with a pixel of space around each so		 */
+/*	filtering does not bleed between glyphs. The atlas grows downwards.		 */
+/*																			 */
+/*	Layout only depends on the characters before a glyph, so a new run		 */
+/*	takes the glyphs of the common prefix from the previous run of its		 */
+/*	slot as they are. The glyphs of the common suffix keep their place		 */
+/*	relative to each other and are moved by the difference the changed		 */
+/*	characters make; on lines after a line break in the suffix only the		 */
+/*	vertical difference applies.											 */
+/*																			 */
+/*****************************************************************************/
+
+#include <string.h>
+
+#include <core/ecds_text.h>
+
+#define ECDS_LOG_DOMAIN "ecds-text"
+
+//!< Tallest glyph the cache accepts, bounds the rectangles of a glyph.
+#define ECDS_TEXT_MAX_GLYPH_HEIGHT		64
+
+//!< Height of the atlas when the first glyph is added.
+#define ECDS_TEXT_ATLAS_INITIAL_HEIGHT	32
+
+//=================================== 8< ====================================//
+//	Glyphs																	 //
+//===========================================================================//
+
+static uint32_t _ecds_text_glyph_hash(const void * key)
+{
+	const ecds_glyph_key_t * k = (const ecds_glyph_key_t *)key;
+
+	return (k->character ^ (k->font_id * 0x85EBCA6Bu) ^ ((k->character ^ k->font_id) >> 16)) * 0x9E3779B1u;
+}
+
+static bool _ecds_text_glyph_equal(const void * a, const void * b)
+{
+	const ecds_glyph_key_t * ka = (const ecds_glyph_key_t *)a;
+	const ecds_glyph_key_t * kb = (const ecds_glyph_key_t *)b;
+
+	return ka->font_id == kb->font_id && ka->character == kb->character;
+}
+
+/* Make room for a width x height bitmap in the atlas, returns false if memory ran out */
+static bool _ecds_text_atlas_place(ecds_text_cache_t * cache, uint32_t width, uint32_t height, uint32_t * x, uint32_t * y)
+{
+	uint32_t new_height;
+	uint8_t * atlas;
+
+	if (cache->shelf_x + width + 1 > cache->atlas_width)
+	{
+		cache->shelf_x = 0;
+		cache->shelf_y += cache->shelf_height;
+		cache->shelf_height = 0;
+	}
+
+	if (cache->shelf_y + height + 1 > cache->atlas_height)
+	{
+		new_height = cache->atlas_height ? cache->atlas_height * 2 : ECDS_TEXT_ATLAS_INITIAL_HEIGHT;
+		while (new_height < cache->shelf_y + height + 1)
+			new_height *= 2;
+
+		if (!(atlas = (uint8_t *)ecds_memory_alloc((size_t)cache->atlas_width * new_height)))
+		{
+			ecds_log_error("Out of memory when growing the glyph atlas to %ux%u", cache->atlas_width, new_height);
+			return false;
+		}
+
+		if (cache->atlas)
+		{
+			memcpy(atlas, cache->atlas, (size_t)cache->atlas_width * cache->atlas_height);
+			ecds_memory_free(cache->atlas);
+		}
+		cache->atlas = atlas;
+		cache->atlas_height = new_height;
+	}
+
+	/* One pixel of space to the left and above every glyph */
+	*x = cache->shelf_x + 1;
+	*y = cache->shelf_y + 1;
+	cache->shelf_x += width + 1;
+	if (height + 1 > cache->shelf_height)
+		cache->shelf_height = height + 1;
+
+	return true;
+}
+
+static ecds_glyph_t * _ecds_text_new_glyph(ecds_text_cache_t * cache, const ecds_font_t * font, uint32_t character)
+{
+	ecds_glyph_rect_t rects[ECDS_TEXT_MAX_GLYPH_HEIGHT * 4];
+	const uint8_t * rows = font->get_glyph(character);
+	uint32_t width = font->glyph_width, height = font->glyph_height;
+	uint32_t count = 0, row, column, run, r;
+	ecds_glyph_t * glyph;
+
+	if (width > 8 || height > ECDS_TEXT_MAX_GLYPH_HEIGHT || !rows)
+	{
+		ecds_log_error("Glyphs of font %s are too large to be cached", font->name);
+		return NULL;
+	}
+
+	for (row = 0; row < height; row++)
+	{
+		for (column = 0; column < width; column += run)
+		{
+			run = 1;
+			if (!(rows[row] & (1u << (width - 1 - column))))
+				continue;
+			while (column + run < width && (rows[row] & (1u << (width - 1 - column - run))))
+				run++;
+
+			/* Extend a rectangle that ends right above this run and has the same columns */
+			for (r = 0; r < count; r++)
+			{
+				if (rects[r].x == column && rects[r].width == run && rects[r].y + rects[r].height == row)
+					break;
+			}
+
+			if (r < count)
+				rects[r].height++;
+			else
+			{
+				rects[count].x = (uint8_t)column;
+				rects[count].y = (uint8_t)row;
+				rects[count].width = (uint8_t)run;
+				rects[count].height = 1;
+				count++;
+			}
+		}
+	}
+
+	if (!(glyph = (ecds_glyph_t *)ecds_memory_alloc(sizeof(ecds_glyph_t) + count * sizeof(ecds_glyph_rect_t))))
+	{
+		ecds_log_error("Out of memory when adding a glyph");
+		return NULL;
+	}
+
+	glyph->key.font_id = font->id;
+	glyph->key.character = character;
+	glyph->width = width;
+	glyph->height = height;
+	glyph->advance = font->advance;
+	glyph->rect_count = count;
+	glyph->rects = (ecds_glyph_rect_t *)(glyph + 1);
+	memcpy(glyph->rects, rects, count * sizeof(ecds_glyph_rect_t));
+
+	if (!_ecds_text_atlas_place(cache, width, height, &glyph->atlas_x, &glyph->atlas_y) ||
+		!ecds_hash_table_insert(&cache->glyphs, &glyph->key, glyph))
+	{
+		ecds_memory_free(glyph);
+		return NULL;
+	}
+
+	for (row = 0; row < height; row++)
+	{
+		uint8_t * target = cache->atlas + (size_t)(glyph->atlas_y + row) * cache->atlas_width + glyph->atlas_x;
+
+		for (column = 0; column < width; column++)
+			target[column] = (rows[row] & (1u << (width - 1 - column))) ? 255 : 0;
+	}
+	cache->atlas_revision++;
+
+	return glyph;
+}
+
+const ecds_glyph_t * ecds_text_cache_get_glyph(ecds_text_cache_t * cache, const ecds_font_t * font, uint32_t character)
+{
+	ecds_glyph_key_t key;
+	ecds_glyph_t * glyph;
+
+	if (!cache || !font)
+		return NULL;
+
+	key.font_id = font->id;
+	key.character = character;
+	if ((glyph = (ecds_glyph_t *)ecds_hash_table_lookup(&cache->glyphs, &key)))
+		return glyph;
+
+	return _ecds_text_new_glyph(cache, font, character);
+}
+
+//=================================== 8< ====================================//
+//	Runs																	 //
+//===========================================================================//
+
+static uint32_t _ecds_text_run_hash(const void * key)
+{
+	const ecds_text_key_t * k = (const ecds_text_key_t *)key;
+	uint32_t hash = 2166136261u, i;
+
+	/* FNV-1a */
+	hash = (hash ^ k->font_id) * 16777619u;
+	for (i = 0; i < k->length; i++)
+		hash = (hash ^ (uint8_t)k->text[i]) * 16777619u;
+
+	return hash;
+}
+
+static bool _ecds_text_run_equal(const void * a, const void * b)
+{
+	const ecds_text_key_t * ka = (const ecds_text_key_t *)a;
+	const ecds_text_key_t * kb = (const ecds_text_key_t *)b;
+
+	return ka->font_id == kb->font_id && ka->length == kb->length && memcmp(ka->text, kb->text, ka->length) == 0;
+}
+
+static void _ecds_text_unlink(ecds_text_cache_t * cache, ecds_text_run_t * run)
+{
+	if (run->newer)
+		run->newer->older = run->older;
+	else
+		cache->newest = run->older;
+
+	if (run->older)
+		run->older->newer = run->newer;
+	else
+		cache->oldest = run->newer;
+
+	run->newer = run->older = NULL;
+}
+
+static void _ecds_text_link_newest(ecds_text_cache_t * cache, ecds_text_run_t * run)
+{
+	run->older = cache->newest;
+	run->newer = NULL;
+
+	if (cache->newest)
+		cache->newest->newer = run;
+	else
+		cache->oldest = run;
+	cache->newest = run;
+}
+
+static inline uint32_t _ecds_text_slot_index(uint64_t slot)
+{
+	slot ^= slot >> 33;
+	slot *= 0xFF51AFD7ED558CCDull;
+	slot ^= slot >> 33;
+
+	return (uint32_t)(slot % ECDS_TEXT_SLOTS);
+}
+
+/* Remember run as the last run drawn in slot */
+static void _ecds_text_set_slot(ecds_text_cache_t * cache, uint64_t slot, ecds_text_run_t * run)
+{
+	uint32_t index = _ecds_text_slot_index(slot);
+	ecds_text_slot_t * entry = &cache->slots[index];
+
+	if (entry->run && entry->run != run)
+		entry->run->slot = -1;
+	if (run->slot >= 0 && (uint32_t)run->slot != index)
+		cache->slots[run->slot].run = NULL;
+
+	entry->slot = slot;
+	entry->run = run;
+	run->slot = (int32_t)index;
+}
+
+static void _ecds_text_evict(ecds_text_cache_t * cache, ecds_text_run_t * run)
+{
+	_ecds_text_unlink(cache, run);
+	ecds_hash_table_remove(&cache->runs, &run->key);
+	if (run->slot >= 0)
+		cache->slots[run->slot].run = NULL;
+	cache->memory -= run->size;
+	ecds_memory_free(run);
+}
+
+/* Lay out text, taking over what did not change from base, which may be NULL */
+static ecds_text_run_t * _ecds_text_new_run(ecds_text_cache_t * cache, const ecds_font_t * font, const char * text, uint32_t length, const ecds_text_run_t * base)
+{
+	uint32_t prefix = 0, suffix = 0, i, from;
+	float pen_x = 0.0f, pen_y = 0.0f, dx, dy;
+	ecds_text_run_t * run;
+	ecds_text_glyph_t * glyph;
+	char * copy;
+	size_t size;
+
+	size = sizeof(ecds_text_run_t) + (size_t)length * sizeof(ecds_text_glyph_t) + length;
+	if (!(run = (ecds_text_run_t *)ecds_memory_alloc(size)))
+	{
+		ecds_log_error("Out of memory when laying out %u characters", length);
+		return NULL;
+	}
+
+	run->glyphs = (ecds_text_glyph_t *)(run + 1);
+	copy = (char *)(run->glyphs + length);
+	memcpy(copy, text, length);
+	run->key.font_id = font->id;
+	run->key.length = length;
+	run->key.text = copy;
+	run->glyph_count = length;
+	run->size = size;
+	run->slot = -1;
+
+	if (base)
+	{
+		while (prefix < length && prefix < base->key.length && text[prefix] == base->key.text[prefix])
+			prefix++;
+		while (suffix < length - prefix && suffix < base->key.length - prefix &&
+			text[length - 1 - suffix] == base->key.text[base->key.length - 1 - suffix])
+			suffix++;
+
+		memcpy(run->glyphs, base->glyphs, prefix * sizeof(ecds_text_glyph_t));
+		if (prefix)
+		{
+			glyph = &run->glyphs[prefix - 1];
+			if (text[prefix - 1] == '\n')
+			{
+				pen_x = 0.0f;
+				pen_y = glyph->y + (float)font->line_height;
+			}
+			else
+			{
+				pen_x = glyph->x + (float)glyph->glyph->advance;
+				pen_y = glyph->y;
+			}
+		}
+	}
+
+	for (i = prefix; i < length - suffix; i++)
+	{
+		glyph = &run->glyphs[i];
+		glyph->x = pen_x;
+		glyph->y = pen_y;
+
+		if (text[i] == '\n')
+		{
+			glyph->glyph = NULL;
+			pen_x = 0.0f;
+			pen_y += (float)font->line_height;
+			continue;
+		}
+
+		if (!(glyph->glyph = ecds_text_cache_get_glyph(cache, font, (uint8_t)text[i])))
+		{
+			ecds_memory_free(run);
+			return NULL;
+		}
+		pen_x += (float)glyph->glyph->advance;
+	}
+
+	if (suffix)
+	{
+		from = base->key.length - suffix;
+		dx = pen_x - base->glyphs[from].x;
+		dy = pen_y - base->glyphs[from].y;
+
+		for (i = 0; i < suffix; i++)
+		{
+			glyph = &run->glyphs[length - suffix + i];
+			*glyph = base->glyphs[from + i];
+			glyph->x += dx;
+			glyph->y += dy;
+
+			/* Lines after a line break start at x = 0 no matter what came before */
+			if (glyph->glyph == NULL)
+				dx = 0.0f;
+		}
+	}
+
+	for (i = 0; i < length; i++)
+	{
+		glyph = &run->glyphs[i];
+		if (!glyph->glyph)
+			continue;
+		if (glyph->x + (float)glyph->glyph->width > run->width)
+			run->width = glyph->x + (float)glyph->glyph->width;
+		if (glyph->y + (float)glyph->glyph->height > run->height)
+			run->height = glyph->y + (float)glyph->glyph->height;
+	}
+
+	cache->characters_reused += prefix + suffix;
+	cache->characters_laid_out += length - prefix - suffix;
+
+	return run;
+}
+
+void ecds_text_cache_initialize(ecds_text_cache_t * cache, size_t memory_limit)
+{
+	if (!cache)
+		return;
+
+	memset(cache, 0, sizeof(ecds_text_cache_t));
+	ecds_hash_table_initialize(&cache->glyphs, _ecds_text_glyph_hash, _ecds_text_glyph_equal);
+	ecds_hash_table_initialize(&cache->runs, _ecds_text_run_hash, _ecds_text_run_equal);
+	cache->memory_limit = memory_limit ? memory_limit : ECDS_TEXT_DEFAULT_LIMIT;
+	cache->atlas_width = ECDS_TEXT_ATLAS_WIDTH;
+}
+
+void ecds_text_cache_clear(ecds_text_cache_t * cache)
+{
+	ecds_text_run_t * run;
+	uint32_t i;
+
+	if (!cache)
+		return;
+
+	while ((run = cache->oldest))
+	{
+		_ecds_text_unlink(cache, run);
+		ecds_memory_free(run);
+	}
+	ecds_hash_table_clear(&cache->runs);
+	memset(cache->slots, 0, sizeof(cache->slots));
+	cache->memory = 0;
+
+	/* Glyphs are only reachable through the table */
+	for (i = 0; cache->glyphs.slots && i <= cache->glyphs.mask; i++)
+	{
+		if (cache->glyphs.slots[i].key && !cache->glyphs.slots[i].removed)
+			ecds_memory_free(cache->glyphs.slots[i].value);
+	}
+	ecds_hash_table_clear(&cache->glyphs);
+
+	ecds_memory_free(cache->atlas);
+	cache->atlas = NULL;
+	cache->atlas_height = 0;
+	cache->shelf_x = cache->shelf_y = cache->shelf_height = 0;
+	cache->atlas_revision++;
+}
+
+const ecds_text_run_t * ecds_text_cache_layout(ecds_text_cache_t * cache, const ecds_font_t * font, const char * text, uint32_t length, uint64_t slot)
+{
+	const ecds_text_run_t * base = NULL;
+	ecds_text_slot_t * entry;
+	ecds_text_run_t * run;
+	ecds_text_key_t key;
+
+	if (!cache || !font || (length && !text))
+		return NULL;
+
+	key.font_id = font->id;
+	key.length = length;
+	key.text = text;
+
+	if ((run = (ecds_text_run_t *)ecds_hash_table_lookup(&cache->runs, &key)))
+	{
+		_ecds_text_unlink(cache, run);
+		_ecds_text_link_newest(cache, run);
+		cache->runs_cached++;
+	}
+	else
+	{
+		entry = &cache->slots[_ecds_text_slot_index(slot)];
+		if (slot && entry->run && entry->slot == slot && entry->run->key.font_id == font->id)
+			base = entry->run;
+
+		if (!(run = _ecds_text_new_run(cache, font, text, length, base)))
+			return NULL;
+
+		if (!ecds_hash_table_insert(&cache->runs, &run->key, run))
+		{
+			ecds_memory_free(run);
+			return NULL;
+		}
+
+		_ecds_text_link_newest(cache, run);
+		cache->memory += run->size;
+		cache->runs_laid_out++;
+
+		/* The new run is the newest, so it survives this */
+		while (cache->memory > cache->memory_limit && cache->oldest != run)
+			_ecds_text_evict(cache, cache->oldest);
+	}
+
+	if (slot)
+		_ecds_text_set_slot(cache, slot, run);
+
+	return run;
+}
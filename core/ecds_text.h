@@ -0,0 +1,150 @@
+/*****************************************************************************/
+/*	@file ecds_text.h													 	 */
+/*	@brief Glyph atlas and text layout cache for renderer implementations.	 */
+/*																			 */
+/*	Glyphs are rasterized once per font into an 8-bit coverage atlas that	 */
+/*	GPU renderers can upload as a texture, together with their metrics		 */
+/*	and their set pixels merged into rectangles for renderers that draw		 */
+/*	text as geometry.														 */
+/*																			 */
+/*	Laid out strings, runs, are cached by font and text. Displays mostly	 */
+/*	redraw the same labels, and values that change in a few digits: a run	 */
+/*	that is not in the cache is laid out starting from the run that was		 */
+/*	last drawn in the same slot, so only the characters between the			 */
+/*	common prefix and the common suffix are looked up and placed again.		 */
+/*	A slot is any number the caller uses to tell the places where text		 */
+/*	is drawn apart, such as the position of the text in a render buffer.	 */
+/*																			 */
+/*	Like the hash table, a cache is embedded in its owner and is not		 */
+/*	thread-safe.															 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_TEXT_H
+#define _ECDS_TEXT_H
+
+#include <ecds.h>
+
+#include <common/ecds_hash_table.h>
+#include <core/ecds_font.h>
+
+#define ECDS_TEXT_DEFAULT_LIMIT			(256 * 1024)	//!< Default memory limit of the run cache in bytes
+#define ECDS_TEXT_SLOTS					256				//!< Number of slots whose last run is remembered
+#define ECDS_TEXT_ATLAS_WIDTH			128				//!< Width of the glyph atlas, it grows downwards
+
+typedef struct _ecds_glyph_key_t ecds_glyph_key_t;
+typedef struct _ecds_glyph_rect_t ecds_glyph_rect_t;
+typedef struct _ecds_glyph_t ecds_glyph_t;
+typedef struct _ecds_text_glyph_t ecds_text_glyph_t;
+typedef struct _ecds_text_key_t ecds_text_key_t;
+typedef struct _ecds_text_run_t ecds_text_run_t;
+typedef struct _ecds_text_slot_t ecds_text_slot_t;
+typedef struct _ecds_text_cache_t ecds_text_cache_t;
+
+struct _ecds_glyph_key_t {
+	uint32_t font_id;
+	uint32_t character;
+};
+
+//!< A rectangle of set pixels in a glyph, in pixels from the top left corner of the glyph.
+struct _ecds_glyph_rect_t {
+	uint8_t x;
+	uint8_t y;
+	uint8_t width;
+	uint8_t height;
+};
+
+struct _ecds_glyph_t {
+	ecds_glyph_key_t key;
+	uint32_t width;						//!< Size of the bitmap in pixels
+	uint32_t height;
+	uint32_t advance;					//!< Distance to the origin of the next glyph
+	uint32_t atlas_x;					//!< Top left corner of the bitmap in the atlas
+	uint32_t atlas_y;
+	uint32_t rect_count;
+	ecds_glyph_rect_t * rects;			//!< Set pixels, rows merged into as few rectangles as possible
+};
+
+//!< A glyph placed in a run. Line breaks have no glyph.
+struct _ecds_text_glyph_t {
+	const ecds_glyph_t * glyph;
+	float x;							//!< Top left corner of the glyph relative to the origin of the run
+	float y;
+};
+
+struct _ecds_text_key_t {
+	uint32_t font_id;
+	uint32_t length;
+	const char * text;					//!< Points into the run, not NUL-terminated
+};
+
+struct _ecds_text_run_t {
+	ecds_text_key_t key;
+	uint32_t glyph_count;				//!< One per character, including line breaks
+	ecds_text_glyph_t * glyphs;
+	float width;						//!< Extent of the laid out text in pixels
+	float height;
+
+	size_t size;						//!< Bytes taken by the run
+	int32_t slot;						//!< Index of the slot that remembers the run, -1 for none
+	ecds_text_run_t * newer;			//!< Neighbours in the LRU order
+	ecds_text_run_t * older;
+};
+
+struct _ecds_text_slot_t {
+	uint64_t slot;
+	ecds_text_run_t * run;
+};
+
+struct _ecds_text_cache_t {
+	ecds_hash_table_t glyphs;			//!< ecds_glyph_key_t to ecds_glyph_t
+	ecds_hash_table_t runs;				//!< ecds_text_key_t to ecds_text_run_t
+	ecds_text_run_t * newest;
+	ecds_text_run_t * oldest;
+	size_t memory;						//!< Bytes taken by all runs
+	size_t memory_limit;
+	ecds_text_slot_t slots[ECDS_TEXT_SLOTS];
+
+	uint8_t * atlas;					//!< Coverage of all glyphs, 0 or 255, row by row
+	uint32_t atlas_width;
+	uint32_t atlas_height;
+	uint32_t atlas_revision;			//!< Incremented whenever a glyph is added
+	uint32_t shelf_x;					//!< Where the next glyph goes in the atlas
+	uint32_t shelf_y;
+	uint32_t shelf_height;
+
+	uint64_t runs_cached;				//!< Lookups that found their run
+	uint64_t runs_laid_out;				//!< Lookups that had to lay out a run
+	uint64_t characters_reused;			//!< Characters taken over from the previous run of a slot
+	uint64_t characters_laid_out;
+};
+
+/**
+ * @brief Set up an empty cache.
+ * @param cache The cache to initialize.
+ * @param memory_limit Bytes the runs may take, 0 for ECDS_TEXT_DEFAULT_LIMIT. Glyphs are never evicted.
+ */
+void ecds_text_cache_initialize(ecds_text_cache_t * cache, size_t memory_limit);
+
+//!< @brief Free all glyphs, runs and the atlas of a cache. The cache can be used again afterwards.
+void ecds_text_cache_clear(ecds_text_cache_t * cache);
+
+/**
+ * @brief Get a glyph, adding it to the atlas if it is not there yet.
+ * @param cache The cache to act on.
+ * @param font The font to take the glyph from.
+ * @param character The character to look up.
+ * @return The glyph, valid until the cache is cleared, or NULL if memory ran out.
+ */
+const ecds_glyph_t * ecds_text_cache_get_glyph(ecds_text_cache_t * cache, const ecds_font_t * font, uint32_t character);
+
+/**
+ * @brief Get a laid out run of text. Lines are separated by '\n' and start at x = 0, the first line at y = 0.
+ * @param cache The cache to act on.
+ * @param font The font to lay the text out in.
+ * @param text, length The text, which does not need to be NUL-terminated.
+ * @param slot Where the text is drawn, 0 if the caller does not track this.
+ * @return The run, valid until the next call on the cache, or NULL if memory ran out.
+ */
+const ecds_text_run_t * ecds_text_cache_layout(ecds_text_cache_t * cache, const ecds_font_t * font, const char * text, uint32_t length, uint64_t slot);
+
+#endif /* _ECDS_TEXT_H */
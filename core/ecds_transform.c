@@ -0,0 +1,493 @@
+/*****************************************************************************/
+/*	@file ecds_transform.c												 	 */
+/*	@brief Transform stack and vertex transform kernels for renderers.		 */
+/*																			 */
+/*	The vertex kernels work on interleaved x, y pairs: two vertices fill	 */
+/*	one SSE register and four fill one AVX register, so the result can be	 */
+/*	stored without transposing. Every kernel performs the same multiplies	 */
+/*	and additions in the same order as the scalar loop. SSE2 is used when	 */
+/*	the compiler targets it; AVX is compiled in separately and chosen at	 */
+/*	run time when the processor and operating system support it.			 */
+/*																			 */
+/*****************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define ECDS_TRANSFORM_SSE2
+#endif
+
+#if defined(ECDS_TRANSFORM_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define ECDS_TRANSFORM_AVX
+#endif
+
+#include <ecds.h>
+#include <common/ecds_log.h>
+
+#include <core/ecds_transform.h>
+
+#define ECDS_LOG_DOMAIN "ecds-transform"
+
+#define ECDS_TRANSFORM_PI				3.14159265358979323846
+
+//!< Vertices converted from doubles at a time by ecds_transform_points_f64().
+#define ECDS_TRANSFORM_F64_BATCH		256
+
+//!< Values of a transform parameter that are taken into account.
+#define ECDS_TRANSFORM_MAX_VALUES		4
+
+struct _ecds_transform_cache_entry_t {
+	uint64_t key;						//!< 0 for an unused entry
+	uint64_t parent_key;				//!< Key of the matrix the transform was applied to
+	unsigned int mode;
+	uint32_t count;
+	double values[ECDS_TRANSFORM_MAX_VALUES];
+	ecds_matrix_t matrix;				//!< Result of the transform
+};
+
+typedef void (*ecds_transform_points_fn)(const float * m, const float * vertices, size_t count, float * points);
+
+//=================================== 8< ====================================//
+//	Matrices																 //
+//===========================================================================//
+
+void ecds_matrix_identity(ecds_matrix_t * matrix)
+{
+	memset(matrix, 0, sizeof(ecds_matrix_t));
+	matrix->m[0] = matrix->m[5] = matrix->m[10] = matrix->m[15] = 1.0f;
+}
+
+void ecds_matrix_multiply(ecds_matrix_t * result, const ecds_matrix_t * a, const ecds_matrix_t * b)
+{
+	ecds_matrix_t product;
+	int column;
+
+	/* Every column of the product is a combination of the columns of a */
+	for (column = 0; column < 4; column++)
+	{
+		const float * factors = b->m + column * 4;
+#ifdef ECDS_TRANSFORM_SSE2
+		__m128 sum = _mm_mul_ps(_mm_loadu_ps(a->m), _mm_set1_ps(factors[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a->m + 4), _mm_set1_ps(factors[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a->m + 8), _mm_set1_ps(factors[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a->m + 12), _mm_set1_ps(factors[3])));
+		_mm_storeu_ps(product.m + column * 4, sum);
+#else
+		int row;
+
+		for (row = 0; row < 4; row++)
+			product.m[column * 4 + row] = a->m[row] * factors[0] + a->m[4 + row] * factors[1] + a->m[8 + row] * factors[2] + a->m[12 + row] * factors[3];
+#endif
+	}
+
+	*result = product;
+}
+
+void ecds_matrix_translate(ecds_matrix_t * matrix, double x, double y, double z)
+{
+	float * m = matrix->m;
+	int row;
+
+	for (row = 0; row < 4; row++)
+		m[12 + row] = (float)(m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row]);
+}
+
+void ecds_matrix_rotate(ecds_matrix_t * matrix, double angle, double x, double y, double z)
+{
+	ecds_matrix_t rotation;
+	double length = sqrt(x * x + y * y + z * z);
+	double s, c, t;
+	float * m = matrix->m;
+	float m0[4];
+	int row;
+
+	angle = angle * ECDS_TRANSFORM_PI / 180.0;
+	s = sin(angle);
+	c = cos(angle);
+
+	if (length == 0.0 || (x == 0.0 && y == 0.0))
+	{
+		/* Rotation around z only mixes the first two columns, done in double precision */
+		if (z < 0.0)
+			s = -s;
+		memcpy(m0, m, sizeof(m0));
+		for (row = 0; row < 4; row++)
+		{
+			m[row] = (float)(m0[row] * c + m[4 + row] * s);
+			m[4 + row] = (float)(m[4 + row] * c - m0[row] * s);
+		}
+		return;
+	}
+
+	x /= length;
+	y /= length;
+	z /= length;
+	t = 1.0 - c;
+
+	ecds_matrix_identity(&rotation);
+	rotation.m[0] = (float)(x * x * t + c);
+	rotation.m[1] = (float)(y * x * t + z * s);
+	rotation.m[2] = (float)(x * z * t - y * s);
+	rotation.m[4] = (float)(x * y * t - z * s);
+	rotation.m[5] = (float)(y * y * t + c);
+	rotation.m[6] = (float)(y * z * t + x * s);
+	rotation.m[8] = (float)(x * z * t + y * s);
+	rotation.m[9] = (float)(y * z * t - x * s);
+	rotation.m[10] = (float)(z * z * t + c);
+
+	ecds_matrix_multiply(matrix, matrix, &rotation);
+}
+
+void ecds_matrix_scale(ecds_matrix_t * matrix, double x, double y, double z)
+{
+	float * m = matrix->m;
+	int row;
+
+	for (row = 0; row < 4; row++)
+	{
+		m[row] = (float)(m[row] * x);
+		m[4 + row] = (float)(m[4 + row] * y);
+		m[8 + row] = (float)(m[8 + row] * z);
+	}
+}
+
+void ecds_matrix_to_affine(const ecds_matrix_t * matrix, ecds_affine_t * affine)
+{
+	affine->m[0] = matrix->m[0];
+	affine->m[1] = matrix->m[1];
+	affine->m[2] = matrix->m[4];
+	affine->m[3] = matrix->m[5];
+	affine->m[4] = matrix->m[12];
+	affine->m[5] = matrix->m[13];
+}
+
+//=================================== 8< ====================================//
+//	Transform stack															 //
+//===========================================================================//
+
+/* Finalizer of splitmix64, spreads every input bit over the whole key */
+static inline uint64_t _ecds_transform_hash(uint64_t value)
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+static uint64_t _ecds_transform_key(uint64_t parent_key, unsigned int mode, const double * values, uint32_t count)
+{
+	uint64_t key = _ecds_transform_hash(parent_key ^ ((uint64_t)mode << 32 | count));
+	uint64_t bits;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(&bits, &values[i], sizeof(bits));
+		key = _ecds_transform_hash(key + bits + 0x9E3779B97F4A7C15ull);
+	}
+
+	/* 0 is reserved for identity and unused cache entries */
+	return key ? key : 1;
+}
+
+void ecds_transform_stack_init(ecds_transform_stack_t * stack)
+{
+	memset(stack, 0, sizeof(ecds_transform_stack_t));
+	ecds_matrix_identity(&stack->matrix);
+}
+
+void ecds_transform_stack_release(ecds_transform_stack_t * stack)
+{
+	ecds_memory_free(stack->cache);
+	stack->cache = NULL;
+}
+
+void ecds_transform_stack_reset(ecds_transform_stack_t * stack)
+{
+	ecds_matrix_identity(&stack->matrix);
+	stack->key = 0;
+	stack->depth = 0;
+}
+
+int ecds_transform_stack_push(ecds_transform_stack_t * stack, unsigned int mode)
+{
+	if (stack->depth == ECDS_TRANSFORM_STACK_DEPTH)
+		return -1;
+
+	stack->saved[stack->depth] = stack->matrix;
+	stack->saved_keys[stack->depth] = stack->key;
+	stack->modes[stack->depth] = mode;
+
+	return ++stack->depth;
+}
+
+int ecds_transform_stack_pop(ecds_transform_stack_t * stack)
+{
+	if (stack->depth == 0)
+		return -1;
+
+	stack->depth--;
+	stack->matrix = stack->saved[stack->depth];
+	stack->key = stack->saved_keys[stack->depth];
+
+	return stack->depth;
+}
+
+int ecds_transform_stack_apply(ecds_transform_stack_t * stack, const double * values, uint32_t count)
+{
+	ecds_transform_cache_entry_t * entry = NULL;
+	unsigned int mode;
+	uint64_t key;
+
+	if (stack->depth == 0 || (count && !values))
+		return -1;
+
+	mode = stack->modes[stack->depth - 1];
+	if (count > ECDS_TRANSFORM_MAX_VALUES)
+		count = ECDS_TRANSFORM_MAX_VALUES;
+
+	switch (mode)
+	{
+	case ECDS_TRANSFORM_TRANSLATE:
+	case ECDS_TRANSFORM_SCALE:
+		if (count < 2)
+			return -1;
+		break;
+	case ECDS_TRANSFORM_ROTATE:
+		if (count < 1)
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	key = _ecds_transform_key(stack->key, mode, values, count);
+
+	if (!stack->cache)
+		stack->cache = (ecds_transform_cache_entry_t *)ecds_memory_alloc(ECDS_TRANSFORM_CACHE_SIZE * sizeof(ecds_transform_cache_entry_t));
+
+	if (stack->cache)
+	{
+		entry = &stack->cache[key % ECDS_TRANSFORM_CACHE_SIZE];
+		if (entry->key == key && entry->parent_key == stack->key && entry->mode == mode && entry->count == count &&
+			memcmp(entry->values, values, count * sizeof(double)) == 0)
+		{
+			stack->matrix = entry->matrix;
+			stack->key = key;
+			stack->cache_hits++;
+			return 0;
+		}
+	}
+
+	switch (mode)
+	{
+	case ECDS_TRANSFORM_TRANSLATE:
+		ecds_matrix_translate(&stack->matrix, values[0], values[1], count > 2 ? values[2] : 0.0);
+		break;
+	case ECDS_TRANSFORM_ROTATE:
+		if (count < 4)
+			ecds_matrix_rotate(&stack->matrix, values[0], 0.0, 0.0, 1.0);
+		else
+			ecds_matrix_rotate(&stack->matrix, values[0], values[1], values[2], values[3]);
+		break;
+	default:
+		ecds_matrix_scale(&stack->matrix, values[0], values[1], count > 2 ? values[2] : 1.0);
+		break;
+	}
+
+	if (entry)
+	{
+		entry->key = key;
+		entry->parent_key = stack->key;
+		entry->mode = mode;
+		entry->count = count;
+		memcpy(entry->values, values, count * sizeof(double));
+		entry->matrix = stack->matrix;
+	}
+
+	stack->key = key;
+	stack->cache_misses++;
+
+	return 0;
+}
+
+void ecds_transform_stack_get_affine(const ecds_transform_stack_t * stack, ecds_affine_t * affine)
+{
+	ecds_matrix_to_affine(&stack->matrix, affine);
+}
+
+//=================================== 8< ====================================//
+//	Vertex kernels															 //
+//===========================================================================//
+
+static void _ecds_transform_points_scalar(const float * m, const float * vertices, size_t count, float * points)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++, vertices += 3, points += 2)
+	{
+		points[0] = m[0] * vertices[0] + m[2] * vertices[1] + m[4];
+		points[1] = m[1] * vertices[0] + m[3] * vertices[1] + m[5];
+	}
+}
+
+#ifdef ECDS_TRANSFORM_SSE2
+/* Gather x and y of four vertices into two registers: x0 y0 x1 y1 and x2 y2 x3 y3 */
+#define ECDS_TRANSFORM_GATHER_XY(vertices, first, second)											\
+	do {																							\
+		__m128 v0 = _mm_loadu_ps((vertices));				/* x0 y0 z0 x1 */						\
+		__m128 v1 = _mm_loadu_ps((vertices) + 4);			/* y1 z1 x2 y2 */						\
+		__m128 v2 = _mm_loadu_ps((vertices) + 8);			/* z2 x3 y3 z3 */						\
+		__m128 x1y1 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 3, 3));								\
+		(first) = _mm_shuffle_ps(v0, x1y1, _MM_SHUFFLE(2, 0, 1, 0));								\
+		(second) = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 1, 3, 2));									\
+	} while (0)
+
+static void _ecds_transform_points_sse2(const float * m, const float * vertices, size_t count, float * points)
+{
+	const __m128 a = _mm_setr_ps(m[0], m[1], m[0], m[1]);
+	const __m128 c = _mm_setr_ps(m[2], m[3], m[2], m[3]);
+	const __m128 t = _mm_setr_ps(m[4], m[5], m[4], m[5]);
+	__m128 first, second;
+	size_t i;
+
+	for (i = 0; i + 4 <= count; i += 4, vertices += 12, points += 8)
+	{
+		ECDS_TRANSFORM_GATHER_XY(vertices, first, second);
+
+		/* Duplicate x and y of every vertex into both lanes of its pair */
+		_mm_storeu_ps(points, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(a, _mm_shuffle_ps(first, first, _MM_SHUFFLE(2, 2, 0, 0))),
+			_mm_mul_ps(c, _mm_shuffle_ps(first, first, _MM_SHUFFLE(3, 3, 1, 1)))), t));
+		_mm_storeu_ps(points + 4, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(a, _mm_shuffle_ps(second, second, _MM_SHUFFLE(2, 2, 0, 0))),
+			_mm_mul_ps(c, _mm_shuffle_ps(second, second, _MM_SHUFFLE(3, 3, 1, 1)))), t));
+	}
+
+	_ecds_transform_points_scalar(m, vertices, count - i, points);
+}
+#endif
+
+#ifdef ECDS_TRANSFORM_AVX
+__attribute__((target("avx")))
+static void _ecds_transform_points_avx(const float * m, const float * vertices, size_t count, float * points)
+{
+	const __m256 a = _mm256_setr_ps(m[0], m[1], m[0], m[1], m[0], m[1], m[0], m[1]);
+	const __m256 c = _mm256_setr_ps(m[2], m[3], m[2], m[3], m[2], m[3], m[2], m[3]);
+	const __m256 t = _mm256_setr_ps(m[4], m[5], m[4], m[5], m[4], m[5], m[4], m[5]);
+	__m128 first, second;
+	__m256 xy;
+	size_t i;
+
+	for (i = 0; i + 4 <= count; i += 4, vertices += 12, points += 8)
+	{
+		ECDS_TRANSFORM_GATHER_XY(vertices, first, second);
+		xy = _mm256_insertf128_ps(_mm256_castps128_ps256(first), second, 1);
+
+		_mm256_storeu_ps(points, _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(a, _mm256_permute_ps(xy, _MM_SHUFFLE(2, 2, 0, 0))),
+			_mm256_mul_ps(c, _mm256_permute_ps(xy, _MM_SHUFFLE(3, 3, 1, 1)))), t));
+	}
+
+	_ecds_transform_points_scalar(m, vertices, count - i, points);
+}
+#endif
+
+static pthread_once_t ecds_transform_kernel_once = PTHREAD_ONCE_INIT;
+static ecds_transform_kernel_t ecds_transform_kernel = ECDS_TRANSFORM_KERNEL_SCALAR;
+static ecds_transform_points_fn ecds_transform_points_kernel = _ecds_transform_points_scalar;
+
+/* Use kernel, or the next narrower one the build and the processor support */
+static ecds_transform_kernel_t _ecds_transform_use_kernel(ecds_transform_kernel_t kernel)
+{
+	if (kernel == ECDS_TRANSFORM_KERNEL_AUTO)
+		kernel = ECDS_TRANSFORM_KERNEL_AVX;
+
+#ifdef ECDS_TRANSFORM_AVX
+	if (kernel == ECDS_TRANSFORM_KERNEL_AVX && !__builtin_cpu_supports("avx"))
+		kernel = ECDS_TRANSFORM_KERNEL_SSE2;
+#else
+	if (kernel == ECDS_TRANSFORM_KERNEL_AVX)
+		kernel = ECDS_TRANSFORM_KERNEL_SSE2;
+#endif
+
+	switch (kernel)
+	{
+#ifdef ECDS_TRANSFORM_AVX
+	case ECDS_TRANSFORM_KERNEL_AVX:
+		ecds_transform_points_kernel = _ecds_transform_points_avx;
+		break;
+#endif
+#ifdef ECDS_TRANSFORM_SSE2
+	case ECDS_TRANSFORM_KERNEL_SSE2:
+		ecds_transform_points_kernel = _ecds_transform_points_sse2;
+		break;
+#endif
+	default:
+		kernel = ECDS_TRANSFORM_KERNEL_SCALAR;
+		ecds_transform_points_kernel = _ecds_transform_points_scalar;
+		break;
+	}
+
+	ecds_transform_kernel = kernel;
+
+	return kernel;
+}
+
+static void _ecds_transform_select_auto(void)
+{
+	_ecds_transform_use_kernel(ECDS_TRANSFORM_KERNEL_AUTO);
+	ecds_log_debug("Transforming vertices with the %s kernel", ecds_transform_kernel_name(ecds_transform_kernel));
+}
+
+ecds_transform_kernel_t ecds_transform_select_kernel(ecds_transform_kernel_t kernel)
+{
+	/* Make sure the automatic choice cannot replace this one later on */
+	pthread_once(&ecds_transform_kernel_once, _ecds_transform_select_auto);
+
+	return _ecds_transform_use_kernel(kernel);
+}
+
+const char * ecds_transform_kernel_name(ecds_transform_kernel_t kernel)
+{
+	switch (kernel)
+	{
+	case ECDS_TRANSFORM_KERNEL_AUTO:
+		return "auto";
+	case ECDS_TRANSFORM_KERNEL_SCALAR:
+		return "scalar";
+	case ECDS_TRANSFORM_KERNEL_SSE2:
+		return "SSE2";
+	case ECDS_TRANSFORM_KERNEL_AVX:
+		return "AVX";
+	default:
+		return "unknown";
+	}
+}
+
+void ecds_transform_points(const ecds_affine_t * affine, const float * vertices, size_t count, float * points)
+{
+	pthread_once(&ecds_transform_kernel_once, _ecds_transform_select_auto);
+	ecds_transform_points_kernel(affine->m, vertices, count, points);
+}
+
+void ecds_transform_points_f64(const ecds_affine_t * affine, const double * vertices, size_t count, float * points)
+{
+	float batch[ECDS_TRANSFORM_F64_BATCH * 3];
+	size_t done, size, i;
+
+	pthread_once(&ecds_transform_kernel_once, _ecds_transform_select_auto);
+
+	for (done = 0; done < count; done += size)
+	{
+		size = count - done < ECDS_TRANSFORM_F64_BATCH ? count - done : ECDS_TRANSFORM_F64_BATCH;
+		for (i = 0; i < size * 3; i++)
+			batch[i] = (float)vertices[done * 3 + i];
+		ecds_transform_points_kernel(affine->m, batch, size, points + done * 2);
+	}
+}
@@ -0,0 +1,166 @@
+/*****************************************************************************/
+/*	@file ecds_transform.h												 	 */
+/*	@brief Transform stack and vertex transform kernels for renderers.		 */
+/*																			 */
+/*	Renderer implementations use a transform stack to interpret the			 */
+/*	begin_transform and end_transform instructions the way glPushMatrix		 */
+/*	and glPopMatrix work: every transform multiplies the current matrix		 */
+/*	from the right, and ending it restores the matrix from before.			 */
+/*																			 */
+/*	The stack keeps full 4x4 matrices. Rasterizers that only need x and y	 */
+/*	take the 3x2 affine part with ecds_transform_stack_get_affine() and		 */
+/*	transform whole vertex arrays with ecds_transform_points(), which uses	 */
+/*	the widest SIMD kernel the processor supports.							 */
+/*																			 */
+/*	Concatenated matrices are cached by the chain of transforms that made	 */
+/*	them, so replaying the same nested transforms in the next frame is a	 */
+/*	lookup instead of trigonometry and matrix products.						 */
+/*																			 */
+/*****************************************************************************/
+#ifndef _ECDS_TRANSFORM_H
+#define _ECDS_TRANSFORM_H
+
+#include <ecds.h>
+
+#include <core/ecds_renderer.h>
+
+#define ECDS_TRANSFORM_STACK_DEPTH		32		//!< Number of transforms that can be open at once
+#define ECDS_TRANSFORM_CACHE_SIZE		256		//!< Number of concatenated matrices remembered by a stack
+
+typedef struct _ecds_matrix_t ecds_matrix_t;
+typedef struct _ecds_affine_t ecds_affine_t;
+typedef struct _ecds_transform_stack_t ecds_transform_stack_t;
+typedef struct _ecds_transform_cache_entry_t ecds_transform_cache_entry_t;
+
+//!< 4x4 matrix in column-major order like OpenGL: m[12], m[13], m[14] hold the translation.
+struct _ecds_matrix_t {
+	float m[16];
+};
+
+//!< 2D affine transform: x' = m[0] x + m[2] y + m[4], y' = m[1] x + m[3] y + m[5].
+struct _ecds_affine_t {
+	float m[6];
+};
+
+struct _ecds_transform_stack_t {
+	ecds_matrix_t matrix;									//!< Current transform
+	uint64_t key;											//!< Identifies the chain of transforms that made matrix, 0 for identity
+	int depth;												//!< Number of open transforms
+	ecds_matrix_t saved[ECDS_TRANSFORM_STACK_DEPTH];		//!< Matrices to restore when the transforms end
+	uint64_t saved_keys[ECDS_TRANSFORM_STACK_DEPTH];
+	unsigned int modes[ECDS_TRANSFORM_STACK_DEPTH];			//!< ECDS_TRANSFORM constant of every open transform
+
+	ecds_transform_cache_entry_t * cache;					//!< ECDS_TRANSFORM_CACHE_SIZE entries, allocated on first use
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+};
+
+/**
+ * Vertex transform kernels, see ecds_transform_select_kernel().
+ */
+typedef enum
+{
+	ECDS_TRANSFORM_KERNEL_AUTO = 0,		//!< The widest kernel the processor supports
+	ECDS_TRANSFORM_KERNEL_SCALAR = 1,
+	ECDS_TRANSFORM_KERNEL_SSE2 = 2,		//!< Two vertices per register
+	ECDS_TRANSFORM_KERNEL_AVX = 3		//!< Four vertices per register
+} ecds_transform_kernel_t;
+
+//===========================================================================//
+//	Matrices																 //
+//===========================================================================//
+//!< @brief Set a matrix to identity.
+void ecds_matrix_identity(ecds_matrix_t * matrix);
+
+/**
+ * @brief Multiply two matrices, result = a * b. result may be a or b.
+ */
+void ecds_matrix_multiply(ecds_matrix_t * result, const ecds_matrix_t * a, const ecds_matrix_t * b);
+
+//!< @brief Multiply a matrix from the right with a translation, like glTranslate().
+void ecds_matrix_translate(ecds_matrix_t * matrix, double x, double y, double z);
+
+//!< @brief Multiply a matrix from the right with a rotation of angle degrees around the axis x, y, z, like glRotate().
+void ecds_matrix_rotate(ecds_matrix_t * matrix, double angle, double x, double y, double z);
+
+//!< @brief Multiply a matrix from the right with a scale, like glScale().
+void ecds_matrix_scale(ecds_matrix_t * matrix, double x, double y, double z);
+
+//!< @brief Take the part of a matrix that maps x and y in the z = 0 plane to x and y.
+void ecds_matrix_to_affine(const ecds_matrix_t * matrix, ecds_affine_t * affine);
+
+//===========================================================================//
+//	Transform stack															 //
+//===========================================================================//
+/**
+ * @brief Initialize a transform stack to identity with no open transforms.
+ * @param stack The stack to initialize.
+ */
+void ecds_transform_stack_init(ecds_transform_stack_t * stack);
+
+/**
+ * @brief Release the cache of a transform stack.
+ * @param stack The stack to release.
+ */
+void ecds_transform_stack_release(ecds_transform_stack_t * stack);
+
+/**
+ * @brief Return to identity with no open transforms, for example at the start of a render buffer. The cache is kept.
+ * @param stack The stack to act on.
+ */
+void ecds_transform_stack_reset(ecds_transform_stack_t * stack);
+
+/**
+ * @brief Open a transform, the equivalent of ECDS_RENDER_TRANSFORM_BEGIN.
+ * @param stack The stack to act on.
+ * @param mode One of the ECDS_TRANSFORM constants, used by ecds_transform_stack_apply().
+ * @return The number of open transforms, or a negative value if the stack is full.
+ */
+int ecds_transform_stack_push(ecds_transform_stack_t * stack, unsigned int mode);
+
+/**
+ * @brief Close the innermost transform and restore the matrix from before it, the equivalent of ECDS_RENDER_TRANSFORM_END.
+ * @param stack The stack to act on.
+ * @return The number of open transforms, or a negative value if no transform was open.
+ */
+int ecds_transform_stack_pop(ecds_transform_stack_t * stack);
+
+/**
+ * @brief Apply the values of an ECDS_RENDER_PARAM_TRANSFORM parameter to the innermost transform.
+ *		  Rotations with fewer than four values or a zero axis rotate around z, missing scale factors are 1.
+ * @param stack The stack to act on.
+ * @param values, count The values of the parameter.
+ * @return 0 on success, or a negative value if no transform is open or the values do not fit its mode.
+ */
+int ecds_transform_stack_apply(ecds_transform_stack_t * stack, const double * values, uint32_t count);
+
+//!< @brief Get the 2D affine part of the current transform.
+void ecds_transform_stack_get_affine(const ecds_transform_stack_t * stack, ecds_affine_t * affine);
+
+//===========================================================================//
+//	Vertex kernels															 //
+//===========================================================================//
+/**
+ * @brief Choose the kernel used by ecds_transform_points(), mostly to compare kernels. All kernels perform the same
+ *		  operations in the same order. Not thread-safe against transforms that are running.
+ * @param kernel The kernel to use. Kernels the processor does not support fall back to the next narrower one.
+ * @return The kernel that is used from now on.
+ */
+ecds_transform_kernel_t ecds_transform_select_kernel(ecds_transform_kernel_t kernel);
+
+//!< @brief Get a printable name for a kernel.
+const char * ecds_transform_kernel_name(ecds_transform_kernel_t kernel);
+
+/**
+ * @brief Transform x and y of an array of vertices, as stored in ECDS_RENDER_PARAM_VERTEX_ARRAY_F32.
+ * @param affine The transform to apply.
+ * @param vertices count x, y, z triplets, z is ignored.
+ * @param count The number of vertices.
+ * @param points Receives count x, y pairs.
+ */
+void ecds_transform_points(const ecds_affine_t * affine, const float * vertices, size_t count, float * points);
+
+//!< @brief Same as ecds_transform_points() for vertices stored as doubles, as in ECDS_RENDER_PARAM_VERTEX_ARRAY.
+void ecds_transform_points_f64(const ecds_affine_t * affine, const double * vertices, size_t count, float * points);
+
+#endif /* _ECDS_TRANSFORM_H */
@@ -0,0 +1,83 @@
+/*****************************************************************************/
+/*	@file ecds_work_deque.c													 */
+/*	@brief Work-stealing deque for ECDS worker threads						 */
+/*																			 */
+/*	The only contended case is the last entry, which the owner and a thief	 */
+/*	may both try to take. Both sides resolve that race with a single		 */
+/*	compare-and-swap on top.												 */
+/*																			 */
+/*****************************************************************************/
+
+#include <string.h>
+
+#include <common/ecds_atomic.h>
+#include <core/ecds_work_deque.h>
+
+#define ECDS_WORK_DEQUE_MASK		(ECDS_WORK_DEQUE_CAPACITY - 1)
+
+void ecds_work_deque_initialize(ecds_work_deque_t * deque)
+{
+	if (!deque)
+		return;
+
+	memset(deque, 0, sizeof(ecds_work_deque_t));
+}
+
+bool ecds_work_deque_push(ecds_work_deque_t * deque, void * work)
+{
+	int64_t bottom = ecds_atomic_load(&deque->bottom);
+	int64_t top = ecds_atomic_load(&deque->top);
+
+	if (bottom - top >= ECDS_WORK_DEQUE_CAPACITY)
+		return false;
+
+	ecds_atomic_store(&deque->entries[bottom & ECDS_WORK_DEQUE_MASK], work);
+	ecds_atomic_store(&deque->bottom, bottom + 1);
+
+	return true;
+}
+
+void * ecds_work_deque_pop(ecds_work_deque_t * deque)
+{
+	int64_t bottom = ecds_atomic_load(&deque->bottom) - 1;
+	int64_t top;
+	void * work;
+
+	/* Claim the bottom entry before looking at top, so thieves see the claim */
+	ecds_atomic_store(&deque->bottom, bottom);
+	top = ecds_atomic_load(&deque->top);
+
+	if (top > bottom)
+	{
+		/* Deque was empty */
+		ecds_atomic_store(&deque->bottom, bottom + 1);
+		return NULL;
+	}
+
+	work = ecds_atomic_load(&deque->entries[bottom & ECDS_WORK_DEQUE_MASK]);
+	if (top == bottom)
+	{
+		/* Last entry, race any thief for it */
+		if (!ecds_atomic_compare_exchange(&deque->top, &top, top + 1))
+			work = NULL;
+		ecds_atomic_store(&deque->bottom, bottom + 1);
+	}
+
+	return work;
+}
+
+void * ecds_work_deque_steal(ecds_work_deque_t * deque)
+{
+	int64_t top = ecds_atomic_load(&deque->top);
+	int64_t bottom = ecds_atomic_load(&deque->bottom);
+	void * work;
+
+	if (top >= bottom)
+		return NULL;
+
+	work = ecds_atomic_load(&deque->entries[top & ECDS_WORK_DEQUE_MASK]);
+	if (!ecds_atomic_compare_exchange(&deque->top, &top, top + 1))
+		return NULL;
+
+	return work;
+}
@@ -0,0 +1,52 @@
+/*****************************************************************************/
+/*	@file ecds_work_deque.h													 */
+/*	@brief Work-stealing deque for ECDS worker threads						 */
+/*																			 */
+/*	Each worker thread owns one deque. The owner pushes and pops work at	 */
+/*	the bottom without contention, while idle workers steal from the top.	 */
+/*	This is the fixed-capacity variant of the Chase-Lev deque: callers		 */
+/*	must bound the amount of work they push, a push to a full deque fails.	 */
+/*																			 */
+/*	The deque stores plain pointers and does not take references.			 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_WORK_DEQUE_H
+#define _ECDS_WORK_DEQUE_H
+
+#include <ecds.h>
+
+//!<	Number of entries in a work deque, must be a power of two.
+#define ECDS_WORK_DEQUE_CAPACITY		256
+
+typedef struct _ecds_work_deque_t ecds_work_deque_t;
+
+struct _ecds_work_deque_t
+{
+	int64_t top;									//!<	Next entry to be stolen
+	int64_t bottom;									//!<	Next free entry for the owner
+	void * entries[ECDS_WORK_DEQUE_CAPACITY];
+};
+
+//!< @brief Reset a deque to the empty state.
+void ecds_work_deque_initialize(ecds_work_deque_t * deque);
+
+/**
+ * @brief Push work at the bottom of the deque. Only the owner may call this.
+ * @return true if the work was pushed, false if the deque is full.
+ */
+bool ecds_work_deque_push(ecds_work_deque_t * deque, void * work);
+
+/**
+ * @brief Pop the most recently pushed work from the bottom of the deque. Only the owner may call this.
+ * @return The work, or NULL if the deque is empty.
+ */
+void * ecds_work_deque_pop(ecds_work_deque_t * deque);
+
+/**
+ * @brief Steal the oldest work from the top of the deque. Any thread may call this.
+ * @return The work, or NULL if the deque is empty or another thread won the race.
+ */
+void * ecds_work_deque_steal(ecds_work_deque_t * deque);
+
+#endif /* _ECDS_WORK_DEQUE_H */
@@ -34,8 +34,10 @@ typedef struct _ecds_process_t ecds_process_t;
 typedef struct _ecds_module_t ecds_module_t;
 typedef struct _ecds_list_t ecds_list_t;
 typedef struct _ecds_list_item_t ecds_list_item_t;
+typedef struct _ecds_array_t ecds_array_t;
 
 typedef struct _ecds_memory_manager_t ecds_memory_manager_t;
+typedef struct _ecds_memory_entry_t ecds_memory_entry_t;
 
 //=================================== 8< ====================================//
 //				GENERAL MEMORY MANAGEMENT FUNCTIONS FOR ECDS				 //
@@ -77,8 +79,21 @@ void ecds_object_ref(ecds_object_t * obj);
 //!< @brief Decrease reference on an object and dispose it if necessary.
 void ecds_object_unref(ecds_object_t * obj);
 
-//!< @brief Get the canonical name of an object.
-char * ecds_object_get_name(ecds_object_t * obj);
+//!< @brief Get the canonical name of an object. The name is borrowed and stays valid until the object is renamed or disposed.
+const char * ecds_object_get_name(ecds_object_t * obj);
+
+/**
+* @brief Allocate a block of zero-filled memory from the pools of the default memory manager.
+* @param size The amount of memory to allocate in bytes.
+* @return A pointer to the memory block, or NULL if the allocation failed.
+*/
+void * ecds_memory_alloc(size_t size);
+
+//!< @brief Release a block obtained from ecds_memory_alloc() or ecds_memory_strdup().
+void ecds_memory_free(void * ptr);
+
+//!< @brief Duplicate a string into memory obtained from ecds_memory_alloc().
+char * ecds_memory_strdup(const char * str);
 
 /**
 * @brief Register a new class.
@@ -0,0 +1,240 @@
+/*****************************************************************************/
+/*	@file ecds_dispatcher_test.c											 */
+/*	@brief Smoke test of dispatcher routing and the worker pool.			 */
+/*																			 */
+/*	Checks that the route table delivers every message to the services		 */
+/*	subscribed to its event and to their handlers, also for handlers		 */
+/*	registered after the subscription, with and without a worker pool.		 */
+/*	In worker pool mode the messages for one service have to stay in		 */
+/*	order. The work-stealing deque the workers share is checked directly.	 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <common/ecds_message.h>
+#include <common/ecds_service.h>
+#include <core/ecds_dispatcher.h>
+#include <core/ecds_object.h>
+#include <core/ecds_work_deque.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-dispatcher-test"
+
+#define TEST_EVENT_ALL			1		//!<	Every service is subscribed
+#define TEST_EVENT_LATE			2		//!<	Handler registered after the subscription
+#define TEST_EVENT_NOBODY		3		//!<	Nobody is subscribed
+#define TEST_SERVICES			6
+#define TEST_MESSAGES			6000
+#define TEST_STEAL_ITEMS		100000
+
+typedef struct _test_service_t test_service_t;
+struct _test_service_t {
+	ecds_service_t service;
+	long next;							//!<	Sequence expected next, only touched by the service's deliveries
+	long received;
+	long out_of_order;
+};
+
+static int handler_all_count;
+static int handler_late_count;
+
+static void _test_handler_all(uint32_t user_data_length, void * user_data)
+{
+	(void)user_data_length;
+	(void)user_data;
+	ecds_atomic_increment(&handler_all_count);
+}
+
+static void _test_handler_late(uint32_t user_data_length, void * user_data)
+{
+	(void)user_data_length;
+	(void)user_data;
+	ecds_atomic_increment(&handler_late_count);
+}
+
+static void _test_receive(test_service_t * svc, ecds_message_t * msg)
+{
+	long sequence = (long)(intptr_t)msg->user_data;
+
+	if (sequence < svc->next)
+		svc->out_of_order++;
+	svc->next = sequence + 1;
+	svc->received++;
+}
+
+static void _test_dispatch(ecds_service_t * service, ecds_dispatcher_t * dispatcher, ecds_message_t * msg)
+{
+	(void)dispatcher;
+	_test_receive((test_service_t *)service, msg);
+}
+
+static void _test_dispatch_batch(ecds_service_t * service, ecds_dispatcher_t * dispatcher, ecds_message_t ** msgs, uint32_t count)
+{
+	(void)dispatcher;
+	for (uint32_t i = 0; i < count; i++)
+		_test_receive((test_service_t *)service, msgs[i]);
+}
+
+static void _test_routing(uint32_t worker_count)
+{
+	ecds_dispatcher_config_t config = { 256, ECDS_RING_QUEUE_BLOCK, worker_count, 0, 16 };
+	ecds_dispatcher_t * disp = (ecds_dispatcher_t *)ecds_dispatcher_construct_with_config("test-dispatcher", &config);
+	test_service_t * services[TEST_SERVICES];
+	long expected_all = 0, expected_late = 0;
+
+	ECDS_TEST_CHECK(disp != NULL);
+	if (!disp)
+		return;
+
+	handler_all_count = 0;
+	handler_late_count = 0;
+
+	for (int s = 0; s < TEST_SERVICES; s++)
+	{
+		services[s] = (test_service_t *)ecds_object_new(NULL, sizeof(test_service_t), ECDS_IS_SERVICE);
+
+		/* Mix services that take single messages and batches */
+		if (s & 1)
+			services[s]->service.dispatch_batch = _test_dispatch_batch;
+		else
+			services[s]->service.dispatch = _test_dispatch;
+
+		ecds_service_add_handler(&services[s]->service, TEST_EVENT_ALL, _test_handler_all);
+		ecds_dispatcher_subscribe(disp, TEST_EVENT_ALL, &services[s]->service);
+	}
+
+	/* The routes have to be rebuilt to include a handler that comes after the subscription */
+	ecds_dispatcher_subscribe(disp, TEST_EVENT_LATE, &services[0]->service);
+	ecds_service_add_handler(&services[0]->service, TEST_EVENT_LATE, _test_handler_late);
+
+	for (long i = 0; i < TEST_MESSAGES; i++)
+	{
+		ecds_message_t * msg = ecds_message_new();
+
+		msg->event_id = i % 3 == 0 ? TEST_EVENT_ALL : i % 3 == 1 ? TEST_EVENT_LATE : TEST_EVENT_NOBODY;
+		msg->user_data = (void *)(intptr_t)i;
+		expected_all += msg->event_id == TEST_EVENT_ALL;
+		expected_late += msg->event_id == TEST_EVENT_LATE;
+
+		ECDS_TEST_CHECK(ecds_dispatcher_queue_message(disp, msg));
+		ecds_object_unref(ECDS_OBJECT(msg));
+	}
+
+	/* Everything queued is delivered before the dispatcher goes away */
+	ecds_dispatcher_destroy(disp);
+
+	ECDS_TEST_CHECK(handler_all_count == expected_all * TEST_SERVICES);
+	ECDS_TEST_CHECK(handler_late_count == expected_late);
+	ECDS_TEST_CHECK(services[0]->received == expected_all + expected_late);
+
+	for (int s = 0; s < TEST_SERVICES; s++)
+	{
+		if (s > 0)
+			ECDS_TEST_CHECK(services[s]->received == expected_all);
+		ECDS_TEST_CHECK(services[s]->out_of_order == 0);
+		ecds_object_unref(ECDS_OBJECT(services[s]));
+	}
+}
+
+static void _test_deque_owner(void)
+{
+	ecds_work_deque_t deque;
+	int items[ECDS_WORK_DEQUE_CAPACITY + 1];
+
+	ecds_work_deque_initialize(&deque);
+	ECDS_TEST_CHECK(ecds_work_deque_pop(&deque) == NULL);
+	ECDS_TEST_CHECK(ecds_work_deque_steal(&deque) == NULL);
+
+	for (int i = 0; i < ECDS_WORK_DEQUE_CAPACITY; i++)
+		ECDS_TEST_CHECK(ecds_work_deque_push(&deque, &items[i]));
+	ECDS_TEST_CHECK(!ecds_work_deque_push(&deque, &items[ECDS_WORK_DEQUE_CAPACITY]));
+
+	/* The owner takes the newest work, thieves take the oldest */
+	ECDS_TEST_CHECK(ecds_work_deque_pop(&deque) == &items[ECDS_WORK_DEQUE_CAPACITY - 1]);
+	ECDS_TEST_CHECK(ecds_work_deque_steal(&deque) == &items[0]);
+	ECDS_TEST_CHECK(ecds_work_deque_steal(&deque) == &items[1]);
+	ECDS_TEST_CHECK(ecds_work_deque_pop(&deque) == &items[ECDS_WORK_DEQUE_CAPACITY - 2]);
+}
+
+typedef struct _test_steal_t test_steal_t;
+struct _test_steal_t {
+	ecds_work_deque_t deque;
+	int taken[TEST_STEAL_ITEMS];		//!<	How often each item was taken
+	int done;
+};
+
+static void * _test_thief_thread(void * arg)
+{
+	test_steal_t * steal = (test_steal_t *)arg;
+	int * item;
+
+	while (!ecds_atomic_load(&steal->done) || ecds_atomic_load(&steal->deque.top) < ecds_atomic_load(&steal->deque.bottom))
+	{
+		if ((item = (int *)ecds_work_deque_steal(&steal->deque)))
+			ecds_atomic_increment(item);
+	}
+
+	return NULL;
+}
+
+static void _test_deque_steal(void)
+{
+	static test_steal_t steal;
+	pthread_t thieves[2];
+	int * item, lost = 0, twice = 0;
+
+	ecds_work_deque_initialize(&steal.deque);
+
+	for (int t = 0; t < 2; t++)
+		pthread_create(&thieves[t], 0, _test_thief_thread, &steal);
+
+	/* The owner keeps pushing and sometimes pops, while the thieves steal from the other end */
+	for (int i = 0; i < TEST_STEAL_ITEMS; i++)
+	{
+		while (!ecds_work_deque_push(&steal.deque, &steal.taken[i]))
+		{
+			if ((item = (int *)ecds_work_deque_pop(&steal.deque)))
+				ecds_atomic_increment(item);
+		}
+
+		if (i % 7 == 0 && (item = (int *)ecds_work_deque_pop(&steal.deque)))
+			ecds_atomic_increment(item);
+	}
+
+	while ((item = (int *)ecds_work_deque_pop(&steal.deque)))
+		ecds_atomic_increment(item);
+
+	ecds_atomic_store(&steal.done, 1);
+	for (int t = 0; t < 2; t++)
+		pthread_join(thieves[t], NULL);
+
+	/* Every item is taken exactly once */
+	for (int i = 0; i < TEST_STEAL_ITEMS; i++)
+	{
+		lost += steal.taken[i] == 0;
+		twice += steal.taken[i] > 1;
+	}
+	ECDS_TEST_CHECK(lost == 0);
+	ECDS_TEST_CHECK(twice == 0);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_routing(0);
+	_test_routing(1);
+	_test_routing(3);
+	_test_deque_owner();
+	_test_deque_steal();
+
+	return ECDS_TEST_RESULT();
+}
@@ -0,0 +1,268 @@
+/*****************************************************************************/
+/*	@file ecds_list_test.c													 */
+/*	@brief Smoke test of the list operations.								 */
+/*																			 */
+/*	Sorts lists with repeating keys, serially and on several threads,		 */
+/*	and checks that the order is right and items with equal keys keep		 */
+/*	their order. Filtering, zipping, concatenating, splitting and taking	 */
+/*	sublists have to keep the order of the source lists. Indexed access		 */
+/*	has to see every change made since the last one.						 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ecds.h>
+#include <common/ecds_list.h>
+#include <core/ecds_object.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-list-test"
+
+#define TEST_ITEMS				1000
+#define TEST_KEYS				37
+//!<	Enough items for the parallel sort to use two threads.
+#define TEST_PARALLEL_ITEMS		(2 * ECDS_LIST_PARALLEL_SORT_MIN + 100)
+
+typedef struct _test_object_t test_object_t;
+struct _test_object_t {
+	ecds_object_t obj;
+	uint32_t key;
+	uint32_t sequence;				//!<	Position before sorting, to check stability
+};
+
+static bool _test_behind(ecds_object_t * a, ecds_object_t * b)
+{
+	return ((test_object_t *)a)->key > ((test_object_t *)b)->key;
+}
+
+static bool _test_even(ecds_object_t * obj)
+{
+	return ((test_object_t *)obj)->sequence % 2 == 0;
+}
+
+static uint32_t _test_sequence(ecds_list_t * list, ecds_list_item_t * item)
+{
+	return ((test_object_t *)ecds_list_get_item(list, item))->sequence;
+}
+
+static void _test_dispose_list(ecds_list_t * list)
+{
+	ecds_list_dispose(list);
+	ecds_object_unref(ECDS_OBJECT(list));
+}
+
+/* A list of count objects, numbered in order, with pseudo random keys or without keys */
+static ecds_list_t * _test_list_new(uint32_t count, bool keys)
+{
+	ecds_list_t * list = ecds_list_new();
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		test_object_t * object = (test_object_t *)ecds_object_new(NULL, sizeof(test_object_t), ECDS_TYPE_TEST_OBJECT);
+
+		object->key = keys ? (uint32_t)rand() % TEST_KEYS : 0;
+		object->sequence = i;
+		ecds_list_add_item(list, ECDS_OBJECT(object));
+		/* The list holds the only reference */
+		ecds_object_unref(ECDS_OBJECT(object));
+	}
+
+	return list;
+}
+
+/* Whether a list is sorted by key and equal keys are in their original order */
+static bool _test_sorted(ecds_list_t * list, uint32_t count)
+{
+	ecds_list_item_t * iter, * previous = NULL;
+	uint32_t seen = 0;
+
+	for (iter = ecds_list_first_item(list); iter; previous = iter, iter = ecds_list_next_item(iter), seen++)
+	{
+		test_object_t * a, * b;
+
+		if (ecds_list_previous_item(iter) != previous)
+			return false;
+		if (!previous)
+			continue;
+
+		a = (test_object_t *)ecds_list_get_item(list, previous);
+		b = (test_object_t *)ecds_list_get_item(list, iter);
+		if (a->key > b->key || (a->key == b->key && a->sequence > b->sequence))
+			return false;
+	}
+
+	return seen == count && ecds_list_last_item(list) == previous;
+}
+
+/* Whether indexed access finds the same items as walking the list */
+static bool _test_indexed(ecds_list_t * list, uint32_t count)
+{
+	ecds_list_item_t * iter = ecds_list_first_item(list);
+	ecds_object_t ** objects;
+	uint32_t i;
+
+	for (i = 0; iter; iter = ecds_list_next_item(iter), i++)
+	{
+		if (ecds_fetch_item(list, (int)i) != iter)
+			return false;
+	}
+
+	if (i != count || ecds_fetch_item(list, (int)count) != NULL || ecds_fetch_item(list, -1) != NULL)
+		return false;
+
+	objects = ecds_list_to_array(list);
+	for (iter = ecds_list_first_item(list), i = 0; iter; iter = ecds_list_next_item(iter), i++)
+	{
+		if (objects[i] != ecds_list_get_item(list, iter))
+			return false;
+	}
+
+	return objects[count] == NULL;
+}
+
+static void _test_sort(void)
+{
+	ecds_list_t * list = _test_list_new(TEST_ITEMS, true), * empty = ecds_list_new();
+	ecds_list_item_t * first = ecds_list_first_item(list);
+	bool found = false;
+
+	ecds_list_sort(list, _test_behind);
+	ECDS_TEST_CHECK(_test_sorted(list, TEST_ITEMS));
+
+	/* The items are relinked, not copied */
+	for (ecds_list_item_t * iter = ecds_list_first_item(list); iter; iter = ecds_list_next_item(iter))
+		found |= iter == first;
+	ECDS_TEST_CHECK(found);
+
+	/* Sorting again changes nothing */
+	ecds_list_sort(list, _test_behind);
+	ECDS_TEST_CHECK(_test_sorted(list, TEST_ITEMS));
+
+	ecds_list_sort(empty, _test_behind);
+	ECDS_TEST_CHECK(ecds_list_first_item(empty) == NULL && ecds_list_last_item(empty) == NULL);
+
+	_test_dispose_list(list);
+	_test_dispose_list(empty);
+}
+
+static void _test_sort_parallel(void)
+{
+	ecds_list_t * list = _test_list_new(TEST_PARALLEL_ITEMS, true);
+	ecds_list_t * small = _test_list_new(TEST_ITEMS, true);
+
+	ecds_list_sort_parallel(list, _test_behind, 4);
+	ECDS_TEST_CHECK(_test_sorted(list, TEST_PARALLEL_ITEMS));
+
+	/* Too few items for threads, sorted serially */
+	ecds_list_sort_parallel(small, _test_behind, 4);
+	ECDS_TEST_CHECK(_test_sorted(small, TEST_ITEMS));
+
+	_test_dispose_list(list);
+	_test_dispose_list(small);
+}
+
+static void _test_operations(void)
+{
+	ecds_list_t * list = _test_list_new(10, false), * other = _test_list_new(3, false);
+	ecds_list_t * filtered, * zipped, * joined, * cloned, * sub, * tail;
+	static const uint32_t zip_order[] = { 0, 0, 1, 1, 2, 2, 3, 4, 5, 6, 7, 8, 9 };
+	ecds_list_item_t * iter;
+	uint32_t i;
+	bool ordered = true;
+
+	filtered = ecds_list_filter(list, _test_even);
+	for (iter = ecds_list_first_item(filtered), i = 0; iter; iter = ecds_list_next_item(iter), i++)
+		ordered &= _test_sequence(filtered, iter) == 2 * i;
+	ECDS_TEST_CHECK(ordered && i == 5);
+
+	/* Alternating while both have items, then the rest of the longer one */
+	zipped = ecds_list_zip(list, other);
+	for (iter = ecds_list_first_item(zipped), i = 0; iter; iter = ecds_list_next_item(iter), i++)
+		ordered &= i < 13 && _test_sequence(zipped, iter) == zip_order[i];
+	ECDS_TEST_CHECK(ordered && i == 13);
+
+	joined = ecds_list_concat(other, list);
+	for (iter = ecds_list_first_item(joined), i = 0; iter; iter = ecds_list_next_item(iter), i++)
+		ordered &= _test_sequence(joined, iter) == (i < 3 ? i : i - 3);
+	ECDS_TEST_CHECK(ordered && i == 13);
+
+	/* The new lists share the objects of the source lists */
+	cloned = ecds_list_clone(list);
+	ECDS_TEST_CHECK(ecds_list_get_item(cloned, ecds_list_first_item(cloned)) == ecds_list_get_item(list, ecds_list_first_item(list)));
+	ECDS_TEST_CHECK(ecds_list_get_item(list, ecds_list_first_item(list))->refcnt == 5);
+
+	/* Both bounds are included */
+	sub = ecds_list_sublist(list, 2, 4);
+	ECDS_TEST_CHECK(_test_sequence(sub, ecds_list_first_item(sub)) == 2 && _test_sequence(sub, ecds_list_last_item(sub)) == 4);
+	ECDS_TEST_CHECK(ecds_list_next_item(ecds_list_next_item(ecds_list_first_item(sub))) == ecds_list_last_item(sub));
+
+	/* The item at the position stays, the items behind it move to the new list */
+	tail = ecds_list_split(cloned, 3);
+	ECDS_TEST_CHECK(_test_sequence(cloned, ecds_list_last_item(cloned)) == 3 && ecds_list_next_item(ecds_list_last_item(cloned)) == NULL);
+	ECDS_TEST_CHECK(_test_sequence(tail, ecds_list_first_item(tail)) == 4 && ecds_list_previous_item(ecds_list_first_item(tail)) == NULL);
+	ECDS_TEST_CHECK(_test_sequence(tail, ecds_list_last_item(tail)) == 9);
+	ECDS_TEST_CHECK(ecds_list_get_item(cloned, ecds_list_first_item(tail)) == NULL);
+
+	_test_dispose_list(tail);
+	_test_dispose_list(sub);
+	_test_dispose_list(cloned);
+	_test_dispose_list(joined);
+	_test_dispose_list(zipped);
+	_test_dispose_list(filtered);
+	_test_dispose_list(other);
+	_test_dispose_list(list);
+}
+
+static void _test_indices(void)
+{
+	ecds_list_t * list = _test_list_new(20, true), * other = _test_list_new(5, false), * tail;
+	ecds_list_item_t * item;
+
+	ECDS_TEST_CHECK(_test_indexed(list, 20));
+
+	/* Appending keeps the list indexed, taking from the front and the middle renumbers */
+	ecds_list_add_item(list, ecds_list_get_item(other, ecds_list_first_item(other)));
+	ECDS_TEST_CHECK(_test_indexed(list, 21));
+	ecds_list_dispose_item(ecds_list_first_item(list));
+	ECDS_TEST_CHECK(_test_indexed(list, 20));
+	ecds_list_dispose_item(ecds_fetch_item(list, 7));
+	ECDS_TEST_CHECK(_test_indexed(list, 19));
+	ecds_list_dispose_item(ecds_list_last_item(list));
+	ECDS_TEST_CHECK(_test_indexed(list, 18));
+
+	/* Inserting behind a position */
+	item = ecds_list_create_item(ecds_list_get_item(other, ecds_list_last_item(other)));
+	ecds_list_insert_item(list, 3, item);
+	ECDS_TEST_CHECK(ecds_fetch_item(list, 4) == item);
+	ECDS_TEST_CHECK(_test_indexed(list, 19));
+	ecds_list_insert_list(list, 10, other);
+	ECDS_TEST_CHECK(_test_indexed(list, 24));
+
+	ecds_list_sort(list, _test_behind);
+	ECDS_TEST_CHECK(_test_indexed(list, 24));
+
+	/* Both halves of a split list are indexed on their own */
+	tail = ecds_list_split(list, 9);
+	ECDS_TEST_CHECK(_test_indexed(list, 10));
+	ECDS_TEST_CHECK(_test_indexed(tail, 14));
+
+	_test_dispose_list(tail);
+	_test_dispose_list(other);
+	_test_dispose_list(list);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+	srand(1);
+
+	_test_sort();
+	_test_sort_parallel();
+	_test_operations();
+	_test_indices();
+
+	return ECDS_TEST_RESULT();
+}
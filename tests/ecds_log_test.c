@@ -0,0 +1,212 @@
+/*****************************************************************************/
+/*	@file ecds_log_test.c													 */
+/*	@brief Smoke test of the asynchronous logger.							 */
+/*																			 */
+/*	Several threads log through the background thread into a sink that		 */
+/*	keeps the messages. Every message has to arrive once, in the order its	 */
+/*	thread logged it, and read exactly as vsnprintf() would have formatted	 */
+/*	it. Threads that exit while the logger stops must not lose or corrupt	 */
+/*	their rings.															 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <ecds.h>
+#include <common/ecds_log_sink.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-log-test"
+
+#define TEST_THREADS			4
+#define TEST_PER_THREAD			400
+#define TEST_RING_SLOTS			512		//!<	Room for all messages of a thread, so none are dropped
+#define TEST_CAPTURED			(TEST_THREADS * TEST_PER_THREAD + 16)
+#define TEST_LINE_SIZE			160
+#define TEST_STOP_ROUNDS		20
+
+typedef struct _test_sink_t test_sink_t;
+struct _test_sink_t {
+	ecds_log_sink_t sink;
+	int count;
+	char lines[TEST_CAPTURED][TEST_LINE_SIZE];
+};
+
+static test_sink_t test_sink;
+
+/* Sinks are called by one thread at a time, so the captured lines need no lock */
+static void _test_sink_write(ecds_log_sink_t * sink, const ecds_log_record_t * record)
+{
+	test_sink_t * capture = (test_sink_t *)sink;
+
+	if (strcmp(record->domain, ECDS_LOG_DOMAIN) != 0)
+		return;
+
+	if (capture->count < TEST_CAPTURED)
+		snprintf(capture->lines[capture->count], TEST_LINE_SIZE, "%s", record->message);
+	capture->count++;
+}
+
+/* Format message i of a thread, and log it if logging is set */
+static void _test_message(char * line, int thread, int i, bool logging)
+{
+	static const char text[] = "abcdefgh";
+
+	switch (i % 4)
+	{
+	case 0:
+		snprintf(line, TEST_LINE_SIZE, "t%d m%d s=%s f=%5.2f", thread, i, "str", i / 3.0);
+		if (logging)
+			ecds_log_info("t%d m%d s=%s f=%5.2f", thread, i, "str", i / 3.0);
+		break;
+	case 1:
+		snprintf(line, TEST_LINE_SIZE, "t%d m%d [%*d] [%-*.*s] %%", thread, i, 6, i, 8, 3, text);
+		if (logging)
+			ecds_log_info("t%d m%d [%*d] [%-*.*s] %%", thread, i, 6, i, 8, 3, text);
+		break;
+	case 2:
+		snprintf(line, TEST_LINE_SIZE, "t%d m%d ll=%lld zu=%zu x=%#x", thread, i, (long long)i * 100000000000ll, (size_t)i, (unsigned int)i);
+		if (logging)
+			ecds_log_info("t%d m%d ll=%lld zu=%zu x=%#x", thread, i, (long long)i * 100000000000ll, (size_t)i, (unsigned int)i);
+		break;
+	default:
+		snprintf(line, TEST_LINE_SIZE, "t%d m%d Lf=%Lf p=%.2s", thread, i, (long double)i / 7, text);
+		if (logging)
+			ecds_log_info("t%d m%d Lf=%Lf p=%.2s", thread, i, (long double)i / 7, text);
+		break;
+	}
+}
+
+static void * _test_thread(void * arg)
+{
+	char line[TEST_LINE_SIZE];
+	int thread = (int)(intptr_t)arg;
+
+	for (int i = 0; i < TEST_PER_THREAD; i++)
+		_test_message(line, thread, i, true);
+
+	return NULL;
+}
+
+static void _test_threads(void)
+{
+	pthread_t threads[TEST_THREADS];
+	int next[TEST_THREADS] = { 0 };
+	char expected[TEST_LINE_SIZE];
+	int thread, i, wrong = 0;
+
+	test_sink.count = 0;
+	ECDS_TEST_CHECK(ecds_log_start(TEST_RING_SLOTS) == 0);
+
+	for (thread = 0; thread < TEST_THREADS; thread++)
+		pthread_create(&threads[thread], 0, _test_thread, (void *)(intptr_t)thread);
+	for (thread = 0; thread < TEST_THREADS; thread++)
+		pthread_join(threads[thread], NULL);
+
+	ecds_log_flush();
+	ecds_log_stop();
+
+	/* Messages of one thread arrive in order and unchanged */
+	for (int k = 0; k < test_sink.count && k < TEST_CAPTURED; k++)
+	{
+		if (sscanf(test_sink.lines[k], "t%d m%d", &thread, &i) != 2 || thread < 0 || thread >= TEST_THREADS || i < next[thread])
+		{
+			wrong++;
+			continue;
+		}
+
+		next[thread] = i + 1;
+		_test_message(expected, thread, i, false);
+		if (strcmp(expected, test_sink.lines[k]) != 0)
+		{
+			fprintf(stderr, "expected '%s'\n     got '%s'\n", expected, test_sink.lines[k]);
+			wrong++;
+		}
+	}
+
+	ECDS_TEST_CHECK(test_sink.count == TEST_THREADS * TEST_PER_THREAD);
+	ECDS_TEST_CHECK(wrong == 0);
+}
+
+static void _test_conversions(void)
+{
+	/* Only valid up to the precision, there is no NUL */
+	static const char unterminated[3] = { 'a', 'b', 'c' };
+
+	test_sink.count = 0;
+	ECDS_TEST_CHECK(ecds_log_start(64) == 0);
+
+	ecds_log_info("[%.3s]", unterminated);
+	ecds_log_info("[%.*s]", 2, unterminated);
+	ecds_log_info("[%.*s]", -1, "negative");
+	ecds_log_flush();
+
+	/* Argument numbers are formatted right away, but still arrive */
+	ecds_log_info("[%2$s %1$d]", 5, "positional");
+	ecds_log_stop();
+
+	ECDS_TEST_CHECK(test_sink.count == 4);
+	ECDS_TEST_CHECK(strcmp(test_sink.lines[0], "[abc]") == 0);
+	ECDS_TEST_CHECK(strcmp(test_sink.lines[1], "[ab]") == 0);
+	ECDS_TEST_CHECK(strcmp(test_sink.lines[2], "[negative]") == 0);
+	ECDS_TEST_CHECK(strcmp(test_sink.lines[3], "[positional 5]") == 0);
+}
+
+static void * _test_exiting_thread(void * arg)
+{
+	(void)arg;
+
+	for (int i = 0; i < 20; i++)
+		ecds_log_info("exiting %d", i);
+
+	return NULL;
+}
+
+static void _test_stop_while_exiting(void)
+{
+	pthread_t threads[TEST_THREADS];
+
+	/* Threads end and release their rings while the logger is stopped */
+	for (int round = 0; round < TEST_STOP_ROUNDS; round++)
+	{
+		ECDS_TEST_CHECK(ecds_log_start(16) == 0);
+
+		for (int t = 0; t < TEST_THREADS; t++)
+			pthread_create(&threads[t], 0, _test_exiting_thread, NULL);
+
+		ecds_log_stop();
+
+		for (int t = 0; t < TEST_THREADS; t++)
+			pthread_join(threads[t], NULL);
+	}
+
+	/* Without the background thread messages are written by the caller */
+	test_sink.count = 0;
+	ecds_log_info("direct");
+	ECDS_TEST_CHECK(test_sink.count == 1);
+}
+
+int main(void)
+{
+	test_sink.sink.name = "test";
+	test_sink.sink.level = ECDS_DEBUG;
+	test_sink.sink.write = _test_sink_write;
+
+	ecds_log_set_level(ECDS_INFO);
+	ecds_log_remove_sink("stdout");
+	ECDS_TEST_CHECK(ecds_log_add_sink(&test_sink.sink) == 0);
+
+	_test_threads();
+	_test_conversions();
+	_test_stop_while_exiting();
+
+	ecds_log_remove_sink("test");
+
+	return ECDS_TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************/
+/*	@file ecds_memory_pool_test.c											 */
+/*	@brief Smoke test of the size-class pool allocator.						 */
+/*																			 */
+/*	Checks that every request is served by the smallest size class that		 */
+/*	fits, that blocks come back zero-filled and are recycled, that pools	 */
+/*	grow by whole slabs, and that requests beyond the largest class go to	 */
+/*	the system heap.														 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ecds.h>
+#include <core/ecds_memory_pool.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-memory-pool-test"
+
+//!<	Enough blocks of the smallest class to need more than one slab.
+#define TEST_MANY_BLOCKS		2000
+
+/* Index of the class whose blocks_in_use went up since before, -1 for none */
+static int _test_class_used(ecds_memory_pool_t * pools, const ecds_memory_pool_stats_t * before)
+{
+	ecds_memory_pool_stats_t stats;
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+	{
+		ecds_memory_pool_get_stats(&pools[i], &stats);
+		if (stats.blocks_in_use > before[i].blocks_in_use)
+			return i;
+	}
+
+	return -1;
+}
+
+static void _test_size_classes(void)
+{
+	ecds_memory_pool_t pools[ECDS_MEMORY_POOL_CLASSES];
+	ecds_memory_pool_stats_t before[ECDS_MEMORY_POOL_CLASSES];
+	size_t largest;
+	int wrong = 0, dirty = 0;
+
+	ecds_memory_pool_initialize(pools);
+	largest = pools[ECDS_MEMORY_POOL_CLASSES - 1].block_size;
+
+	for (size_t size = 1; size <= largest; size++)
+	{
+		uint8_t * block;
+		int used;
+
+		for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+			ecds_memory_pool_get_stats(&pools[i], &before[i]);
+
+		block = (uint8_t *)ecds_memory_pool_alloc(pools, size);
+		used = _test_class_used(pools, before);
+
+		/* The smallest class that fits, not just any class that does */
+		if (used < 0 || pools[used].block_size < size || (used > 0 && pools[used - 1].block_size >= size))
+			wrong++;
+
+		for (size_t b = 0; b < size; b++)
+			dirty += block[b] != 0;
+
+		/* Leave garbage behind for the next allocation of the class */
+		memset(block, 0xA5, size);
+		ecds_memory_pool_free(block);
+	}
+
+	ECDS_TEST_CHECK(wrong == 0);
+	ECDS_TEST_CHECK(dirty == 0);
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+	{
+		ecds_memory_pool_get_stats(&pools[i], &before[i]);
+		ECDS_TEST_CHECK(before[i].blocks_in_use == 0);
+		ECDS_TEST_CHECK(before[i].slab_count == 1);
+	}
+
+	ecds_memory_pool_dispose(pools);
+}
+
+static void _test_recycling(void)
+{
+	static void * blocks[TEST_MANY_BLOCKS];
+	ecds_memory_pool_t pools[ECDS_MEMORY_POOL_CLASSES];
+	ecds_memory_pool_stats_t stats;
+	uint32_t slab_count;
+	void * first;
+
+	ecds_memory_pool_initialize(pools);
+
+	/* A freed block is handed out again before the pool grows */
+	first = ecds_memory_pool_alloc(pools, 8);
+	ecds_memory_pool_free(first);
+	ECDS_TEST_CHECK(ecds_memory_pool_alloc(pools, 8) == first);
+	ecds_memory_pool_free(first);
+
+	for (int i = 0; i < TEST_MANY_BLOCKS; i++)
+		blocks[i] = ecds_memory_pool_alloc(pools, 8);
+
+	ecds_memory_pool_get_stats(&pools[0], &stats);
+	ECDS_TEST_CHECK(stats.blocks_in_use == TEST_MANY_BLOCKS);
+	ECDS_TEST_CHECK(stats.blocks_peak == TEST_MANY_BLOCKS);
+	ECDS_TEST_CHECK(stats.slab_count > 1);
+	ECDS_TEST_CHECK(stats.blocks_total >= TEST_MANY_BLOCKS);
+	ECDS_TEST_CHECK(stats.allocations == TEST_MANY_BLOCKS + 2);
+	slab_count = stats.slab_count;
+
+	for (int i = 0; i < TEST_MANY_BLOCKS; i++)
+		ecds_memory_pool_free(blocks[i]);
+
+	/* The slabs stay, the next round does not need the heap */
+	for (int i = 0; i < TEST_MANY_BLOCKS; i++)
+		blocks[i] = ecds_memory_pool_alloc(pools, 8);
+	for (int i = 0; i < TEST_MANY_BLOCKS; i++)
+		ecds_memory_pool_free(blocks[i]);
+
+	ecds_memory_pool_get_stats(&pools[0], &stats);
+	ECDS_TEST_CHECK(stats.slab_count == slab_count);
+	ECDS_TEST_CHECK(stats.blocks_in_use == 0);
+
+	ecds_memory_pool_dispose(pools);
+}
+
+static void _test_heap_fallback(void)
+{
+	ecds_memory_pool_t pools[ECDS_MEMORY_POOL_CLASSES];
+	ecds_memory_pool_stats_t before[ECDS_MEMORY_POOL_CLASSES], heap_before, heap;
+	size_t size;
+	uint8_t * block, * unpooled;
+	int dirty = 0;
+
+	ecds_memory_pool_initialize(pools);
+	size = pools[ECDS_MEMORY_POOL_CLASSES - 1].block_size + 1;
+
+	for (int i = 0; i < ECDS_MEMORY_POOL_CLASSES; i++)
+		ecds_memory_pool_get_stats(&pools[i], &before[i]);
+	ecds_memory_pool_get_stats(NULL, &heap_before);
+
+	/* Too big for every class, and no pools at all */
+	block = (uint8_t *)ecds_memory_pool_alloc(pools, size);
+	unpooled = (uint8_t *)ecds_memory_pool_alloc(NULL, 16);
+	ECDS_TEST_CHECK(block != NULL && unpooled != NULL);
+	ECDS_TEST_CHECK(_test_class_used(pools, before) == -1);
+
+	ecds_memory_pool_get_stats(NULL, &heap);
+	ECDS_TEST_CHECK(heap.block_size == 0);
+	ECDS_TEST_CHECK(heap.allocations == heap_before.allocations + 2);
+	ECDS_TEST_CHECK(heap.blocks_in_use == heap_before.blocks_in_use + 2);
+
+	for (size_t b = 0; b < size; b++)
+		dirty += block[b] != 0;
+	ECDS_TEST_CHECK(dirty == 0);
+
+	/* Heap blocks are released through the same call as pool blocks */
+	ecds_memory_pool_free(block);
+	ecds_memory_pool_free(unpooled);
+	ecds_memory_pool_get_stats(NULL, &heap);
+	ECDS_TEST_CHECK(heap.blocks_in_use == heap_before.blocks_in_use);
+
+	ecds_memory_pool_dispose(pools);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_size_classes();
+	_test_recycling();
+	_test_heap_fallback();
+
+	return ECDS_TEST_RESULT();
+}
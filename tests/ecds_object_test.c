@@ -0,0 +1,187 @@
+/*****************************************************************************/
+/*	@file ecds_object_test.c												 */
+/*	@brief Smoke test of object reference counting and lookup by name.		 */
+/*																			 */
+/*	Several threads take and release references on shared objects. Every	 */
+/*	object has to be disposed exactly once, after its last reference, and	 */
+/*	the memory manager has to end up with the objects it started with.		 */
+/*	Objects found by name while others release them must still be alive,	 */
+/*	and objects of the same name share one interned name.					 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <core/ecds_atom.h>
+#include <core/ecds_memory_manager.h>
+#include <core/ecds_object.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-object-test"
+
+#define TEST_THREADS			4
+#define TEST_OBJECTS			64
+#define TEST_ROUNDS				200
+#define TEST_FIND_ROUNDS		20000
+#define TEST_NAME				"test-shared"
+
+typedef struct _test_object_t test_object_t;
+struct _test_object_t {
+	ecds_object_t obj;
+	int disposed;
+};
+
+static int disposed_count;
+
+static void _test_dispose(ecds_object_t * obj)
+{
+	ecds_atomic_increment(&((test_object_t *)obj)->disposed);
+	ecds_atomic_increment(&disposed_count);
+}
+
+static test_object_t * _test_object_new(const char * name)
+{
+	test_object_t * object = (test_object_t *)ecds_object_new(name, sizeof(test_object_t), ECDS_TYPE_TEST_OBJECT);
+
+	object->obj.dispose = _test_dispose;
+
+	return object;
+}
+
+static test_object_t * refcount_objects[TEST_OBJECTS];
+
+static void * _test_refcount_thread(void * arg)
+{
+	(void)arg;
+
+	for (int round = 0; round < TEST_ROUNDS; round++)
+	{
+		for (int i = 0; i < TEST_OBJECTS; i++)
+			ecds_object_ref(ECDS_OBJECT(refcount_objects[i]));
+		for (int i = 0; i < TEST_OBJECTS; i++)
+			ecds_object_unref(ECDS_OBJECT(refcount_objects[i]));
+	}
+
+	/* Each thread owns one reference the main thread handed over */
+	for (int i = 0; i < TEST_OBJECTS; i++)
+		ecds_object_unref(ECDS_OBJECT(refcount_objects[i]));
+
+	return NULL;
+}
+
+static void _test_refcount(void)
+{
+	pthread_t threads[TEST_THREADS];
+	uint32_t object_count = ecds_memory_manager_get_object_count(NULL);
+	int alive = 0;
+
+	disposed_count = 0;
+	for (int i = 0; i < TEST_OBJECTS; i++)
+	{
+		refcount_objects[i] = _test_object_new(NULL);
+		for (int t = 0; t < TEST_THREADS; t++)
+			ecds_object_ref(ECDS_OBJECT(refcount_objects[i]));
+	}
+	ECDS_TEST_CHECK(ecds_memory_manager_get_object_count(NULL) == object_count + TEST_OBJECTS);
+
+	for (int t = 0; t < TEST_THREADS; t++)
+		pthread_create(&threads[t], 0, _test_refcount_thread, NULL);
+	for (int t = 0; t < TEST_THREADS; t++)
+		pthread_join(threads[t], NULL);
+
+	/* Only the reference of the main thread is left */
+	for (int i = 0; i < TEST_OBJECTS; i++)
+		alive += ecds_atomic_load(&refcount_objects[i]->obj.refcnt) == 1 && refcount_objects[i]->disposed == 0;
+	ECDS_TEST_CHECK(alive == TEST_OBJECTS);
+
+	for (int i = 0; i < TEST_OBJECTS; i++)
+		ecds_object_unref(ECDS_OBJECT(refcount_objects[i]));
+
+	ECDS_TEST_CHECK(disposed_count == TEST_OBJECTS);
+	ECDS_TEST_CHECK(ecds_memory_manager_get_object_count(NULL) == object_count);
+}
+
+static int find_done;
+
+static void * _test_find_thread(void * arg)
+{
+	int * wrong = (int *)arg;
+	ecds_object_t * found;
+
+	while (!ecds_atomic_load(&find_done))
+	{
+		if (!(found = ecds_object_find(TEST_NAME)))
+			continue;
+
+		/* The reference taken by the lookup keeps the object alive */
+		if (found->type_uid != ECDS_TYPE_TEST_OBJECT || strcmp(found->name, TEST_NAME) != 0 ||
+			ecds_atomic_load(&((test_object_t *)found)->disposed) != 0)
+			(*wrong)++;
+		ecds_object_unref(found);
+	}
+
+	return NULL;
+}
+
+static void _test_find(void)
+{
+	pthread_t threads[TEST_THREADS];
+	int wrong[TEST_THREADS] = { 0 };
+	uint32_t object_count = ecds_memory_manager_get_object_count(NULL);
+	uint32_t atom_count = ecds_atom_get_count();
+	test_object_t * first, * second, * object;
+
+	/* Objects of the same name share the interned name, the most recent one is found */
+	first = _test_object_new(TEST_NAME);
+	second = _test_object_new(TEST_NAME);
+	ECDS_TEST_CHECK(first->obj.name == second->obj.name);
+	ECDS_TEST_CHECK(ecds_atom_get_count() == atom_count + 1);
+	ECDS_TEST_CHECK(ecds_object_find(TEST_NAME) == ECDS_OBJECT(second));
+	ecds_object_unref(ECDS_OBJECT(second));
+	ecds_object_unref(ECDS_OBJECT(second));
+	ECDS_TEST_CHECK(ecds_object_find(TEST_NAME) == ECDS_OBJECT(first));
+	ecds_object_unref(ECDS_OBJECT(first));
+	ecds_object_unref(ECDS_OBJECT(first));
+	ECDS_TEST_CHECK(ecds_object_find(TEST_NAME) == NULL);
+
+	/* Objects are found while the main thread releases their last reference */
+	disposed_count = 0;
+	find_done = 0;
+	for (int t = 0; t < TEST_THREADS; t++)
+		pthread_create(&threads[t], 0, _test_find_thread, &wrong[t]);
+
+	for (int round = 0; round < TEST_FIND_ROUNDS; round++)
+	{
+		object = _test_object_new(TEST_NAME);
+		ecds_object_unref(ECDS_OBJECT(object));
+	}
+
+	ecds_atomic_store(&find_done, 1);
+	for (int t = 0; t < TEST_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ECDS_TEST_CHECK(wrong[t] == 0);
+	}
+
+	ECDS_TEST_CHECK(disposed_count == TEST_FIND_ROUNDS);
+	ECDS_TEST_CHECK(ecds_object_find(TEST_NAME) == NULL);
+	ECDS_TEST_CHECK(ecds_memory_manager_get_object_count(NULL) == object_count);
+	ECDS_TEST_CHECK(ecds_atom_get_count() == atom_count);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_refcount();
+	_test_find();
+
+	return ECDS_TEST_RESULT();
+}
@@ -0,0 +1,247 @@
+/*****************************************************************************/
+/*	@file ecds_render_stream_test.c											 */
+/*	@brief Smoke test of render buffer streaming.							 */
+/*																			 */
+/*	Streams a changing scene from one renderer to another and checks that	 */
+/*	full and delta frames rebuild the buffers exactly. Frames that were		 */
+/*	cut short or carry oversized varints have to be rejected without		 */
+/*	touching memory outside the receiver's copy.							 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ecds.h>
+#include <common/ecds_payload.h>
+#include <core/ecds_object.h>
+#include <core/ecds_render_stream.h>
+#include <core/ecds_renderer.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-render-stream-test"
+
+#define TEST_VERTICES			40
+
+static const ecds_render_stream_config_t test_lossless = {
+	ECDS_RENDER_VERTEX_FLOAT64,
+	1.0,
+	true,
+	0
+};
+
+/* Record a rectangle in buffer 2, which does not change afterwards */
+static void _test_static_buffer(ecds_renderer_t * r)
+{
+	ecds_renderer_select_buffer(r, ecds_renderer_new_buffer(r));
+	ecds_renderer_set_colour(r, 1, 1, 1, 1);
+	ecds_renderer_rectangle(r, 30, 20);
+}
+
+/* Record a line strip in buffer 1, moved is the vertex that differs between frames */
+static void _test_scene(ecds_renderer_t * r, int moved, double offset)
+{
+	ecds_renderer_clear_buffer(r, 1);
+	ecds_renderer_select_buffer(r, 1);
+	ecds_renderer_set_colour(r, 1, 0.5, 0.25, 1);
+	ecds_renderer_begin_geometry(r, ECDS_DRAW_MODE_LINE_STRIP);
+	for (int i = 0; i < TEST_VERTICES; i++)
+		ecds_renderer_add_vertex(r, i * 2.5, i == moved ? offset : i * 0.5, 0);
+	ecds_renderer_end_geometry(r);
+
+	ecds_renderer_commit(r);
+}
+
+static bool _test_same_buffer(ecds_renderer_t * a, ecds_renderer_t * b, unsigned int buffer_id)
+{
+	const ecds_render_instruction_t * data_a, * data_b;
+	size_t length_a = ecds_renderer_get_buffer_data(a, buffer_id, &data_a);
+	size_t length_b = ecds_renderer_get_buffer_data(b, buffer_id, &data_b);
+
+	return length_a == length_b && length_a > 0 && memcmp(data_a, data_b, length_a) == 0;
+}
+
+/* Encode a frame of the sender and apply it to the receiver */
+static int _test_transfer(ecds_render_sender_t * sender, ecds_render_receiver_t * receiver)
+{
+	ecds_payload_t * frame = ecds_render_sender_encode_frame(sender);
+	int ret;
+
+	if (!frame)
+		return -1;
+
+	ret = ecds_render_receiver_apply_frame(receiver, ecds_payload_get_data(frame), ecds_payload_get_length(frame));
+	ecds_object_unref(ECDS_OBJECT(frame));
+
+	return ret;
+}
+
+static void _test_round_trip(void)
+{
+	ecds_renderer_t * source = ecds_renderer_new("test-source", sizeof(ecds_renderer_t));
+	ecds_renderer_t * target = ecds_renderer_new("test-target", sizeof(ecds_renderer_t));
+	ecds_render_sender_t * sender = ecds_render_sender_new(source, &test_lossless);
+	ecds_render_receiver_t * receiver = ecds_render_receiver_new(target);
+	ecds_render_sender_stats_t stats;
+
+	_test_static_buffer(source);
+	_test_scene(source, -1, 0);
+
+	/* The first frame carries every buffer in full and creates the missing ones */
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 1));
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 2));
+
+	/* One vertex moves: only buffer 1 changes, the receiver keeps what is around the change */
+	_test_scene(source, TEST_VERTICES / 2, 100);
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 1));
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 2));
+
+	/* Changes at both ends leave no common prefix or suffix */
+	_test_scene(source, 0, -5);
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+	_test_scene(source, TEST_VERTICES - 1, 7);
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 1));
+
+	ecds_render_sender_get_stats(sender, &stats);
+	ECDS_TEST_CHECK(stats.frames == 4);
+	ECDS_TEST_CHECK(stats.buffers_full == 2);
+	ECDS_TEST_CHECK(stats.buffers_delta == 3);
+	ECDS_TEST_CHECK(stats.buffers_skipped == 3);
+
+	ecds_object_unref(ECDS_OBJECT(receiver));
+	ecds_object_unref(ECDS_OBJECT(sender));
+	ecds_object_unref(ECDS_OBJECT(target));
+	ecds_object_unref(ECDS_OBJECT(source));
+}
+
+static void _test_truncated(void)
+{
+	ecds_renderer_t * source = ecds_renderer_new("test-source", sizeof(ecds_renderer_t));
+	ecds_renderer_t * target = ecds_renderer_new("test-target", sizeof(ecds_renderer_t));
+	ecds_render_sender_t * sender = ecds_render_sender_new(source, &test_lossless);
+	ecds_render_receiver_t * receiver = ecds_render_receiver_new(target);
+	ecds_render_receiver_stats_t stats;
+	ecds_payload_t * frame;
+	uint32_t length, rejected = 0;
+
+	_test_static_buffer(source);
+	_test_scene(source, -1, 0);
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+
+	_test_scene(source, 3, 50);
+	frame = ecds_render_sender_encode_frame(sender);
+	ECDS_TEST_CHECK(frame != NULL);
+	if (!frame)
+		return;
+	length = ecds_payload_get_length(frame);
+
+	/* Every byte of a frame is needed, so each shorter piece has to be rejected */
+	for (uint32_t cut = 0; cut < length; cut++)
+		rejected += ecds_render_receiver_apply_frame(receiver, ecds_payload_get_data(frame), cut) < 0;
+	ECDS_TEST_CHECK(rejected == length);
+
+	ecds_render_receiver_get_stats(receiver, &stats);
+	ECDS_TEST_CHECK(stats.frames == 1);
+	ECDS_TEST_CHECK(stats.errors == length);
+
+	ecds_object_unref(ECDS_OBJECT(frame));
+	ecds_object_unref(ECDS_OBJECT(receiver));
+	ecds_object_unref(ECDS_OBJECT(sender));
+	ecds_object_unref(ECDS_OBJECT(target));
+	ecds_object_unref(ECDS_OBJECT(source));
+}
+
+static size_t _test_put_varint(uint8_t * data, uint64_t value)
+{
+	size_t length = 0;
+
+	do
+	{
+		data[length] = (uint8_t)(value & 0x7F);
+		value >>= 7;
+		if (value)
+			data[length] |= 0x80;
+		length++;
+	} while (value);
+
+	return length;
+}
+
+/* Build a frame with one delta for buffer 1 that keeps prefix and suffix instructions and adds nothing */
+static size_t _test_delta_frame(uint8_t * data, uint64_t prefix, uint64_t suffix)
+{
+	size_t length = 0;
+
+	data[length++] = 0xEC;									/* Magic */
+	data[length++] = ECDS_RENDER_STREAM_VERSION;
+	length += _test_put_varint(data + length, ECDS_RENDER_VERTEX_FLOAT64);
+	length += _test_put_varint(data + length, 1);		/* Frame number */
+	length += _test_put_varint(data + length, 1);		/* Buffer count */
+	length += _test_put_varint(data + length, 1);		/* Buffer ID */
+	length += _test_put_varint(data + length, 1);		/* Delta */
+	length += _test_put_varint(data + length, prefix);
+	length += _test_put_varint(data + length, suffix);
+	length += _test_put_varint(data + length, 0);		/* Instruction count */
+
+	return length;
+}
+
+static void _test_oversized(void)
+{
+	ecds_renderer_t * source = ecds_renderer_new("test-source", sizeof(ecds_renderer_t));
+	ecds_renderer_t * target = ecds_renderer_new("test-target", sizeof(ecds_renderer_t));
+	ecds_render_sender_t * sender = ecds_render_sender_new(source, &test_lossless);
+	ecds_render_receiver_t * receiver = ecds_render_receiver_new(target);
+	uint8_t frame[128];
+	size_t length;
+
+	_test_static_buffer(source);
+	_test_scene(source, -1, 0);
+	ECDS_TEST_CHECK(_test_transfer(sender, receiver) == 0);
+
+	/* A delta that keeps the whole buffer is valid: colour, begin, the vertices and end */
+	length = _test_delta_frame(frame, 2, TEST_VERTICES + 1);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) == 0);
+	ECDS_TEST_CHECK(_test_same_buffer(source, target, 1));
+
+	/* Prefix and suffix that only fit when their sum wraps */
+	length = _test_delta_frame(frame, UINT64_MAX, 2);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) < 0);
+	length = _test_delta_frame(frame, 1, UINT64_MAX);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) < 0);
+	length = _test_delta_frame(frame, (uint64_t)UINT32_MAX + 1, 0);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) < 0);
+	length = _test_delta_frame(frame, TEST_VERTICES, TEST_VERTICES);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) < 0);
+
+	/* A varint longer than 64 bits */
+	length = _test_delta_frame(frame, 0, 0);
+	memset(frame + length - 1, 0xFF, 11);
+	frame[length + 10] = 0x01;
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length + 11) < 0);
+
+	/* Counts far beyond the data that follows */
+	length = _test_delta_frame(frame, 0, 0);
+	length = length - 1 + _test_put_varint(frame + length - 1, UINT64_MAX);
+	ECDS_TEST_CHECK(ecds_render_receiver_apply_frame(receiver, frame, length) < 0);
+
+	ecds_object_unref(ECDS_OBJECT(receiver));
+	ecds_object_unref(ECDS_OBJECT(sender));
+	ecds_object_unref(ECDS_OBJECT(target));
+	ecds_object_unref(ECDS_OBJECT(source));
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_ERROR);
+
+	_test_round_trip();
+	_test_truncated();
+	_test_oversized();
+
+	return ECDS_TEST_RESULT();
+}
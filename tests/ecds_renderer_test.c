@@ -0,0 +1,198 @@
+/*****************************************************************************/
+/*	@file ecds_renderer_test.c												 */
+/*	@brief Smoke test of render buffer recording.							 */
+/*																			 */
+/*	Records instructions into the contiguous render buffers and walks		 */
+/*	them back: headers have to stay aligned, data and padding have to		 */
+/*	survive the buffer growing, and copies and replays have to see the		 */
+/*	same instructions that were recorded.									 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ecds.h>
+#include <core/ecds_object.h>
+#include <core/ecds_renderer.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-renderer-test"
+
+//!<	Enough vertices to make the buffer grow a few times past its initial capacity.
+#define TEST_VERTICES			200
+
+typedef struct _test_renderer_t test_renderer_t;
+struct _test_renderer_t {
+	ecds_renderer_t renderer;
+	int geometries;
+	int vertices;
+	int wrong_vertices;
+	int colours;
+};
+
+static int _test_begin_geometry(ecds_renderer_t * renderer, unsigned int draw_mode)
+{
+	(void)draw_mode;
+	return ++((test_renderer_t *)renderer)->geometries;
+}
+
+static int _test_new_vertex(ecds_renderer_t * renderer, double x, double y, double z)
+{
+	test_renderer_t * tr = (test_renderer_t *)renderer;
+
+	if (x != tr->vertices || y != -tr->vertices || z != 0.5)
+		tr->wrong_vertices++;
+	return ++tr->vertices;
+}
+
+static int _test_set_colour(ecds_renderer_t * renderer, double a, double r, double g, double b)
+{
+	(void)a; (void)r; (void)g; (void)b;
+	return ++((test_renderer_t *)renderer)->colours;
+}
+
+/* Colour, a line with TEST_VERTICES vertices, text in a transform: TEST_VERTICES + 6 instructions */
+static void _test_record(ecds_renderer_t * r)
+{
+	ecds_renderer_set_colour(r, 1, 0.25, 0.5, 0.75);
+	ecds_renderer_begin_geometry(r, ECDS_DRAW_MODE_LINE_STRIP);
+	for (int i = 0; i < TEST_VERTICES; i++)
+		ecds_renderer_add_vertex(r, i, -i, 0.5);
+	ecds_renderer_end_geometry(r);
+	ecds_renderer_begin_transform(r, ECDS_TRANSFORM_NONE);
+	ecds_renderer_text(r, "abc");
+	ecds_renderer_end_transform(r);
+}
+
+static void _test_layout(void)
+{
+	test_renderer_t * tr = (test_renderer_t *)ecds_renderer_new("test-renderer", sizeof(test_renderer_t));
+	ecds_renderer_t * r = &tr->renderer;
+	const ecds_render_instruction_t * data, * instr, * end;
+	uint32_t count = 0, misaligned = 0, wrong_vertices = 0, dirty_padding = 0;
+	size_t length;
+
+	_test_record(r);
+	length = ecds_renderer_get_buffer_data(r, 1, &data);
+	ECDS_TEST_CHECK(length > 0 && length % 8 == 0);
+
+	end = (const ecds_render_instruction_t *)((const uint8_t *)data + length);
+	for (instr = data; instr < end; instr = ECDS_RENDER_INSTRUCTION_NEXT(instr), count++)
+	{
+		const uint8_t * bytes = (const uint8_t *)ECDS_RENDER_INSTRUCTION_DATA(instr);
+
+		misaligned += ((const uint8_t *)instr - (const uint8_t *)data) % 8 != 0;
+		for (size_t b = instr->length; b < ECDS_RENDER_INSTRUCTION_SIZE(instr->length) - sizeof(ecds_render_instruction_t); b++)
+			dirty_padding += bytes[b] != 0;
+
+		if (instr->opcode == ECDS_RENDER_PARAMETER && instr->parameter == ECDS_RENDER_PARAM_VERTEX)
+		{
+			double values[3];
+			int i = (int)count - 2;
+
+			memcpy(values, bytes, sizeof(values));
+			wrong_vertices += instr->length != sizeof(values) || values[0] != i || values[1] != -i || values[2] != 0.5;
+		}
+	}
+
+	/* The walk ends exactly at the end of the buffer */
+	ECDS_TEST_CHECK(instr == end);
+	ECDS_TEST_CHECK(count == TEST_VERTICES + 6);
+	ECDS_TEST_CHECK(misaligned == 0);
+	ECDS_TEST_CHECK(wrong_vertices == 0);
+	ECDS_TEST_CHECK(dirty_padding == 0);
+
+	/* The text is the second to last instruction and keeps its terminator */
+	instr = (const ecds_render_instruction_t *)((const uint8_t *)end - ECDS_RENDER_INSTRUCTION_SIZE(0) - ECDS_RENDER_INSTRUCTION_SIZE(4));
+	ECDS_TEST_CHECK(instr->parameter == ECDS_RENDER_PARAM_TEXT && instr->length == 4);
+	ECDS_TEST_CHECK(strcmp((const char *)ECDS_RENDER_INSTRUCTION_DATA(instr), "abc") == 0);
+
+	/* Replaying passes every vertex and colour to the implementation */
+	tr->renderer.begin_geometry = _test_begin_geometry;
+	tr->renderer.new_vertex = _test_new_vertex;
+	tr->renderer.set_colour = _test_set_colour;
+	ecds_renderer_redraw(r);
+	ECDS_TEST_CHECK(tr->geometries == 1 && tr->colours == 1);
+	ECDS_TEST_CHECK(tr->vertices == TEST_VERTICES && tr->wrong_vertices == 0);
+
+	ecds_object_unref(ECDS_OBJECT(tr));
+}
+
+static void _test_copy(void)
+{
+	ecds_renderer_t * r = ecds_renderer_new("test-renderer", sizeof(ecds_renderer_t));
+	const ecds_render_instruction_t * data, * copied, * instr, * end;
+	ecds_render_instruction_t * target;
+	unsigned int length = 0, small;
+	size_t copied_length;
+	int second;
+
+	_test_record(r);
+	ECDS_TEST_CHECK(ecds_renderer_copy_buffer(r, &length, NULL) == 0);
+	ECDS_TEST_CHECK(length == ecds_renderer_get_buffer_data(r, 1, &data));
+
+	/* Too little room is refused, enough room gets an exact copy */
+	target = (ecds_render_instruction_t *)ecds_memory_alloc(length);
+	small = length - 8;
+	ECDS_TEST_CHECK(ecds_renderer_copy_buffer(r, &small, target) < 0);
+	ECDS_TEST_CHECK(ecds_renderer_copy_buffer(r, &length, target) == (int)length);
+	ECDS_TEST_CHECK(memcmp(target, data, length) == 0);
+
+	/* Appending the instructions one by one to another buffer gives the same bytes */
+	second = ecds_renderer_new_buffer(r);
+	ECDS_TEST_CHECK(second == 2);
+	ECDS_TEST_CHECK(ecds_renderer_select_buffer(r, (unsigned int)second) == second);
+	end = (const ecds_render_instruction_t *)((const uint8_t *)target + length);
+	for (instr = target; instr < end; instr = ECDS_RENDER_INSTRUCTION_NEXT(instr))
+		ecds_renderer_append_instruction(r, instr);
+
+	copied_length = ecds_renderer_get_buffer_data(r, (unsigned int)second, &copied);
+	ECDS_TEST_CHECK(copied_length == length && memcmp(copied, target, length) == 0);
+
+	/* The appended instructions are balanced, so nothing is left open */
+	ECDS_TEST_CHECK(ecds_renderer_end_geometry(r) < 0);
+	ECDS_TEST_CHECK(ecds_renderer_end_transform(r) < 0);
+
+	ecds_memory_free(target);
+	ecds_object_unref(ECDS_OBJECT(r));
+}
+
+static void _test_clear(void)
+{
+	ecds_renderer_t * r = ecds_renderer_new("test-renderer", sizeof(ecds_renderer_t));
+	const ecds_render_instruction_t * before, * after;
+	size_t length;
+
+	ECDS_TEST_CHECK(ecds_renderer_select_buffer(r, 7) < 0);
+	ECDS_TEST_CHECK(ecds_renderer_end_geometry(r) < 0);
+
+	_test_record(r);
+	ECDS_TEST_CHECK(ecds_renderer_buffer_is_dirty(r, 1));
+	ECDS_TEST_CHECK(ecds_renderer_commit(r) == 1);
+	ECDS_TEST_CHECK(!ecds_renderer_buffer_is_dirty(r, 1));
+	length = ecds_renderer_get_buffer_data(r, 1, &before);
+
+	/* Clearing marks the buffer changed but keeps its memory for the next recording */
+	ecds_renderer_clear_buffer(r, 1);
+	ECDS_TEST_CHECK(ecds_renderer_get_buffer_data(r, 1, &after) == 0);
+	ECDS_TEST_CHECK(ecds_renderer_buffer_is_dirty(r, 1));
+
+	_test_record(r);
+	ECDS_TEST_CHECK(ecds_renderer_get_buffer_data(r, 1, &after) == length);
+	ECDS_TEST_CHECK(after == before);
+
+	ecds_object_unref(ECDS_OBJECT(r));
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_layout();
+	_test_copy();
+	_test_clear();
+
+	return ECDS_TEST_RESULT();
+}
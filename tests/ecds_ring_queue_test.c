@@ -0,0 +1,226 @@
+/*****************************************************************************/
+/*	@file ecds_ring_queue_test.c											 */
+/*	@brief Smoke test of the bounded ring queue.							 */
+/*																			 */
+/*	Checks the order objects come out in, the three back-pressure			 */
+/*	policies and their counters, closing, and several producers feeding		 */
+/*	one blocked consumer.													 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <ecds.h>
+#include <common/ecds_ring_queue.h>
+#include <core/ecds_object.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-ring-queue-test"
+
+#define TEST_PRODUCERS		4
+#define TEST_PER_PRODUCER	5000
+
+typedef struct _test_item_t test_item_t;
+struct _test_item_t {
+	ecds_object_t obj;
+	int producer;
+	int sequence;
+};
+
+static test_item_t * _test_item_new(int producer, int sequence)
+{
+	test_item_t * item = (test_item_t *)ecds_object_new(NULL, sizeof(test_item_t), ECDS_TYPE_TEST_OBJECT);
+
+	item->producer = producer;
+	item->sequence = sequence;
+
+	return item;
+}
+
+/* Post an item and drop the reference of the caller, the queue keeps its own */
+static bool _test_post(ecds_ring_queue_t * queue, int producer, int sequence)
+{
+	test_item_t * item = _test_item_new(producer, sequence);
+	bool ret = ecds_ring_queue_enqueue(queue, ECDS_OBJECT(item));
+
+	ecds_object_unref(ECDS_OBJECT(item));
+
+	return ret;
+}
+
+/* Take the next item, returns its sequence or -1 if the queue is empty */
+static int _test_take(ecds_ring_queue_t * queue)
+{
+	test_item_t * item = (test_item_t *)ecds_ring_queue_dequeue(queue);
+	int sequence;
+
+	if (!item)
+		return -1;
+
+	sequence = item->sequence;
+	ecds_object_unref(ECDS_OBJECT(item));
+
+	return sequence;
+}
+
+static void _test_order(void)
+{
+	ecds_ring_queue_t * queue = ecds_ring_queue_new(8, ECDS_RING_QUEUE_FAIL);
+	ecds_ring_queue_stats_t stats;
+
+	for (int i = 0; i < 5; i++)
+		ECDS_TEST_CHECK(_test_post(queue, 0, i));
+	ECDS_TEST_CHECK(ecds_ring_queue_depth(queue) == 5);
+
+	for (int i = 0; i < 5; i++)
+		ECDS_TEST_CHECK(_test_take(queue) == i);
+	ECDS_TEST_CHECK(_test_take(queue) == -1);
+
+	ecds_ring_queue_get_stats(queue, &stats);
+	ECDS_TEST_CHECK(stats.capacity == 8);
+	ECDS_TEST_CHECK(stats.depth == 0);
+	ECDS_TEST_CHECK(stats.peak_depth == 5);
+	ECDS_TEST_CHECK(stats.enqueued == 5 && stats.dequeued == 5);
+
+	ecds_ring_queue_dispose(queue);
+}
+
+static void _test_fail_policy(void)
+{
+	ecds_ring_queue_t * queue = ecds_ring_queue_new(4, ECDS_RING_QUEUE_FAIL);
+	ecds_ring_queue_stats_t stats;
+
+	for (int i = 0; i < 4; i++)
+		ECDS_TEST_CHECK(_test_post(queue, 0, i));
+	ECDS_TEST_CHECK(!_test_post(queue, 0, 4));
+
+	/* The oldest items stay, the new one is refused */
+	ECDS_TEST_CHECK(_test_take(queue) == 0);
+
+	ecds_ring_queue_get_stats(queue, &stats);
+	ECDS_TEST_CHECK(stats.enqueued == 4);
+	ECDS_TEST_CHECK(stats.rejected == 1);
+	ECDS_TEST_CHECK(stats.dropped == 0);
+
+	ecds_ring_queue_dispose(queue);
+}
+
+static void _test_drop_oldest_policy(void)
+{
+	ecds_ring_queue_t * queue = ecds_ring_queue_new(4, ECDS_RING_QUEUE_DROP_OLDEST);
+	ecds_ring_queue_stats_t stats;
+	int taken = 0;
+
+	for (int i = 0; i < 10; i++)
+		ECDS_TEST_CHECK(_test_post(queue, 0, i));
+
+	/* Only the newest items are left */
+	for (int i = 6; i < 10; i++, taken++)
+		ECDS_TEST_CHECK(_test_take(queue) == i);
+	ECDS_TEST_CHECK(_test_take(queue) == -1);
+
+	/* Evicted items are dropped, not dequeued */
+	ecds_ring_queue_get_stats(queue, &stats);
+	ECDS_TEST_CHECK(stats.enqueued == 10);
+	ECDS_TEST_CHECK(stats.dropped == 6);
+	ECDS_TEST_CHECK(stats.dequeued == (uint64_t)taken);
+	ECDS_TEST_CHECK(stats.enqueued == stats.dequeued + stats.dropped);
+
+	ecds_ring_queue_dispose(queue);
+}
+
+static void _test_close(void)
+{
+	ecds_ring_queue_t * queue = ecds_ring_queue_new(4, ECDS_RING_QUEUE_BLOCK);
+	ecds_ring_queue_stats_t stats;
+
+	ECDS_TEST_CHECK(_test_post(queue, 0, 0));
+	ecds_ring_queue_close(queue);
+
+	/* Queued items can still be taken, new ones are refused */
+	ECDS_TEST_CHECK(!_test_post(queue, 0, 1));
+	ECDS_TEST_CHECK(ecds_ring_queue_wait(queue));
+	ECDS_TEST_CHECK(_test_take(queue) == 0);
+	ECDS_TEST_CHECK(!ecds_ring_queue_wait(queue));
+
+	ecds_ring_queue_get_stats(queue, &stats);
+	ECDS_TEST_CHECK(stats.rejected == 1);
+
+	ecds_ring_queue_dispose(queue);
+}
+
+typedef struct _test_producer_t test_producer_t;
+struct _test_producer_t {
+	ecds_ring_queue_t * queue;
+	int index;
+	pthread_t thread[1];
+};
+
+static void * _test_producer_thread(void * arg)
+{
+	test_producer_t * producer = (test_producer_t *)arg;
+
+	for (int i = 0; i < TEST_PER_PRODUCER; i++)
+		_test_post(producer->queue, producer->index, i);
+
+	return NULL;
+}
+
+static void _test_producers(void)
+{
+	ecds_ring_queue_t * queue = ecds_ring_queue_new(64, ECDS_RING_QUEUE_BLOCK);
+	test_producer_t producers[TEST_PRODUCERS];
+	int next[TEST_PRODUCERS] = { 0 };
+	ecds_ring_queue_stats_t stats;
+	test_item_t * item;
+	int received = 0, out_of_order = 0;
+
+	for (int p = 0; p < TEST_PRODUCERS; p++)
+	{
+		producers[p].queue = queue;
+		producers[p].index = p;
+		pthread_create(producers[p].thread, 0, _test_producer_thread, &producers[p]);
+	}
+
+	/* A small queue makes the producers block on the consumer */
+	while (received < TEST_PRODUCERS * TEST_PER_PRODUCER && ecds_ring_queue_wait(queue))
+	{
+		while ((item = (test_item_t *)ecds_ring_queue_dequeue(queue)))
+		{
+			/* Items of one producer arrive in the order they were posted */
+			if (item->sequence != next[item->producer]++)
+				out_of_order++;
+			received++;
+			ecds_object_unref(ECDS_OBJECT(item));
+		}
+	}
+
+	for (int p = 0; p < TEST_PRODUCERS; p++)
+		pthread_join(producers[p].thread[0], NULL);
+
+	ECDS_TEST_CHECK(received == TEST_PRODUCERS * TEST_PER_PRODUCER);
+	ECDS_TEST_CHECK(out_of_order == 0);
+
+	ecds_ring_queue_get_stats(queue, &stats);
+	ECDS_TEST_CHECK(stats.enqueued == (uint64_t)received && stats.dequeued == (uint64_t)received);
+	ECDS_TEST_CHECK(stats.peak_depth <= stats.capacity);
+
+	ecds_ring_queue_dispose(queue);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_order();
+	_test_fail_policy();
+	_test_drop_oldest_policy();
+	_test_close();
+	_test_producers();
+
+	return ECDS_TEST_RESULT();
+}
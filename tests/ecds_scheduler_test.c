@@ -0,0 +1,204 @@
+/*****************************************************************************/
+/*	@file ecds_scheduler_test.c												 */
+/*	@brief Smoke test of the cyclic scheduler.								 */
+/*																			 */
+/*	Adds processes, lets them run a few frames, moves them between			 */
+/*	workers and removes them again.											 */
+/*	Every process has to be initialized on a worker before its first		 */
+/*	frame and shut down after its last one, once per time it was added.		 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+
+#define HAVE_STRUCT_TIMESPEC
+#include <pthread.h>
+
+#include <ecds.h>
+#include <common/ecds_atomic.h>
+#include <core/ecds_object.h>
+#include <core/ecds_process.h>
+#include <core/ecds_scheduler.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-scheduler-test"
+
+#define TEST_PERIOD				ECDS_SCHEDULER_HZ(1000)
+#define TEST_FRAMES				10
+#define TEST_TIMEOUT_MS			5000
+
+typedef struct _test_process_t test_process_t;
+struct _test_process_t {
+	ecds_process_t process;
+	int initialized;
+	int runs;
+	int shutdowns;
+	int runs_outside;				//!<	Frames that ran before initialize(), after shutdown() or on the main thread
+};
+
+static pthread_t main_thread;
+
+static void _test_initialize(ecds_process_t * proc)
+{
+	test_process_t * tp = (test_process_t *)proc;
+
+	ecds_atomic_increment(&tp->initialized);
+}
+
+static void _test_run(ecds_process_t * proc)
+{
+	test_process_t * tp = (test_process_t *)proc;
+
+	if (ecds_atomic_load(&tp->initialized) != ecds_atomic_load(&tp->shutdowns) + 1 || pthread_equal(pthread_self(), main_thread))
+		ecds_atomic_increment(&tp->runs_outside);
+	ecds_atomic_increment(&tp->runs);
+}
+
+static void _test_shutdown(ecds_process_t * proc)
+{
+	test_process_t * tp = (test_process_t *)proc;
+
+	ecds_atomic_increment(&tp->shutdowns);
+}
+
+static test_process_t * _test_process_new(void)
+{
+	test_process_t * tp = (test_process_t *)ecds_object_new(NULL, sizeof(test_process_t), ECDS_TYPE_TEST_OBJECT);
+
+	tp->process.initialize = _test_initialize;
+	tp->process.run = _test_run;
+	tp->process.shutdown = _test_shutdown;
+
+	return tp;
+}
+
+static void _test_sleep_ms(long ms)
+{
+	struct timespec delay = { ms / 1000, (ms % 1000) * 1000000 };
+
+	nanosleep(&delay, NULL);
+}
+
+/* Wait until a process ran at least count more frames, returns false on timeout */
+static bool _test_wait_runs(test_process_t * tp, int count)
+{
+	int target = ecds_atomic_load(&tp->runs) + count;
+
+	for (int waited = 0; waited < TEST_TIMEOUT_MS; waited++)
+	{
+		if (ecds_atomic_load(&tp->runs) >= target)
+			return true;
+		_test_sleep_ms(1);
+	}
+
+	return false;
+}
+
+static void _test_add_remove(void)
+{
+	ecds_scheduler_t * sched = (ecds_scheduler_t *)ecds_scheduler_construct("test-scheduler");
+	test_process_t * first = _test_process_new(), * second = _test_process_new();
+	ecds_scheduler_stats_t stats;
+	int runs;
+
+	ECDS_TEST_CHECK(sched != NULL);
+	if (!sched)
+		return;
+
+	ECDS_TEST_CHECK(ecds_scheduler_add_process(sched, &first->process, TEST_PERIOD));
+	ECDS_TEST_CHECK(!ecds_scheduler_add_process(sched, &first->process, TEST_PERIOD));
+	ECDS_TEST_CHECK(ecds_scheduler_add_process(sched, &second->process, TEST_PERIOD));
+	ECDS_TEST_CHECK(_test_wait_runs(first, TEST_FRAMES));
+	ECDS_TEST_CHECK(_test_wait_runs(second, TEST_FRAMES));
+
+	ECDS_TEST_CHECK(ecds_scheduler_get_stats(sched, &first->process, &stats));
+	ECDS_TEST_CHECK(stats.period_ns == TEST_PERIOD);
+	ECDS_TEST_CHECK(stats.frames >= TEST_FRAMES);
+
+	/* Once removed, a process is shut down and does not run anymore */
+	ECDS_TEST_CHECK(ecds_scheduler_remove_process(sched, &first->process));
+	ECDS_TEST_CHECK(!ecds_scheduler_remove_process(sched, &first->process));
+	ECDS_TEST_CHECK(!ecds_scheduler_get_stats(sched, &first->process, &stats));
+	ECDS_TEST_CHECK(first->shutdowns == 1);
+	runs = ecds_atomic_load(&first->runs);
+	ECDS_TEST_CHECK(_test_wait_runs(second, TEST_FRAMES));
+	ECDS_TEST_CHECK(ecds_atomic_load(&first->runs) == runs);
+
+	/* A removed process can be scheduled again */
+	ECDS_TEST_CHECK(ecds_scheduler_add_process(sched, &first->process, TEST_PERIOD));
+	ECDS_TEST_CHECK(_test_wait_runs(first, 1));
+	ECDS_TEST_CHECK(ecds_scheduler_remove_process(sched, &first->process));
+	ECDS_TEST_CHECK(first->initialized == 2 && first->shutdowns == 2);
+
+	/* Destroying the scheduler shuts down what is left */
+	ecds_scheduler_destroy(sched);
+	ECDS_TEST_CHECK(second->initialized == 1 && second->shutdowns == 1);
+	ECDS_TEST_CHECK(first->runs_outside == 0 && second->runs_outside == 0);
+
+	ecds_object_unref(ECDS_OBJECT(first));
+	ecds_object_unref(ECDS_OBJECT(second));
+}
+
+static void _test_move(void)
+{
+	ecds_scheduler_config_t config = { 2, NULL };
+	ecds_scheduler_t * sched = (ecds_scheduler_t *)ecds_scheduler_construct_with_config("test-scheduler", &config);
+	test_process_t * moved = _test_process_new(), * placed = _test_process_new();
+	ecds_scheduler_worker_stats_t worker_stats[2];
+	ecds_scheduler_stats_t stats;
+	uint64_t frames;
+
+	ECDS_TEST_CHECK(sched != NULL);
+	if (!sched)
+		return;
+
+	ECDS_TEST_CHECK(ecds_scheduler_get_worker_count(sched) == 2);
+	ECDS_TEST_CHECK(!ecds_scheduler_add_process_on(sched, &moved->process, TEST_PERIOD, 2));
+	ECDS_TEST_CHECK(ecds_scheduler_add_process_on(sched, &moved->process, TEST_PERIOD, 0));
+	ECDS_TEST_CHECK(_test_wait_runs(moved, TEST_FRAMES));
+	ECDS_TEST_CHECK(ecds_scheduler_get_stats(sched, &moved->process, &stats) && stats.worker == 0);
+	frames = stats.frames;
+
+	/* The process keeps its statistics and is not initialized again on the other worker */
+	ECDS_TEST_CHECK(!ecds_scheduler_move_process(sched, &moved->process, 2));
+	ECDS_TEST_CHECK(!ecds_scheduler_move_process(sched, &placed->process, 1));
+	ECDS_TEST_CHECK(ecds_scheduler_move_process(sched, &moved->process, 1));
+	ECDS_TEST_CHECK(_test_wait_runs(moved, TEST_FRAMES));
+	ECDS_TEST_CHECK(ecds_scheduler_get_stats(sched, &moved->process, &stats) && stats.worker == 1);
+	ECDS_TEST_CHECK(stats.frames > frames);
+	ECDS_TEST_CHECK(moved->initialized == 1 && moved->shutdowns == 0);
+
+	ECDS_TEST_CHECK(ecds_scheduler_get_worker_stats(sched, 0, &worker_stats[0]));
+	ECDS_TEST_CHECK(ecds_scheduler_get_worker_stats(sched, 1, &worker_stats[1]));
+	ECDS_TEST_CHECK(!ecds_scheduler_get_worker_stats(sched, 2, &worker_stats[0]));
+	ECDS_TEST_CHECK(worker_stats[0].process_count == 0 && worker_stats[1].process_count == 1);
+
+	/* Without a worker index the least loaded worker is picked */
+	ECDS_TEST_CHECK(ecds_scheduler_add_process(sched, &placed->process, TEST_PERIOD));
+	ECDS_TEST_CHECK(_test_wait_runs(placed, 1));
+	ECDS_TEST_CHECK(ecds_scheduler_get_stats(sched, &placed->process, &stats) && stats.worker == 0);
+
+	/* A moved process is removed from the worker it ended up on */
+	ECDS_TEST_CHECK(ecds_scheduler_remove_process(sched, &moved->process));
+	ECDS_TEST_CHECK(moved->shutdowns == 1);
+
+	ecds_scheduler_destroy(sched);
+	ECDS_TEST_CHECK(placed->initialized == 1 && placed->shutdowns == 1);
+	ECDS_TEST_CHECK(moved->runs_outside == 0 && placed->runs_outside == 0);
+
+	ecds_object_unref(ECDS_OBJECT(moved));
+	ecds_object_unref(ECDS_OBJECT(placed));
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+	main_thread = pthread_self();
+
+	_test_add_remove();
+	_test_move();
+
+	return ECDS_TEST_RESULT();
+}
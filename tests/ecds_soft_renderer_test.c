@@ -0,0 +1,226 @@
+/*****************************************************************************/
+/*	@file ecds_soft_renderer_test.c											 */
+/*	@brief Golden image test of the software renderer.						 */
+/*																			 */
+/*	Renders a fixed scene that uses every kind of geometry, nested			 */
+/*	transforms, blending and text, once on the calling thread and once		 */
+/*	with worker threads, and compares both with a checked-in PPM image.		 */
+/*																			 */
+/*	Usage: ecds_soft_renderer_test <golden.ppm> [<actual.ppm>]				 */
+/*	The rendered image is written to actual.ppm when it does not match.		 */
+/*	With ECDS_UPDATE_GOLDEN set in the environment the golden image is		 */
+/*	written instead, after a change to the renderer was checked by eye.		 */
+/*																			 */
+/*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecds.h>
+#include <core/ecds_object.h>
+#include <core/ecds_renderer.h>
+#include <core/ecds_soft_renderer.h>
+#include <core/ecds_transform.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-soft-renderer-test"
+
+#define TEST_WIDTH				160
+#define TEST_HEIGHT				120
+#define TEST_THREADS			3
+
+//!<	A channel may be off by this much, for rounding differences of the math library.
+#define TEST_CHANNEL_TOLERANCE	2
+
+//!<	Pixels allowed to differ by more than TEST_CHANNEL_TOLERANCE, for edges that round the other way.
+#define TEST_PIXEL_TOLERANCE	((TEST_WIDTH * TEST_HEIGHT) / 1000)
+
+static void _test_transform(ecds_renderer_t * r, unsigned int mode, double a, double b)
+{
+	double values[2] = { a, b };
+
+	ecds_renderer_begin_transform(r, mode);
+	ecds_renderer_parameter(r, ECDS_RENDER_PARAM_TRANSFORM, mode == ECDS_TRANSFORM_ROTATE ? sizeof(double) : sizeof(values), values);
+}
+
+static void _test_scene(ecds_renderer_t * r)
+{
+	static const double fan[] = {
+		0, 0, 0,	40, 0, 0,	28, 28, 0,
+		0, 0, 0,	0, 40, 0,	-28, 28, 0,
+	};
+
+	ecds_renderer_clear_buffer(r, 1);
+
+	/* Background and a filled triangle fan, rotated and scaled */
+	ecds_renderer_set_colour(r, 1, 0.1, 0.1, 0.2);
+	ecds_renderer_rectangle(r, TEST_WIDTH, TEST_HEIGHT);
+
+	_test_transform(r, ECDS_TRANSFORM_TRANSLATE, 40, 40);
+	_test_transform(r, ECDS_TRANSFORM_ROTATE, 20, 0);
+	_test_transform(r, ECDS_TRANSFORM_SCALE, 1.2, 0.8);
+	ecds_renderer_set_colour(r, 1, 0.3, 0.8, 0.2);
+	ecds_renderer_begin_geometry(r, ECDS_DRAW_MODE_TRIANGLE);
+	ecds_renderer_add_vertices(r, fan, sizeof(fan) / sizeof(fan[0]) / 3);
+	ecds_renderer_end_geometry(r);
+	ecds_renderer_end_transform(r);
+	ecds_renderer_end_transform(r);
+	ecds_renderer_end_transform(r);
+
+	/* A dial: filled ellipse, a filled arc and outlines */
+	_test_transform(r, ECDS_TRANSFORM_TRANSLATE, 110, 55);
+	ecds_renderer_set_colour(r, 1, 0.3, 0.3, 0.3);
+	ecds_renderer_ellipse(r, 80, 70);
+	ecds_renderer_set_colour(r, 1, 0, 0.8, 0);
+	ecds_renderer_arc(r, 70, 60, 135, 300);
+	ecds_renderer_begin_geometry(r, ECDS_DRAW_MODE_LINE_LOOP);
+	ecds_renderer_set_colour(r, 1, 1, 1, 1);
+	ecds_renderer_arc(r, 84, 74, 135, 405);
+	ecds_renderer_end_geometry(r);
+
+	/* A translucent square on top */
+	_test_transform(r, ECDS_TRANSFORM_TRANSLATE, -15, -15);
+	ecds_renderer_set_colour(r, 0.5, 0.2, 0.2, 1);
+	ecds_renderer_rectangle(r, 30, 30);
+	ecds_renderer_end_transform(r);
+	ecds_renderer_end_transform(r);
+
+	/* Lines and text */
+	ecds_renderer_set_colour(r, 1, 1, 0.6, 0);
+	ecds_renderer_begin_geometry(r, ECDS_DRAW_MODE_LINE);
+	for (int i = 0; i < 8; i++)
+	{
+		ecds_renderer_add_vertex(r, 10 + i * 6, 100, 0);
+		ecds_renderer_add_vertex(r, 10 + i * 6, 100 + (i % 3) * 4 + 4, 0);
+	}
+	ecds_renderer_end_geometry(r);
+
+	_test_transform(r, ECDS_TRANSFORM_TRANSLATE, 70, 102);
+	ecds_renderer_set_colour(r, 1, 1, 1, 1);
+	ecds_renderer_text(r, "ALT 1234");
+	ecds_renderer_end_transform(r);
+
+	ecds_renderer_commit(r);
+}
+
+static ecds_soft_renderer_t * _test_render(uint32_t thread_count)
+{
+	ecds_soft_renderer_t * sr = ecds_soft_renderer_new("test-renderer", TEST_WIDTH, TEST_HEIGHT, thread_count);
+
+	if (sr)
+		_test_scene(&sr->renderer);
+
+	return sr;
+}
+
+/* Read a binary PPM as written by ecds_soft_renderer_write_ppm(), returns NULL if it cannot be read */
+static uint8_t * _test_read_ppm(const char * path, uint32_t * width, uint32_t * height)
+{
+	uint8_t * data = NULL;
+	unsigned int w, h, max;
+	FILE * file;
+
+	if (!(file = fopen(path, "rb")))
+		return NULL;
+
+	if (fscanf(file, "P6 %u %u %u", &w, &h, &max) == 3 && max == 255 && fgetc(file) != EOF &&
+		(data = (uint8_t *)malloc((size_t)w * h * 3)) && fread(data, 3, (size_t)w * h, file) == (size_t)w * h)
+	{
+		*width = w;
+		*height = h;
+	}
+	else
+	{
+		free(data);
+		data = NULL;
+	}
+
+	fclose(file);
+	return data;
+}
+
+/* Count the pixels that differ from the golden image by more than the channel tolerance */
+static uint32_t _test_compare(ecds_soft_renderer_t * sr, const uint8_t * golden)
+{
+	uint32_t differing = 0;
+
+	for (size_t i = 0; i < (size_t)TEST_WIDTH * TEST_HEIGHT; i++)
+	{
+		const uint8_t expected[3] = { golden[i * 3], golden[i * 3 + 1], golden[i * 3 + 2] };
+		const uint8_t actual[3] = { (uint8_t)(sr->pixels[i] >> 16), (uint8_t)(sr->pixels[i] >> 8), (uint8_t)sr->pixels[i] };
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (abs((int)expected[c] - (int)actual[c]) > TEST_CHANNEL_TOLERANCE)
+			{
+				differing++;
+				break;
+			}
+		}
+	}
+
+	return differing;
+}
+
+int main(int argc, char ** argv)
+{
+	ecds_soft_renderer_t * single, * threaded;
+	uint32_t width = 0, height = 0, differing;
+	uint8_t * golden;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <golden.ppm> [<actual.ppm>]\n", argv[0]);
+		return 2;
+	}
+
+	ecds_log_set_level(ECDS_WARN);
+
+	/* The vector kernels may round differently, the golden image is made with the scalar one */
+	ecds_transform_select_kernel(ECDS_TRANSFORM_KERNEL_SCALAR);
+
+	single = _test_render(0);
+	threaded = _test_render(TEST_THREADS);
+	ECDS_TEST_CHECK(single != NULL && threaded != NULL);
+	if (!single || !threaded)
+		return ECDS_TEST_RESULT();
+
+	/* Tiles rendered by workers have to match the single threaded result exactly */
+	ECDS_TEST_CHECK(memcmp(single->pixels, threaded->pixels, (size_t)TEST_WIDTH * TEST_HEIGHT * sizeof(uint32_t)) == 0);
+
+	if (getenv("ECDS_UPDATE_GOLDEN"))
+	{
+		ECDS_TEST_CHECK(ecds_soft_renderer_write_ppm(single, argv[1]) == 0);
+		printf("Wrote golden image %s\n", argv[1]);
+	}
+	else if (!(golden = _test_read_ppm(argv[1], &width, &height)))
+	{
+		fprintf(stderr, "Cannot read golden image %s\n", argv[1]);
+		ecds_test_failures++;
+	}
+	else
+	{
+		ECDS_TEST_CHECK(width == TEST_WIDTH && height == TEST_HEIGHT);
+		if (width == TEST_WIDTH && height == TEST_HEIGHT)
+		{
+			differing = _test_compare(single, golden);
+			if (differing > TEST_PIXEL_TOLERANCE)
+				fprintf(stderr, "%u pixels differ from %s\n", differing, argv[1]);
+			ECDS_TEST_CHECK(differing <= TEST_PIXEL_TOLERANCE);
+		}
+		free(golden);
+	}
+
+	if (ecds_test_failures && argc > 2)
+	{
+		ecds_soft_renderer_write_ppm(single, argv[2]);
+		fprintf(stderr, "Rendered image written to %s\n", argv[2]);
+	}
+
+	ecds_object_unref(ECDS_OBJECT(single));
+	ecds_object_unref(ECDS_OBJECT(threaded));
+
+	return ECDS_TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+/*****************************************************************************/
+/*	@file ecds_tessellation_test.c											 */
+/*	@brief Smoke test of the tessellation cache.							 */
+/*																			 */
+/*	Checks hits and misses, that the least recently used outline is			 */
+/*	evicted first once the memory limit is reached, that lowering the		 */
+/*	limit trims the cache, and that segment counts stay within bounds.		 */
+/*																			 */
+/*****************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+
+#include <ecds.h>
+#include <core/ecds_renderer.h>
+#include <core/ecds_tessellation.h>
+
+#include "ecds_test.h"
+
+#define ECDS_LOG_DOMAIN "ecds-tessellation-test"
+
+//!<	Bytes taken by the outline of a rectangle.
+#define TEST_RECTANGLE_SIZE		(sizeof(ecds_tessellation_t) + 4 * 3 * sizeof(float))
+
+static const ecds_tessellation_t * _test_rectangle(ecds_tessellation_cache_t * cache, double width)
+{
+	return ecds_tessellation_cache_get(cache, ECDS_RENDER_PARAM_RECTANGLE, width, 10, 0, 0, 1);
+}
+
+/* Whether a rectangle is cached, without touching its place in the LRU order */
+static bool _test_cached(ecds_tessellation_cache_t * cache, double width)
+{
+	for (const ecds_tessellation_t * entry = cache->newest; entry; entry = entry->older)
+	{
+		if (entry->key.width == width)
+			return true;
+	}
+
+	return false;
+}
+
+static void _test_hits(void)
+{
+	ecds_tessellation_cache_t cache;
+	const ecds_tessellation_t * first, * again, * full_arc;
+
+	ecds_tessellation_cache_initialize(&cache, 0, 0);
+
+	first = ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_ELLIPSE, 100, 50, 0, 0, 2);
+	again = ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_ELLIPSE, 100, 50, 0, 0, 2);
+	ECDS_TEST_CHECK(first != NULL && first == again);
+	ECDS_TEST_CHECK(cache.hits == 1 && cache.misses == 1);
+	ECDS_TEST_CHECK(first->closed && first->point_count == first->key.segments);
+
+	/* An arc all the way around is the same outline */
+	full_arc = ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_ARC, 100, 50, 0, 360, 2);
+	ECDS_TEST_CHECK(full_arc == first);
+	ECDS_TEST_CHECK(cache.hits == 2);
+
+	/* A larger scale needs more segments, so it is another entry */
+	ECDS_TEST_CHECK(ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_ELLIPSE, 100, 50, 0, 0, 8)->key.segments > first->key.segments);
+	ECDS_TEST_CHECK(cache.misses == 2);
+
+	ECDS_TEST_CHECK(ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_TEXT, 1, 1, 0, 0, 1) == NULL);
+
+	ecds_tessellation_cache_clear(&cache);
+	ECDS_TEST_CHECK(cache.memory == 0 && cache.newest == NULL && cache.oldest == NULL);
+}
+
+static void _test_eviction(void)
+{
+	ecds_tessellation_cache_t cache;
+
+	/* Room for three rectangles */
+	ecds_tessellation_cache_initialize(&cache, 0, 3 * TEST_RECTANGLE_SIZE);
+
+	_test_rectangle(&cache, 1);
+	_test_rectangle(&cache, 2);
+	_test_rectangle(&cache, 3);
+	ECDS_TEST_CHECK(cache.memory == 3 * TEST_RECTANGLE_SIZE);
+	ECDS_TEST_CHECK(cache.evictions == 0);
+
+	/* Using the oldest makes the second one the least recently used */
+	_test_rectangle(&cache, 1);
+	_test_rectangle(&cache, 4);
+	ECDS_TEST_CHECK(cache.evictions == 1);
+	ECDS_TEST_CHECK(!_test_cached(&cache, 2));
+	ECDS_TEST_CHECK(_test_cached(&cache, 1) && _test_cached(&cache, 3) && _test_cached(&cache, 4));
+	ECDS_TEST_CHECK(cache.oldest->key.width == 3 && cache.newest->key.width == 4);
+	ECDS_TEST_CHECK(cache.memory <= cache.memory_limit);
+
+	/* Lowering the limit trims from the old end */
+	ecds_tessellation_cache_configure(&cache, 0, TEST_RECTANGLE_SIZE);
+	ECDS_TEST_CHECK(cache.evictions == 3);
+	ECDS_TEST_CHECK(cache.oldest == cache.newest && cache.newest->key.width == 4);
+
+	/* An entry larger than the limit is still returned, it is only evicted by the next one */
+	ECDS_TEST_CHECK(ecds_tessellation_cache_get(&cache, ECDS_RENDER_PARAM_ELLIPSE, 100, 100, 0, 0, 1) != NULL);
+	ECDS_TEST_CHECK(cache.oldest == cache.newest && cache.newest->key.primitive == ECDS_RENDER_PARAM_ELLIPSE);
+	ECDS_TEST_CHECK(cache.evictions == 4);
+
+	ecds_tessellation_cache_clear(&cache);
+}
+
+static void _test_segments(void)
+{
+	uint32_t small = ecds_tessellation_segments(0.1, 0.1, 360, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE);
+	uint32_t medium = ecds_tessellation_segments(100, 100, 360, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE);
+	uint32_t huge = ecds_tessellation_segments(1e9, 1e9, 360, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE);
+
+	ECDS_TEST_CHECK(small == ECDS_TESSELLATION_MIN_SEGMENTS);
+	ECDS_TEST_CHECK(medium > small && medium < huge);
+	ECDS_TEST_CHECK(huge == ECDS_TESSELLATION_MAX_SEGMENTS);
+	ECDS_TEST_CHECK(ecds_tessellation_segments(NAN, 1, 360, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE) == ECDS_TESSELLATION_MIN_SEGMENTS);
+
+	/* Arcs get their share of the full ellipse, but at least two segments */
+	ECDS_TEST_CHECK(ecds_tessellation_segments(100, 100, 90, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE) == (medium + 3) / 4);
+	ECDS_TEST_CHECK(ecds_tessellation_segments(100, 100, 0.001, 1, ECDS_TESSELLATION_DEFAULT_TOLERANCE) == 2);
+}
+
+int main(void)
+{
+	ecds_log_set_level(ECDS_WARN);
+
+	_test_hits();
+	_test_eviction();
+	_test_segments();
+
+	return ECDS_TEST_RESULT();
+}
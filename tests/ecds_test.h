@@ -0,0 +1,35 @@
+/*****************************************************************************/
+/*	@file ecds_test.h														 */
+/*	@brief Checks shared by the ECDS tests.									 */
+/*																			 */
+/*	Every test is a program that is registered with CTest. A failed check	 */
+/*	is reported with its location and the test keeps going, so one run		 */
+/*	shows all failures. main() returns ECDS_TEST_RESULT().					 */
+/*																			 */
+/*****************************************************************************/
+
+#ifndef _ECDS_TEST_H
+#define _ECDS_TEST_H
+
+#include <stdio.h>
+
+#include <ecds.h>
+
+//!<	Type of the objects the tests create, outside the ranges ECDS uses.
+#define ECDS_TYPE_TEST_OBJECT		0x0FFFFFF1
+
+static int ecds_test_failures = 0;
+
+#define ECDS_TEST_CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			ecds_test_failures++; \
+		} \
+	} while (0)
+
+//!<	Exit status of a test program, 0 when every check passed.
+#define ECDS_TEST_RESULT()			(ecds_test_failures ? 1 : 0)
+
+#endif /* _ECDS_TEST_H */